@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "DistGrid.h"
+
+#include "run_benchmarks.h"
+
+#define N_SWEEPS 20
+
+static volatile double bench_dist_sink;
+
+/*********************************************************************
+* Face flux of the distributed face loops
+*********************************************************************/
+static void bench_dist_faces(const DualGrid *dualgrid, 
+                             const int *faces, int n_faces,
+                             const double *u, double *res)
+{
+  double (*norms)[2] = dualgrid->face_norms;
+  int    (*nbrs)[2]  = dualgrid->face_nbrs;
+  int i;
+
+  for ( i = 0; i < n_faces; i++ )
+  {
+    const int f  = faces[i];
+    const int p0 = nbrs[f][0];
+    const int p1 = nbrs[f][1];
+
+    const double flux = 0.5 * ( u[p0] + u[p1] ) 
+                      * ( norms[f][0] + norms[f][1] );
+
+    res[p0] += flux;
+    res[p1] -= flux;
+  }
+
+} /* bench_dist_faces() */
+
+/*********************************************************************
+* Writes a SFC-ordered benchmark grid with nx x ny cells on rank 0
+*********************************************************************/
+static int bench_dist_write(const char *path, int nx, int ny)
+{
+  int rank, status = ICF_SUCCESS;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if ( rank == 0 )
+  {
+    PrimaryGrid *primgrid = bench_create_primgrid(nx, ny);
+
+    status = PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT)
+          && PrimaryGrid_write_binary(primgrid, path);
+
+    PrimaryGrid_destroy( primgrid );
+  }
+
+  MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  return status;
+
+} /* bench_dist_write() */
+
+/*********************************************************************
+* Reads a grid on the first <n_ranks> ranks and runs face loops with
+* overlapped halo updates and a global residual norm per sweep.
+* Returns the maximum read time and time per sweep over all ranks
+* on rank 0.
+*********************************************************************/
+static int bench_dist_run(const char *path, BoundaryDef *bdry_def,
+                          int n_ranks, double *dt_read, double *dt_sweep)
+{
+  MPI_Comm comm;
+  int rank, i, status = ICF_SUCCESS;
+  double dt[2] = { 0.0, 0.0 }, dt_max[2] = { 0.0, 0.0 };
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_split(MPI_COMM_WORLD, rank < n_ranks ? 0 : MPI_UNDEFINED, 
+                 rank, &comm);
+
+  if ( comm != MPI_COMM_NULL )
+  {
+    DistGrid *dist = DistGrid_create(comm);
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+
+    status = DistGrid_read(dist, bdry_def, path);
+
+    dt[0] = MPI_Wtime() - t0;
+
+    if ( status )
+    {
+      const DualGrid *loc = dist->dualgrid;
+      double *u   = malloc(loc->n_elements * sizeof(double));
+      double *res = calloc(loc->n_elements, sizeof(double));
+      double  norm = 0.0;
+
+      for ( i = 0; i < loc->n_elements; i++ )
+        u[i] = loc->xy[i][0] + 2.0 * loc->xy[i][1];
+
+      MPI_Barrier(comm);
+      t0 = MPI_Wtime();
+
+      for ( i = 0; i < N_SWEEPS && status; i++ )
+      {
+        status = DistGrid_update_begin(dist, u, 1);
+
+        bench_dist_faces(loc, dist->inner_faces, dist->n_inner_faces, 
+                         u, res);
+
+        status = status && DistGrid_update_end(dist);
+
+        bench_dist_faces(loc, dist->halo_faces, dist->n_halo_faces, 
+                         u, res);
+
+        norm += DistGrid_residual_norm(dist, res, 1);
+      }
+
+      dt[1] = ( MPI_Wtime() - t0 ) / (double) N_SWEEPS;
+      bench_dist_sink += norm;
+
+      free( u );
+      free( res );
+    }
+
+    MPI_Allreduce(dt, dt_max, 2, MPI_DOUBLE, MPI_MAX, comm);
+    DistGrid_destroy( dist );
+    MPI_Comm_free(&comm);
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_LAND, 
+                MPI_COMM_WORLD);
+
+  *dt_read  = dt_max[0];
+  *dt_sweep = dt_max[1];
+
+  return status;
+
+} /* bench_dist_run() */
+
+/*********************************************************************
+* Strong scaling on a grid with n x n cells and weak scaling with 
+* n x n cells per rank for 1, 2, 4, ... ranks
+*********************************************************************/
+void run_benchmarks_DistGrid(int n)
+{
+  const char *path = "icf_bench_dist.grid";
+  BoundaryDef *bdry_def = BoundaryDef_create();
+  double dt_read, dt_sweep, dt_ref = 0.0;
+  int rank, n_ranks, np;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+  bdry_def->n_bdry_markers = 4;
+  bdry_def->bdry_markers   = calloc(4, sizeof(int));
+  bdry_def->bdry_types     = calloc(4, sizeof(BoundaryType));
+  bdry_def->bdry_markers[0] = 1; bdry_def->bdry_types[0] = INLET;
+  bdry_def->bdry_markers[1] = 2; bdry_def->bdry_types[1] = OUTLET;
+  bdry_def->bdry_markers[2] = 3; bdry_def->bdry_types[2] = WALL;
+  bdry_def->bdry_markers[3] = 4; bdry_def->bdry_types[3] = WALL;
+
+  if ( rank == 0 )
+  {
+    fprintf(stderr, "> DistGrid (%d ranks)\n", n_ranks);
+    fprintf(stderr, "  %-16s %5s %10s %9s %9s %10s\n", "Scaling", 
+        "Ranks", "Cells", "Read", "Sweep", "Efficiency");
+  }
+
+  /*------------------------------------------------------------------
+  | Strong scaling
+  ------------------------------------------------------------------*/
+  if ( !bench_dist_write(path, n, n) && rank == 0 )
+    fprintf(stderr, "  [WARNING] Failed to write the grid!\n");
+
+  for ( np = 1; np <= n_ranks; np *= 2 )
+  {
+    if ( !bench_dist_run(path, bdry_def, np, &dt_read, &dt_sweep) )
+    {
+      if ( rank == 0 )
+        fprintf(stderr, "  [WARNING] DistGrid_read() failed!\n");
+      continue;
+    }
+
+    if ( np == 1 )
+      dt_ref = dt_sweep;
+
+    if ( rank == 0 )
+      fprintf(stderr, "  %-16s %5d %10d %7.3lf s %7.4lf s %9.1lf%%\n",
+          "Strong", np, n * n, dt_read, dt_sweep, 
+          100.0 * dt_ref / ( np * dt_sweep ));
+  }
+
+  /*------------------------------------------------------------------
+  | Weak scaling
+  ------------------------------------------------------------------*/
+  for ( np = 1; np <= n_ranks; np *= 2 )
+  {
+    if ( !bench_dist_write(path, n * np, n) 
+      || !bench_dist_run(path, bdry_def, np, &dt_read, &dt_sweep) )
+    {
+      if ( rank == 0 )
+        fprintf(stderr, "  [WARNING] Weak scaling with %d ranks "
+                        "failed!\n", np);
+      continue;
+    }
+
+    if ( np == 1 )
+      dt_ref = dt_sweep;
+
+    if ( rank == 0 )
+      fprintf(stderr, "  %-16s %5d %10d %7.3lf s %7.4lf s %9.1lf%%\n",
+          "Weak", np, n * n * np, dt_read, dt_sweep, 
+          100.0 * dt_ref / dt_sweep);
+  }
+
+  if ( rank == 0 )
+    remove(path);
+
+  BoundaryDef_destroy( bdry_def );
+
+} /* run_benchmarks_DistGrid() */
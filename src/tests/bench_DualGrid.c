@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+
+#include "run_benchmarks.h"
+
+#define N_SWEEPS 10
+
+static volatile double bench_color_sink;
+
+/*********************************************************************
+* Flux computation of bench_face_loop() for a block of faces of 
+* one color
+*********************************************************************/
+typedef struct 
+{
+  const DualGrid *dualgrid;
+  const double   *u;
+  double         *res;
+} ColorBenchCtx;
+
+static void bench_color_task(void *ctx, 
+                             int   i_start, 
+                             int   i_end, 
+                             int   i_thread)
+{
+  ColorBenchCtx *c = ctx;
+  double (*norms)[2] = c->dualgrid->face_norms;
+  int    (*nbrs)[2]  = c->dualgrid->face_nbrs;
+  int f;
+
+  for ( f = i_start; f < i_end; f++ )
+  {
+    const int p0 = nbrs[f][0];
+    const int p1 = nbrs[f][1];
+
+    const double flux = 0.5 * ( c->u[p0] + c->u[p1] ) 
+                      * ( norms[f][0] + norms[f][1] );
+
+    c->res[p0] += flux;
+    c->res[p1] -= flux;
+  }
+
+} /* bench_color_task() */
+
+/*********************************************************************
+* Colored face loop on <pool>. Returns the time per sweep in seconds.
+*********************************************************************/
+static double bench_color_loop(DualGrid *dualgrid, ThreadPool *pool, 
+                               int n_sweeps)
+{
+  const int n_elems = dualgrid->n_elements;
+  double *u   = malloc(n_elems * sizeof(double));
+  double *res = calloc(n_elems, sizeof(double));
+  int i;
+
+  for ( i = 0; i < n_elems; i++ )
+    u[i] = dualgrid->xy[i][0] + 2.0 * dualgrid->xy[i][1];
+
+  ColorBenchCtx ctx = { dualgrid, u, res };
+
+  double t0 = bench_time();
+
+  for ( i = 0; i < n_sweeps; i++ )
+    DualGrid_color_loop(dualgrid, pool, bench_color_task, &ctx);
+
+  double dt = ( bench_time() - t0 ) / (double) n_sweeps;
+
+  for ( i = 0; i < n_elems; i++ )
+    bench_color_sink += res[i];
+
+  free( u );
+  free( res );
+
+  return dt;
+
+} /* bench_color_loop() */
+
+/*********************************************************************
+* Centroid of a triangle
+*********************************************************************/
+static inline void calc_tri_centroid(const double coords[3][2],
+                                     double       center[2]) 
+{
+  center[0] = (coords[0][0] + coords[1][0] + coords[2][0]) / 3.0;
+  center[1] = (coords[0][1] + coords[1][1] + coords[2][1]) / 3.0;
+}
+
+/*********************************************************************
+* Edge centroids of a triangle
+*********************************************************************/
+static inline void calc_tri_edge_centroids(const double coords[3][2],
+                                           double       centroids[3][2])
+{
+  centroids[0][0] = 0.5 * ( coords[0][0] + coords[1][0] );
+  centroids[0][1] = 0.5 * ( coords[0][1] + coords[1][1] );
+
+  centroids[1][0] = 0.5 * ( coords[1][0] + coords[2][0] );
+  centroids[1][1] = 0.5 * ( coords[1][1] + coords[2][1] );
+
+  centroids[2][0] = 0.5 * ( coords[2][0] + coords[0][0] );
+  centroids[2][1] = 0.5 * ( coords[2][1] + coords[0][1] );
+}
+
+/*********************************************************************
+* Centroid of a quad
+*********************************************************************/
+static inline void calc_quad_centroid(const double coords[4][2],
+                                      double       center[2])
+{
+  center[0] = 0.25 * ( coords[0][0] + coords[1][0] 
+                     + coords[2][0] + coords[3][0] );
+  center[1] = 0.25 * ( coords[0][1] + coords[1][1] 
+                     + coords[2][1] + coords[3][1] );
+}
+
+/*********************************************************************
+* Edge centroids of a quad
+*********************************************************************/
+static inline void calc_quad_edge_centroids(const double coords[4][2],
+                                            double       centroids[4][2])
+{
+  centroids[0][0] = 0.5 * ( coords[0][0] + coords[1][0] );
+  centroids[0][1] = 0.5 * ( coords[0][1] + coords[1][1] );
+
+  centroids[1][0] = 0.5 * ( coords[1][0] + coords[2][0] );
+  centroids[1][1] = 0.5 * ( coords[1][1] + coords[2][1] );
+
+  centroids[2][0] = 0.5 * ( coords[2][0] + coords[3][0] );
+  centroids[2][1] = 0.5 * ( coords[2][1] + coords[3][1] );
+
+  centroids[3][0] = 0.5 * ( coords[3][0] + coords[0][0] );
+  centroids[3][1] = 0.5 * ( coords[3][1] + coords[0][1] );
+}
+
+
+/*********************************************************************
+* Reference implementation of the dualgrid metrics with separate 
+* loops over the tris and quads, which compute the sub-triangles 
+* of every element edge at runtime
+*********************************************************************/
+static void bench_metrics_reference(DualGrid *dualgrid)
+{
+  PrimaryGrid *primgrid = dualgrid->primgrid;
+
+  int n_tris  = primgrid->n_tris;
+  int n_quads = primgrid->n_quads;
+
+  int (*tris)[3]  = primgrid->tris;
+  int (*quads)[4] = primgrid->quads;
+
+  double (*v_coords)[2]   = primgrid->vertex_coords;
+  double  *vol            = dualgrid->vol;
+  double (*face_norms)[2] = dualgrid->face_norms;
+
+  const int *elem_face_ptr   = dualgrid->elem_face_ptr;
+  const int *elem_faces      = dualgrid->elem_faces;
+  const int *elem_face_signs = dualgrid->elem_face_signs;
+  const int *elem_nbrs       = dualgrid->elem_nbrs;
+
+  int i_tri, i_quad, i_edge, i_face, k;
+
+  for ( k = 0; k < dualgrid->n_elements; k++ )
+    vol[k] = 0.0;
+
+  for ( i_face = 0; i_face < dualgrid->n_intr_faces; i_face++ )
+    face_norms[i_face][0] = face_norms[i_face][1] = 0.0;
+
+
+  /*--------------------------------------------------------------------
+  | Compute dualgrid metrics that arise from triangular elements
+  --------------------------------------------------------------------*/
+  for ( i_tri = 0; i_tri < n_tris; i_tri++ )
+  {
+    int *tri = tris[i_tri];
+
+    double tri_coords[3][2] = {
+      { v_coords[tri[0]][0], v_coords[tri[0]][1] },
+      { v_coords[tri[1]][0], v_coords[tri[1]][1] },
+      { v_coords[tri[2]][0], v_coords[tri[2]][1] },
+    };
+
+    double tri_centroid[2]      = { 0.0 };
+    double edge_centroids[3][2] = { 0.0 };
+
+    calc_tri_centroid(tri_coords, tri_centroid);
+    calc_tri_edge_centroids(tri_coords, edge_centroids);
+
+    /* Loop over all triangle edges and compute forward sub-triangles */
+    for ( i_edge = 0; i_edge < 3; i_edge++ )
+    {
+      /* Local vertex indices -> range from 0 to 2 */ 
+      const int p0_loc = i_edge;
+      const int p1_loc = MOD(i_edge+1,3);
+      
+      /* Global vertex indices */
+      int p0 = tri[p0_loc];
+      int p1 = tri[p1_loc];
+
+      const double a0[2] = {
+        edge_centroids[i_edge][0] - tri_coords[p0_loc][0],
+        edge_centroids[i_edge][1] - tri_coords[p0_loc][1],
+      };
+
+      const double b0[2] = {
+        tri_centroid[0] - tri_coords[p0_loc][0],
+        tri_centroid[1] - tri_coords[p0_loc][1],
+      };
+
+
+      const double a1[2] = {
+        edge_centroids[i_edge][0] - tri_coords[p1_loc][0],
+        edge_centroids[i_edge][1] - tri_coords[p1_loc][1],
+      };
+
+      const double b1[2] = {
+        tri_centroid[0] - tri_coords[p1_loc][0],
+        tri_centroid[1] - tri_coords[p1_loc][1],
+      };
+
+      /* Sub-triangle area */
+      const double area0 = 0.5 * ( a0[0] * b0[1] - a0[1] * b0[0] ) ;
+      const double area1 = 0.5 * ( a1[0] * b1[1] - a1[1] * b1[0] ) ;
+
+      vol[p0] += area0;
+      vol[p1] -= area1;
+
+
+      /* Normal contribution of sub-triangle interface 
+       * --> Rotation in CCW */
+      const double norm[2] = {
+        -edge_centroids[i_edge][1] + tri_centroid[1],
+         edge_centroids[i_edge][0] - tri_centroid[0],
+      };
+
+      /* Find global index of current face and compute face normal 
+       * --> Normal points from p0 to p1 */
+      for ( k = elem_face_ptr[p0]; k < elem_face_ptr[p0+1]; k++ )
+      {
+        if ( elem_nbrs[k] == p1 )
+        {
+          i_face = elem_faces[k];
+          face_norms[i_face][0] += elem_face_signs[k] * norm[0];
+          face_norms[i_face][1] += elem_face_signs[k] * norm[1];
+          break;
+        }
+      }
+    } /* for ( i_edge = ... ) */
+  } /* for( i_tri = ... ) */
+
+  /*--------------------------------------------------------------------
+  | Compute dualgrid metrics that arise from quadrilateral elements
+  --------------------------------------------------------------------*/
+  for ( i_quad = 0; i_quad < n_quads; i_quad++ )
+  {
+    int *quad = quads[i_quad];
+
+    double quad_coords[4][2] = {
+      { v_coords[quad[0]][0], v_coords[quad[0]][1] },
+      { v_coords[quad[1]][0], v_coords[quad[1]][1] },
+      { v_coords[quad[2]][0], v_coords[quad[2]][1] },
+      { v_coords[quad[3]][0], v_coords[quad[3]][1] },
+    };
+
+    double quad_centroid[2]     = { 0.0 };
+    double edge_centroids[4][2] = { 0.0 };
+
+    calc_quad_centroid(quad_coords, quad_centroid);
+    calc_quad_edge_centroids(quad_coords, edge_centroids);
+
+    /* Loop over all quad edges and compute forward sub-triangles */
+    for ( i_edge = 0; i_edge < 4; i_edge++ )
+    {
+      /* Local vertex indices -> range from 0 to 2 */ 
+      const int p0_loc = i_edge;
+      const int p1_loc = MOD(i_edge+1,4);
+
+      /* Global vertex indices */
+      int p0 = quad[p0_loc];
+      int p1 = quad[p1_loc];
+
+      const double a0[2] = {
+        edge_centroids[i_edge][0] - quad_coords[p0_loc][0],
+        edge_centroids[i_edge][1] - quad_coords[p0_loc][1],
+      };
+
+      const double b0[2] = {
+        quad_centroid[0] - quad_coords[p0_loc][0],
+        quad_centroid[1] - quad_coords[p0_loc][1],
+      };
+
+
+      const double a1[2] = {
+        edge_centroids[i_edge][0] - quad_coords[p1_loc][0],
+        edge_centroids[i_edge][1] - quad_coords[p1_loc][1],
+      };
+
+      const double b1[2] = {
+        quad_centroid[0] - quad_coords[p1_loc][0],
+        quad_centroid[1] - quad_coords[p1_loc][1],
+      };
+
+      /* Sub-triangle area */
+      const double area0 = 0.5 * ( a0[0] * b0[1] - a0[1] * b0[0] ) ;
+      const double area1 = 0.5 * ( a1[0] * b1[1] - a1[1] * b1[0] ) ;
+
+      vol[p0] += area0;
+      vol[p1] -= area1;
+
+
+      /* Normal contribution of sub-triangle interface 
+       * --> Rotation in CCW */
+      const double norm[2] = {
+        -edge_centroids[i_edge][1] + quad_centroid[1],
+         edge_centroids[i_edge][0] - quad_centroid[0],
+      };
+
+      /* Find global index of current face and compute face normal 
+       * --> Normal points from p0 to p1 */
+      for ( k = elem_face_ptr[p0]; k < elem_face_ptr[p0+1]; k++ )
+      {
+        if ( elem_nbrs[k] == p1 )
+        {
+          i_face = elem_faces[k];
+          face_norms[i_face][0] += elem_face_signs[k] * norm[0];
+          face_norms[i_face][1] += elem_face_signs[k] * norm[1];
+          break;
+        }
+      }
+    } /* for ( i_edge = ... ) */
+  } /* for( i_quad = ... ) */
+
+} /* bench_metrics_reference() */
+
+/*********************************************************************
+* Computes the dualgrid metrics <n_sweeps> times with <metrics>.
+* Returns the time per sweep in seconds.
+*********************************************************************/
+static double bench_metrics(DualGrid *dualgrid, 
+                            void    (*metrics)(DualGrid *),
+                            int       n_sweeps)
+{
+  double t0 = bench_time();
+  int i;
+
+  for ( i = 0; i < n_sweeps; i++ )
+    metrics(dualgrid);
+
+  return ( bench_time() - t0 ) / n_sweeps;
+
+} /* bench_metrics() */
+
+/*********************************************************************
+* Wrapper of DualGrid_compute_metrics() for bench_metrics()
+*********************************************************************/
+static void bench_metrics_kernels(DualGrid *dualgrid)
+{
+  if ( !DualGrid_compute_metrics(dualgrid) )
+    fprintf(stderr, "  [WARNING] DualGrid_compute_metrics() failed!\n");
+
+} /* bench_metrics_kernels() */
+
+/*********************************************************************
+* Vertex orderings to compare
+*********************************************************************/
+#define N_ORDERINGS 3
+
+static const char *bench_order_names[N_ORDERINGS] = {
+  "Generator order",
+  "Shuffled",
+  "Reverse Cuthill-McKee",
+};
+
+/*********************************************************************
+* Face loop performance with the dualgrid faces in primary grid 
+* edge order and sorted by their elements
+*********************************************************************/
+void run_benchmarks_DualGrid(int n)
+{
+  int i;
+
+  fprintf(stderr, "> DualGrid\n");
+  fprintf(stderr, "  %-24s %9s %9s %9s %9s\n", "Ordering", "Faces", 
+      "Sort", "Sorted", "Row ptr");
+
+  for ( i = 0; i < N_ORDERINGS; i++ )
+  {
+    PrimaryGrid *primgrid = bench_create_primgrid(n, n);
+
+    if ( i > 0 )
+      bench_shuffle_primgrid(primgrid, 42u);
+    if ( i > 1 )
+      PrimaryGrid_renumber(primgrid, NULL, NULL);
+
+    DualGrid *dualgrid = bench_create_dualgrid(primgrid);
+
+    double dt_faces = bench_face_loop(dualgrid, N_SWEEPS);
+
+    double t0 = bench_time();
+    int status = DualGrid_sort_faces(dualgrid);
+    double dt_sort = bench_time() - t0;
+
+    if ( !status )
+      fprintf(stderr, "  [WARNING] DualGrid_sort_faces() failed!\n");
+
+    double dt_sorted = bench_face_loop(dualgrid, N_SWEEPS);
+    double dt_ptr    = bench_face_ptr_loop(dualgrid, N_SWEEPS);
+
+    fprintf(stderr, "  %-24s %7.4lf s %7.3lf s %7.4lf s %7.4lf s\n",
+        bench_order_names[i], dt_faces, dt_sort, dt_sorted, dt_ptr);
+
+    DualGrid_destroy( dualgrid );
+    PrimaryGrid_destroy( primgrid );
+  }
+
+  /*------------------------------------------------------------------
+  | Face coloring for race-free parallel face loops
+  ------------------------------------------------------------------*/
+  PrimaryGrid *primgrid = bench_create_primgrid(n, n);
+  DualGrid    *dualgrid = bench_create_dualgrid(primgrid);
+  int n_threads = ThreadPool_n_procs();
+  int block_sizes[2] = { 1, ICF_COLOR_BLOCK_SIZE };
+  int i_bs, balance;
+
+  DualGrid_sort_faces(dualgrid);
+
+  fprintf(stderr, "  %-24s %9s %9s %9s %9s\n", "Coloring", "Time", 
+      "Colors", "Imbalance", "Loop");
+  fprintf(stderr, "  %-24s %9s %9s %9s %7.4lf s\n", "Serial", 
+      "-", "-", "-", bench_face_loop(dualgrid, N_SWEEPS));
+
+  for ( i_bs = 0; i_bs < 2; i_bs++ )
+    for ( balance = 0; balance < 2; balance++ )
+    {
+      char name[64];
+
+      double t0 = bench_time();
+      int status = DualGrid_color_faces(dualgrid, block_sizes[i_bs], 
+                                        balance);
+      double dt = bench_time() - t0;
+
+      if ( !status )
+        fprintf(stderr, "  [WARNING] DualGrid_color_faces() failed!\n");
+
+      snprintf(name, sizeof(name), "Blocks of %d%s", block_sizes[i_bs],
+          balance ? ", balanced" : "");
+
+      fprintf(stderr, "  %-24s %7.3lf s %9d %9.3lf %7.4lf s\n", 
+          name, dt, dualgrid->n_colors, 
+          DualGrid_color_imbalance(dualgrid, NULL),
+          bench_color_loop(dualgrid, NULL, N_SWEEPS));
+    }
+
+  for ( i = 1; i <= n_threads; i *= 2 )
+  {
+    ThreadPool *pool = ThreadPool_create(i);
+    char name[64];
+
+    snprintf(name, sizeof(name), "Colored face loop (%d T)", i);
+    fprintf(stderr, "  %-37s %8.4lf s\n", name, 
+        bench_color_loop(dualgrid, pool, N_SWEEPS));
+
+    ThreadPool_destroy( pool );
+  }
+
+  /*------------------------------------------------------------------
+  | Dualgrid metrics computed per edge vs. by element kernels
+  ------------------------------------------------------------------*/
+  int n_elems = primgrid->n_tris + primgrid->n_quads;
+  int n_verts = dualgrid->n_elements;
+  int n_faces = dualgrid->n_intr_faces;
+  double *vol_ref = NULL;
+  double (*norm_ref)[2] = NULL;
+  double err = 0.0;
+
+  vol_ref  = calloc(n_verts, sizeof(double));
+  norm_ref = calloc(n_faces, sizeof(double[2]));
+
+  if ( !vol_ref || !norm_ref )
+  {
+    fprintf(stderr, "  [WARNING] Failed to allocate memory!\n");
+    free( vol_ref );
+    free( norm_ref );
+    DualGrid_destroy( dualgrid );
+    PrimaryGrid_destroy( primgrid );
+    return;
+  }
+
+  double dt_ref = bench_metrics(dualgrid, bench_metrics_reference, 
+                                N_SWEEPS);
+
+  for ( i = 0; i < n_verts; i++ )
+    vol_ref[i] = dualgrid->vol[i];
+  for ( i = 0; i < n_faces; i++ )
+  {
+    norm_ref[i][0] = dualgrid->face_norms[i][0];
+    norm_ref[i][1] = dualgrid->face_norms[i][1];
+  }
+
+  double dt_kernels = bench_metrics(dualgrid, bench_metrics_kernels, 
+                                    N_SWEEPS);
+
+  for ( i = 0; i < n_verts; i++ )
+    err = MAX(err, ABS(vol_ref[i] - dualgrid->vol[i]));
+  for ( i = 0; i < n_faces; i++ )
+  {
+    err = MAX(err, ABS(norm_ref[i][0] - dualgrid->face_norms[i][0]));
+    err = MAX(err, ABS(norm_ref[i][1] - dualgrid->face_norms[i][1]));
+  }
+
+  fprintf(stderr, "  %-24s %9s %9s %9s\n", "Metrics", "Time", 
+      "Elem/s", "Max diff");
+  fprintf(stderr, "  %-24s %7.4lf s %9.3le %9s\n", "Per edge", 
+      dt_ref, (double) n_elems / dt_ref, "-");
+  fprintf(stderr, "  %-24s %7.4lf s %9.3le %9.2le\n", "Element kernels", 
+      dt_kernels, (double) n_elems / dt_kernels, err);
+
+  double t_map = bench_time();
+
+  if ( !DualGrid_build_edge_faces(dualgrid) )
+    fprintf(stderr, "  [WARNING] DualGrid_build_edge_faces() failed!\n");
+
+  double dt_map = bench_time() - t_map;
+
+  fprintf(stderr, "  %-24s %7.4lf s %9.3le %9s\n", "Edge face map", 
+      dt_map, (double) n_elems / dt_map, "-");
+
+  /*------------------------------------------------------------------
+  | Dualgrid build with the element edge map looked up vs. taken 
+  | over from the primary grid topology
+  ------------------------------------------------------------------*/
+  double t_build = bench_time();
+  DualGrid *lookup = bench_create_dualgrid(primgrid);
+  double dt_lookup = bench_time() - t_build;
+
+  DualGrid_destroy( lookup );
+
+  if ( !PrimaryGrid_build_topology(primgrid, 1) )
+    fprintf(stderr, "  [WARNING] PrimaryGrid_build_topology() failed!\n");
+
+  t_build = bench_time();
+  DualGrid *taken = bench_create_dualgrid(primgrid);
+  double dt_taken = bench_time() - t_build;
+
+  DualGrid_destroy( taken );
+
+  fprintf(stderr, "  %-24s %7.4lf s %9.3le %9s\n", "Build, map looked up", 
+      dt_lookup, (double) n_elems / dt_lookup, "-");
+  fprintf(stderr, "  %-24s %7.4lf s %9.3le %9s\n", "Build, topology map", 
+      dt_taken, (double) n_elems / dt_taken, "-");
+
+  free( vol_ref );
+  free( norm_ref );
+
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+} /* run_benchmarks_DualGrid() */
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "GridCache.h"
+
+#include "run_benchmarks.h"
+
+#define N_CASES 3
+
+/*********************************************************************
+* Compare the startup time of a case with and without grid cache
+*********************************************************************/
+void run_benchmarks_GridCache(const char *bench_grid)
+{
+  const char *cache_dir = "icf_bench_cache";
+  const char *names[N_CASES] = { 
+    "Read mesh + DualGrid_build()",
+    "GridCache_load() - cache miss",
+    "GridCache_load() - cache hit",
+  };
+  uint64_t key = 0;
+  char path[1024];
+  int i;
+
+  fprintf(stderr, "> GridCache\n");
+
+  for ( i = 0; i < N_CASES; i++ )
+  {
+    DualGrid    *dualgrid = DualGrid_create();
+    PrimaryGrid *primgrid = PrimaryGrid_create();
+    BoundaryDef *bdry_def = dualgrid->boundaries->bdry_def;
+
+    bdry_def->n_bdry_markers = 4;
+    bdry_def->bdry_markers   = calloc(4, sizeof(int));
+    bdry_def->bdry_types     = calloc(4, sizeof(BoundaryType));
+    bdry_def->bdry_markers[0] = 1; bdry_def->bdry_types[0] = INLET;
+    bdry_def->bdry_markers[1] = 2; bdry_def->bdry_types[1] = OUTLET;
+    bdry_def->bdry_markers[2] = 3; bdry_def->bdry_types[2] = WALL;
+    bdry_def->bdry_markers[3] = 4; bdry_def->bdry_types[3] = WALL;
+
+    double t0 = bench_time();
+    int status = GridCache_load(dualgrid, primgrid, bdry_def, bench_grid,
+                                i > 0 ? cache_dir : NULL);
+    double dt = bench_time() - t0;
+
+    if ( !status )
+      fprintf(stderr, "  [WARNING] %s failed!\n", names[i]);
+    else
+      fprintf(stderr, "  %-37s %8.3lf s\n", names[i], dt);
+
+    if ( i == N_CASES - 1 )
+      GridCache_key(bench_grid, bdry_def, &key);
+
+    DualGrid_destroy( dualgrid );
+    PrimaryGrid_destroy( primgrid );
+  }
+
+  snprintf(path, sizeof(path), "%s/%016llx.grid", 
+           cache_dir, (unsigned long long) key);
+  remove(path);
+  snprintf(path, sizeof(path), "%s/%016llx.dual", 
+           cache_dir, (unsigned long long) key);
+  remove(path);
+  remove(cache_dir);
+
+} /* run_benchmarks_GridCache() */
@@ -0,0 +1,208 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Partition.h"
+#include "HaloExchange.h"
+
+#include "run_benchmarks.h"
+
+#define N_SWEEPS 20
+
+static volatile double bench_halo_sink;
+
+/*********************************************************************
+* Face flux of the benchmark loops
+*********************************************************************/
+static inline void bench_halo_faces(const DualGrid *dualgrid,
+                                    int i_start, int i_end,
+                                    const double *u, double *res)
+{
+  double (*norms)[2] = dualgrid->face_norms;
+  int    (*nbrs)[2]  = dualgrid->face_nbrs;
+  int f;
+
+  for ( f = i_start; f < i_end; f++ )
+  {
+    const int p0 = nbrs[f][0];
+    const int p1 = nbrs[f][1];
+
+    const double flux = 0.5 * ( u[p0] + u[p1] ) 
+                      * ( norms[f][0] + norms[f][1] );
+
+    res[p0] += flux;
+    res[p1] -= flux;
+  }
+
+} /* bench_halo_faces() */
+
+/*********************************************************************
+* Shared-memory thread model: Colored face loop on a thread pool
+*********************************************************************/
+typedef struct 
+{
+  const DualGrid *dualgrid;
+  const double   *u;
+  double         *res;
+} ThreadBenchCtx;
+
+static void bench_thread_task(void *ctx, int i_start, int i_end, 
+                              int i_thread)
+{
+  ThreadBenchCtx *c = ctx;
+  bench_halo_faces(c->dualgrid, i_start, i_end, c->u, c->res);
+
+} /* bench_thread_task() */
+
+static double bench_threads(DualGrid *dualgrid, int n_threads)
+{
+  const int n_elems = dualgrid->n_elements;
+  ThreadPool *pool = ThreadPool_create(n_threads);
+  double *u   = malloc(n_elems * sizeof(double));
+  double *res = calloc(n_elems, sizeof(double));
+  int i;
+
+  for ( i = 0; i < n_elems; i++ )
+    u[i] = dualgrid->xy[i][0] + 2.0 * dualgrid->xy[i][1];
+
+  ThreadBenchCtx ctx = { dualgrid, u, res };
+
+  double t0 = bench_time();
+
+  for ( i = 0; i < N_SWEEPS; i++ )
+    DualGrid_color_loop(dualgrid, pool, bench_thread_task, &ctx);
+
+  double dt = ( bench_time() - t0 ) / (double) N_SWEEPS;
+
+  for ( i = 0; i < n_elems; i++ )
+    bench_halo_sink += res[i];
+
+  ThreadPool_destroy( pool );
+  free( u );
+  free( res );
+
+  return dt;
+
+} /* bench_threads() */
+
+/*********************************************************************
+* Process model: Every worker runs the face loop on its local 
+* dualgrid and updates its ghosts afterwards. The time per sweep 
+* is measured between two barriers and returned through <dt>, which
+* is shared with the workers.
+*********************************************************************/
+typedef struct
+{
+  double *dt;
+} ProcBenchCtx;
+
+static int bench_proc_worker(HaloExchange *hx, void *ctx)
+{
+  ProcBenchCtx   *c        = ctx;
+  const DualGrid *dualgrid = hx->dualgrid;
+  const int       n_loc    = dualgrid->n_elements;
+  double *u   = malloc(n_loc * sizeof(double));
+  double *res = calloc(n_loc, sizeof(double));
+  int i, status = ICF_SUCCESS;
+
+  for ( i = 0; i < n_loc; i++ )
+    u[i] = dualgrid->xy[i][0] + 2.0 * dualgrid->xy[i][1];
+
+  if ( !HaloExchange_barrier(hx) )
+    status = ICF_ERROR;
+
+  double t0 = bench_time();
+
+  for ( i = 0; i < N_SWEEPS && status; i++ )
+  {
+    bench_halo_faces(dualgrid, 0, dualgrid->n_intr_faces, u, res);
+
+    if ( !HaloExchange_update(hx, u, 1) )
+      status = ICF_ERROR;
+  }
+
+  if ( status && !HaloExchange_barrier(hx) )
+    status = ICF_ERROR;
+
+  if ( hx->part == 0 )
+    *c->dt = ( bench_time() - t0 ) / (double) N_SWEEPS;
+
+  for ( i = 0; i < n_loc; i++ )
+    bench_halo_sink += res[i];
+
+  free( u );
+  free( res );
+
+  return status;
+
+} /* bench_proc_worker() */
+
+/*********************************************************************
+* Face loop performance of colored threads and forked partition 
+* workers with halo exchange
+*********************************************************************/
+void run_benchmarks_HaloExchange(int n)
+{
+  PrimaryGrid *primgrid  = bench_create_primgrid(n, n);
+  DualGrid    *dualgrid  = bench_create_dualgrid(primgrid);
+  Partition   *partition = Partition_create();
+  int n_procs = ThreadPool_n_procs();
+  int n_workers;
+
+  double *dt_proc = mmap(NULL, sizeof(double), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  if ( dt_proc == MAP_FAILED )
+  {
+    fprintf(stderr, "  [WARNING] Failed to map shared memory!\n");
+    dt_proc = NULL;
+  }
+
+  DualGrid_sort_faces(dualgrid);
+  DualGrid_color_faces(dualgrid, ICF_COLOR_BLOCK_SIZE, 1);
+
+  fprintf(stderr, "> HaloExchange (%d elements, %d faces)\n", 
+      dualgrid->n_elements, dualgrid->n_intr_faces);
+  fprintf(stderr, "  %-24s %9s %9s %9s\n", "Workers", "Threads", 
+      "Processes", "Startup");
+
+  for ( n_workers = 1; dt_proc && n_workers <= MAX(n_procs, 4); 
+        n_workers *= 2 )
+  {
+    ProcBenchCtx ctx = { dt_proc };
+    double dt_threads = bench_threads(dualgrid, n_workers);
+
+    *dt_proc = 0.0;
+
+    Partition_rcb(partition, dualgrid, NULL, n_workers);
+
+    double t0 = bench_time();
+    int status = HaloExchange_run(dualgrid, 
+                                  dualgrid->boundaries->bdry_def,
+                                  partition->part, n_workers, 1, NULL,
+                                  bench_proc_worker, &ctx);
+    double dt_run = bench_time() - t0;
+
+    if ( !status )
+      fprintf(stderr, "  [WARNING] HaloExchange_run() failed!\n");
+
+    fprintf(stderr, "  %-24d %7.4lf s %7.4lf s %7.3lf s\n",
+        n_workers, dt_threads, *dt_proc, 
+        dt_run - N_SWEEPS * *dt_proc);
+  }
+
+  if ( dt_proc )
+    munmap(dt_proc, sizeof(double));
+
+  Partition_destroy( partition );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+} /* run_benchmarks_HaloExchange() */
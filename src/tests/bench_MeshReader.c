@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "MeshReader.h"
+#include "PrimaryGrid.h"
+#include "ThreadPool.h"
+
+#include "run_benchmarks.h"
+
+#define N_LOADERS 5
+
+static const char *bench_grid_path = NULL;
+static char        bench_bin_path[1024];
+static char        bench_lean_path[1024];
+
+/*********************************************************************
+* The different mesh loaders to compare
+*********************************************************************/
+static PrimaryGrid *bench_load_lines(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create( path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_read_primgrid( mesh_reader, primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_stream(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create_stream( path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_stream_primgrid( mesh_reader, primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_mmap(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create_mmap( path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_stream_primgrid( mesh_reader, primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_parallel(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create_mmap( path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_read_primgrid_parallel( mesh_reader, primgrid, 0 );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_binary(const char *path)
+{
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  PrimaryGrid_read_binary( primgrid, bench_bin_path );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_lean(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create_mmap( bench_lean_path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_stream_primgrid( mesh_reader, primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+static PrimaryGrid *bench_load_lean_parallel(const char *path)
+{
+  MeshReader  *mesh_reader = MeshReader_create_mmap( bench_lean_path );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+
+  MeshReader_read_primgrid_parallel( mesh_reader, primgrid, 0 );
+  MeshReader_destroy( mesh_reader );
+
+  return primgrid;
+}
+
+typedef PrimaryGrid *BenchLoader(const char *path);
+
+static void bench_run_loader(void *ctx)
+{
+  BenchLoader *loader = *(BenchLoader **) ctx;
+  PrimaryGrid_destroy( loader(bench_grid_path) );
+}
+
+static void bench_run_nothing(void *ctx)
+{
+}
+
+static void bench_run_write_grid(void *ctx)
+{
+  int n = *(int *) ctx;
+  PrimaryGrid *primgrid = bench_create_primgrid(n, n);
+  bench_write_primgrid(bench_grid_path, primgrid, 0);
+  bench_write_primgrid(bench_lean_path, primgrid, 1);
+  PrimaryGrid_destroy( primgrid );
+
+  /* Binary grid is converted from the ASCII grid, as icf_mesh2bin   */
+  primgrid = bench_load_stream(bench_grid_path);
+  PrimaryGrid_write_binary(primgrid, bench_bin_path);
+  PrimaryGrid_destroy( primgrid );
+}
+
+/* Memory budget of the out-of-core conversion benchmark           */
+#define BENCH_CONVERT_BUDGET (16L * 1024L * 1024L)
+
+static void bench_run_convert_incore(void *ctx)
+{
+  PrimaryGrid *primgrid = bench_load_mmap(bench_grid_path);
+  PrimaryGrid_write_binary(primgrid, bench_bin_path);
+  PrimaryGrid_destroy( primgrid );
+}
+
+static void bench_run_convert_ooc(void *ctx)
+{
+  MeshReader_convert_binary(bench_grid_path, bench_bin_path, 
+                            BENCH_CONVERT_BUDGET);
+}
+
+/*********************************************************************
+* 
+*********************************************************************/
+void run_benchmarks_MeshReader(const char *bench_grid, int n)
+{
+  const char *names[N_LOADERS] = { 
+    "MeshReader_read_primgrid()",
+    "MeshReader_stream_primgrid()",
+    "MeshReader_create_mmap()",
+    "MeshReader_read_primgrid_parallel()",
+    "PrimaryGrid_read_binary()",
+  };
+  BenchLoader *loaders[N_LOADERS] = { 
+    bench_load_lines, 
+    bench_load_stream, 
+    bench_load_mmap,
+    bench_load_parallel,
+    bench_load_binary,
+  };
+  PrimaryGrid *grids[N_LOADERS];
+  long rss[N_LOADERS];
+  int i;
+
+  snprintf(bench_bin_path, sizeof(bench_bin_path), "%s.bin", bench_grid);
+  snprintf(bench_lean_path, sizeof(bench_lean_path), "%s.lean", 
+           bench_grid);
+
+  /* The grid is written by a child process, such that the memory   */
+  /* measurements are not biased by the heap of this process         */
+  bench_grid_path = bench_grid;
+  bench_peak_rss(bench_run_write_grid, &n);
+
+  double mb = (double) bench_file_size(bench_grid) / (1024.0 * 1024.0);
+
+  fprintf(stderr, "> MeshReader (%d vertices, %.1lf MB, %d threads)\n", 
+      (n+1)*(n+1), mb, ThreadPool_n_procs());
+
+  /* Peak memory of every loader, relative to an idle process. This  */
+  /* is done first, since children inherit the peak of this process */
+  for ( i = 0; i < N_LOADERS; i++ )
+    rss[i] = bench_peak_rss(bench_run_loader, &loaders[i])
+           - bench_peak_rss(bench_run_nothing, NULL);
+
+  long rss_in  = bench_peak_rss(bench_run_convert_incore, NULL)
+               - bench_peak_rss(bench_run_nothing, NULL);
+  long rss_ooc = bench_peak_rss(bench_run_convert_ooc, NULL)
+               - bench_peak_rss(bench_run_nothing, NULL);
+
+  for ( i = 0; i < N_LOADERS; i++ )
+  {
+    double t0 = bench_time();
+    grids[i]  = loaders[i](bench_grid);
+    double dt = bench_time() - t0;
+
+    fprintf(stderr, 
+        "  %-37s %8.3lf s  (%8.2lf MB/s, peak RSS +%7.1lf MB)\n",
+        names[i], dt, mb / dt, (double) rss[i] / 1024.0);
+  }
+
+  for ( i = 1; i < N_LOADERS; i++ )
+    if ( !bench_compare_primgrid(grids[0], grids[i]) )
+      fprintf(stderr, "  [WARNING] Grid of %s differs!\n", names[i]);
+
+  /*------------------------------------------------------------------
+  | ASCII to binary conversion: in-core vs. out-of-core 
+  ------------------------------------------------------------------*/
+  double t0 = bench_time();
+  bench_run_convert_incore(NULL);
+  double dt_in = bench_time() - t0;
+
+  t0 = bench_time();
+  bench_run_convert_ooc(NULL);
+  double dt_ooc = bench_time() - t0;
+
+  fprintf(stderr, 
+      "  %-37s %8.3lf s  (%8.2lf MB/s, peak RSS +%7.1lf MB)\n",
+      "Conversion in-core", dt_in, mb / dt_in, 
+      (double) rss_in / 1024.0);
+  fprintf(stderr, 
+      "  %-37s %8.3lf s  (%8.2lf MB/s, peak RSS +%7.1lf MB)\n",
+      "Conversion out-of-core (16 MB budget)", dt_ooc, mb / dt_ooc, 
+      (double) rss_ooc / 1024.0);
+
+  PrimaryGrid *converted = PrimaryGrid_create();
+
+  if ( !PrimaryGrid_read_binary(converted, bench_bin_path) 
+    || !bench_compare_primgrid(grids[0], converted) )
+    fprintf(stderr, "  [WARNING] Out-of-core conversion differs!\n");
+
+  PrimaryGrid_destroy( converted );
+
+  /*------------------------------------------------------------------
+  | Lean grid files: The connectivity is rebuilt from the elements 
+  | and the boundary markers instead of being parsed
+  ------------------------------------------------------------------*/
+  double mb_lean = (double) bench_file_size(bench_lean_path) 
+                 / (1024.0 * 1024.0);
+
+  fprintf(stderr, "  Lean grid file: %.1lf MB (%.0lf%% of full file)\n", 
+      mb_lean, 100.0 * mb_lean / mb);
+
+  BenchLoader *lean_loaders[2] = { 
+    bench_load_lean, bench_load_lean_parallel };
+  const char *lean_names[2] = {
+    "Lean file, stream_primgrid()",
+    "Lean file, read_primgrid_parallel()" };
+
+  for ( i = 0; i < 2; i++ )
+  {
+    t0 = bench_time();
+    PrimaryGrid *lean = lean_loaders[i](bench_grid);
+    double dt = bench_time() - t0;
+
+    fprintf(stderr, "  %-37s %8.3lf s\n", lean_names[i], dt);
+
+    if ( !bench_compare_primgrid(grids[0], lean) )
+      fprintf(stderr, "  [WARNING] Grid of %s differs!\n", lean_names[i]);
+
+    PrimaryGrid_destroy( lean );
+  }
+
+  for ( i = 1; i <= ThreadPool_n_procs(); i *= 2 )
+  {
+    t0 = bench_time();
+    PrimaryGrid_build_topology(grids[0], i);
+    double dt = bench_time() - t0;
+
+    char name[64];
+    snprintf(name, sizeof(name), "PrimaryGrid_build_topology() (%d T)", i);
+    fprintf(stderr, "  %-37s %8.3lf s\n", name, dt);
+  }
+
+  if ( !bench_compare_primgrid(grids[0], grids[1]) )
+    fprintf(stderr, "  [WARNING] Rebuilt connectivity differs!\n");
+
+  for ( i = 0; i < N_LOADERS; i++ )
+    PrimaryGrid_destroy( grids[i] );
+
+  remove(bench_bin_path);
+  remove(bench_lean_path);
+
+} /* run_benchmarks_MeshReader() */
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "bstrlib.h"
+#include "NumScan.h"
+
+#include "run_benchmarks.h"
+
+/*********************************************************************
+* Creates a buffer with <n_rows> rows of <n_vals> comma-separated 
+* doubles or integers, as they appear in mesh files. <padded> doubles
+* are right-aligned in columns of blanks.
+*********************************************************************/
+static char *bench_create_rows(int n_rows, int n_vals, int is_double,
+                               int padded, long *length)
+{
+  char *buffer = malloc( (size_t) n_rows * n_vals * 32 + 1 );
+  char *c      = buffer;
+  int i, k;
+
+  srand(42);
+
+  for ( i = 0; i < n_rows; i++ )
+    for ( k = 0; k < n_vals; k++ )
+    {
+      const char sep = ( k == n_vals - 1 ) ? '\n' : ',';
+
+      if ( is_double && padded )
+        c += sprintf(c, "%28.16le%c", 
+            (double) rand() / RAND_MAX * 100.0 - 50.0, sep);
+      else if ( is_double )
+        c += sprintf(c, "%.16lf%c", 
+            (double) rand() / RAND_MAX * 100.0 - 50.0, sep);
+      else
+        c += sprintf(c, "%d%c", rand() % 10000000 - 1, sep);
+    }
+
+  *length = (long) (c - buffer);
+
+  return buffer;
+
+} /* bench_create_rows() */
+
+/*********************************************************************
+* Current path of the line-based reader: bsplit() every row and 
+* convert every token with atof() / atoi()
+*********************************************************************/
+static void bench_rows_bsplit(struct bstrList *lines, int n_vals, 
+                              int is_double, double *out)
+{
+  int i, k;
+
+  for ( i = 0; i < lines->qty; i++ )
+  {
+    if ( lines->entry[i]->slen < 1 )
+      continue;
+
+    struct bstrList *values = bsplit(lines->entry[i], ',');
+
+    for ( k = 0; k < n_vals; k++ )
+      out[i*n_vals+k] = is_double 
+                      ? atof((char *) values->entry[k]->data)
+                      : (double) atoi((char *) values->entry[k]->data);
+
+    bstrListDestroy( values );
+  }
+
+} /* bench_rows_bsplit() */
+
+/*********************************************************************
+* In-place parsing with strtod() / strtol()
+*********************************************************************/
+static void bench_rows_strtod(const char *buffer, long length, 
+                              int n_vals, int is_double, double *out)
+{
+  const char *c   = buffer;
+  const char *end = buffer + length;
+  char *stop;
+  int   n = 0;
+
+  while ( c < end )
+  {
+    out[n++] = is_double ? strtod(c, &stop) : (double) strtol(c, &stop, 10);
+    c = stop + 1;
+  }
+
+} /* bench_rows_strtod() */
+
+/*********************************************************************
+* In-place parsing with NumScan
+*********************************************************************/
+static void bench_rows_numscan(const char *buffer, long length, 
+                               int n_vals, int is_double, double *out)
+{
+  const char *c   = buffer;
+  const char *end = buffer + length;
+  int ivals[8];
+  int i = 0, k;
+
+  while ( c < end )
+  {
+    if ( is_double )
+      NumScan_row_doubles(&c, end, &out[i*n_vals], n_vals);
+    else
+    {
+      NumScan_row_ints(&c, end, ivals, n_vals);
+      for ( k = 0; k < n_vals; k++ )
+        out[i*n_vals+k] = (double) ivals[k];
+    }
+    ++i;
+  }
+
+} /* bench_rows_numscan() */
+
+/*********************************************************************
+* Benchmark all number parsers on a given row type
+*********************************************************************/
+static void bench_NumScan_rows(const char *name, int n_rows, 
+                               int n_vals, int is_double, int padded)
+{
+  long length;
+  char *buffer = bench_create_rows(n_rows, n_vals, is_double, padded,
+                                   &length);
+  double mb = (double) length / (1024.0 * 1024.0);
+
+  double *ref = calloc( (size_t) n_rows * n_vals, sizeof(double) );
+  double *out = calloc( (size_t) n_rows * n_vals, sizeof(double) );
+
+  buffer[length] = '\0';
+  bstring txt = bfromcstr( buffer );
+  struct bstrList *lines = bsplit(txt, '\n');
+
+  double t0 = bench_time();
+  bench_rows_bsplit(lines, n_vals, is_double, ref);
+  double t_bsplit = bench_time() - t0;
+
+  t0 = bench_time();
+  bench_rows_strtod(buffer, length, n_vals, is_double, out);
+  double t_strtod = bench_time() - t0;
+
+  t0 = bench_time();
+  bench_rows_numscan(buffer, length, n_vals, is_double, out);
+  double t_numscan = bench_time() - t0;
+
+  fprintf(stderr, "  %-8s bsplit+ato*: %8.2lf MB/s | strto*: %8.2lf MB/s"
+                  " | NumScan: %8.2lf MB/s\n",
+      name, mb / t_bsplit, mb / t_strtod, mb / t_numscan);
+
+  if ( memcmp(ref, out, (size_t) n_rows * n_vals * sizeof(double)) != 0 )
+    fprintf(stderr, "  [WARNING] NumScan results differ!\n");
+
+  bstrListDestroy( lines );
+  bdestroy( txt );
+  free( ref );
+  free( out );
+  free( buffer );
+
+} /* bench_NumScan_rows() */
+
+/*********************************************************************
+* 
+*********************************************************************/
+void run_benchmarks_NumScan(int n)
+{
+  int n_rows = (n+1) * (n+1);
+
+  fprintf(stderr, "> NumScan (%d rows)\n", n_rows);
+
+  bench_NumScan_rows("doubles", n_rows, 2, 1, 0);
+  bench_NumScan_rows("padded",  n_rows, 2, 1, 1);
+  bench_NumScan_rows("ints",    n_rows, 4, 0, 0);
+
+} /* run_benchmarks_NumScan() */
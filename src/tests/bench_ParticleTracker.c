@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "ThreadPool.h"
+#include "ParticleTracker.h"
+
+#include "run_benchmarks.h"
+
+#define N_PARTICLES 1000000
+#define N_STEPS     10
+
+/*********************************************************************
+* Advances the particles by N_STEPS time steps in a solid body 
+* rotation and returns the number of particle steps per second
+*********************************************************************/
+static double bench_particle_steps(ParticleTracker *tracker,
+                                   ThreadPool      *pool,
+                                   const double    *u_field,
+                                   const double    *v_field,
+                                   double           dt)
+{
+  const int n_particles = tracker->n_particles;
+  double t0 = bench_time();
+  int step;
+
+  for ( step = 0; step < N_STEPS; step++ )
+    if ( !ParticleTracker_step(tracker, pool, u_field, v_field, dt) )
+      fprintf(stderr, "  [WARNING] ParticleTracker_step() failed!\n");
+
+  return (double) N_STEPS * n_particles / ( bench_time() - t0 );
+
+} /* bench_particle_steps() */
+
+/*********************************************************************
+* Throughput of the particle steps on a grid with n x n cells for 
+* particles in random order and sorted by their host elements on 
+* 1, 2, 4, ... threads
+*********************************************************************/
+void run_benchmarks_ParticleTracker(int n)
+{
+  const int    n_threads = ThreadPool_n_procs();
+  const double dt        = 0.5 / n;
+
+  PrimaryGrid     *primgrid = bench_create_primgrid(n, n);
+  BoundaryDef     *bdry_def = BoundaryDef_create();
+  ParticleTracker *tracker  = ParticleTracker_create();
+  double (*xy)[2] = malloc(N_PARTICLES * sizeof(*xy));
+  double  *u_field = malloc(primgrid->n_vertices * sizeof(double));
+  double  *v_field = malloc(primgrid->n_vertices * sizeof(double));
+  unsigned seed = 12345u;
+  int i, sorted;
+
+  if ( !PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT) )
+    fprintf(stderr, "  [WARNING] PrimaryGrid_reorder_sfc() failed!\n");
+
+  /* All boundaries are walls, such that the particles are kept      */
+  bdry_def->n_bdry_markers = 4;
+  bdry_def->bdry_markers   = calloc(4, sizeof(int));
+  bdry_def->bdry_types     = calloc(4, sizeof(BoundaryType));
+
+  for ( i = 0; i < 4; i++ )
+  {
+    bdry_def->bdry_markers[i] = i + 1;
+    bdry_def->bdry_types[i]   = WALL;
+  }
+
+  if ( !ParticleTracker_init(tracker, primgrid, bdry_def) )
+    fprintf(stderr, "  [WARNING] ParticleTracker_init() failed!\n");
+
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+  {
+    u_field[i] = 0.5 - primgrid->vertex_coords[i][1];
+    v_field[i] = primgrid->vertex_coords[i][0] - 0.5;
+  }
+
+  for ( i = 0; i < N_PARTICLES; i++ )
+  {
+    seed = seed * 1103515245u + 12345u;
+    xy[i][0] = (double) ( seed >> 8 ) / (double) ( 1u << 24 );
+    seed = seed * 1103515245u + 12345u;
+    xy[i][1] = (double) ( seed >> 8 ) / (double) ( 1u << 24 );
+  }
+
+  fprintf(stderr, "> ParticleTracker (%d elements, %d particles)\n", 
+      primgrid->n_quads + primgrid->n_tris, N_PARTICLES);
+  fprintf(stderr, "  %-28s %14s\n", "Step", "Particles/s");
+
+  for ( sorted = 0; sorted < 2; sorted++ )
+    for ( i = 1; i <= n_threads; i *= 2 )
+    {
+      ThreadPool *pool = ( i > 1 ) ? ThreadPool_create(i) : NULL;
+      char name[64];
+
+      /* Restart from the random initial positions                   */
+      if ( !ParticleTracker_init(tracker, primgrid, bdry_def) 
+        || !ParticleTracker_add(tracker, N_PARTICLES, 
+                                (const double (*)[2]) xy, NULL) )
+        fprintf(stderr, "  [WARNING] ParticleTracker_add() failed!\n");
+
+      if ( sorted && !ParticleTracker_compact(tracker) )
+        fprintf(stderr, "  [WARNING] ParticleTracker_compact() failed!\n");
+
+      snprintf(name, sizeof(name), "%s (%d T)", 
+          sorted ? "Sorted" : "Random order", i);
+      fprintf(stderr, "  %-28s %14.3e\n", name, 
+          bench_particle_steps(tracker, pool, u_field, v_field, dt));
+
+      if ( pool )
+        ThreadPool_destroy( pool );
+    }
+
+  free( xy );
+  free( u_field );
+  free( v_field );
+  ParticleTracker_destroy( tracker );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+} /* run_benchmarks_ParticleTracker() */
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Partition.h"
+
+#include "run_benchmarks.h"
+
+#define N_PART_CASES 3
+
+/*********************************************************************
+* Run time, edge-cut and imbalance of the partitioners
+*********************************************************************/
+void run_benchmarks_Partition(int n)
+{
+  static const int n_parts[N_PART_CASES] = { 4, 16, 64 };
+
+  PrimaryGrid *primgrid  = bench_create_primgrid(n, n);
+  DualGrid    *dualgrid  = bench_create_dualgrid(primgrid);
+  Partition   *partition = Partition_create();
+  int *bdry_weights = Partition_boundary_weights(dualgrid, 4);
+  int i, method;
+
+  fprintf(stderr, "> Partition (%d elements, %d faces)\n", 
+      dualgrid->n_elements, dualgrid->n_intr_faces);
+  fprintf(stderr, "  %-24s %5s %9s %9s %9s\n", "Method", "Parts", 
+      "Time", "Edge-cut", "Imbalance");
+
+  for ( method = 0; method < 3; method++ )
+    for ( i = 0; i < N_PART_CASES; i++ )
+    {
+      const char *names[3] = { 
+        "RCB", "K-way", "K-way (boundary x4)" };
+      const int *weights = ( method == 2 ) ? bdry_weights : NULL;
+      int status;
+
+      double t0 = bench_time();
+      if ( method == 0 )
+        status = Partition_rcb(partition, dualgrid, weights, n_parts[i]);
+      else
+        status = Partition_kway(partition, dualgrid, weights, n_parts[i]);
+      double dt = bench_time() - t0;
+
+      if ( !status )
+        fprintf(stderr, "  [WARNING] %s failed!\n", names[method]);
+
+      fprintf(stderr, "  %-24s %5d %7.3lf s %9ld %9.3lf\n", 
+          names[method], n_parts[i], dt, partition->edge_cut, 
+          partition->imbalance);
+    }
+
+  free( bdry_weights );
+  Partition_destroy( partition );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+} /* run_benchmarks_Partition() */
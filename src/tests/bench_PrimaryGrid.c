@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+
+#include "run_benchmarks.h"
+
+#define N_SWEEPS 10
+
+/*********************************************************************
+* Checks, that the vertex coordinates of a renumbered grid match the
+* original grid through <vertex_order>
+*********************************************************************/
+static int bench_check_order(PrimaryGrid *grid, PrimaryGrid *orig)
+{
+  int i;
+
+  for ( i = 0; i < grid->n_vertices; i++ )
+  {
+    const int j = grid->vertex_order[i];
+
+    if ( grid->vertex_coords[i][0] != orig->vertex_coords[j][0] 
+      || grid->vertex_coords[i][1] != orig->vertex_coords[j][1] )
+      return ICF_FALSE;
+  }
+
+  return ICF_TRUE;
+}
+
+/*********************************************************************
+* Vertex orderings to compare
+*********************************************************************/
+#define N_ORDERINGS 5
+
+static const char *bench_order_names[N_ORDERINGS] = {
+  "Generator order",
+  "Shuffled",
+  "Reverse Cuthill-McKee",
+  "Morton curve",
+  "Hilbert curve",
+};
+
+static void bench_reorder(PrimaryGrid *grid, int ordering)
+{
+  switch ( ordering )
+  {
+    case 2: 
+      PrimaryGrid_renumber(grid, NULL, NULL);
+      break;
+    case 3: 
+      PrimaryGrid_reorder_sfc(grid, ICF_SFC_MORTON);
+      break;
+    case 4: 
+      PrimaryGrid_reorder_sfc(grid, ICF_SFC_HILBERT);
+      break;
+  }
+}
+
+/*********************************************************************
+* Edge and element loop performance for different vertex numberings
+*********************************************************************/
+void run_benchmarks_PrimaryGrid(int n)
+{
+  PrimaryGrid *orig = bench_create_primgrid(n, n);
+  int i;
+
+  fprintf(stderr, "> PrimaryGrid (%d vertices, %d interior edges)\n", 
+      orig->n_vertices, orig->n_intr_edges);
+  fprintf(stderr, "  %-24s %9s %9s %9s %9s\n", "Ordering", "Reorder", 
+      "Edges", "Elements", "Bandwidth");
+
+  for ( i = 0; i < N_ORDERINGS; i++ )
+  {
+    PrimaryGrid *grid = bench_create_primgrid(n, n);
+
+    if ( i > 0 )
+      bench_shuffle_primgrid(grid, 42u);
+
+    double t0 = bench_time();
+    bench_reorder(grid, i);
+    double dt_order = bench_time() - t0;
+
+    double dt_edges = bench_edge_loop(grid, N_SWEEPS);
+    double dt_elems = bench_elem_loop(grid, N_SWEEPS);
+
+    fprintf(stderr, "  %-24s %7.3lf s %7.4lf s %7.4lf s %9d\n",
+        bench_order_names[i], dt_order, dt_edges, dt_elems, 
+        PrimaryGrid_bandwidth(grid));
+
+    if ( i > 0 && !bench_check_order(grid, orig) )
+      fprintf(stderr, "  [WARNING] Vertex order of %s is invalid!\n",
+          bench_order_names[i]);
+
+    PrimaryGrid_destroy( grid );
+  }
+
+  PrimaryGrid_destroy( orig );
+
+} /* run_benchmarks_PrimaryGrid() */
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "SpatialIndex.h"
+
+#include "run_benchmarks.h"
+
+#define N_QUERIES     1000000
+#define N_BRUTE_FORCE 200
+
+static volatile long bench_spatial_sink;
+
+/*********************************************************************
+* Brute-force point location over all elements, which checks the
+* point against every element edge
+*********************************************************************/
+static int bench_locate_brute_force(const PrimaryGrid *primgrid,
+                                    double x, double y)
+{
+  const double (*xy)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  int e, k;
+
+  for ( e = 0; e < primgrid->n_quads + primgrid->n_tris; e++ )
+  {
+    const int *v = ( e < primgrid->n_quads ) 
+                 ? primgrid->quads[e] 
+                 : primgrid->tris[e - primgrid->n_quads];
+    const int  n = ( e < primgrid->n_quads ) ? 4 : 3;
+    int n_pos = 0, n_neg = 0;
+
+    for ( k = 0; k < n; k++ )
+    {
+      const double *a = xy[v[k]];
+      const double *b = xy[v[(k+1) % n]];
+      const double  c = ( b[0] - a[0] ) * ( y - a[1] ) 
+                      - ( b[1] - a[1] ) * ( x - a[0] );
+      n_pos += ( c > 0.0 );
+      n_neg += ( c < 0.0 );
+    }
+
+    if ( n_pos == 0 || n_neg == 0 )
+      return e;
+  }
+
+  return -1;
+
+} /* bench_locate_brute_force() */
+
+/*********************************************************************
+* Build time and query throughput of the spatial index for random 
+* query points and coherent points along probe lines. The grid is 
+* reordered along a Hilbert curve, such that neighbor walks stay 
+* local in memory.
+*********************************************************************/
+void run_benchmarks_SpatialIndex(int n)
+{
+  PrimaryGrid  *primgrid = bench_create_primgrid(n, n);
+  SpatialIndex *index    = SpatialIndex_create();
+  double (*xy)[2]      = malloc(N_QUERIES * sizeof(*xy));
+  double (*xy_path)[2] = malloc(N_QUERIES * sizeof(*xy_path));
+  const double (*xy_rnd)[2] = (const double (*)[2]) xy;
+  int     *res    = malloc(N_QUERIES * sizeof(int));
+  unsigned seed   = 12345u;
+  long     sum    = 0;
+  double   t0, dt;
+  int i;
+
+  for ( i = 0; i < N_QUERIES; i++ )
+  {
+    seed = seed * 1103515245u + 12345u;
+    xy[i][0] = (double) ( seed >> 8 ) / (double) ( 1u << 24 );
+    seed = seed * 1103515245u + 12345u;
+    xy[i][1] = (double) ( seed >> 8 ) / (double) ( 1u << 24 );
+  }
+
+  if ( !PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT) )
+    fprintf(stderr, "  [WARNING] PrimaryGrid_reorder_sfc() failed!\n");
+
+  fprintf(stderr, "> SpatialIndex (%d elements, %d vertices)\n", 
+      primgrid->n_quads + primgrid->n_tris, primgrid->n_vertices);
+
+  t0 = bench_time();
+  if ( !SpatialIndex_build(index, primgrid) )
+    fprintf(stderr, "  [WARNING] SpatialIndex_build() failed!\n");
+  dt = bench_time() - t0;
+
+  fprintf(stderr, "  %-28s %7.3lf s (%d nodes)\n", "Build", dt, 
+      index->n_nodes);
+  fprintf(stderr, "  %-28s %9s %12s\n", "Query", "Time", "Queries/s");
+
+  /*------------------------------------------------------------------
+  | Brute-force location of a few points as reference
+  ------------------------------------------------------------------*/
+  t0 = bench_time();
+  for ( i = 0; i < N_BRUTE_FORCE; i++ )
+    sum += bench_locate_brute_force(primgrid, xy[i][0], xy[i][1]);
+  dt = bench_time() - t0;
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Locate (brute force)", 
+      dt, N_BRUTE_FORCE / dt);
+
+  /*------------------------------------------------------------------
+  | Single and batched queries
+  ------------------------------------------------------------------*/
+  t0 = bench_time();
+  for ( i = 0; i < N_QUERIES; i++ )
+    sum += SpatialIndex_locate(index, xy[i][0], xy[i][1]);
+  dt = bench_time() - t0;
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Locate", 
+      dt, N_QUERIES / dt);
+
+  t0 = bench_time();
+  if ( !SpatialIndex_locate_batch(index, N_QUERIES, 
+                                  (const double (*)[2]) xy, res) )
+    fprintf(stderr, "  [WARNING] SpatialIndex_locate_batch() failed!\n");
+  dt = bench_time() - t0;
+  sum += res[N_QUERIES-1];
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Locate (batch)", 
+      dt, N_QUERIES / dt);
+
+  /*------------------------------------------------------------------
+  | Coherent stream of points along 1000 random probe lines
+  ------------------------------------------------------------------*/
+  for ( i = 0; i < N_QUERIES; i++ )
+  {
+    const int    line = i / ( N_QUERIES / 1000 );
+    const double t    = (double) ( i % ( N_QUERIES / 1000 ) ) 
+                      / ( N_QUERIES / 1000 );
+    const double *p0  = xy_rnd[2 * line];
+    const double *p1  = xy_rnd[2 * line + 1];
+
+    xy_path[i][0] = p0[0] + t * ( p1[0] - p0[0] );
+    xy_path[i][1] = p0[1] + t * ( p1[1] - p0[1] );
+  }
+
+  t0 = bench_time();
+  for ( i = 0; i < N_QUERIES; i++ )
+    sum += SpatialIndex_locate(index, xy_path[i][0], xy_path[i][1]);
+  dt = bench_time() - t0;
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Probe lines (tree)", 
+      dt, N_QUERIES / dt);
+
+  t0 = bench_time();
+  SpatialIndex_locate_path(index, N_QUERIES, 
+                           (const double (*)[2]) xy_path, -1, res);
+  dt = bench_time() - t0;
+  sum += res[N_QUERIES-1];
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Probe lines (walk)", 
+      dt, N_QUERIES / dt);
+
+  t0 = bench_time();
+  for ( i = 0; i < N_QUERIES; i++ )
+    sum += SpatialIndex_nearest_vertex(index, xy[i][0], xy[i][1]);
+  dt = bench_time() - t0;
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Nearest vertex", 
+      dt, N_QUERIES / dt);
+
+  t0 = bench_time();
+  if ( !SpatialIndex_nearest_vertex_batch(index, N_QUERIES, 
+                                          (const double (*)[2]) xy, res) )
+    fprintf(stderr, "  [WARNING] SpatialIndex_nearest_vertex_batch() "
+                    "failed!\n");
+  dt = bench_time() - t0;
+  sum += res[N_QUERIES-1];
+
+  fprintf(stderr, "  %-28s %7.3lf s %12.3e\n", "Nearest vertex (batch)", 
+      dt, N_QUERIES / dt);
+
+  bench_spatial_sink = sum;
+
+  free( xy );
+  free( xy_path );
+  free( res );
+  SpatialIndex_destroy( index );
+  PrimaryGrid_destroy( primgrid );
+
+} /* run_benchmarks_SpatialIndex() */
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "run_benchmarks.h"
+
+/*********************************************************************
+* The main function
+*
+* Usage: run_benchmarks [N] [grid-file]
+*   N         : The benchmark grid consists of N x N cells
+*   grid-file : Location, where the benchmark grid is written to
+*********************************************************************/
+int main(int argc, char *argv[])
+{
+  int n = 500;
+  const char *bench_grid = "icf_bench_grid.dat";
+
+  if ( argc > 1 )
+    n = atoi(argv[1]);
+  if ( argc > 2 )
+    bench_grid = argv[2];
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "==============================================\n");
+  fprintf(stderr, "INCOMFLOW BENCHMARKS (%d x %d cells)\n", n, n);
+  fprintf(stderr, "==============================================\n");
+  fprintf(stderr, "\n");
+
+  run_benchmarks_NumScan(n);
+  run_benchmarks_MeshReader(bench_grid, n);
+  run_benchmarks_GridCache(bench_grid);
+  run_benchmarks_PrimaryGrid(n);
+  run_benchmarks_DualGrid(n);
+  run_benchmarks_Partition(n);
+  run_benchmarks_HaloExchange(n);
+  run_benchmarks_SpatialIndex(n);
+  run_benchmarks_ParticleTracker(n);
+
+  remove(bench_grid);
+
+  return EXIT_SUCCESS;
+}
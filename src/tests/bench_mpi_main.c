@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "run_benchmarks.h"
+
+/*********************************************************************
+* The main function of the MPI benchmarks
+*
+* Usage: mpirun -np P run_benchmarks_mpi [N]
+*   N : The strong scaling grid consists of N x N cells, the weak 
+*       scaling grids of N x N cells per rank
+*********************************************************************/
+int main(int argc, char *argv[])
+{
+  int n = 500;
+  int rank;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if ( argc > 1 )
+    n = atoi(argv[1]);
+
+  if ( rank == 0 )
+  {
+    fprintf(stderr, "\n");
+    fprintf(stderr, "==============================================\n");
+    fprintf(stderr, "INCOMFLOW MPI BENCHMARKS (%d x %d cells)\n", n, n);
+    fprintf(stderr, "==============================================\n");
+    fprintf(stderr, "\n");
+  }
+
+  run_benchmarks_DistGrid(n);
+
+  MPI_Finalize();
+
+  return EXIT_SUCCESS;
+}
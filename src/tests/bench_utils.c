@@ -0,0 +1,733 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+
+#include "run_benchmarks.h"
+
+/*********************************************************************
+* Returns the current wall clock time in seconds
+*********************************************************************/
+double bench_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + 1.0E-9 * (double) ts.tv_nsec;
+
+} /* bench_time() */
+
+/*********************************************************************
+* Returns the size of a file in bytes
+*********************************************************************/
+long bench_file_size(const char *path)
+{
+  FILE *fptr = fopen(path, "rb");
+
+  if ( !fptr )
+    return 0;
+
+  fseek(fptr, 0, SEEK_END);
+  long length = ftell(fptr);
+  fclose(fptr);
+
+  return length;
+
+} /* bench_file_size() */
+
+/*********************************************************************
+* Returns the value of a "<key>: <value> kB" entry of 
+* /proc/self/status, or -1 if it is not available
+*********************************************************************/
+static long bench_proc_status(const char *key)
+{
+  char  line[256];
+  long  value = -1;
+  FILE *fptr  = fopen("/proc/self/status", "r");
+
+  if ( !fptr )
+    return -1;
+
+  while ( fgets(line, sizeof(line), fptr) )
+    if ( strncmp(line, key, strlen(key)) == 0 )
+      value = atol(line + strlen(key) + 1);
+
+  fclose(fptr);
+
+  return value;
+
+} /* bench_proc_status() */
+
+/*********************************************************************
+* Runs <fn> in a child process and returns its peak resident set 
+* size in kB.
+* Freed heap memory of the parent stays resident in the child, such
+* that allocations in <fn> would not raise the peak. If possible, 
+* this memory is therefore released first and the peak is counted 
+* from there on.
+*********************************************************************/
+long bench_peak_rss(void (*fn)(void *ctx), void *ctx)
+{
+  struct rusage usage;
+  int  status;
+  int  fds[2];
+  long peak = -1;
+
+  if ( pipe(fds) != 0 )
+    return -1;
+
+  pid_t pid = fork();
+
+  if ( pid < 0 )
+    return -1;
+
+  if ( pid == 0 )
+  {
+    close(fds[0]);
+
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+
+    /* Reset the peak resident set size to the current one */
+    FILE *fptr = fopen("/proc/self/clear_refs", "w");
+    if ( fptr )
+    {
+      fputs("5", fptr);
+      fclose(fptr);
+    }
+
+    fn(ctx);
+
+    peak = bench_proc_status("VmHWM:");
+    if ( write(fds[1], &peak, sizeof(long)) != sizeof(long) )
+      _exit(EXIT_FAILURE);
+
+    _exit(EXIT_SUCCESS);
+  }
+
+  close(fds[1]);
+
+  if ( read(fds[0], &peak, sizeof(long)) != sizeof(long) )
+    peak = -1;
+
+  close(fds[0]);
+
+  if ( wait4(pid, &status, 0, &usage) < 0 )
+    return -1;
+
+  return peak > 0 ? peak : usage.ru_maxrss;
+
+} /* bench_peak_rss() */
+
+/*********************************************************************
+* Simple linear congruential generator for reproducible shuffles
+*********************************************************************/
+static inline unsigned bench_rand(unsigned *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return *state >> 8;
+}
+
+/*********************************************************************
+* Shuffles the vertex numbering and the order of the interior edges
+* of a primary grid, as for unordered mesh generator output
+*********************************************************************/
+void bench_shuffle_primgrid(PrimaryGrid *primgrid, unsigned seed)
+{
+  int n_verts = primgrid->n_vertices;
+  int *perm   = malloc(n_verts * sizeof(int));
+  int i, j, tmp[2];
+
+  for ( i = 0; i < n_verts; i++ )
+    perm[i] = i;
+
+  for ( i = n_verts - 1; i > 0; i-- )
+  {
+    j = (int) ( bench_rand(&seed) % (unsigned) (i + 1) );
+    tmp[0] = perm[i]; perm[i] = perm[j]; perm[j] = tmp[0];
+  }
+
+  PrimaryGrid_permute_vertices(primgrid, perm);
+
+  /* The element edge map does not follow the shuffled edges          */
+  free( primgrid->elem_edges );
+  primgrid->elem_edges = NULL;
+
+  for ( i = primgrid->n_intr_edges - 1; i > 0; i-- )
+  {
+    j = (int) ( bench_rand(&seed) % (unsigned) (i + 1) );
+
+    memcpy(tmp, primgrid->intr_edges[i], 2*sizeof(int));
+    memcpy(primgrid->intr_edges[i], primgrid->intr_edges[j], 
+           2*sizeof(int));
+    memcpy(primgrid->intr_edges[j], tmp, 2*sizeof(int));
+
+    memcpy(tmp, primgrid->intr_edge_nbrs[i], 2*sizeof(int));
+    memcpy(primgrid->intr_edge_nbrs[i], primgrid->intr_edge_nbrs[j], 
+           2*sizeof(int));
+    memcpy(primgrid->intr_edge_nbrs[j], tmp, 2*sizeof(int));
+  }
+
+  free( perm );
+}
+
+/*********************************************************************
+* Element edge entry, used for matching of element edges
+*********************************************************************/
+typedef struct 
+{
+  int lo, hi;   /* Sorted vertex indices */
+  int p0, p1;   /* Vertex indices in element orientation */
+  int elem;     /* Element index (quads first, then triangles) */
+  int loc;      /* Local edge index in element */
+} BenchEdge;
+
+static int bench_edge_cmp(const void *a, const void *b)
+{
+  const BenchEdge *ea = a;
+  const BenchEdge *eb = b;
+
+  if ( ea->lo != eb->lo )
+    return ( ea->lo < eb->lo ) ? -1 : 1;
+  if ( ea->hi != eb->hi )
+    return ( ea->hi < eb->hi ) ? -1 : 1;
+  if ( ea->elem != eb->elem )
+    return ( ea->elem < eb->elem ) ? -1 : 1;
+  return 0;
+}
+
+#define BENCH_SAME_EDGE(a, b) ( (a).lo == (b).lo && (a).hi == (b).hi )
+
+/*********************************************************************
+* Creates a structured primary grid on the unit square with 
+* nx x ny cells. The left half of the domain is made up of quads,
+* the right half of triangles. 
+* Boundary markers: 1 = bottom, 2 = right, 3 = top, 4 = left
+*********************************************************************/
+PrimaryGrid *bench_create_primgrid(int nx, int ny)
+{
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  int i, j, k;
+  int nx_quad = nx / 2;
+
+  int n_verts = (nx+1) * (ny+1);
+  int n_quads = nx_quad * ny;
+  int n_tris  = 2 * (nx - nx_quad) * ny;
+
+  primgrid->n_vertices    = n_verts;
+  primgrid->n_quads       = n_quads;
+  primgrid->n_tris        = n_tris;
+
+  primgrid->vertex_coords  = calloc(n_verts, 2*sizeof(double));
+  primgrid->quads          = calloc(n_quads, 4*sizeof(int));
+  primgrid->tris           = calloc(n_tris,  3*sizeof(int));
+  primgrid->quad_neighbors = calloc(n_quads, 4*sizeof(int));
+  primgrid->tri_neighbors  = calloc(n_tris,  3*sizeof(int));
+
+  /*------------------------------------------------------------------
+  | Vertices
+  ------------------------------------------------------------------*/
+  for ( j = 0; j <= ny; j++ )
+    for ( i = 0; i <= nx; i++ )
+    {
+      primgrid->vertex_coords[j*(nx+1)+i][0] = (double) i / (double) nx;
+      primgrid->vertex_coords[j*(nx+1)+i][1] = (double) j / (double) ny;
+    }
+
+  /*------------------------------------------------------------------
+  | Elements (counter-clockwise)
+  ------------------------------------------------------------------*/
+  int i_quad = 0;
+  int i_tri  = 0;
+
+  for ( j = 0; j < ny; j++ )
+    for ( i = 0; i < nx; i++ )
+    {
+      int v00 = j*(nx+1) + i;
+      int v10 = v00 + 1;
+      int v01 = v00 + nx + 1;
+      int v11 = v01 + 1;
+
+      if ( i < nx_quad )
+      {
+        primgrid->quads[i_quad][0] = v00;
+        primgrid->quads[i_quad][1] = v10;
+        primgrid->quads[i_quad][2] = v11;
+        primgrid->quads[i_quad][3] = v01;
+        ++i_quad;
+      }
+      else
+      {
+        primgrid->tris[i_tri][0] = v00;
+        primgrid->tris[i_tri][1] = v10;
+        primgrid->tris[i_tri][2] = v11;
+        ++i_tri;
+        primgrid->tris[i_tri][0] = v00;
+        primgrid->tris[i_tri][1] = v11;
+        primgrid->tris[i_tri][2] = v01;
+        ++i_tri;
+      }
+    }
+
+  /*------------------------------------------------------------------
+  | Collect all element edges and match them 
+  ------------------------------------------------------------------*/
+  int n_elem_edges = 4 * n_quads + 3 * n_tris;
+  BenchEdge *edges = calloc(n_elem_edges, sizeof(BenchEdge));
+  int n = 0;
+
+  for ( i = 0; i < n_quads; i++ )
+    for ( k = 0; k < 4; k++ )
+    {
+      edges[n].p0   = primgrid->quads[i][k];
+      edges[n].p1   = primgrid->quads[i][(k+1)%4];
+      edges[n].elem = i;
+      edges[n].loc  = k;
+      ++n;
+    }
+
+  for ( i = 0; i < n_tris; i++ )
+    for ( k = 0; k < 3; k++ )
+    {
+      edges[n].p0   = primgrid->tris[i][k];
+      edges[n].p1   = primgrid->tris[i][(k+1)%3];
+      edges[n].elem = n_quads + i;
+      edges[n].loc  = k;
+      ++n;
+    }
+
+  for ( i = 0; i < n; i++ )
+  {
+    edges[i].lo = MIN(edges[i].p0, edges[i].p1);
+    edges[i].hi = MAX(edges[i].p0, edges[i].p1);
+  }
+
+  qsort(edges, n, sizeof(BenchEdge), bench_edge_cmp);
+
+  int n_intr = 0;
+  int n_bdry = 0;
+
+  for ( i = 0; i < n; i++ )
+  {
+    if ( i+1 < n && BENCH_SAME_EDGE(edges[i], edges[i+1]) )
+    {
+      ++n_intr;
+      ++i;
+    }
+    else
+      ++n_bdry;
+  }
+
+  primgrid->n_intr_edges     = n_intr;
+  primgrid->n_bdry_edges     = n_bdry;
+  primgrid->intr_edges       = calloc(n_intr, 2*sizeof(int));
+  primgrid->intr_edge_nbrs   = calloc(n_intr, 2*sizeof(int));
+  primgrid->bdry_edges       = calloc(n_bdry, 2*sizeof(int));
+  primgrid->bdry_edge_nbrs   = calloc(n_bdry, sizeof(int));
+  primgrid->bdry_edge_marker = calloc(n_bdry, sizeof(int));
+
+  /*------------------------------------------------------------------
+  | Element neighbor k is adjacent to the local edge (k, k+1)
+  ------------------------------------------------------------------*/
+#define BENCH_SET_NBR(e, nbr)                                         \
+  if ( (e).elem < n_quads )                                           \
+    primgrid->quad_neighbors[(e).elem][(e).loc] = (nbr);              \
+  else                                                                \
+    primgrid->tri_neighbors[(e).elem-n_quads][(e).loc] = (nbr);
+
+  n_intr = n_bdry = 0;
+
+  for ( i = 0; i < n; i++ )
+  {
+    if ( i+1 < n && BENCH_SAME_EDGE(edges[i], edges[i+1]) )
+    {
+      primgrid->intr_edges[n_intr][0]     = edges[i].p0;
+      primgrid->intr_edges[n_intr][1]     = edges[i].p1;
+      primgrid->intr_edge_nbrs[n_intr][0] = edges[i].elem;
+      primgrid->intr_edge_nbrs[n_intr][1] = edges[i+1].elem;
+
+      BENCH_SET_NBR(edges[i], edges[i+1].elem);
+      BENCH_SET_NBR(edges[i+1], edges[i].elem);
+
+      ++n_intr;
+      ++i;
+    }
+    else
+    {
+      const double *x0 = primgrid->vertex_coords[edges[i].p0];
+      const double *x1 = primgrid->vertex_coords[edges[i].p1];
+      int marker = 4;
+
+      if ( x0[1] == 0.0 && x1[1] == 0.0 )
+        marker = 1;
+      else if ( x0[0] == 1.0 && x1[0] == 1.0 )
+        marker = 2;
+      else if ( x0[1] == 1.0 && x1[1] == 1.0 )
+        marker = 3;
+
+      primgrid->bdry_edges[n_bdry][0]    = edges[i].p0;
+      primgrid->bdry_edges[n_bdry][1]    = edges[i].p1;
+      primgrid->bdry_edge_nbrs[n_bdry]   = edges[i].elem;
+      primgrid->bdry_edge_marker[n_bdry] = marker;
+
+      BENCH_SET_NBR(edges[i], -1);
+
+      ++n_bdry;
+    }
+  }
+
+#undef BENCH_SET_NBR
+
+  free( edges );
+
+  return primgrid;
+
+} /* bench_create_primgrid() */
+
+/*********************************************************************
+* Writes a primary grid to a file in the IncomFlow mesh format
+*********************************************************************/
+int bench_write_primgrid(const char *path, PrimaryGrid *primgrid, 
+                         int lean)
+{
+  int i;
+  FILE *fptr = fopen(path, "w");
+  check(fptr, "Failed to open %s.", path);
+
+  fprintf(fptr, "VERTICES %d\n", primgrid->n_vertices);
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+    fprintf(fptr, "%.16lf,%.16lf\n", 
+        primgrid->vertex_coords[i][0], primgrid->vertex_coords[i][1]);
+
+  /* Lean grid files only contain the vertices, elements and the   */
+  /* boundary markers                                              */
+  if ( lean )
+  {
+    fprintf(fptr, "BOUNDARYEDGES %d\n", primgrid->n_bdry_edges);
+    for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+      fprintf(fptr, "%d,%d,%d\n", 
+          primgrid->bdry_edges[i][0], primgrid->bdry_edges[i][1],
+          primgrid->bdry_edge_marker[i]);
+
+    fprintf(fptr, "QUADS %d\n", primgrid->n_quads);
+    for ( i = 0; i < primgrid->n_quads; i++ )
+      fprintf(fptr, "%d,%d,%d,%d\n", 
+          primgrid->quads[i][0], primgrid->quads[i][1],
+          primgrid->quads[i][2], primgrid->quads[i][3]);
+
+    fprintf(fptr, "TRIANGLES %d\n", primgrid->n_tris);
+    for ( i = 0; i < primgrid->n_tris; i++ )
+      fprintf(fptr, "%d,%d,%d\n", primgrid->tris[i][0], 
+          primgrid->tris[i][1], primgrid->tris[i][2]);
+
+    fclose(fptr);
+    return ICF_SUCCESS;
+  }
+
+  fprintf(fptr, "INTERIOREDGES %d\n", primgrid->n_intr_edges);
+  for ( i = 0; i < primgrid->n_intr_edges; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->intr_edges[i][0], primgrid->intr_edges[i][1],
+        primgrid->intr_edge_nbrs[i][0], primgrid->intr_edge_nbrs[i][1]);
+
+  fprintf(fptr, "BOUNDARYEDGES %d\n", primgrid->n_bdry_edges);
+  for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->bdry_edges[i][0], primgrid->bdry_edges[i][1],
+        primgrid->bdry_edge_nbrs[i], primgrid->bdry_edge_marker[i]);
+
+  fprintf(fptr, "QUADS %d\n", primgrid->n_quads);
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->quads[i][0], primgrid->quads[i][1],
+        primgrid->quads[i][2], primgrid->quads[i][3]);
+
+  fprintf(fptr, "TRIANGLES %d\n", primgrid->n_tris);
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    fprintf(fptr, "%d,%d,%d\n", 
+        primgrid->tris[i][0], primgrid->tris[i][1], primgrid->tris[i][2]);
+
+  fprintf(fptr, "QUADNEIGHBORS %d\n", primgrid->n_quads);
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->quad_neighbors[i][0], primgrid->quad_neighbors[i][1],
+        primgrid->quad_neighbors[i][2], primgrid->quad_neighbors[i][3]);
+
+  fprintf(fptr, "TRIANGLENEIGHBORS %d\n", primgrid->n_tris);
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    fprintf(fptr, "%d,%d,%d\n", 
+        primgrid->tri_neighbors[i][0], primgrid->tri_neighbors[i][1],
+        primgrid->tri_neighbors[i][2]);
+
+  fclose(fptr);
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* bench_write_primgrid() */
+
+/*********************************************************************
+* Returns ICF_TRUE if two primary grids are identical
+*********************************************************************/
+int bench_compare_primgrid(PrimaryGrid *a, PrimaryGrid *b)
+{
+  if ( a->n_vertices   != b->n_vertices   ||
+       a->n_tris       != b->n_tris       ||
+       a->n_quads      != b->n_quads      ||
+       a->n_intr_edges != b->n_intr_edges ||
+       a->n_bdry_edges != b->n_bdry_edges )
+    return ICF_FALSE;
+
+#define BENCH_CMP_ARRAY(arr, n, size)                                 \
+  if ( (n) > 0 && ( !a->arr || !b->arr ||                             \
+       memcmp(a->arr, b->arr, (size_t)(n) * (size)) != 0 ) )          \
+    return ICF_FALSE;
+
+  BENCH_CMP_ARRAY(vertex_coords,    a->n_vertices,   2*sizeof(double));
+  BENCH_CMP_ARRAY(tris,             a->n_tris,       3*sizeof(int));
+  BENCH_CMP_ARRAY(quads,            a->n_quads,      4*sizeof(int));
+  BENCH_CMP_ARRAY(tri_neighbors,    a->n_tris,       3*sizeof(int));
+  BENCH_CMP_ARRAY(quad_neighbors,   a->n_quads,      4*sizeof(int));
+  BENCH_CMP_ARRAY(intr_edges,       a->n_intr_edges, 2*sizeof(int));
+  BENCH_CMP_ARRAY(intr_edge_nbrs,   a->n_intr_edges, 2*sizeof(int));
+  BENCH_CMP_ARRAY(bdry_edges,       a->n_bdry_edges, 2*sizeof(int));
+  BENCH_CMP_ARRAY(bdry_edge_nbrs,   a->n_bdry_edges, sizeof(int));
+  BENCH_CMP_ARRAY(bdry_edge_marker, a->n_bdry_edges, sizeof(int));
+
+#undef BENCH_CMP_ARRAY
+
+  return ICF_TRUE;
+
+} /* bench_compare_primgrid() */
+
+/*********************************************************************
+* Edge-based flux loop over all interior edges of a primary grid, 
+* as in a finite volume residual evaluation on the dualgrid. 
+* Returns the time per sweep in seconds.
+*********************************************************************/
+static volatile double bench_sink;
+
+double bench_edge_loop(PrimaryGrid *primgrid, int n_sweeps)
+{
+  const int n_verts = primgrid->n_vertices;
+  double (*xy)[2] = primgrid->vertex_coords;
+  double *u   = malloc(n_verts * sizeof(double));
+  double *res = calloc(n_verts, sizeof(double));
+  int i, i_sweep;
+
+  for ( i = 0; i < n_verts; i++ )
+    u[i] = xy[i][0] + 2.0 * xy[i][1];
+
+  double t0 = bench_time();
+
+  for ( i_sweep = 0; i_sweep < n_sweeps; i_sweep++ )
+    for ( i = 0; i < primgrid->n_intr_edges; i++ )
+    {
+      const int p0 = primgrid->intr_edges[i][0];
+      const int p1 = primgrid->intr_edges[i][1];
+
+      const double nx   = xy[p1][1] - xy[p0][1];
+      const double ny   = xy[p0][0] - xy[p1][0];
+      const double flux = 0.5 * ( u[p0] + u[p1] ) * ( nx + ny );
+
+      res[p0] += flux;
+      res[p1] -= flux;
+    }
+
+  double dt = ( bench_time() - t0 ) / (double) n_sweeps;
+
+  for ( i = 0; i < n_verts; i++ )
+    bench_sink += res[i];
+
+  free( u );
+  free( res );
+
+  return dt;
+
+} /* bench_edge_loop() */
+
+/*********************************************************************
+* Element-based loop over all quads and tris of a primary grid, 
+* which scatters the element areas to their vertices as in the 
+* dualgrid volume computation. Returns the time per sweep in seconds.
+*********************************************************************/
+double bench_elem_loop(PrimaryGrid *primgrid, int n_sweeps)
+{
+  double (*xy)[2] = primgrid->vertex_coords;
+  double *vol = calloc(primgrid->n_vertices, sizeof(double));
+  int i, k, i_sweep;
+
+  double t0 = bench_time();
+
+  for ( i_sweep = 0; i_sweep < n_sweeps; i_sweep++ )
+  {
+    for ( i = 0; i < primgrid->n_quads; i++ )
+    {
+      const int *q = primgrid->quads[i];
+      double area = 0.0;
+
+      for ( k = 0; k < 4; k++ )
+        area += xy[q[k]][0] * xy[q[(k+1)%4]][1] 
+              - xy[q[(k+1)%4]][0] * xy[q[k]][1];
+
+      for ( k = 0; k < 4; k++ )
+        vol[q[k]] += 0.125 * area;
+    }
+
+    for ( i = 0; i < primgrid->n_tris; i++ )
+    {
+      const int *t = primgrid->tris[i];
+      double area = ( xy[t[1]][0] - xy[t[0]][0] ) 
+                  * ( xy[t[2]][1] - xy[t[0]][1] )
+                  - ( xy[t[2]][0] - xy[t[0]][0] ) 
+                  * ( xy[t[1]][1] - xy[t[0]][1] );
+
+      for ( k = 0; k < 3; k++ )
+        vol[t[k]] += area / 6.0;
+    }
+  }
+
+  double dt = ( bench_time() - t0 ) / (double) n_sweeps;
+
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+    bench_sink += vol[i];
+
+  free( vol );
+
+  return dt;
+
+} /* bench_elem_loop() */
+
+/*********************************************************************
+* Builds the dualgrid of a benchmark grid with the boundary markers
+* of bench_create_primgrid()
+*********************************************************************/
+DualGrid *bench_create_dualgrid(PrimaryGrid *primgrid)
+{
+  DualGrid    *dualgrid = DualGrid_create();
+  BoundaryDef *bdry_def = dualgrid->boundaries->bdry_def;
+
+  bdry_def->n_bdry_markers = 4;
+  bdry_def->bdry_markers   = calloc(4, sizeof(int));
+  bdry_def->bdry_types     = calloc(4, sizeof(BoundaryType));
+  bdry_def->bdry_markers[0] = 1; bdry_def->bdry_types[0] = INLET;
+  bdry_def->bdry_markers[1] = 2; bdry_def->bdry_types[1] = OUTLET;
+  bdry_def->bdry_markers[2] = 3; bdry_def->bdry_types[2] = WALL;
+  bdry_def->bdry_markers[3] = 4; bdry_def->bdry_types[3] = WALL;
+
+  DualGrid_build(dualgrid, bdry_def, primgrid);
+
+  return dualgrid;
+
+} /* bench_create_dualgrid() */
+
+/*********************************************************************
+* Face-based loop over all faces of a dualgrid, which computes a 
+* convective flux from the face normals and scatters it to both 
+* elements. Returns the time per sweep in seconds.
+*********************************************************************/
+double bench_face_loop(DualGrid *dualgrid, int n_sweeps)
+{
+  const int n_elems = dualgrid->n_elements;
+  double (*norms)[2] = dualgrid->face_norms;
+  int    (*nbrs)[2]  = dualgrid->face_nbrs;
+  double *u   = malloc(n_elems * sizeof(double));
+  double *res = calloc(n_elems, sizeof(double));
+  int i, i_sweep;
+
+  for ( i = 0; i < n_elems; i++ )
+    u[i] = dualgrid->xy[i][0] + 2.0 * dualgrid->xy[i][1];
+
+  double t0 = bench_time();
+
+  for ( i_sweep = 0; i_sweep < n_sweeps; i_sweep++ )
+    for ( i = 0; i < dualgrid->n_intr_faces; i++ )
+    {
+      const int p0 = nbrs[i][0];
+      const int p1 = nbrs[i][1];
+
+      const double flux = 0.5 * ( u[p0] + u[p1] ) 
+                        * ( norms[i][0] + norms[i][1] );
+
+      res[p0] += flux;
+      res[p1] -= flux;
+    }
+
+  double dt = ( bench_time() - t0 ) / (double) n_sweeps;
+
+  for ( i = 0; i < n_elems; i++ )
+    bench_sink += res[i];
+
+  free( u );
+  free( res );
+
+  return dt;
+
+} /* bench_face_loop() */
+
+/*********************************************************************
+* Vertex-based loop over the faces of a sorted dualgrid through its 
+* row pointers, which keeps the first element of every face in a 
+* register. Returns the time per sweep in seconds.
+*********************************************************************/
+double bench_face_ptr_loop(DualGrid *dualgrid, int n_sweeps)
+{
+  const int n_elems = dualgrid->n_elements;
+  const int *ptrs[2] = { dualgrid->face_ptr, dualgrid->bdry_face_ptr };
+  double (*norms)[2] = dualgrid->face_norms;
+  int    (*nbrs)[2]  = dualgrid->face_nbrs;
+  double *u   = malloc(n_elems * sizeof(double));
+  double *res = calloc(n_elems, sizeof(double));
+  int i, j, k, i_sweep;
+
+  for ( i = 0; i < n_elems; i++ )
+    u[i] = dualgrid->xy[i][0] + 2.0 * dualgrid->xy[i][1];
+
+  double t0 = bench_time();
+
+  for ( i_sweep = 0; i_sweep < n_sweeps; i_sweep++ )
+    for ( k = 0; k < 2; k++ )
+      for ( i = 0; i < n_elems; i++ )
+      {
+        const double u0 = u[i];
+        double r0 = 0.0;
+
+        for ( j = ptrs[k][i]; j < ptrs[k][i+1]; j++ )
+        {
+          const int    p1   = nbrs[j][1];
+          const double flux = 0.5 * ( u0 + u[p1] ) 
+                            * ( norms[j][0] + norms[j][1] );
+          r0      += flux;
+          res[p1] -= flux;
+        }
+
+        res[i] += r0;
+      }
+
+  double dt = ( bench_time() - t0 ) / (double) n_sweeps;
+
+  for ( i = 0; i < n_elems; i++ )
+    bench_sink += res[i];
+
+  free( u );
+  free( res );
+
+  return dt;
+
+} /* bench_face_ptr_loop() */
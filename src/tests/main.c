@@ -17,8 +17,15 @@ int main()
   fprintf(stderr, "==============================================\n");
   fprintf(stderr, "\n");
 
+  run_tests_NumScan();
+  run_tests_GmshReader();
   run_tests_MeshReader();
+  run_tests_PrimaryGrid();
   run_tests_DualGrid();
+  run_tests_Partition();
+  run_tests_HaloExchange();
+  run_tests_SpatialIndex();
+  run_tests_ParticleTracker();
 
   fprintf(stderr, "\n\nEverything works like a charm.\n\n");
 
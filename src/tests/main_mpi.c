@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "run_tests.h"
+
+/*********************************************************************
+* The main function of the MPI tests
+*
+* Usage: mpirun -np N run_tests_mpi
+*********************************************************************/
+int main(int argc, char *argv[])
+{
+  int rank, status;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if ( rank == 0 )
+  {
+    fprintf(stderr, "\n");
+    fprintf(stderr, "==============================================\n");
+    fprintf(stderr, "INCOMFLOW MPI UNIT TESTS\n");
+    fprintf(stderr, "==============================================\n");
+    fprintf(stderr, "\n");
+  }
+
+  status = run_tests_DistGrid();
+
+  MPI_Finalize();
+
+  return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
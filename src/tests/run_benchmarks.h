@@ -0,0 +1,53 @@
+#ifndef RUN_BENCHMARKS_H
+#define RUN_BENCHMARKS_H
+
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+
+/*********************************************************************
+* Benchmark utilities 
+*********************************************************************/
+double bench_time();
+
+PrimaryGrid *bench_create_primgrid(int nx, int ny);
+
+int bench_write_primgrid(const char *path, PrimaryGrid *primgrid, 
+                         int lean);
+
+long bench_file_size(const char *path);
+
+long bench_peak_rss(void (*fn)(void *ctx), void *ctx);
+
+int bench_compare_primgrid(PrimaryGrid *a, PrimaryGrid *b);
+
+void bench_shuffle_primgrid(PrimaryGrid *primgrid, unsigned seed);
+
+double bench_edge_loop(PrimaryGrid *primgrid, int n_sweeps);
+
+double bench_elem_loop(PrimaryGrid *primgrid, int n_sweeps);
+
+DualGrid *bench_create_dualgrid(PrimaryGrid *primgrid);
+
+double bench_face_loop(DualGrid *dualgrid, int n_sweeps);
+
+double bench_face_ptr_loop(DualGrid *dualgrid, int n_sweeps);
+
+/*********************************************************************
+* Benchmarks
+*********************************************************************/
+void run_benchmarks_NumScan(int n);
+void run_benchmarks_MeshReader(const char *bench_grid, int n);
+void run_benchmarks_GridCache(const char *bench_grid);
+void run_benchmarks_PrimaryGrid(int n);
+void run_benchmarks_DualGrid(int n);
+void run_benchmarks_Partition(int n);
+void run_benchmarks_HaloExchange(int n);
+void run_benchmarks_SpatialIndex(int n);
+void run_benchmarks_ParticleTracker(int n);
+
+#ifdef ICF_USE_MPI
+void run_benchmarks_DistGrid(int n);
+#endif
+
+
+#endif /* RUN_BENCHMARKS_H */
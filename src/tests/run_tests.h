@@ -1,11 +1,36 @@
 #ifndef RUN_TESTS_H
 #define RUN_TESTS_H
 
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+
+/*********************************************************************
+* Test utilities
+*********************************************************************/
+PrimaryGrid *tests_create_primgrid(int nx, int ny);
+
+PrimaryGrid *tests_create_polygrid();
+
+int tests_write_primgrid(const char *path, PrimaryGrid *primgrid);
+
+void tests_set_bdry_def(BoundaryDef *bdry_def);
+
 /*********************************************************************
 * 
 *********************************************************************/
-void run_tests_MeshReader();
-void run_tests_DualGrid();
+int run_tests_NumScan();
+int run_tests_MeshReader();
+int run_tests_PrimaryGrid();
+int run_tests_GmshReader();
+int run_tests_DualGrid();
+int run_tests_Partition();
+int run_tests_HaloExchange();
+int run_tests_SpatialIndex();
+int run_tests_ParticleTracker();
+
+#ifdef ICF_USE_MPI
+int run_tests_DistGrid();
+#endif
 
 
 #endif /* RUN_TESTS_H*/
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "DistGrid.h"
+
+#include "run_tests.h"
+
+static const char *test_dist_grid = "icf_test_dist.grid";
+
+/*********************************************************************
+* Face residual of a smooth function for the faces <faces>
+*********************************************************************/
+static void dist_face_residual(const DualGrid *dualgrid, 
+                               const int *faces, int n_faces,
+                               const double *u, double *res)
+{
+  int i;
+
+  for ( i = 0; i < n_faces; i++ )
+  {
+    const int f  = faces ? faces[i] : i;
+    const int p0 = dualgrid->face_nbrs[f][0];
+    const int p1 = dualgrid->face_nbrs[f][1];
+
+    const double flux = 0.5 * ( u[p0] + u[p1] ) 
+                      * ( dualgrid->face_norms[f][0] 
+                        + dualgrid->face_norms[f][1] );
+
+    res[p0] += flux;
+    res[p1] -= flux;
+  }
+
+} /* dist_face_residual() */
+
+/*********************************************************************
+* Test the distributed dualgrid against the serial dualgrid: 
+* Volumes, face residuals with overlapped halo updates, residual 
+* norms and boundary fluxes must match
+*********************************************************************/
+int test_DistGrid_read()
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(30, 24);
+  DualGrid    *dualgrid = DualGrid_create();
+  DistGrid    *dist     = DistGrid_create(MPI_COMM_WORLD);
+  double *u = NULL, *res = NULL, *u_loc = NULL, *res_loc = NULL;
+  double *fluxes = NULL;
+  Boundary *bdry;
+  int i, k, status = ICF_SUCCESS;
+
+  check( primgrid, "Failed to create the test grid." );
+  check( PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT),
+      "PrimaryGrid_reorder_sfc() failed." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  if ( dist->rank == 0 )
+    status = PrimaryGrid_write_binary(primgrid, test_dist_grid);
+
+  MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  check( status, "PrimaryGrid_write_binary() failed." );
+
+  check( DistGrid_read(dist, dualgrid->boundaries->bdry_def, 
+                       test_dist_grid),
+      "DistGrid_read() failed." );
+
+  const DualGrid     *loc  = dist->dualgrid;
+  const DualGridHalo *halo = loc->halo;
+  const int n_elems = dualgrid->n_elements;
+
+  /*------------------------------------------------------------------
+  | Owned elements and global volume
+  ------------------------------------------------------------------*/
+  check( halo->n_owned == dist->vtx_end - dist->vtx_begin,
+      "Wrong number of owned elements." );
+
+  for ( i = 0; i < halo->n_owned; i++ )
+  {
+    check( DistGrid_owner(halo->global_index[i], n_elems, 
+                          dist->n_ranks) == dist->rank,
+        "Wrong owner of element %d.", halo->global_index[i] );
+    check( EQ(loc->vol[i], dualgrid->vol[halo->global_index[i]]),
+        "Wrong volume of element %d.", halo->global_index[i] );
+  }
+
+  check( fabs(DistGrid_volume(dist) - 1.0) < 1.0E-12, 
+      "Wrong global volume." );
+
+  /*------------------------------------------------------------------
+  | Face residual with overlapped halo update
+  ------------------------------------------------------------------*/
+  u       = calloc(n_elems, sizeof(double));
+  res     = calloc(n_elems, sizeof(double));
+  u_loc   = calloc(loc->n_elements, sizeof(double));
+  res_loc = calloc(loc->n_elements, sizeof(double));
+
+  for ( i = 0; i < n_elems; i++ )
+    u[i] = sin( 3.0 * dualgrid->xy[i][0] ) + dualgrid->xy[i][1];
+
+  dist_face_residual(dualgrid, NULL, dualgrid->n_intr_faces, u, res);
+
+  for ( i = 0; i < halo->n_owned; i++ )
+    u_loc[i] = u[ halo->global_index[i] ];
+
+  check( DistGrid_update_begin(dist, u_loc, 1), 
+      "DistGrid_update_begin() failed." );
+
+  dist_face_residual(loc, dist->inner_faces, dist->n_inner_faces, 
+                     u_loc, res_loc);
+
+  check( DistGrid_update_end(dist), "DistGrid_update_end() failed." );
+
+  for ( i = halo->n_owned; i < loc->n_elements; i++ )
+    check( u_loc[i] == u[ halo->global_index[i] ],
+        "Wrong ghost value of element %d.", halo->global_index[i] );
+
+  dist_face_residual(loc, dist->halo_faces, dist->n_halo_faces, 
+                     u_loc, res_loc);
+
+  for ( i = 0; i < halo->n_owned; i++ )
+    check( fabs(res_loc[i] - res[ halo->global_index[i] ]) < 1.0E-12,
+        "Wrong residual of element %d.", halo->global_index[i] );
+
+  double norm = 0.0;
+
+  for ( i = 0; i < n_elems; i++ )
+    norm += res[i] * res[i];
+
+  check( fabs(DistGrid_residual_norm(dist, res_loc, 1) - sqrt(norm)) 
+         < 1.0E-12,
+      "Wrong global residual norm." );
+
+  /*------------------------------------------------------------------
+  | Boundary fluxes: A unit flux at every boundary vertex sums up to
+  | the number of boundary vertices
+  ------------------------------------------------------------------*/
+  fluxes = calloc(loc->boundaries->n_boundaries, sizeof(double));
+
+  for ( bdry = loc->boundaries->start; bdry; bdry = bdry->next )
+    for ( i = 0; i < bdry->n_bdry_points; i++ )
+      bdry->bdry_mflux[i] = 1.0;
+
+  check( DistGrid_boundary_fluxes(dist, fluxes), 
+      "DistGrid_boundary_fluxes() failed." );
+
+  for ( bdry = dualgrid->boundaries->start, k = 0; bdry; 
+        bdry = bdry->next, k++ )
+    check( EQ(fluxes[k], (double) bdry->n_bdry_points),
+        "Wrong flux of boundary %d.", k );
+
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if ( dist->rank == 0 )
+    remove(test_dist_grid);
+
+  DistGrid_destroy( dist );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  free( u );
+  free( res );
+  free( u_loc );
+  free( res_loc );
+  free( fluxes );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_DistGrid_read() */
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_DistGrid()
+{
+  check( test_DistGrid_read(), 
+      "> test_DistGrid_read() failed" ); 
+
+  fprintf(stderr, "> test_DistGrid() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_DistGrid() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_DistGrid() */
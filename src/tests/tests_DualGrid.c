@@ -8,6 +8,9 @@
 #include "MeshReader.h"
 #include "PrimaryGrid.h"
 #include "DualGrid.h"
+#include "GridCache.h"
+
+#include "run_tests.h"
 
 static const char *test_grid = "/datadisk/Code/C-Code/SimpleSolver/input/grid/TestGrid.dat";
 
@@ -302,6 +305,1133 @@ error:
 } /* test_DualGrid_build()*/
 
 
+/*********************************************************************
+* Test loading of dualgrids from the grid cache
+*********************************************************************/
+void tests_set_bdry_def(BoundaryDef *bdry_def)
+{
+  bdry_def->n_bdry_markers = 4;
+  bdry_def->bdry_markers = calloc(4, sizeof(int));
+  bdry_def->bdry_markers[0] = 1; // INLET
+  bdry_def->bdry_markers[1] = 2; // DOMAIN WALL
+  bdry_def->bdry_markers[2] = 3; // OUTLET
+  bdry_def->bdry_markers[3] = 4; // RECTANGLE WALL
+
+  bdry_def->bdry_types = calloc(4, sizeof(BoundaryType));
+  bdry_def->bdry_types[0] = INLET;
+  bdry_def->bdry_types[1] = WALL;
+  bdry_def->bdry_types[2] = OUTLET;
+  bdry_def->bdry_types[3] = WALL;
+
+} /* tests_set_bdry_def() */
+
+int test_DualGrid_cache()
+{
+  const char *cache_dir = "icf_test_cache";
+  const char *grid_file = "icf_test_cache.dat";
+  DualGrid    *dualgrids[3];
+  PrimaryGrid *primgrids[3];
+  PrimaryGrid *testgrid = tests_create_primgrid(12, 8);
+  uint64_t key;
+  char path[1024];
+  int i, j;
+
+  check( tests_write_primgrid(grid_file, testgrid),
+      "tests_write_primgrid() failed." );
+
+  /*------------------------------------------------------------------
+  | 0: Without cache, 1: Cache miss, 2: Cache hit
+  ------------------------------------------------------------------*/
+  for ( i = 0; i < 3; i++ )
+  {
+    dualgrids[i] = DualGrid_create();
+    primgrids[i] = PrimaryGrid_create();
+    tests_set_bdry_def( dualgrids[i]->boundaries->bdry_def );
+
+    check( GridCache_load(dualgrids[i], primgrids[i], 
+                          dualgrids[i]->boundaries->bdry_def, grid_file,
+                          i > 0 ? cache_dir : NULL), 
+        "GridCache_load() failed." );
+  }
+
+  check( dualgrids[1]->cache_map == NULL, "Grid cache was not empty.");
+  check( dualgrids[2]->cache_map != NULL, "Grid cache was not used.");
+
+  /*------------------------------------------------------------------
+  | Compare cached and built dualgrids
+  ------------------------------------------------------------------*/
+  DualGrid *ref = dualgrids[0];
+  DualGrid *dg  = dualgrids[2];
+
+  check( dg->n_elements == ref->n_elements 
+      && dg->n_intr_faces == ref->n_intr_faces,
+      "Wrong dualgrid size from cache." );
+
+  for ( i = 0; i < ref->n_elements; i++ )
+    check( dg->vol[i] == ref->vol[i], "Wrong volume from cache." );
+
+  for ( i = 0; i < ref->n_intr_faces; i++ )
+    for ( j = 0; j < 2; j++ )
+    {
+      check( dg->face_nbrs[i][j] == ref->face_nbrs[i][j], 
+          "Wrong face neighbors from cache." );
+      check( dg->face_norms[i][j] == ref->face_norms[i][j], 
+          "Wrong face normals from cache." );
+    }
+
+  Boundary *b_ref = ref->boundaries->start;
+  Boundary *b     = dg->boundaries->start;
+
+  check( dg->boundaries->n_boundaries == ref->boundaries->n_boundaries,
+      "Wrong number of boundaries from cache." );
+
+  for ( ; b_ref && b; b_ref = b_ref->next, b = b->next )
+  {
+    check( b->type == b_ref->type 
+        && b->n_bdry_points == b_ref->n_bdry_points
+        && b->n_bdry_edges  == b_ref->n_bdry_edges,
+        "Wrong boundary from cache." );
+
+    for ( i = 0; i < b->n_bdry_points; i++ )
+      check( b->bdry_points[i] == b_ref->bdry_points[i], 
+          "Wrong boundary points from cache." );
+
+    for ( i = 0; i < b->n_bdry_edges; i++ )
+      check( b->bdry_edges[i][0] == b_ref->bdry_edges[i][0] 
+          && b->bdry_edges[i][1] == b_ref->bdry_edges[i][1], 
+          "Wrong boundary edges from cache." );
+  }
+
+  check( b_ref == NULL && b == NULL, "Wrong boundaries from cache." );
+
+  /*------------------------------------------------------------------
+  | A section offset, for which offset + size wraps around, must be 
+  | rejected
+  ------------------------------------------------------------------*/
+  check( GridCache_key(grid_file, ref->boundaries->bdry_def, &key),
+      "GridCache_key() failed." );
+
+  snprintf(path, sizeof(path), "%s/%016llx.dual", 
+           cache_dir, (unsigned long long) key);
+
+  GridCacheHeader header;
+  FILE *fptr = fopen(path, "r+b");
+  check( fptr, "Failed to open %s.", path );
+  check( fread(&header, sizeof(header), 1, fptr) == 1, 
+      "Failed to read %s.", path );
+
+  header.offsets[ICF_CACHE_BOUNDARIES] = UINT64_MAX 
+                                       - ICF_CACHE_ALIGNMENT + 1;
+
+  fseek(fptr, 0, SEEK_SET);
+  check( fwrite(&header, sizeof(header), 1, fptr) == 1, 
+      "Failed to write %s.", path );
+  fclose(fptr);
+
+  DualGrid *corrupted = DualGrid_create();
+  tests_set_bdry_def( corrupted->boundaries->bdry_def );
+
+  check( !GridCache_read_dualgrid(corrupted, primgrids[2], key, path),
+      "Corrupted section offset was not detected." );
+
+  DualGrid_destroy( corrupted );
+
+  /*------------------------------------------------------------------
+  | Clean up
+  ------------------------------------------------------------------*/
+  remove(path);
+  snprintf(path, sizeof(path), "%s/%016llx.grid", 
+           cache_dir, (unsigned long long) key);
+  remove(path);
+  remove(cache_dir);
+
+  for ( i = 0; i < 3; i++ )
+  {
+    DualGrid_destroy( dualgrids[i] );
+    PrimaryGrid_destroy( primgrids[i] );
+  }
+
+  PrimaryGrid_destroy( testgrid );
+  remove(grid_file);
+
+  return ICF_SUCCESS;
+
+error:
+  remove(grid_file);
+  return ICF_ERROR;
+
+} /* test_DualGrid_cache() */
+
+
+/*********************************************************************
+* Creates a grid of nx x ny cells on the unit square with quads in 
+* the left half and tris in the right half. The boundary markers are
+* 1 (bottom), 2 (right), 3 (top) and 4 (left).
+*********************************************************************/
+PrimaryGrid *tests_create_primgrid(int nx, int ny)
+{
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+  int i, j, k;
+
+  primgrid->n_vertices   = (nx+1) * (ny+1);
+  primgrid->n_quads      = nx/2 * ny;
+  primgrid->n_tris       = 2 * (nx - nx/2) * ny;
+  primgrid->n_bdry_edges = 2 * (nx + ny);
+
+  primgrid->vertex_coords    = calloc(primgrid->n_vertices, 2*sizeof(double));
+  primgrid->quads            = calloc(primgrid->n_quads, 4*sizeof(int));
+  primgrid->tris             = calloc(primgrid->n_tris,  3*sizeof(int));
+  primgrid->bdry_edges       = calloc(primgrid->n_bdry_edges, 2*sizeof(int));
+  primgrid->bdry_edge_marker = calloc(primgrid->n_bdry_edges, sizeof(int));
+
+#define GRID_VERTEX(i, j) ( (j)*(nx+1) + (i) )
+
+  for ( j = 0; j <= ny; j++ )
+    for ( i = 0; i <= nx; i++ )
+    {
+      primgrid->vertex_coords[GRID_VERTEX(i,j)][0] = (double) i / nx;
+      primgrid->vertex_coords[GRID_VERTEX(i,j)][1] = (double) j / ny;
+    }
+
+  for ( j = 0; j < ny; j++ )
+    for ( i = 0; i < nx; i++ )
+    {
+      const int v0 = GRID_VERTEX(i,   j);
+      const int v1 = GRID_VERTEX(i+1, j);
+      const int v2 = GRID_VERTEX(i+1, j+1);
+      const int v3 = GRID_VERTEX(i,   j+1);
+
+      if ( i < nx/2 )
+      {
+        int *q = primgrid->quads[j*(nx/2) + i];
+        q[0] = v0; q[1] = v1; q[2] = v2; q[3] = v3;
+      }
+      else
+      {
+        int *t0 = primgrid->tris[2 * ( j*(nx-nx/2) + i-nx/2 )];
+        int *t1 = primgrid->tris[2 * ( j*(nx-nx/2) + i-nx/2 ) + 1];
+        t0[0] = v0; t0[1] = v1; t0[2] = v2; 
+        t1[0] = v0; t1[1] = v2; t1[2] = v3;
+      }
+    }
+
+  k = 0;
+  for ( i = 0; i < nx; i++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]      = GRID_VERTEX(i,   0);
+    primgrid->bdry_edges[k][1]      = GRID_VERTEX(i+1, 0);
+    primgrid->bdry_edge_marker[k]   = 1;
+    primgrid->bdry_edges[k+1][0]    = GRID_VERTEX(i+1, ny);
+    primgrid->bdry_edges[k+1][1]    = GRID_VERTEX(i,   ny);
+    primgrid->bdry_edge_marker[k+1] = 3;
+  }
+  for ( j = 0; j < ny; j++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]      = GRID_VERTEX(nx, j);
+    primgrid->bdry_edges[k][1]      = GRID_VERTEX(nx, j+1);
+    primgrid->bdry_edge_marker[k]   = 2;
+    primgrid->bdry_edges[k+1][0]    = GRID_VERTEX(0,  j+1);
+    primgrid->bdry_edges[k+1][1]    = GRID_VERTEX(0,  j);
+    primgrid->bdry_edge_marker[k+1] = 4;
+  }
+
+#undef GRID_VERTEX
+
+  check( PrimaryGrid_build_topology( primgrid, 1 ),
+      "PrimaryGrid_build_topology() failed.");
+
+  return primgrid;
+
+error:
+  PrimaryGrid_destroy( primgrid );
+  return NULL;
+
+} /* tests_create_primgrid() */
+
+/*********************************************************************
+* Writes a primary grid with all connectivity sections to an ASCII 
+* grid file, which can be read by every MeshReader
+*********************************************************************/
+int tests_write_primgrid(const char *path, PrimaryGrid *primgrid)
+{
+  FILE *fptr = fopen(path, "w");
+  int i;
+
+  check( fptr, "Failed to open %s.", path);
+
+  fprintf(fptr, "VERTICES %d\n", primgrid->n_vertices);
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+    fprintf(fptr, "%.16lf,%.16lf\n", 
+        primgrid->vertex_coords[i][0], primgrid->vertex_coords[i][1]);
+
+  fprintf(fptr, "INTERIOREDGES %d\n", primgrid->n_intr_edges);
+  for ( i = 0; i < primgrid->n_intr_edges; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->intr_edges[i][0], primgrid->intr_edges[i][1],
+        primgrid->intr_edge_nbrs[i][0], primgrid->intr_edge_nbrs[i][1]);
+
+  fprintf(fptr, "BOUNDARYEDGES %d\n", primgrid->n_bdry_edges);
+  for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->bdry_edges[i][0], primgrid->bdry_edges[i][1],
+        primgrid->bdry_edge_nbrs[i], primgrid->bdry_edge_marker[i]);
+
+  fprintf(fptr, "QUADS %d\n", primgrid->n_quads);
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->quads[i][0], primgrid->quads[i][1],
+        primgrid->quads[i][2], primgrid->quads[i][3]);
+
+  fprintf(fptr, "TRIANGLES %d\n", primgrid->n_tris);
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    fprintf(fptr, "%d,%d,%d\n", 
+        primgrid->tris[i][0], primgrid->tris[i][1], primgrid->tris[i][2]);
+
+  fprintf(fptr, "QUADNEIGHBORS %d\n", primgrid->n_quads);
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    fprintf(fptr, "%d,%d,%d,%d\n", 
+        primgrid->quad_neighbors[i][0], primgrid->quad_neighbors[i][1],
+        primgrid->quad_neighbors[i][2], primgrid->quad_neighbors[i][3]);
+
+  fprintf(fptr, "TRIANGLENEIGHBORS %d\n", primgrid->n_tris);
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    fprintf(fptr, "%d,%d,%d\n", 
+        primgrid->tri_neighbors[i][0], primgrid->tri_neighbors[i][1],
+        primgrid->tri_neighbors[i][2]);
+
+  fclose(fptr);
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* tests_write_primgrid() */
+
+/*********************************************************************
+* Creates a grid on [0,3]x[0,1] from a pentagon (element 4), two 
+* quads (elements 0, 1) and two tris (elements 2, 3), where the 
+* pentagon and one tri are added as polygons to the element store:
+*
+*   3-----4-----5
+*   |     | Q1  | \ T2
+*   |  P  6-----7--8
+*   |     | Q0  | / T
+*   0-----1-----2
+*
+* The boundary markers are 1 (bottom), 2 (right), 3 (top) and 
+* 4 (left).
+*********************************************************************/
+PrimaryGrid *tests_create_polygrid()
+{
+  static const double xy[9][2] = { {0.0,0.0}, {1.0,0.0}, {2.0,0.0}, 
+                                   {0.0,1.0}, {1.0,1.0}, {2.0,1.0}, 
+                                   {1.0,0.5}, {2.0,0.5}, {3.0,0.5} };
+  static const int quads[2][4] = { {1,2,7,6}, {6,7,5,4} };
+  static const int tris[1][3]  = { {2,8,7} };
+  static const int bdry[7][2]  = { {0,1}, {1,2}, {2,8}, {8,5}, 
+                                   {5,4}, {4,3}, {3,0} };
+  static const int markers[7]  = { 1, 1, 2, 2, 3, 3, 4 };
+  static const int poly_ptr[3]   = { 0, 5, 8 };
+  static const int poly_verts[8] = { 0, 1, 6, 4, 3, 7, 8, 5 };
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  primgrid->n_vertices   = 9;
+  primgrid->n_quads      = 2;
+  primgrid->n_tris       = 1;
+  primgrid->n_bdry_edges = 7;
+
+  primgrid->vertex_coords    = calloc(9, 2*sizeof(double));
+  primgrid->quads            = calloc(2, 4*sizeof(int));
+  primgrid->tris             = calloc(1, 3*sizeof(int));
+  primgrid->bdry_edges       = calloc(7, 2*sizeof(int));
+  primgrid->bdry_edge_marker = calloc(7, sizeof(int));
+
+  memcpy(primgrid->vertex_coords, xy, sizeof(xy));
+  memcpy(primgrid->quads, quads, sizeof(quads));
+  memcpy(primgrid->tris, tris, sizeof(tris));
+  memcpy(primgrid->bdry_edges, bdry, sizeof(bdry));
+  memcpy(primgrid->bdry_edge_marker, markers, sizeof(markers));
+
+  check( PrimaryGrid_build_elements( primgrid, 2, poly_ptr, poly_verts ),
+      "PrimaryGrid_build_elements() failed.");
+  check( PrimaryGrid_build_topology( primgrid, 2 ),
+      "PrimaryGrid_build_topology() failed.");
+
+  return primgrid;
+
+error:
+  PrimaryGrid_destroy( primgrid );
+  return NULL;
+
+} /* tests_create_polygrid() */
+
+/*********************************************************************
+* Checks the element adjacency of a dualgrid against its faces
+*********************************************************************/
+static int check_adjacency(DualGrid *dualgrid)
+{
+  const int *ptr = dualgrid->elem_face_ptr;
+  int i, j;
+
+  check( ptr && ptr[0] == 0 
+      && ptr[dualgrid->n_elements] == 2 * dualgrid->n_intr_faces,
+      "Wrong adjacency row pointer." );
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+    for ( j = ptr[i]; j < ptr[i+1]; j++ )
+    {
+      const int *f = dualgrid->face_nbrs[ dualgrid->elem_faces[j] ];
+      const int  s = dualgrid->elem_face_signs[j];
+
+      check( ( s ==  1 && f[0] == i && f[1] == dualgrid->elem_nbrs[j] )
+          || ( s == -1 && f[1] == i && f[0] == dualgrid->elem_nbrs[j] ),
+          "Wrong adjacency of element %d.", i );
+
+      check( j == ptr[i] || dualgrid->elem_faces[j-1] < dualgrid->elem_faces[j],
+          "Faces of element %d are not ordered.", i );
+    }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* check_adjacency() */
+
+/*********************************************************************
+* Test the element adjacency of a dualgrid: The face normals of 
+* every closed dual element must sum up to zero
+*********************************************************************/
+int test_DualGrid_adjacency()
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(6, 5);
+  DualGrid    *dualgrid = DualGrid_create();
+  double total_vol = 0.0;
+  int i, j;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  check( check_adjacency(dualgrid), "Wrong dualgrid adjacency." );
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+    total_vol += dualgrid->vol[i];
+
+  check( EQ(total_vol, 1.0), "Wrong calculation of element areas." );
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+  {
+    const double *xy = dualgrid->xy[i];
+    double sum[2] = { 0.0, 0.0 };
+
+    /* Dual elements of boundary vertices are not closed */
+    if ( xy[0] == 0.0 || xy[0] == 1.0 || xy[1] == 0.0 || xy[1] == 1.0 )
+      continue;
+
+    for ( j = dualgrid->elem_face_ptr[i]; 
+          j < dualgrid->elem_face_ptr[i+1]; j++ )
+    {
+      const int f = dualgrid->elem_faces[j];
+      sum[0] += dualgrid->elem_face_signs[j] * dualgrid->face_norms[f][0];
+      sum[1] += dualgrid->elem_face_signs[j] * dualgrid->face_norms[f][1];
+    }
+
+    check( EQ(sum[0], 0.0) && EQ(sum[1], 0.0),
+        "Dual element %d is not closed.", i );
+  }
+
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_DualGrid_adjacency() */
+
+/*********************************************************************
+* Test the dualgrid metrics of a grid with polygons and of a grid,
+* whose elements are views of the element store
+*********************************************************************/
+int test_DualGrid_polygons()
+{
+  PrimaryGrid *primgrid = tests_create_polygrid();
+  PrimaryGrid *ref_prim = tests_create_primgrid(6, 5);
+  PrimaryGrid *cmp_prim = tests_create_primgrid(6, 5);
+  DualGrid    *dualgrid = DualGrid_create();
+  DualGrid    *ref_dual = DualGrid_create();
+  DualGrid    *cmp_dual = DualGrid_create();
+  double total_vol = 0.0;
+  int i, j;
+
+  check( primgrid && ref_prim && cmp_prim, 
+      "Failed to create the test grids." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  tests_set_bdry_def( ref_dual->boundaries->bdry_def );
+  tests_set_bdry_def( cmp_dual->boundaries->bdry_def );
+
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  /*------------------------------------------------------------------
+  | Vertex 0 gets the quadrilateral between itself, the midpoints of 
+  | its edges and the pentagon centroid (0.6, 0.5)
+  ------------------------------------------------------------------*/
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+  {
+    check( dualgrid->vol[i] > 0.0, "Wrong area of element %d.", i );
+    total_vol += dualgrid->vol[i];
+  }
+
+  check( EQ(total_vol, 2.5), "Wrong calculation of element areas." );
+  check( EQ(dualgrid->vol[0], 0.275), "Wrong area of the pentagon corner." );
+
+  /* Vertices 6 and 7 are interior vertices                          */
+  for ( i = 6; i <= 7; i++ )
+  {
+    double sum[2] = { 0.0, 0.0 };
+
+    for ( j = dualgrid->elem_face_ptr[i]; 
+          j < dualgrid->elem_face_ptr[i+1]; j++ )
+    {
+      const int f = dualgrid->elem_faces[j];
+      sum[0] += dualgrid->elem_face_signs[j] * dualgrid->face_norms[f][0];
+      sum[1] += dualgrid->elem_face_signs[j] * dualgrid->face_norms[f][1];
+    }
+
+    check( EQ(sum[0], 0.0) && EQ(sum[1], 0.0),
+        "Dual element %d is not closed.", i );
+  }
+
+  /*------------------------------------------------------------------
+  | Views of the element store give the same metrics
+  ------------------------------------------------------------------*/
+  check( PrimaryGrid_build_elements(cmp_prim, 0, NULL, NULL),
+      "PrimaryGrid_build_elements() failed." );
+
+  check( DualGrid_build(ref_dual, ref_dual->boundaries->bdry_def, 
+                        ref_prim)
+      && DualGrid_build(cmp_dual, cmp_dual->boundaries->bdry_def, 
+                        cmp_prim),
+      "DualGrid_build() failed." );
+
+  check( !memcmp(ref_dual->vol, cmp_dual->vol, 
+                 ref_dual->n_elements * sizeof(double))
+      && !memcmp(ref_dual->face_norms, cmp_dual->face_norms, 
+                 ref_dual->n_intr_faces * 2*sizeof(double)),
+      "Different metrics of the element store." );
+
+  DualGrid_destroy( dualgrid );
+  DualGrid_destroy( ref_dual );
+  DualGrid_destroy( cmp_dual );
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( ref_prim );
+  PrimaryGrid_destroy( cmp_prim );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_DualGrid_polygons() */
+
+/*********************************************************************
+* Checks the element edge map of a dualgrid against its faces
+*********************************************************************/
+static int check_edge_faces(const DualGrid *dualgrid)
+{
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
+  const int n_prims = primgrid->n_quads + primgrid->n_tris 
+                    + primgrid->n_polys;
+  int i, k, pos = 0;
+
+  check( dualgrid->edge_faces, "Missing element edge map." );
+
+  for ( i = 0; i < n_prims; i++ )
+  {
+    const int *verts = ICF_ELEM_VERTS(primgrid, i);
+    const int  n     = ICF_ELEM_N_VERTS(primgrid, i);
+
+    for ( k = 0; k < n; k++, pos++ )
+    {
+      const int  p0 = verts[k];
+      const int  p1 = verts[ k+1 < n ? k+1 : 0 ];
+      const int *f  = dualgrid->face_nbrs[ dualgrid->edge_faces[pos] ];
+
+      check( f[0] == MIN(p0, p1) && f[1] == MAX(p0, p1),
+          "Wrong face of edge %d of element %d.", k, i );
+    }
+  }
+
+  check( pos == dualgrid->n_edge_faces, 
+      "Wrong number of element edges." );
+
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    for ( k = 0; k < 4; k++ )
+      check( dualgrid->quad_faces[i][k] == dualgrid->edge_faces[4*i+k],
+          "Wrong view of the quad faces." );
+
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    for ( k = 0; k < 3; k++ )
+      check( dualgrid->tri_faces[i][k] 
+          == dualgrid->edge_faces[4*primgrid->n_quads + 3*i + k],
+          "Wrong view of the tri faces." );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* check_edge_faces() */
+
+/*********************************************************************
+* Test the map of the element edges to the dualgrid faces, which 
+* must follow the faces when they are sorted
+*********************************************************************/
+int test_DualGrid_edge_faces()
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(6, 5);
+  PrimaryGrid *polygrid = tests_create_polygrid();
+  DualGrid    *dualgrid = DualGrid_create();
+  DualGrid    *polydual = DualGrid_create();
+  int *counts = NULL;
+  int i, n_wrong = 0;
+
+  check( primgrid && polygrid, "Failed to create the test grids." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  tests_set_bdry_def( polydual->boundaries->bdry_def );
+
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid)
+      && DualGrid_build(polydual, polydual->boundaries->bdry_def, 
+                        polygrid),
+      "DualGrid_build() failed." );
+
+  check( dualgrid->n_edge_faces 
+      == 4 * primgrid->n_quads + 3 * primgrid->n_tris,
+      "Wrong size of the element edge map." );
+
+  check( check_edge_faces(dualgrid), "Wrong element edge map." );
+  check( check_edge_faces(polydual), "Wrong polygon edge map." );
+
+  /* The map has been taken over from the primary grid topology      */
+  check( !primgrid->elem_edges && !polygrid->elem_edges,
+      "Element edge map has not been taken over." );
+
+  /* Interior faces are shared by two element edges, boundary faces
+   * belong to a single one                                          */
+  counts = calloc(dualgrid->n_intr_faces, sizeof(int));
+  check_mem(counts);
+
+  for ( i = 0; i < dualgrid->n_edge_faces; i++ )
+    ++counts[ dualgrid->edge_faces[i] ];
+
+  for ( i = 0; i < dualgrid->n_intr_faces; i++ )
+    n_wrong += counts[i] != ( i < primgrid->n_intr_edges ? 2 : 1 );
+
+  free( counts );
+
+  check( n_wrong == 0, "Wrong number of element edges of %d faces.",
+      n_wrong );
+
+  /*------------------------------------------------------------------
+  | The map follows the sorted faces
+  ------------------------------------------------------------------*/
+  check( DualGrid_sort_faces(dualgrid), "DualGrid_sort_faces() failed." );
+  check( check_edge_faces(dualgrid), "Wrong map of the sorted faces." );
+
+  /*------------------------------------------------------------------
+  | The map is looked up in the adjacency without the topology map
+  ------------------------------------------------------------------*/
+  check( DualGrid_build_edge_faces(polydual) 
+      && check_edge_faces(polydual), "Wrong looked up polygon map." );
+
+  free( dualgrid->edge_faces );
+  dualgrid->edge_faces = NULL;
+
+  check( DualGrid_compute_metrics(dualgrid) 
+      && check_edge_faces(dualgrid), "Wrong map of the metrics." );
+
+  DualGrid_destroy( dualgrid );
+  DualGrid_destroy( polydual );
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( polygrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_DualGrid_edge_faces() */
+
+/*********************************************************************
+* Test sorting of the dualgrid faces by their elements
+*********************************************************************/
+int test_DualGrid_sort_faces()
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(6, 5);
+  DualGrid    *dualgrid = DualGrid_create();
+  int    (*nbrs)[2]  = NULL;
+  double (*norms)[2] = NULL;
+  int i, j, k;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, primgrid);
+
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = dualgrid->n_intr_faces;
+  const int n_intr  = primgrid->n_intr_edges;
+
+  nbrs  = calloc(n_faces, 2*sizeof(int));
+  norms = calloc(n_faces, 2*sizeof(double));
+  memcpy(nbrs,  dualgrid->face_nbrs,  n_faces * 2 * sizeof(int));
+  memcpy(norms, dualgrid->face_norms, n_faces * 2 * sizeof(double));
+
+  check( DualGrid_sort_faces( dualgrid ), 
+      "DualGrid_sort_faces() failed." );
+
+  check( dualgrid->n_intr_faces == n_faces,
+      "Wrong number of sorted faces." );
+
+  check( check_adjacency(dualgrid), 
+      "Wrong dualgrid adjacency after sorting." );
+
+  /*------------------------------------------------------------------
+  | Faces are sorted within the interior range and the boundary tail
+  ------------------------------------------------------------------*/
+  for ( i = 1; i < n_faces; i++ )
+  {
+    const int *f0 = dualgrid->face_nbrs[i-1];
+    const int *f1 = dualgrid->face_nbrs[i];
+
+    if ( i == n_intr )
+      continue;
+
+    check( f0[0] < f1[0] || ( f0[0] == f1[0] && f0[1] < f1[1] ),
+        "Faces %d and %d are not sorted.", i-1, i );
+  }
+
+  /*------------------------------------------------------------------
+  | The row pointers cover all faces of their first element
+  ------------------------------------------------------------------*/
+  check( dualgrid->face_ptr[0] == 0 
+      && dualgrid->face_ptr[n_elems] == n_intr
+      && dualgrid->bdry_face_ptr[0] == n_intr
+      && dualgrid->bdry_face_ptr[n_elems] == n_faces,
+      "Wrong face row pointers." );
+
+  for ( i = 0; i < n_elems; i++ )
+  {
+    for ( j = dualgrid->face_ptr[i]; j < dualgrid->face_ptr[i+1]; j++ )
+      check( dualgrid->face_nbrs[j][0] == i, 
+          "Wrong face row pointer of element %d.", i );
+
+    for ( j = dualgrid->bdry_face_ptr[i]; 
+          j < dualgrid->bdry_face_ptr[i+1]; j++ )
+      check( dualgrid->face_nbrs[j][0] == i, 
+          "Wrong boundary face row pointer of element %d.", i );
+  }
+
+  /*------------------------------------------------------------------
+  | Every original face is found with its normal in its range
+  ------------------------------------------------------------------*/
+  for ( i = 0; i < n_faces; i++ )
+  {
+    const int *ptr = ( i < n_intr ) ? dualgrid->face_ptr 
+                                    : dualgrid->bdry_face_ptr;
+    const int  p0  = nbrs[i][0];
+    int found = 0;
+
+    for ( j = ptr[p0]; j < ptr[p0+1]; j++ )
+    {
+      if ( dualgrid->face_nbrs[j][1] != nbrs[i][1] )
+        continue;
+
+      for ( k = 0; k < 2; k++ )
+        check( dualgrid->face_norms[j][k] == norms[i][k],
+            "Wrong normal of sorted face %d.", j );
+
+      found = 1;
+    }
+
+    check( found, "Face %d was lost while sorting.", i );
+  }
+
+  free( nbrs );
+  free( norms );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  free( nbrs );
+  free( norms );
+  return ICF_ERROR;
+
+} /* test_DualGrid_sort_faces() */
+
+
+/*********************************************************************
+* Scatter loop over a block of faces for test_DualGrid_color_faces()
+*********************************************************************/
+typedef struct 
+{
+  const DualGrid *dualgrid;
+  long           *res;
+} ColorTestCtx;
+
+static void color_test_task(void *ctx, 
+                            int   i_start, 
+                            int   i_end, 
+                            int   i_thread)
+{
+  ColorTestCtx *c = ctx;
+  int f;
+
+  for ( f = i_start; f < i_end; f++ )
+  {
+    c->res[ c->dualgrid->face_nbrs[f][0] ] += f + 1;
+    c->res[ c->dualgrid->face_nbrs[f][1] ] -= 2 * ( f + 1 );
+  }
+
+} /* color_test_task() */
+
+/*********************************************************************
+* Test the coloring of dualgrid faces and the parallel face loop
+*********************************************************************/
+int test_DualGrid_color_faces()
+{
+  static const int block_sizes[3] = { 1, 4, 16 };
+
+  PrimaryGrid *primgrid = tests_create_primgrid(12, 9);
+  DualGrid    *dualgrid = DualGrid_create();
+  ThreadPool  *pool     = ThreadPool_create(3);
+  int  *elem_color = NULL;
+  int  *elem_block = NULL;
+  int  *face_seen  = NULL;
+  long *res        = NULL;
+  long *ref        = NULL;
+  int    color_faces[16];
+  double color_imbalance[16];
+  int i_bs, balance, i, j, c;
+
+  check( primgrid && pool, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+  check( DualGrid_sort_faces(dualgrid), "DualGrid_sort_faces() failed." );
+
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = dualgrid->n_intr_faces;
+
+  elem_color = calloc(n_elems, sizeof(int));
+  elem_block = calloc(n_elems, sizeof(int));
+  face_seen  = calloc(n_faces, sizeof(int));
+  res        = calloc(n_elems, sizeof(long));
+  ref        = calloc(n_elems, sizeof(long));
+
+  for ( i = 0; i < n_faces; i++ )
+  {
+    ref[ dualgrid->face_nbrs[i][0] ] += i + 1;
+    ref[ dualgrid->face_nbrs[i][1] ] -= 2 * ( i + 1 );
+  }
+
+  for ( i_bs = 0; i_bs < 3; i_bs++ )
+  for ( balance = 0; balance < 2; balance++ )
+  {
+    const int bs = block_sizes[i_bs];
+
+    check( DualGrid_color_faces( dualgrid, bs, balance ),
+        "DualGrid_color_faces() failed." );
+
+    check( dualgrid->n_colors > 1 && dualgrid->n_colors < 16
+        && dualgrid->color_block_size == bs
+        && dualgrid->color_ptr[0] == 0 
+        && dualgrid->color_ptr[dualgrid->n_colors] == (n_faces+bs-1) / bs,
+        "Wrong number of colors: %d", dualgrid->n_colors );
+
+    /*----------------------------------------------------------------
+    | Every face has one color and blocks of one color do not share 
+    | any element
+    ----------------------------------------------------------------*/
+    memset(elem_color, 0, n_elems * sizeof(int));
+    memset(face_seen,  0, n_faces * sizeof(int));
+
+    for ( c = 0; c < dualgrid->n_colors; c++ )
+      color_faces[c] = 0;
+
+    for ( c = 0; c < dualgrid->n_colors; c++ )
+      for ( j = dualgrid->color_ptr[c]; j < dualgrid->color_ptr[c+1]; j++ )
+      {
+        const int b = dualgrid->color_blocks[j];
+        int f;
+
+        color_faces[c] += MIN( (b+1) * bs, n_faces ) - b * bs;
+
+        check( j == dualgrid->color_ptr[c] 
+            || dualgrid->color_blocks[j-1] < b,
+            "Blocks of color %d are not ordered.", c );
+
+        for ( f = b * bs; f < MIN( (b+1) * bs, n_faces ); f++ )
+        {
+          check( face_seen[f] == 0, "Face %d has two colors.", f );
+          face_seen[f] = 1;
+
+          for ( i = 0; i < 2; i++ )
+          {
+            const int p = dualgrid->face_nbrs[f][i];
+
+            check( elem_color[p] != c+1 || elem_block[p] == b, 
+                "Element %d appears in two blocks of color %d.", p, c );
+
+            elem_color[p] = c+1;
+            elem_block[p] = b;
+          }
+        }
+      }
+
+    for ( i = 0; i < n_faces; i++ )
+      check( face_seen[i], "Face %d has no color.", i );
+
+    /*----------------------------------------------------------------
+    | The imbalance of every color is its number of faces in relation
+    | to the mean and the overall imbalance is the largest of them
+    ----------------------------------------------------------------*/
+    const double imbalance = DualGrid_color_imbalance(dualgrid, 
+                                                      color_imbalance);
+    double max_imbalance = 0.0;
+
+    for ( c = 0; c < dualgrid->n_colors; c++ )
+    {
+      const double ref_imbalance = (double) color_faces[c] 
+        * (double) dualgrid->n_colors / (double) n_faces;
+
+      check( EQ(color_imbalance[c], ref_imbalance), 
+          "Wrong imbalance %lf of color %d.", color_imbalance[c], c );
+
+      max_imbalance = MAX( max_imbalance, color_imbalance[c] );
+    }
+
+    check( EQ(imbalance, max_imbalance), 
+        "Wrong coloring imbalance: %lf", imbalance );
+
+    if ( balance && bs == 1 )
+      check( imbalance < 1.1, "Coloring is not balanced: %lf", imbalance );
+
+    /*----------------------------------------------------------------
+    | The colored loop yields the result of the serial loop
+    ----------------------------------------------------------------*/
+    ColorTestCtx ctx = { dualgrid, res };
+
+    memset(res, 0, n_elems * sizeof(long));
+    DualGrid_color_loop(dualgrid, pool, color_test_task, &ctx);
+
+    for ( i = 0; i < n_elems; i++ )
+      check( res[i] == ref[i], "Wrong result of colored loop." );
+
+    memset(res, 0, n_elems * sizeof(long));
+    DualGrid_color_loop(dualgrid, NULL, color_test_task, &ctx);
+
+    for ( i = 0; i < n_elems; i++ )
+      check( res[i] == ref[i], "Wrong result of serial colored loop." );
+  }
+
+  free( elem_color );
+  free( elem_block );
+  free( face_seen );
+  free( res );
+  free( ref );
+  ThreadPool_destroy( pool );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  free( elem_color );
+  free( elem_block );
+  free( face_seen );
+  free( res );
+  free( ref );
+  if ( pool )
+    ThreadPool_destroy( pool );
+  return ICF_ERROR;
+
+} /* test_DualGrid_color_faces() */
+
+
+/*********************************************************************
+* Test the extraction of partition-local dualgrids: The owned 
+* elements must keep their global metrics, every boundary edge must 
+* be owned by exactly one partition and the send lists must match 
+* the receive lists of the neighbors
+*********************************************************************/
+int test_DualGrid_extract_partition()
+{
+  enum { N_PARTS = 6 };
+
+  PrimaryGrid *primgrid = tests_create_primgrid(12, 10);
+  DualGrid    *dualgrid = DualGrid_create();
+  DualGrid    *parts[N_PARTS] = { NULL };
+  int         *part     = NULL;
+  int          n_bdry_edges[4] = { 0 };
+  double       total_vol = 0.0;
+  Boundary    *bdry;
+  int i, j, k, p, q;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  /* Split the unit square into 3 x 2 blocks */
+  part = calloc(dualgrid->n_elements, sizeof(int));
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+  {
+    const int ix = MIN( (int) (3.0 * dualgrid->xy[i][0]), 2 );
+    const int iy = MIN( (int) (2.0 * dualgrid->xy[i][1]), 1 );
+    part[i] = ix + 3 * iy;
+  }
+
+  check( !DualGrid_extract_partition(dualgrid, 
+                                     dualgrid->boundaries->bdry_def,
+                                     part, N_PARTS, N_PARTS),
+      "Extraction of an invalid partition succeeded." );
+
+  for ( p = 0; p < N_PARTS; p++ )
+  {
+    parts[p] = DualGrid_extract_partition(dualgrid, 
+                                          dualgrid->boundaries->bdry_def,
+                                          part, N_PARTS, p);
+    check( parts[p], "Failed to extract partition %d.", p );
+    check( check_adjacency(parts[p]), 
+        "Wrong adjacency of partition %d.", p );
+
+    const DualGridHalo *halo = parts[p]->halo;
+    const int          *gidx = halo->global_index;
+
+    check( halo->n_owned + halo->n_ghosts == parts[p]->n_elements,
+        "Wrong number of elements in partition %d.", p );
+
+    /*----------------------------------------------------------------
+    | Owned elements keep their volumes and face normals
+    ----------------------------------------------------------------*/
+    for ( i = 0; i < halo->n_owned; i++ )
+    {
+      check( part[gidx[i]] == p, "Element %d is not owned.", gidx[i] );
+      check( EQ(parts[p]->vol[i], dualgrid->vol[gidx[i]]),
+          "Wrong volume of element %d.", gidx[i] );
+
+      total_vol += parts[p]->vol[i];
+
+      for ( j = parts[p]->elem_face_ptr[i]; 
+            j < parts[p]->elem_face_ptr[i+1]; j++ )
+      {
+        const int     f  = parts[p]->elem_faces[j];
+        const int     s  = parts[p]->elem_face_signs[j];
+        const int     g  = gidx[ parts[p]->elem_nbrs[j] ];
+        const double *n0 = parts[p]->face_norms[f];
+
+        for ( k = dualgrid->elem_face_ptr[gidx[i]]; 
+              k < dualgrid->elem_face_ptr[gidx[i]+1] 
+              && dualgrid->elem_nbrs[k] != g; k++ );
+
+        check( k < dualgrid->elem_face_ptr[gidx[i]+1],
+            "Face (%d,%d) is not a dualgrid face.", gidx[i], g );
+
+        const int     gs = dualgrid->elem_face_signs[k];
+        const double *n1 = dualgrid->face_norms[ dualgrid->elem_faces[k] ];
+
+        check( EQ(s*n0[0], gs*n1[0]) && EQ(s*n0[1], gs*n1[1]),
+            "Wrong normal of face (%d,%d).", gidx[i], g );
+      }
+    }
+
+    /*----------------------------------------------------------------
+    | Count the local boundary edges, that start at an owned vertex
+    ----------------------------------------------------------------*/
+    for ( bdry = parts[p]->boundaries->start, k = 0; bdry; 
+          bdry = bdry->next, k++ )
+      for ( i = 0; i < bdry->n_bdry_edges; i++ )
+        if ( bdry->bdry_edges[i][0] < halo->n_owned )
+          ++n_bdry_edges[k];
+  }
+
+  check( EQ(total_vol, 1.0), "Wrong volume of owned elements." );
+
+  for ( bdry = dualgrid->boundaries->start, k = 0; bdry; 
+        bdry = bdry->next, k++ )
+    check( n_bdry_edges[k] == bdry->n_bdry_edges,
+        "Wrong number of local edges of boundary %d.", k );
+
+  /*------------------------------------------------------------------
+  | The send lists must match the receive lists of the neighbors
+  ------------------------------------------------------------------*/
+  for ( p = 0; p < N_PARTS; p++ )
+  {
+    const DualGridHalo *hp = parts[p]->halo;
+
+    for ( i = 0; i < hp->n_nbr_parts; i++ )
+    {
+      const DualGridHalo *hq = parts[ hp->nbr_parts[i] ]->halo;
+
+      for ( j = 0; j < hq->n_nbr_parts && hq->nbr_parts[j] != p; j++ );
+
+      check( j < hq->n_nbr_parts, 
+          "Partitions %d and %d are not mutual neighbors.", 
+          p, hp->nbr_parts[i] );
+
+      const int n_send = hp->send_ptr[i+1] - hp->send_ptr[i];
+      const int n_recv = hq->recv_ptr[j+1] - hq->recv_ptr[j];
+
+      check( n_send > 0 && n_send == n_recv,
+          "Wrong halo size between partitions %d and %d.",
+          p, hp->nbr_parts[i] );
+
+      for ( q = 0; q < n_send; q++ )
+      {
+        const int s = hp->global_index[ hp->send_idx[hp->send_ptr[i]+q] ];
+        const int r = hq->global_index[ hq->recv_idx[hq->recv_ptr[j]+q] ];
+
+        check( s == r && part[s] == p, 
+            "Send and receive lists of partitions %d and %d differ.",
+            p, hp->nbr_parts[i] );
+      }
+    }
+  }
+
+  for ( p = 0; p < N_PARTS; p++ )
+    DualGrid_destroy( parts[p] );
+
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  free( part );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_DualGrid_extract_partition() */
+
 /*********************************************************************
 * 
 *********************************************************************/
@@ -310,12 +1440,33 @@ int run_tests_DualGrid()
   check( test_DualGrid_create_destroy(), 
       "> test_DualGrid_create_destroy() failed" ); 
 
+  check( test_DualGrid_adjacency(), 
+      "> test_DualGrid_adjacency() failed" ); 
+
+  check( test_DualGrid_polygons(), 
+      "> test_DualGrid_polygons() failed" ); 
+
+  check( test_DualGrid_edge_faces(), 
+      "> test_DualGrid_edge_faces() failed" ); 
+
+  check( test_DualGrid_sort_faces(), 
+      "> test_DualGrid_sort_faces() failed" ); 
+
+  check( test_DualGrid_color_faces(), 
+      "> test_DualGrid_color_faces() failed" ); 
+
+  check( test_DualGrid_extract_partition(), 
+      "> test_DualGrid_extract_partition() failed" ); 
+
   check( test_DualGrid_build_boundaries(), 
       "> test_DualGrid_build_boundaries() failed" ); 
 
   check( test_DualGrid_build(), 
       "> test_DualGrid_build() failed" ); 
 
+  check( test_DualGrid_cache(), 
+      "> test_DualGrid_cache() failed" ); 
+
   fprintf(stderr, "> test_DualGrid() succeeded\n");
   return ICF_SUCCESS;
 
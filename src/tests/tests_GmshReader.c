@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "GmshReader.h"
+#include "PrimaryGrid.h"
+
+static const char *test_msh = "icf_test_grid.msh";
+
+/*********************************************************************
+* Helper functions to write Gmsh values in ASCII or binary format
+*********************************************************************/
+static void msh_int(FILE *fptr, int binary, int val)
+{
+  int32_t i32 = val;
+  if ( binary )
+    fwrite(&i32, sizeof(int32_t), 1, fptr);
+  else
+    fprintf(fptr, "%d ", val);
+}
+
+static void msh_size(FILE *fptr, int binary, int val)
+{
+  uint64_t u64 = val;
+  if ( binary )
+    fwrite(&u64, sizeof(uint64_t), 1, fptr);
+  else
+    fprintf(fptr, "%d ", val);
+}
+
+static void msh_double(FILE *fptr, int binary, double val)
+{
+  if ( binary )
+    fwrite(&val, sizeof(double), 1, fptr);
+  else
+    fprintf(fptr, "%.16g ", val);
+}
+
+static void msh_eol(FILE *fptr, int binary)
+{
+  if ( !binary )
+    fprintf(fptr, "\n");
+}
+
+/*********************************************************************
+* Writes a Gmsh file of one quad and one clockwise triangle with 
+* two physical boundary curves
+*
+*   4 ---- 3
+*   |      | \
+*   |      |  5
+*   |      | /
+*   1 ---- 2
+*********************************************************************/
+static void write_test_msh(const char *path, int binary)
+{
+  static const double xy[5][2] = { {0.0,0.0}, {1.0,0.0}, {1.0,1.0}, 
+                                   {0.0,1.0}, {2.0,0.5} };
+  static const int lines[5][2] = { {1,2}, {3,4}, {4,1}, {2,5}, {5,3} };
+  int i, j;
+
+  FILE *fptr = fopen(path, "wb");
+
+  fprintf(fptr, "$MeshFormat\n4.1 %d 8\n", binary);
+  if ( binary )
+  {
+    msh_int(fptr, binary, 1);
+    fprintf(fptr, "\n");
+  }
+  fprintf(fptr, "$EndMeshFormat\n");
+
+  fprintf(fptr, "$PhysicalNames\n2\n1 1 \"wall\"\n1 2 \"$outlet\"\n"
+                "$EndPhysicalNames\n");
+
+  /*------------------------------------------------------------------
+  | Entities: curve 1 -> physical 1, curve 2 -> physical 2
+  ------------------------------------------------------------------*/
+  fprintf(fptr, "$Entities\n");
+  msh_size(fptr, binary, 0);
+  msh_size(fptr, binary, 2);
+  msh_size(fptr, binary, 1);
+  msh_size(fptr, binary, 0);
+  msh_eol(fptr, binary);
+
+  for ( i = 1; i <= 2; i++ )
+  {
+    msh_int(fptr, binary, i);
+    for ( j = 0; j < 6; j++ )
+      msh_double(fptr, binary, 0.0);
+    msh_size(fptr, binary, 1);
+    msh_int(fptr, binary, i);
+    msh_size(fptr, binary, 0);
+    msh_eol(fptr, binary);
+  }
+
+  msh_int(fptr, binary, 1);
+  for ( j = 0; j < 6; j++ )
+    msh_double(fptr, binary, 0.0);
+  msh_size(fptr, binary, 0);
+  msh_size(fptr, binary, 2);
+  msh_int(fptr, binary, 1);
+  msh_int(fptr, binary, -2);
+  msh_eol(fptr, binary);
+  fprintf(fptr, "%s$EndEntities\n", binary ? "\n" : "");
+
+  /*------------------------------------------------------------------
+  | Nodes: block on curve 1 with nodes 1,2 and on the surface 
+  | with nodes 3,4,5
+  ------------------------------------------------------------------*/
+  fprintf(fptr, "$Nodes\n");
+  msh_size(fptr, binary, 2);
+  msh_size(fptr, binary, 5);
+  msh_size(fptr, binary, 1);
+  msh_size(fptr, binary, 5);
+  msh_eol(fptr, binary);
+
+  for ( i = 0; i < 2; i++ )
+  {
+    int first = ( i == 0 ) ? 1 : 3;
+    int n     = ( i == 0 ) ? 2 : 3;
+
+    msh_int(fptr, binary, i+1);
+    msh_int(fptr, binary, 1);
+    msh_int(fptr, binary, 0);
+    msh_size(fptr, binary, n);
+    msh_eol(fptr, binary);
+
+    for ( j = first; j < first + n; j++ )
+    {
+      msh_size(fptr, binary, j);
+      msh_eol(fptr, binary);
+    }
+
+    for ( j = first; j < first + n; j++ )
+    {
+      msh_double(fptr, binary, xy[j-1][0]);
+      msh_double(fptr, binary, xy[j-1][1]);
+      msh_double(fptr, binary, 0.0);
+      msh_eol(fptr, binary);
+    }
+  }
+  fprintf(fptr, "%s$EndNodes\n", binary ? "\n" : "");
+
+  /*------------------------------------------------------------------
+  | Elements: lines of both curves, one quad and one triangle
+  ------------------------------------------------------------------*/
+  fprintf(fptr, "$Elements\n");
+  msh_size(fptr, binary, 4);
+  msh_size(fptr, binary, 7);
+  msh_size(fptr, binary, 1);
+  msh_size(fptr, binary, 7);
+  msh_eol(fptr, binary);
+
+  for ( i = 0; i < 2; i++ )
+  {
+    int first = ( i == 0 ) ? 0 : 3;
+    int n     = ( i == 0 ) ? 3 : 2;
+
+    msh_int(fptr, binary, 1);
+    msh_int(fptr, binary, i+1);
+    msh_int(fptr, binary, ICF_GMSH_LINE);
+    msh_size(fptr, binary, n);
+    msh_eol(fptr, binary);
+
+    for ( j = first; j < first + n; j++ )
+    {
+      msh_size(fptr, binary, j+1);
+      msh_size(fptr, binary, lines[j][0]);
+      msh_size(fptr, binary, lines[j][1]);
+      msh_eol(fptr, binary);
+    }
+  }
+
+  msh_int(fptr, binary, 2);
+  msh_int(fptr, binary, 1);
+  msh_int(fptr, binary, ICF_GMSH_QUAD);
+  msh_size(fptr, binary, 1);
+  msh_eol(fptr, binary);
+  for ( j = 6; j <= 10; j++ )
+    msh_size(fptr, binary, ( j == 6 ) ? 6 : j - 6);
+  msh_eol(fptr, binary);
+
+  msh_int(fptr, binary, 2);
+  msh_int(fptr, binary, 1);
+  msh_int(fptr, binary, ICF_GMSH_TRI);
+  msh_size(fptr, binary, 1);
+  msh_eol(fptr, binary);
+  msh_size(fptr, binary, 7);
+  msh_size(fptr, binary, 2);
+  msh_size(fptr, binary, 3);
+  msh_size(fptr, binary, 5);
+  msh_eol(fptr, binary);
+  fprintf(fptr, "%s$EndElements\n", binary ? "\n" : "");
+
+  fclose(fptr);
+}
+
+/*********************************************************************
+* Test reading of Gmsh files in ASCII and binary format
+*********************************************************************/
+int test_GmshReader_read_primgrid()
+{
+  static const int markers[5] = { 1, 1, 1, 2, 2 };
+  int binary, i;
+
+  for ( binary = 0; binary < 2; binary++ )
+  {
+    PrimaryGrid *primgrid = PrimaryGrid_create();
+
+    write_test_msh(test_msh, binary);
+
+    check( GmshReader_read_primgrid( test_msh, primgrid, 2 ),
+      "> GmshReader_read_primgrid() failed");
+
+    check( primgrid->n_vertices == 5,
+      "> GmshReader_read_primgrid() failed");
+    check( primgrid->n_quads == 1 && primgrid->n_tris == 1,
+      "> GmshReader_read_primgrid() failed");
+    check( primgrid->n_bdry_edges == 5 && primgrid->n_intr_edges == 1,
+      "> GmshReader_read_primgrid() failed");
+
+    check( primgrid->vertex_coords[4][0] == 2.0 
+        && primgrid->vertex_coords[4][1] == 0.5,
+      "> GmshReader_read_primgrid() failed");
+
+    for ( i = 0; i < 5; i++ )
+      check( primgrid->bdry_edge_marker[i] == markers[i],
+        "> GmshReader_read_primgrid() failed");
+
+    /* The clockwise triangle must be reoriented                    */
+    check( primgrid->tris[0][0] == 1 && primgrid->tris[0][1] == 4 
+        && primgrid->tris[0][2] == 2,
+      "> GmshReader_read_primgrid() failed");
+
+    check( primgrid->quad_neighbors[0][1] == 1 
+        && primgrid->tri_neighbors[0][2] == 0,
+      "> GmshReader_read_primgrid() failed");
+    check( primgrid->intr_edge_nbrs[0][0] == 0 
+        && primgrid->intr_edge_nbrs[0][1] == 1,
+      "> GmshReader_read_primgrid() failed");
+    check( primgrid->bdry_edge_nbrs[3] == 1,
+      "> GmshReader_read_primgrid() failed");
+
+    PrimaryGrid_destroy( primgrid );
+  }
+
+  remove( test_msh );
+
+  return ICF_SUCCESS;
+
+error:
+  remove( test_msh );
+  return ICF_ERROR;
+
+} /* test_GmshReader_read_primgrid() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_GmshReader()
+{
+  check( test_GmshReader_read_primgrid(), 
+      "> test_GmshReader_read_primgrid() failed" ); 
+
+  fprintf(stderr, "> test_GmshReader() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_GmshReader() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_GmshReader() */
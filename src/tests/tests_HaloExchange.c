@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Partition.h"
+#include "HaloExchange.h"
+
+#include "run_tests.h"
+
+/*********************************************************************
+* Context of the smoothing workers
+*********************************************************************/
+typedef struct
+{
+  int n_iter;
+  int fail_part;
+
+} SmoothCtx;
+
+/*********************************************************************
+* Initial values of the smoothing test
+*********************************************************************/
+static inline void smooth_init(const double xy[2], double u[2])
+{
+  u[0] = xy[0] + 2.0 * xy[1] * xy[1];
+  u[1] = sin( 3.0 * xy[0] ) * xy[1];
+
+} /* smooth_init() */
+
+/*********************************************************************
+* One smoothing step for the first <n_elems> elements of a dualgrid: 
+* Every value is replaced by the mean of its own value and the mean 
+* of its neighbor values
+*********************************************************************/
+static void smooth_step(const DualGrid *dualgrid, int n_elems,
+                        const double *u, double *u_new)
+{
+  int i, j, v;
+
+  for ( i = 0; i < n_elems; i++ )
+  {
+    const int j_start = dualgrid->elem_face_ptr[i];
+    const int j_end   = dualgrid->elem_face_ptr[i+1];
+
+    for ( v = 0; v < 2; v++ )
+    {
+      double sum = 0.0;
+
+      for ( j = j_start; j < j_end; j++ )
+        sum += u[ 2 * dualgrid->elem_nbrs[j] + v ];
+
+      u_new[2*i+v] = 0.5 * u[2*i+v] + 0.5 * sum / ( j_end - j_start );
+    }
+  }
+
+} /* smooth_step() */
+
+/*********************************************************************
+* Worker, that smoothes the values of its partition and exchanges 
+* the ghost values after every step
+*********************************************************************/
+static int smooth_worker(HaloExchange *hx, void *ctx)
+{
+  const SmoothCtx *sctx     = ctx;
+  const DualGrid  *dualgrid = hx->dualgrid;
+  const int        n_owned  = dualgrid->halo->n_owned;
+  const int        n_loc    = dualgrid->n_elements;
+
+  double *u     = calloc(2 * n_loc, sizeof(double));
+  double *u_new = calloc(2 * n_loc, sizeof(double));
+  double  vol = 0.0, total_vol = 0.0;
+  int i, it;
+
+  check( hx->part != sctx->fail_part, "Planned failure." );
+
+  for ( i = 0; i < n_owned; i++ )
+    smooth_init(dualgrid->xy[i], &u[2*i]);
+
+  check( HaloExchange_update(hx, u, 2), "Halo exchange failed." );
+
+  for ( it = 0; it < sctx->n_iter; it++ )
+  {
+    smooth_step(dualgrid, n_owned, u, u_new);
+    memcpy(u, u_new, 2 * n_owned * sizeof(double));
+
+    check( HaloExchange_update(hx, u, 2), "Halo exchange failed." );
+  }
+
+  for ( i = 0; i < n_owned; i++ )
+    vol += dualgrid->vol[i];
+
+  check( HaloExchange_sum(hx, vol, &total_vol), "Reduction failed." );
+  check( fabs(total_vol - 1.0) < 1.0E-12, "Wrong total volume." );
+
+  HaloExchange_store(hx, u, 2);
+
+  free( u );
+  free( u_new );
+
+  return ICF_SUCCESS;
+
+error:
+  free( u );
+  free( u_new );
+
+  return ICF_ERROR;
+
+} /* smooth_worker() */
+
+/*********************************************************************
+* Test the execution of partitions in forked workers: The smoothed 
+* values must match a serial computation on the global dualgrid 
+* and a failing worker must not block the other workers
+*********************************************************************/
+int test_HaloExchange_run()
+{
+  PrimaryGrid *primgrid  = tests_create_primgrid(30, 24);
+  DualGrid    *dualgrid  = DualGrid_create();
+  Partition   *partition = Partition_create();
+  SmoothCtx    ctx       = { 10, -1 };
+  double      *u = NULL, *u_new = NULL, *result = NULL;
+  int i, it;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  check( Partition_kway(partition, dualgrid, NULL, 5),
+      "Partition_kway() failed." );
+
+  const int n_elems = dualgrid->n_elements;
+
+  u      = calloc(2 * n_elems, sizeof(double));
+  u_new  = calloc(2 * n_elems, sizeof(double));
+  result = calloc(2 * n_elems, sizeof(double));
+
+  for ( i = 0; i < n_elems; i++ )
+    smooth_init(dualgrid->xy[i], &u[2*i]);
+
+  for ( it = 0; it < ctx.n_iter; it++ )
+  {
+    smooth_step(dualgrid, n_elems, u, u_new);
+    memcpy(u, u_new, 2 * n_elems * sizeof(double));
+  }
+
+  check( HaloExchange_run(dualgrid, dualgrid->boundaries->bdry_def,
+                          partition->part, partition->n_parts, 2, 
+                          result, smooth_worker, &ctx),
+      "HaloExchange_run() failed." );
+
+  for ( i = 0; i < 2 * n_elems; i++ )
+    check( fabs(result[i] - u[i]) < 1.0E-12, 
+        "Wrong value of element %d.", i / 2 );
+
+  /*------------------------------------------------------------------
+  | A failing child process of the host, which is not a worker, must
+  | not be taken for one of the workers
+  ------------------------------------------------------------------*/
+  pid_t other = fork();
+
+  if ( other == 0 )
+    _exit(1);
+
+  check( other > 0, "Failed to fork a child process." );
+
+  memset(result, 0, 2 * n_elems * sizeof(double));
+
+  check( HaloExchange_run(dualgrid, dualgrid->boundaries->bdry_def,
+                          partition->part, partition->n_parts, 2, 
+                          result, smooth_worker, &ctx),
+      "HaloExchange_run() failed with another child process." );
+
+  for ( i = 0; i < 2 * n_elems; i++ )
+    check( fabs(result[i] - u[i]) < 1.0E-12, 
+        "Wrong value of element %d with another child process.", i / 2 );
+
+  ctx.fail_part = 3;
+
+  check( !HaloExchange_run(dualgrid, dualgrid->boundaries->bdry_def,
+                           partition->part, partition->n_parts, 2, 
+                           NULL, smooth_worker, &ctx),
+      "Failure of a worker was not detected." );
+
+  Partition_destroy( partition );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  free( u );
+  free( u_new );
+  free( result );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_HaloExchange_run() */
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_HaloExchange()
+{
+  check( test_HaloExchange_run(), 
+      "> test_HaloExchange_run() failed" ); 
+
+  fprintf(stderr, "> test_HaloExchange() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_HaloExchange() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_HaloExchange() */
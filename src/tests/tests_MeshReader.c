@@ -10,6 +10,32 @@
 #include "DualGrid.h"
 
 static const char *test_grid = "/datadisk/Code/C-Code/SimpleSolver/input/grid/TestGrid.dat";
+static const char *test_lean = "icf_test_grid.dat";
+
+/*********************************************************************
+* Writes a lean grid file of a quad and a triangle, whose vertex 
+* section holds the number of entries <n_verts>
+*
+*   3 ---- 2
+*   |      | \
+*   |      |  4
+*   |      | /
+*   0 ---- 1
+*********************************************************************/
+static void write_test_lean(const char *path, const char *n_verts)
+{
+  FILE *fptr = fopen(path, "w");
+
+  fprintf(fptr, "VERTICES %s\n", n_verts);
+  fprintf(fptr, "0.0,0.0\n1.0,0.0\n1.0,1.0\n0.0,1.0\n2.0,0.5\n");
+  fprintf(fptr, "TRIANGLES 1\n1,4,2\n");
+  fprintf(fptr, "QUADS 1\n0,1,2,3\n");
+  fprintf(fptr, "BOUNDARYEDGES 5\n");
+  fprintf(fptr, "0,1,1\n2,3,1\n3,0,1\n1,4,2\n4,2,2\n");
+
+  fclose(fptr);
+
+} /* write_test_lean() */
 
 /*********************************************************************
 * Test creation / destruction of MeshReader structure 
@@ -112,19 +138,329 @@ error:
 
 } /* test_MeshReader_read_primgrid() */
 
+/*********************************************************************
+* Test single-pass streaming of primary grid with MeshReader 
+*********************************************************************/
+int test_MeshReader_stream_primgrid()
+{
+  write_test_lean(test_lean, "5");
+
+  MeshReader *mesh_reader = MeshReader_create_stream( test_lean );
+  check( mesh_reader, "> MeshReader_create_stream() failed");
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  check( MeshReader_stream_primgrid( mesh_reader, primgrid ),
+    "> MeshReader_stream_primgrid() failed");
+
+  check( primgrid->n_vertices == 5,
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->n_tris == 1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->n_quads == 1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->n_intr_edges == 1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->n_bdry_edges == 5, 
+    "> MeshReader_stream_primgrid() failed");
+
+  check( EQ(primgrid->vertex_coords[4][0], 2.0)
+      && EQ(primgrid->vertex_coords[4][1], 0.5), 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->tris[0][1] == 4, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->quads[0][3] == 3, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->tri_neighbors[0][2] == 0, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->quad_neighbors[0][1] == 1
+      && primgrid->quad_neighbors[0][3] == -1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->intr_edges[0][0] == 1
+      && primgrid->intr_edges[0][1] == 2, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->intr_edge_nbrs[0][0] == 0
+      && primgrid->intr_edge_nbrs[0][1] == 1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->bdry_edges[3][1] == 4, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->bdry_edge_nbrs[2] == 0
+      && primgrid->bdry_edge_nbrs[3] == 1, 
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->bdry_edge_marker[3] == 2, 
+    "> MeshReader_stream_primgrid() failed");
+
+  PrimaryGrid_destroy( primgrid );
+
+  MeshReader_destroy( mesh_reader );
+
+  remove(test_lean);
+
+  return ICF_SUCCESS;
+
+error:
+  remove(test_lean);
+  return ICF_ERROR;
+
+} /* test_MeshReader_stream_primgrid() */
+
+/*********************************************************************
+* Test streaming of primary grid from a memory mapped file 
+*********************************************************************/
+int test_MeshReader_mmap_primgrid()
+{
+  write_test_lean(test_lean, "5");
+
+  MeshReader *mesh_reader = MeshReader_create_mmap( test_lean );
+  check( mesh_reader, "> MeshReader_create_mmap() failed");
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  check( MeshReader_stream_primgrid( mesh_reader, primgrid ),
+    "> MeshReader_stream_primgrid() failed");
+
+  check( primgrid->n_vertices == 5,
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->n_tris == 1, 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->n_quads == 1, 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->n_intr_edges == 1, 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->n_bdry_edges == 5, 
+    "> MeshReader_create_mmap() failed");
+
+  check( EQ(primgrid->vertex_coords[2][1], 1.0), 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->quads[0][2] == 2, 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->intr_edge_nbrs[0][1] == 1, 
+    "> MeshReader_create_mmap() failed");
+  check( primgrid->bdry_edge_marker[3] == 2, 
+    "> MeshReader_create_mmap() failed");
+
+  PrimaryGrid_destroy( primgrid );
+
+  MeshReader_destroy( mesh_reader );
 
+  remove(test_lean);
+
+  return ICF_SUCCESS;
+
+error:
+  remove(test_lean);
+  return ICF_ERROR;
+
+} /* test_MeshReader_mmap_primgrid() */
+
+/*********************************************************************
+* Test multithreaded reading of primary grid 
+*********************************************************************/
+int test_MeshReader_read_primgrid_parallel()
+{
+  write_test_lean(test_lean, "5");
+
+  MeshReader *mesh_reader = MeshReader_create_mmap( test_lean );
+  check( mesh_reader, "> MeshReader_create_mmap() failed");
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+
+  check( MeshReader_read_primgrid_parallel( mesh_reader, primgrid, 4 ),
+    "> MeshReader_read_primgrid_parallel() failed");
+
+  check( primgrid->n_vertices == 5,
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->n_tris == 1, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->n_quads == 1, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->n_intr_edges == 1, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->n_bdry_edges == 5, 
+    "> MeshReader_read_primgrid_parallel() failed");
+
+  check( EQ(primgrid->vertex_coords[4][0], 2.0), 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->tris[0][2] == 2, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->tri_neighbors[0][2] == 0, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->intr_edges[0][0] == 1, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->bdry_edges[4][0] == 4
+      && primgrid->bdry_edge_marker[4] == 2, 
+    "> MeshReader_read_primgrid_parallel() failed");
+  check( primgrid->bdry_edge_nbrs[4] == 1, 
+    "> MeshReader_read_primgrid_parallel() failed");
+
+  PrimaryGrid_destroy( primgrid );
+
+  MeshReader_destroy( mesh_reader );
+
+  remove(test_lean);
+
+  return ICF_SUCCESS;
+
+error:
+  remove(test_lean);
+  return ICF_ERROR;
+
+} /* test_MeshReader_read_primgrid_parallel() */
+
+/*********************************************************************
+* Test that section sizes beyond INT_MAX are rejected by the 
+* streaming and the multithreaded reader, instead of being 
+* truncated to a valid size (2^32 + 5 -> 5)
+*********************************************************************/
+int test_MeshReader_section_size()
+{
+  MeshReader  *mesh_reader = NULL;
+  PrimaryGrid *primgrid    = NULL;
+
+  write_test_lean(test_lean, "5");
+
+  mesh_reader = MeshReader_create_stream( test_lean );
+  primgrid    = PrimaryGrid_create();
+
+  check( MeshReader_stream_primgrid( mesh_reader, primgrid ),
+    "> MeshReader_stream_primgrid() failed");
+  check( primgrid->n_vertices == 5 && primgrid->n_intr_edges == 1,
+    "> MeshReader_stream_primgrid() failed");
+
+  PrimaryGrid_destroy( primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  write_test_lean(test_lean, "4294967301");
+
+  mesh_reader = MeshReader_create_stream( test_lean );
+  primgrid    = PrimaryGrid_create();
+
+  check( !MeshReader_stream_primgrid( mesh_reader, primgrid ),
+    "> MeshReader_stream_primgrid() failed");
+
+  PrimaryGrid_destroy( primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  mesh_reader = MeshReader_create_mmap( test_lean );
+  primgrid    = PrimaryGrid_create();
+
+  check( !MeshReader_read_primgrid_parallel( mesh_reader, primgrid, 2 ),
+    "> MeshReader_read_primgrid_parallel() failed");
+
+  PrimaryGrid_destroy( primgrid );
+  MeshReader_destroy( mesh_reader );
+
+  remove(test_lean);
+
+  return ICF_SUCCESS;
+
+error:
+  if ( primgrid )
+    PrimaryGrid_destroy( primgrid );
+  if ( mesh_reader )
+    MeshReader_destroy( mesh_reader );
+
+  remove(test_lean);
+
+  return ICF_ERROR;
+
+} /* test_MeshReader_section_size() */
+
+/*********************************************************************
+* Test the keyword index of a list of lines
+*********************************************************************/
+int test_MeshReader_keyword_index()
+{
+  bstring txt = bfromcstr( "# Parameter file\n"
+                           "Mesh file: grid.dat\n"
+                           "Mesh size: 0.25\n"
+                           "TRIANGLENEIGHBORS 2\n"
+                           "1,2,3\n"
+                           "  TRIANGLES 7\n"
+                           "Mesh size: 0.5\n"
+                           "Markers: 1, 2,3\n" );
+  struct bstrList *txtlist = bsplit(txt, '\n');
+  bstrIndex *index = bstrlib_index_create(txtlist);
+
+  int     line = -1;
+  int     ival = 0;
+  double  dval = 0.0;
+  int    *iarr = NULL;
+  bstring sval = NULL;
+
+  check( index != NULL, "bstrlib_index_create() failed" );
+
+  check( bstrlib_index_find(index, "TRIANGLES", &line) == 1, 
+      "bstrlib_index_find() failed" );
+  check( line == 5, "bstrlib_index_find() failed" );
+
+  check( bstrlib_index_find(index, "QUADS", &line) == 0, 
+      "bstrlib_index_find() failed" );
+  check( bstrlib_index_find(index, "1,2,3", &line) == 0, 
+      "bstrlib_index_find() failed" );
+
+  check( bstrlib_index_extract_param(index, "TRIANGLENEIGHBORS", 
+                                     0, &ival) == 1, 
+      "bstrlib_index_extract_param() failed" );
+  check( ival == 2, "bstrlib_index_extract_param() failed" );
+
+  /* Last definition of a specifier is used */
+  check( bstrlib_index_extract_param(index, "Mesh size:", 
+                                     1, &dval) == 2, 
+      "bstrlib_index_extract_param() failed" );
+  check( EQ(dval, 0.5), "bstrlib_index_extract_param() failed" );
+
+  check( bstrlib_index_extract_param(index, "Mesh file:", 
+                                     2, &sval) == 1, 
+      "bstrlib_index_extract_param() failed" );
+  check( biseqcstr(sval, " grid.dat"), 
+      "bstrlib_index_extract_param() failed" );
+
+  check( bstrlib_index_extract_array(index, "Markers:", 
+                                     0, &iarr) == 1, 
+      "bstrlib_index_extract_array() failed" );
+  check( iarr[0] == 1 && iarr[1] == 2 && iarr[2] == 3, 
+      "bstrlib_index_extract_array() failed" );
+
+  free( iarr );
+  bdestroy( sval );
+  bstrlib_index_destroy( index );
+  bstrListDestroy( txtlist );
+  bdestroy( txt );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_MeshReader_keyword_index() */
 
 /*********************************************************************
 * 
 *********************************************************************/
 int run_tests_MeshReader()
 {
+  check( test_MeshReader_keyword_index(), 
+      "> test_MeshReader_keyword_index() failed" ); 
+
+  check( test_MeshReader_section_size(), 
+      "> test_MeshReader_section_size() failed" ); 
+
   check( test_MeshReader_create_destroy(), 
       "> test_MeshReader_create_destroy() failed" ); 
 
   check( test_MeshReader_read_primgrid(), 
       "> test_MeshReader_read_primgrid() failed" ); 
 
+  check( test_MeshReader_stream_primgrid(), 
+      "> test_MeshReader_stream_primgrid() failed" ); 
+
+  check( test_MeshReader_mmap_primgrid(), 
+      "> test_MeshReader_mmap_primgrid() failed" ); 
+
+  check( test_MeshReader_read_primgrid_parallel(), 
+      "> test_MeshReader_read_primgrid_parallel() failed" ); 
+
   fprintf(stderr, "> test_MeshReader() succeeded\n");
   return ICF_SUCCESS;
 
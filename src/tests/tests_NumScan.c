@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "NumScan.h"
+
+/*********************************************************************
+* Test parsing of single doubles against strtod()
+*********************************************************************/
+int test_NumScan_double()
+{
+  const char *values[] = {
+    "0.1", "-0.0", "1.5", "3.", "-.5", "1e23", "5e-324",
+    "0.0033333333333333", "-12.3456789012345678",
+    "9007199254740993", "4503599627370497.5",
+    "2.2250738585072014e-308", "1.7976931348623157e308",
+    "1.00000000000000011102230246251565404236316680908203125",
+    "12345678.87654321", "0.000000001234567890123456789",
+    "00000000000000000000123.25", "1234567890123456789012.5",
+  };
+  int n_values = sizeof(values) / sizeof(values[0]);
+  int i;
+
+  for ( i = 0; i < n_values; i++ )
+  {
+    const char *pos = values[i];
+    const char *end = values[i] + strlen(values[i]);
+    double val = 0.0;
+    double ref = strtod(values[i], NULL);
+
+    check( NumScan_double(&pos, end, &val), 
+        "NumScan_double() failed for %s", values[i]);
+    check( pos == end, 
+        "NumScan_double() failed for %s", values[i]);
+    check( memcmp(&val, &ref, sizeof(double)) == 0, 
+        "NumScan_double() is not correctly rounded for %s", values[i]);
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_NumScan_double() */
+
+/*********************************************************************
+* Test parsing of comma-separated rows
+*********************************************************************/
+int test_NumScan_rows()
+{
+  const char *txt = "1, 2,3\r\n-4,5,6\n7,8x,9\n1,2,3,4\n0.5,-1.5e2\n";
+  const char *pos = txt;
+  const char *end = txt + strlen(txt);
+
+  int    ivals[3];
+  double dvals[2];
+
+  check( NumScan_row_ints(&pos, end, ivals, 3) == 3, 
+      "NumScan_row_ints() failed");
+  check( ivals[0] == 1 && ivals[1] == 2 && ivals[2] == 3,
+      "NumScan_row_ints() failed");
+
+  check( NumScan_row_ints(&pos, end, ivals, 3) == 3, 
+      "NumScan_row_ints() failed");
+  check( ivals[0] == -4 && ivals[1] == 5 && ivals[2] == 6,
+      "NumScan_row_ints() failed");
+
+  /* Malformed value and too many values */
+  check( NumScan_row_ints(&pos, end, ivals, 3) == -1, 
+      "NumScan_row_ints() failed");
+  check( NumScan_row_ints(&pos, end, ivals, 3) == -1, 
+      "NumScan_row_ints() failed");
+
+  check( NumScan_row_doubles(&pos, end, dvals, 2) == 2, 
+      "NumScan_row_doubles() failed");
+  check( EQ(dvals[0], 0.5) && EQ(dvals[1], -150.0),
+      "NumScan_row_doubles() failed");
+  check( pos == end, "NumScan_row_doubles() failed");
+
+  /* Line utilities */
+  check( NumScan_count_lines(txt, end) == 5, 
+      "NumScan_count_lines() failed");
+  check( NumScan_skip_lines(txt, end, 2) == strstr(txt, "7,8x"), 
+      "NumScan_skip_lines() failed");
+  check( NumScan_find_eol(txt, end) == strchr(txt, '\n'), 
+      "NumScan_find_eol() failed");
+
+  /* Digit runs, which are parsed word by word */
+  const char *wide = "000000002147483647,-2147483648,123456789\n"
+                     "2147483648,1\n";
+  pos = wide;
+  end = wide + strlen(wide);
+
+  check( NumScan_row_ints(&pos, end, ivals, 3) == 3, 
+      "NumScan_row_ints() failed for long digit runs");
+  check( ivals[0] == INT_MAX && ivals[1] == INT_MIN 
+      && ivals[2] == 123456789,
+      "NumScan_row_ints() failed for long digit runs");
+  check( NumScan_row_ints(&pos, end, ivals, 3) == -1 && pos == end, 
+      "NumScan_row_ints() accepted an integer overflow");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_NumScan_rows() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_NumScan()
+{
+  check( test_NumScan_double(), 
+      "> test_NumScan_double() failed" ); 
+
+  check( test_NumScan_rows(), 
+      "> test_NumScan_rows() failed" ); 
+
+  fprintf(stderr, "> test_NumScan() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_NumScan() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_NumScan() */
@@ -0,0 +1,584 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "ThreadPool.h"
+#include "ParticleTracker.h"
+
+#include "run_tests.h"
+
+/*********************************************************************
+* Returns a pseudo-random number in [0, 1)
+*********************************************************************/
+static double test_rand(unsigned *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return (double) ( ( *state >> 8 ) & 0xFFFFFFu ) / (double) 0x1000000u;
+
+} /* test_rand() */
+
+/*********************************************************************
+* Creates the test grid and a particle tracker with the boundary 
+* types of tests_set_bdry_def():
+* bottom: INLET, right: WALL, top: OUTLET, left: WALL
+*********************************************************************/
+static ParticleTracker *create_tracker(PrimaryGrid **primgrid, 
+                                       BoundaryDef **bdry_def)
+{
+  ParticleTracker *tracker = ParticleTracker_create();
+
+  *primgrid = tests_create_primgrid(12, 9);
+  *bdry_def = BoundaryDef_create();
+
+  check( tracker && *primgrid && *bdry_def, 
+      "Failed to create the test data." );
+
+  tests_set_bdry_def( *bdry_def );
+
+  check( ParticleTracker_init(tracker, *primgrid, *bdry_def),
+      "ParticleTracker_init() failed." );
+
+  return tracker;
+
+error:
+  return NULL;
+
+} /* create_tracker() */
+
+/*********************************************************************
+* Creates a vertex field f = a + b*x + c*y
+*********************************************************************/
+static double *create_field(const PrimaryGrid *primgrid, 
+                            double a, double b, double c)
+{
+  double *field = calloc(primgrid->n_vertices, sizeof(double));
+  int i;
+
+  if ( !field )
+    return NULL;
+
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+    field[i] = a + b * primgrid->vertex_coords[i][0] 
+                 + c * primgrid->vertex_coords[i][1];
+
+  return field;
+
+} /* create_field() */
+
+/*********************************************************************
+* Test the interpolation of a linear field, which must be exact
+*********************************************************************/
+int test_ParticleTracker_interpolate()
+{
+  const int n_points = 3000;
+
+  unsigned         seed = 3;
+  PrimaryGrid     *primgrid;
+  BoundaryDef     *bdry_def;
+  ParticleTracker *tracker = create_tracker(&primgrid, &bdry_def);
+  ThreadPool      *pool    = ThreadPool_create(3);
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  double  *values = calloc(n_points, sizeof(double));
+  double  *field;
+  int i;
+
+  check( tracker && pool && xy && values, 
+      "Failed to create the test data." );
+
+  field = create_field(primgrid, 1.0, 2.0, -3.0);
+  check_mem(field);
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = 1.2 * test_rand(&seed) - 0.1;
+    xy[i][1] = 1.2 * test_rand(&seed) - 0.1;
+  }
+
+  check( ParticleTracker_add(tracker, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+
+  check( tracker->n_particles > n_points / 2 
+      && tracker->n_particles < n_points,
+      "Wrong number of particles inside of the grid." );
+
+  ParticleTracker_interpolate(tracker, pool, field, values);
+
+  for ( i = 0; i < tracker->n_particles; i++ )
+  {
+    const double x = tracker->x[i];
+    const double y = tracker->y[i];
+
+    check( x >= 0.0 && x <= 1.0 && y >= 0.0 && y <= 1.0,
+        "Particle %d outside of the grid.", i );
+    check( fabs( values[i] - ( 1.0 + 2.0 * x - 3.0 * y ) ) < 1.0E-12,
+        "Wrong interpolated value %e of particle %d.", values[i], i );
+  }
+
+  free( field );
+  free( xy );
+  free( values );
+  ThreadPool_destroy( pool );
+  ParticleTracker_destroy( tracker );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_ParticleTracker_interpolate() */
+
+/*********************************************************************
+* Test the outflow of tracer particles through the top boundary and 
+* the compaction of the particle arrays
+*********************************************************************/
+int test_ParticleTracker_outlet()
+{
+  const int    n_points = 1000;
+  const double dt       = 0.5;
+
+  unsigned         seed = 5;
+  PrimaryGrid     *primgrid;
+  BoundaryDef     *bdry_def;
+  ParticleTracker *tracker = create_tracker(&primgrid, &bdry_def);
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  double  *u_field, *v_field;
+  int i, n_exit = 0;
+
+  check( tracker && xy, "Failed to create the test data." );
+
+  u_field = create_field(primgrid, 0.0, 0.0, 0.0);
+  v_field = create_field(primgrid, 1.0, 0.0, 0.0);
+  check_mem(u_field);
+  check_mem(v_field);
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = 0.05 + 0.9 * test_rand(&seed);
+    xy[i][1] = 0.2  + 0.7 * test_rand(&seed);
+
+    if ( xy[i][1] + dt > 1.0 )
+      ++n_exit;
+  }
+
+  check( ParticleTracker_add(tracker, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+  check( tracker->n_particles == n_points, 
+      "Wrong number of particles." );
+
+  check( ParticleTracker_step(tracker, NULL, u_field, v_field, dt),
+      "ParticleTracker_step() failed." );
+
+  /* More than ICF_PARTICLE_COMPACT of the particles exited, such 
+   * that the arrays have been compacted                            */
+  check( tracker->n_exited == n_exit, "Wrong number of exits." );
+  check( tracker->n_particles == n_points - n_exit 
+      && tracker->n_inactive == 0,
+      "The particle arrays have not been compacted." );
+
+  for ( i = 0; i < tracker->n_particles; i++ )
+  {
+    const int id = tracker->id[i];
+
+    check( id >= 0 && id < n_points, "Wrong particle id %d.", id );
+    check( tracker->state[i] == ICF_PARTICLE_ACTIVE,
+        "Inactive particle %d after compaction.", id );
+    check( fabs( tracker->x[i] - xy[id][0] ) < 1.0E-12 
+        && fabs( tracker->y[i] - xy[id][1] - dt ) < 1.0E-12,
+        "Wrong position of particle %d.", id );
+    check( i == 0 || tracker->elem[i-1] <= tracker->elem[i],
+        "Particles are not sorted by their elements." );
+  }
+
+  free( u_field );
+  free( v_field );
+  free( xy );
+  ParticleTracker_destroy( tracker );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_ParticleTracker_outlet() */
+
+/*********************************************************************
+* Test the reflection and deposition of particles at the walls
+*********************************************************************/
+int test_ParticleTracker_wall()
+{
+  const int    n_points = 1000;
+  const double dt       = 0.5;
+  const double e        = 0.5;
+  const double tau      = 0.1;
+  const double u_p      = 1.0 - exp( -dt / tau );
+
+  unsigned         seed = 9;
+  PrimaryGrid     *primgrid;
+  BoundaryDef     *bdry_def;
+  ParticleTracker *tracker = create_tracker(&primgrid, &bdry_def);
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  double  *u_field, *v_field;
+  int i, n_wall = 0;
+
+  check( tracker && xy, "Failed to create the test data." );
+
+  u_field = create_field(primgrid, 1.0, 0.0, 0.0);
+  v_field = create_field(primgrid, 0.0, 0.0, 0.0);
+  check_mem(u_field);
+  check_mem(v_field);
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = 0.05 + 0.6 * test_rand(&seed);
+    xy[i][1] = 0.05 + 0.9 * test_rand(&seed);
+
+    if ( xy[i][0] + dt * u_p > 1.0 )
+      ++n_wall;
+  }
+
+  check( n_wall > 0 && n_wall < ICF_PARTICLE_COMPACT * n_points,
+      "Bad test setup." );
+
+  /*------------------------------------------------------------------
+  | Reflection of inertial particles at the right wall
+  ------------------------------------------------------------------*/
+  tracker->tau         = tau;
+  tracker->restitution = e;
+
+  check( ParticleTracker_add(tracker, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+  check( ParticleTracker_step(tracker, NULL, u_field, v_field, dt),
+      "ParticleTracker_step() failed." );
+  check( tracker->n_particles == n_points && tracker->n_inactive == 0, 
+      "Particles have left the grid." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const double x_end = xy[i][0] + dt * u_p;
+    const double x_ref = ( x_end > 1.0 ) ? 1.0 - e * ( x_end - 1.0 ) 
+                                         : x_end;
+    const double u_ref = ( x_end > 1.0 ) ? -e * u_p : u_p;
+
+    check( fabs( tracker->x[i] - x_ref ) < 1.0E-12 
+        && fabs( tracker->y[i] - xy[i][1] ) < 1.0E-12,
+        "Wrong position of particle %d.", i );
+    check( fabs( tracker->u[i] - u_ref ) < 1.0E-12,
+        "Wrong velocity of particle %d.", i );
+  }
+
+  /*------------------------------------------------------------------
+  | Deposition of the particles at the right wall
+  ------------------------------------------------------------------*/
+  check( ParticleTracker_init(tracker, primgrid, bdry_def),
+      "ParticleTracker_init() failed." );
+
+  tracker->tau     = tau;
+  tracker->deposit = 1;
+
+  check( ParticleTracker_add(tracker, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+  check( ParticleTracker_step(tracker, NULL, u_field, v_field, dt),
+      "ParticleTracker_step() failed." );
+  check( tracker->n_deposited == n_wall && tracker->n_exited == 0,
+      "Wrong number of deposited particles." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const double x_end = xy[i][0] + dt * u_p;
+
+    if ( x_end > 1.0 )
+    {
+      check( tracker->state[i] == ICF_PARTICLE_DEPOSITED 
+          && fabs( tracker->x[i] - 1.0 ) < 1.0E-12,
+          "Particle %d has not been deposited.", i );
+    }
+    else
+    {
+      check( tracker->state[i] == ICF_PARTICLE_ACTIVE 
+          && fabs( tracker->x[i] - x_end ) < 1.0E-12,
+          "Wrong position of particle %d.", i );
+    }
+  }
+
+  free( u_field );
+  free( v_field );
+  free( xy );
+  ParticleTracker_destroy( tracker );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_ParticleTracker_wall() */
+
+/*********************************************************************
+* Test that threaded steps in a vortex give the same results as 
+* serial steps and that all particles stay in their host elements
+*********************************************************************/
+int test_ParticleTracker_threads()
+{
+  const int    n_points = 5000;
+  const int    n_steps  = 20;
+  const double dt       = 0.05;
+
+  unsigned         seed = 13;
+  PrimaryGrid     *primgrid;
+  BoundaryDef     *bdry_def;
+  ParticleTracker *serial   = create_tracker(&primgrid, &bdry_def);
+  ParticleTracker *threaded = ParticleTracker_create();
+  ThreadPool      *pool     = ThreadPool_create(3);
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  double  *u_field, *v_field;
+  int i, step;
+
+  check( serial && threaded && pool && xy, 
+      "Failed to create the test data." );
+  check( ParticleTracker_init(threaded, primgrid, bdry_def),
+      "ParticleTracker_init() failed." );
+
+  /* Solid body rotation around the center of the grid               */
+  u_field = create_field(primgrid,  0.5, 0.0, -1.0);
+  v_field = create_field(primgrid, -0.5, 1.0,  0.0);
+  check_mem(u_field);
+  check_mem(v_field);
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = test_rand(&seed);
+    xy[i][1] = test_rand(&seed);
+  }
+
+  serial->tau   = threaded->tau   = 0.02;
+  serial->restitution = threaded->restitution = 0.8;
+
+  check( ParticleTracker_add(serial, n_points, 
+                             (const double (*)[2]) xy, NULL)
+      && ParticleTracker_add(threaded, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+
+  for ( step = 0; step < n_steps; step++ )
+  {
+    check( ParticleTracker_step(serial, NULL, u_field, v_field, dt)
+        && ParticleTracker_step(threaded, pool, u_field, v_field, dt),
+        "ParticleTracker_step() failed." );
+  }
+
+  check( serial->n_particles == threaded->n_particles
+      && serial->n_exited == threaded->n_exited
+      && serial->n_exited > 0,
+      "Different number of particles." );
+
+  for ( i = 0; i < serial->n_particles; i++ )
+  {
+    check( serial->id[i]    == threaded->id[i] 
+        && serial->elem[i]  == threaded->elem[i]
+        && serial->state[i] == threaded->state[i]
+        && serial->x[i] == threaded->x[i] 
+        && serial->y[i] == threaded->y[i]
+        && serial->u[i] == threaded->u[i] 
+        && serial->v[i] == threaded->v[i],
+        "Different results of particle %d.", serial->id[i] );
+
+    if ( serial->state[i] == ICF_PARTICLE_ACTIVE )
+    {
+      const PrimaryGrid *g    = primgrid;
+      const int          elem = serial->elem[i];
+      const int         *v    = ICF_ELEM_VERTS(g, elem);
+      const int          n    = ICF_ELEM_N_VERTS(g, elem);
+      double area = 0.0, sum = 0.0;
+      int k;
+
+      for ( k = 0; k < n; k++ )
+      {
+        const double *a = g->vertex_coords[v[k]];
+        const double *b = g->vertex_coords[v[(k+1) % n]];
+        const double  x = serial->x[i];
+        const double  y = serial->y[i];
+
+        area += a[0] * b[1] - b[0] * a[1];
+        sum  += fabs( ( a[0] - x ) * ( b[1] - y ) 
+                    - ( b[0] - x ) * ( a[1] - y ) );
+      }
+
+      check( fabs( sum - fabs(area) ) <= 1.0E-9 * fabs(area),
+          "Particle %d is not in its host element.", serial->id[i] );
+    }
+  }
+
+  free( u_field );
+  free( v_field );
+  free( xy );
+  ThreadPool_destroy( pool );
+  ParticleTracker_destroy( serial );
+  ParticleTracker_destroy( threaded );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_ParticleTracker_threads() */
+
+/*********************************************************************
+* Test the tracking of particles into and within the polygons of 
+* the element store: A particle is moved from a quad into the 
+* pentagon, another one is reflected at the pentagon wall and 
+* linear fields are interpolated exactly within the polygons
+*********************************************************************/
+int test_ParticleTracker_polygons()
+{
+  const int    n_points = 500;
+  const double dt       = 0.5;
+  const double e        = 0.5;
+  const double xy_ref[2][2] = { { 1.5, 0.25 }, { 0.3, 0.75 } };
+
+  unsigned         seed     = 11;
+  PrimaryGrid     *primgrid = tests_create_polygrid();
+  BoundaryDef     *bdry_def = BoundaryDef_create();
+  ParticleTracker *tracker  = ParticleTracker_create();
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  double  *values = calloc(n_points, sizeof(double));
+  double  *u_field = NULL;
+  double  *v_field = NULL;
+  double  *field   = NULL;
+  int i;
+
+  check( primgrid && bdry_def && tracker && xy && values, 
+      "Failed to create the test data." );
+  check( primgrid->n_polys == 1, "Bad test setup." );
+
+  tests_set_bdry_def( bdry_def );
+
+  check( ParticleTracker_init(tracker, primgrid, bdry_def),
+      "ParticleTracker_init() failed." );
+
+  u_field = create_field(primgrid, -2.0, 0.0, 0.0);
+  v_field = create_field(primgrid,  0.0, 0.0, 0.0);
+  field   = create_field(primgrid,  1.0, 2.0, -3.0);
+  check_mem(u_field);
+  check_mem(v_field);
+  check_mem(field);
+
+  /*------------------------------------------------------------------
+  | Particle 0 moves from quad 0 into the pentagon (element 4), 
+  | particle 1 is reflected at the left wall of the pentagon
+  ------------------------------------------------------------------*/
+  tracker->restitution = e;
+
+  check( ParticleTracker_add(tracker, 2, xy_ref, NULL),
+      "ParticleTracker_add() failed." );
+  check( tracker->elem[0] == 0 && tracker->elem[1] == 4,
+      "Wrong initial host elements." );
+
+  check( ParticleTracker_step(tracker, NULL, u_field, v_field, dt),
+      "ParticleTracker_step() failed." );
+  check( tracker->n_exited == 0 && tracker->n_deposited == 0,
+      "Particles have left the grid." );
+
+  check( tracker->elem[0] == 4 
+      && fabs( tracker->x[0] - 0.5  ) < 1.0E-12
+      && fabs( tracker->y[0] - 0.25 ) < 1.0E-12,
+      "Wrong position of the particle in the pentagon." );
+
+  check( tracker->elem[1] == 4 
+      && fabs( tracker->x[1] - e * 0.7 ) < 1.0E-12
+      && fabs( tracker->y[1] - 0.75    ) < 1.0E-12,
+      "Wrong reflection at the pentagon wall." );
+
+  check( ParticleTracker_compact(tracker), 
+      "ParticleTracker_compact() failed." );
+  check( tracker->n_particles == 2, "Wrong number of particles." );
+
+  /*------------------------------------------------------------------
+  | Interpolation of a linear field in all elements
+  ------------------------------------------------------------------*/
+  check( ParticleTracker_init(tracker, primgrid, bdry_def),
+      "ParticleTracker_init() failed." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = 2.0 * test_rand(&seed);
+    xy[i][1] = test_rand(&seed);
+  }
+
+  check( ParticleTracker_add(tracker, n_points, 
+                             (const double (*)[2]) xy, NULL),
+      "ParticleTracker_add() failed." );
+  check( tracker->n_particles == n_points, 
+      "Particles in the polygons have not been located." );
+
+  ParticleTracker_interpolate(tracker, NULL, field, values);
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const double x = tracker->x[i];
+    const double y = tracker->y[i];
+
+    check( fabs( values[i] - ( 1.0 + 2.0 * x - 3.0 * y ) ) < 1.0E-12,
+        "Wrong interpolated value %e of particle %d.", values[i], i );
+  }
+
+  free( u_field );
+  free( v_field );
+  free( field );
+  free( xy );
+  free( values );
+  ParticleTracker_destroy( tracker );
+  BoundaryDef_destroy( bdry_def );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_ParticleTracker_polygons() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_ParticleTracker()
+{
+  check( test_ParticleTracker_interpolate(), 
+      "> test_ParticleTracker_interpolate() failed" ); 
+
+  check( test_ParticleTracker_outlet(), 
+      "> test_ParticleTracker_outlet() failed" ); 
+
+  check( test_ParticleTracker_wall(), 
+      "> test_ParticleTracker_wall() failed" ); 
+
+  check( test_ParticleTracker_threads(), 
+      "> test_ParticleTracker_threads() failed" ); 
+
+  check( test_ParticleTracker_polygons(), 
+      "> test_ParticleTracker_polygons() failed" ); 
+
+  fprintf(stderr, "> test_ParticleTracker() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_ParticleTracker() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_ParticleTracker() */
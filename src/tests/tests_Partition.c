@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Partition.h"
+
+#include "run_tests.h"
+
+/*********************************************************************
+* Checks a partition of a dualgrid: All partitions are non-empty 
+* and the weights and the edge-cut match the partition vector
+*********************************************************************/
+static int check_partition(Partition *partition, 
+                           DualGrid  *dualgrid,
+                           const int *weights)
+{
+  long *pwgts = calloc(partition->n_parts, sizeof(long));
+  long  cut   = 0;
+  int i;
+
+  check( partition->n_elements == dualgrid->n_elements,
+      "Wrong number of partitioned elements." );
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+  {
+    const int p = partition->part[i];
+
+    check( p >= 0 && p < partition->n_parts, 
+        "Invalid partition %d of element %d.", p, i );
+
+    pwgts[p] += weights ? weights[i] : 1;
+  }
+
+  for ( i = 0; i < partition->n_parts; i++ )
+    check( pwgts[i] > 0 && pwgts[i] == partition->part_weights[i],
+        "Wrong weight of partition %d.", i );
+
+  for ( i = 0; i < dualgrid->n_intr_faces; i++ )
+    if ( partition->part[dualgrid->face_nbrs[i][0]] 
+      != partition->part[dualgrid->face_nbrs[i][1]] )
+      ++cut;
+
+  check( cut == partition->edge_cut, "Wrong edge-cut." );
+
+  free( pwgts );
+  return ICF_SUCCESS;
+
+error:
+  free( pwgts );
+  return ICF_ERROR;
+
+} /* check_partition() */
+
+/*********************************************************************
+* Creates a strip of nx x ny quads, which is wound up to a spiral 
+* with a gap of ny between its turns. The bisections of the RCB 
+* partitioner cut through several turns, while an optimal partition 
+* cuts the strip across in (k-1) places, i.e. at (ny+1) faces each.
+* The boundary markers are 1 (outer), 2 (end), 3 (inner) and 
+* 4 (start).
+*********************************************************************/
+static PrimaryGrid *create_spiral_grid(int nx, int ny)
+{
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+  const double pitch = 2.0 * ny;
+  const double two_pi = 8.0 * atan(1.0);
+  double theta = 0.0;
+  int i, j, k;
+
+  primgrid->n_vertices   = (nx+1) * (ny+1);
+  primgrid->n_quads      = nx * ny;
+  primgrid->n_bdry_edges = 2 * (nx + ny);
+
+  primgrid->vertex_coords    = calloc(primgrid->n_vertices, 2*sizeof(double));
+  primgrid->quads            = calloc(primgrid->n_quads, 4*sizeof(int));
+  primgrid->bdry_edges       = calloc(primgrid->n_bdry_edges, 2*sizeof(int));
+  primgrid->bdry_edge_marker = calloc(primgrid->n_bdry_edges, sizeof(int));
+
+#define SPIRAL_VERTEX(i, j) ( (j)*(nx+1) + (i) )
+
+  /* Vertices of unit spacing, where j runs from outside to inside    */
+  for ( i = 0; i <= nx; i++ )
+  {
+    const double r_inner = pitch * ( 1.0 + theta / two_pi );
+
+    for ( j = 0; j <= ny; j++ )
+    {
+      const double r = r_inner + ny - j;
+      primgrid->vertex_coords[SPIRAL_VERTEX(i,j)][0] = r * cos(theta);
+      primgrid->vertex_coords[SPIRAL_VERTEX(i,j)][1] = r * sin(theta);
+    }
+
+    theta += 1.0 / r_inner;
+  }
+
+  for ( j = 0; j < ny; j++ )
+    for ( i = 0; i < nx; i++ )
+    {
+      int *q = primgrid->quads[j*nx + i];
+      q[0] = SPIRAL_VERTEX(i,   j);
+      q[1] = SPIRAL_VERTEX(i+1, j);
+      q[2] = SPIRAL_VERTEX(i+1, j+1);
+      q[3] = SPIRAL_VERTEX(i,   j+1);
+    }
+
+  k = 0;
+  for ( i = 0; i < nx; i++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]      = SPIRAL_VERTEX(i,   0);
+    primgrid->bdry_edges[k][1]      = SPIRAL_VERTEX(i+1, 0);
+    primgrid->bdry_edge_marker[k]   = 1;
+    primgrid->bdry_edges[k+1][0]    = SPIRAL_VERTEX(i+1, ny);
+    primgrid->bdry_edges[k+1][1]    = SPIRAL_VERTEX(i,   ny);
+    primgrid->bdry_edge_marker[k+1] = 3;
+  }
+  for ( j = 0; j < ny; j++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]      = SPIRAL_VERTEX(nx, j);
+    primgrid->bdry_edges[k][1]      = SPIRAL_VERTEX(nx, j+1);
+    primgrid->bdry_edge_marker[k]   = 2;
+    primgrid->bdry_edges[k+1][0]    = SPIRAL_VERTEX(0,  j+1);
+    primgrid->bdry_edges[k+1][1]    = SPIRAL_VERTEX(0,  j);
+    primgrid->bdry_edge_marker[k+1] = 4;
+  }
+
+#undef SPIRAL_VERTEX
+
+  check( PrimaryGrid_build_topology( primgrid, 1 ),
+      "PrimaryGrid_build_topology() failed.");
+
+  return primgrid;
+
+error:
+  PrimaryGrid_destroy( primgrid );
+  return NULL;
+
+} /* create_spiral_grid() */
+
+/*********************************************************************
+* Test partitioning by recursive coordinate bisection and with the
+* multilevel k-way partitioner
+*********************************************************************/
+int test_Partition_rcb_kway()
+{
+  static const int n_parts[5] = { 1, 2, 5, 8, 16 };
+
+  /* Fixed bounds of the multilevel edge-cut without RCB fallback   */
+  static const long max_ml_cut[5] = { 0, 36, 150, 225, 390 };
+
+  PrimaryGrid *primgrid  = tests_create_primgrid(40, 30);
+  DualGrid    *dualgrid  = DualGrid_create();
+  Partition   *partition = Partition_create();
+  int i;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  for ( i = 0; i < 5; i++ )
+  {
+    const int k = n_parts[i];
+    long rcb_cut, ml_cut;
+
+    check( Partition_rcb(partition, dualgrid, NULL, k),
+        "Partition_rcb() failed." );
+    check( check_partition(partition, dualgrid, NULL),
+        "Wrong RCB partition into %d parts.", k );
+    check( partition->imbalance < 1.01,
+        "RCB partition into %d parts is imbalanced: %lf", 
+        k, partition->imbalance );
+
+    rcb_cut = partition->edge_cut;
+
+    check( Partition_multilevel(partition, dualgrid, NULL, k),
+        "Partition_multilevel() failed." );
+    check( check_partition(partition, dualgrid, NULL),
+        "Wrong multilevel partition into %d parts.", k );
+    check( partition->imbalance <= 1.0 + ICF_PART_UBFACTOR + 0.01,
+        "Multilevel partition into %d parts is imbalanced: %lf", 
+        k, partition->imbalance );
+    check( partition->edge_cut <= max_ml_cut[i],
+        "Multilevel edge-cut %ld into %d parts is above %ld", 
+        partition->edge_cut, k, max_ml_cut[i] );
+
+    ml_cut = partition->edge_cut;
+
+    check( Partition_kway(partition, dualgrid, NULL, k),
+        "Partition_kway() failed." );
+    check( check_partition(partition, dualgrid, NULL),
+        "Wrong k-way partition into %d parts.", k );
+    check( partition->imbalance <= 1.0 + ICF_PART_UBFACTOR + 0.01,
+        "K-way partition into %d parts is imbalanced: %lf", 
+        k, partition->imbalance );
+    check( partition->edge_cut <= rcb_cut 
+        && partition->edge_cut <= ml_cut,
+        "K-way edge-cut %ld is above the RCB edge-cut %ld or the "
+        "multilevel edge-cut %ld", partition->edge_cut, rcb_cut, ml_cut );
+  }
+
+  check( !Partition_kway(partition, dualgrid, NULL, 0),
+      "Partition_kway() accepted zero partitions." );
+
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  Partition_destroy( partition );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_Partition_rcb_kway() */
+
+/*********************************************************************
+* Test the multilevel k-way partitioner on a spiral strip, where it 
+* must find a cut close to the optimal one and where it must be kept 
+* over the RCB partition by Partition_kway()
+*********************************************************************/
+int test_Partition_multilevel_spiral()
+{
+  static const int n_parts[4] = { 2, 4, 8, 16 };
+  const int nx = 300, ny = 4;
+
+  PrimaryGrid *primgrid  = create_spiral_grid(nx, ny);
+  DualGrid    *dualgrid  = DualGrid_create();
+  Partition   *partition = Partition_create();
+  int i;
+
+  check( primgrid, "Failed to create the spiral grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  for ( i = 0; i < 4; i++ )
+  {
+    const int  k       = n_parts[i];
+    const long opt_cut = (long) (ny+1) * (k-1);
+    long rcb_cut, ml_cut;
+
+    check( Partition_rcb(partition, dualgrid, NULL, k),
+        "Partition_rcb() failed." );
+
+    rcb_cut = partition->edge_cut;
+
+    check( Partition_multilevel(partition, dualgrid, NULL, k),
+        "Partition_multilevel() failed." );
+    check( check_partition(partition, dualgrid, NULL),
+        "Wrong multilevel partition into %d parts.", k );
+    check( partition->imbalance <= 1.0 + ICF_PART_UBFACTOR + 0.01,
+        "Multilevel partition into %d parts is imbalanced: %lf", 
+        k, partition->imbalance );
+    check( partition->edge_cut <= opt_cut + k
+        && 2 * partition->edge_cut < rcb_cut,
+        "Multilevel edge-cut %ld into %d parts is not close to %ld "
+        "or not below half the RCB edge-cut %ld", 
+        partition->edge_cut, k, opt_cut, rcb_cut );
+
+    ml_cut = partition->edge_cut;
+
+    check( Partition_kway(partition, dualgrid, NULL, k),
+        "Partition_kway() failed." );
+    check( partition->edge_cut == ml_cut,
+        "K-way edge-cut %ld differs from the multilevel edge-cut %ld", 
+        partition->edge_cut, ml_cut );
+  }
+
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  Partition_destroy( partition );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_Partition_multilevel_spiral() */
+
+/*********************************************************************
+* Test partitioning with larger weights for boundary elements
+*********************************************************************/
+int test_Partition_weights()
+{
+  PrimaryGrid *primgrid  = tests_create_primgrid(40, 30);
+  DualGrid    *dualgrid  = DualGrid_create();
+  Partition   *partition = Partition_create();
+  int *weights = NULL;
+  int i, n_bdry = 0;
+
+  check( primgrid, "Failed to create the test grid." );
+
+  tests_set_bdry_def( dualgrid->boundaries->bdry_def );
+  check( DualGrid_build(dualgrid, dualgrid->boundaries->bdry_def, 
+                        primgrid),
+      "DualGrid_build() failed." );
+
+  weights = Partition_boundary_weights(dualgrid, 10);
+  check( weights, "Partition_boundary_weights() failed." );
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+    n_bdry += ( weights[i] == 10 );
+
+  check( n_bdry == 2 * ( 40 + 30 ), "Wrong boundary weights." );
+
+  check( Partition_rcb(partition, dualgrid, weights, 6),
+      "Partition_rcb() failed." );
+  check( check_partition(partition, dualgrid, weights),
+      "Wrong weighted RCB partition." );
+  check( partition->imbalance < 1.05,
+      "Weighted RCB partition is imbalanced: %lf", partition->imbalance );
+
+  check( Partition_kway(partition, dualgrid, weights, 6),
+      "Partition_kway() failed." );
+  check( check_partition(partition, dualgrid, weights),
+      "Wrong weighted k-way partition." );
+  check( partition->imbalance <= 1.0 + ICF_PART_UBFACTOR + 0.01,
+      "Weighted k-way partition is imbalanced: %lf", 
+      partition->imbalance );
+
+  free( weights );
+  DualGrid_destroy( dualgrid );
+  PrimaryGrid_destroy( primgrid );
+  Partition_destroy( partition );
+
+  return ICF_SUCCESS;
+
+error:
+  free( weights );
+  return ICF_ERROR;
+
+} /* test_Partition_weights() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_Partition()
+{
+  check( test_Partition_rcb_kway(), 
+      "> test_Partition_rcb_kway() failed" ); 
+
+  check( test_Partition_multilevel_spiral(), 
+      "> test_Partition_multilevel_spiral() failed" ); 
+
+  check( test_Partition_weights(), 
+      "> test_Partition_weights() failed" ); 
+
+  fprintf(stderr, "> test_Partition() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_Partition() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_Partition() */
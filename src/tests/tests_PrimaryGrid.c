@@ -0,0 +1,940 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "MeshReader.h"
+#include "PrimaryGrid.h"
+
+#include "run_tests.h"
+
+static const char *test_grid_txt = "icf_test_grid.txt";
+static const char *test_grid_bin = "icf_test_grid.bin";
+
+/*********************************************************************
+* Test writing / reading of primary grids in binary format 
+*********************************************************************/
+int test_PrimaryGrid_binary_io()
+{
+  PrimaryGrid *testgrid    = tests_create_primgrid(12, 8);
+
+  check( tests_write_primgrid( test_grid_txt, testgrid ),
+    "> tests_write_primgrid() failed");
+
+  MeshReader  *mesh_reader = MeshReader_create( test_grid_txt );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+  PrimaryGrid *bingrid     = PrimaryGrid_create();
+
+  MeshReader_read_primgrid( mesh_reader, primgrid );
+
+  check( primgrid->n_vertices == testgrid->n_vertices
+      && primgrid->n_intr_edges == testgrid->n_intr_edges,
+    "> MeshReader_read_primgrid() failed");
+
+  check( PrimaryGrid_write_binary( primgrid, test_grid_bin ),
+    "> PrimaryGrid_write_binary() failed");
+  check( PrimaryGrid_read_binary( bingrid, test_grid_bin ),
+    "> PrimaryGrid_read_binary() failed");
+
+  check( bingrid->n_vertices == primgrid->n_vertices,
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_tris == primgrid->n_tris,
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_quads == primgrid->n_quads,
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_intr_edges == primgrid->n_intr_edges,
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_bdry_edges == primgrid->n_bdry_edges,
+    "> PrimaryGrid_read_binary() failed");
+
+  check( memcmp( bingrid->vertex_coords, primgrid->vertex_coords,
+                 primgrid->n_vertices * 2 * sizeof(double) ) == 0,
+    "> PrimaryGrid_read_binary() failed");
+  check( memcmp( bingrid->tris, primgrid->tris,
+                 primgrid->n_tris * 3 * sizeof(int) ) == 0,
+    "> PrimaryGrid_read_binary() failed");
+  check( memcmp( bingrid->quad_neighbors, primgrid->quad_neighbors,
+                 primgrid->n_quads * 4 * sizeof(int) ) == 0,
+    "> PrimaryGrid_read_binary() failed");
+  check( memcmp( bingrid->intr_edge_nbrs, primgrid->intr_edge_nbrs,
+                 primgrid->n_intr_edges * 2 * sizeof(int) ) == 0,
+    "> PrimaryGrid_read_binary() failed");
+  check( memcmp( bingrid->bdry_edge_marker, primgrid->bdry_edge_marker,
+                 primgrid->n_bdry_edges * sizeof(int) ) == 0,
+    "> PrimaryGrid_read_binary() failed");
+
+  PrimaryGrid_destroy( bingrid );
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( testgrid );
+  MeshReader_destroy( mesh_reader );
+
+  remove( test_grid_bin );
+  remove( test_grid_txt );
+
+  return ICF_SUCCESS;
+
+error:
+  remove( test_grid_txt );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_binary_io() */
+
+/*********************************************************************
+* Test the validation of binary grid headers: Counts, which do not
+* fit into an int, must be rejected
+*********************************************************************/
+int test_PrimaryGrid_binary_header()
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(4, 3);
+  PrimaryGrid *bingrid  = PrimaryGrid_create();
+  PrimaryGridHeader header;
+  FILE *fptr = NULL;
+
+  check( primgrid && bingrid, "Failed to create the test grids." );
+
+  check( PrimaryGrid_write_binary( primgrid, test_grid_bin ),
+    "> PrimaryGrid_write_binary() failed");
+  check( PrimaryGrid_read_binary( bingrid, test_grid_bin ),
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_vertices == primgrid->n_vertices,
+    "> PrimaryGrid_read_binary() failed");
+
+  /*------------------------------------------------------------------
+  | Read into a grid, whose quads and tris are views of a store
+  ------------------------------------------------------------------*/
+  check( PrimaryGrid_build_elements( bingrid, 0, NULL, NULL ),
+    "> PrimaryGrid_build_elements() failed");
+  check( PrimaryGrid_read_binary( bingrid, test_grid_bin ),
+    "> PrimaryGrid_read_binary() failed");
+  check( bingrid->n_elements == 0 
+      && bingrid->n_quads == primgrid->n_quads
+      && bingrid->quads[0][2] == primgrid->quads[0][2],
+    "> PrimaryGrid_read_binary() failed");
+
+  check( PrimaryGrid_build_elements( bingrid, 0, NULL, NULL ),
+    "> PrimaryGrid_build_elements() failed");
+
+  /*------------------------------------------------------------------
+  | Vertex count beyond INT_MAX with consistent section sizes
+  ------------------------------------------------------------------*/
+  fptr = fopen(test_grid_bin, "r+b");
+  check( fptr, "Failed to open %s.", test_grid_bin );
+  check( fread(&header, sizeof(header), 1, fptr) == 1,
+      "Failed to read %s.", test_grid_bin );
+
+  PrimaryGrid_swap_header_to_le(&header);
+  header.n_vertices = (int64_t) INT_MAX + 1;
+  PrimaryGrid_init_binary_header(&header,
+                                 header.sizes[ICF_GRID_TRI_NEIGHBORS]  > 0,
+                                 header.sizes[ICF_GRID_QUAD_NEIGHBORS] > 0);
+  PrimaryGrid_swap_header_to_le(&header);
+
+  check( fseek(fptr, 0, SEEK_SET) == 0 
+      && fwrite(&header, sizeof(header), 1, fptr) == 1,
+      "Failed to write %s.", test_grid_bin );
+  fclose( fptr );
+  fptr = NULL;
+
+  check( !PrimaryGrid_read_binary( bingrid, test_grid_bin ),
+      "Invalid vertex count has not been rejected." );
+  check( bingrid->n_vertices == 0 && !bingrid->vertex_coords,
+      "Grid has not been reset after a failed read." );
+
+  PrimaryGrid_destroy( bingrid );
+  PrimaryGrid_destroy( primgrid );
+
+  remove( test_grid_bin );
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fptr )
+    fclose( fptr );
+  remove( test_grid_bin );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_binary_header() */
+
+
+/*********************************************************************
+* Test out-of-core conversion of ASCII grids into binary format 
+*********************************************************************/
+int test_PrimaryGrid_convert_binary()
+{
+  PrimaryGrid *testgrid    = tests_create_primgrid(40, 30);
+
+  check( tests_write_primgrid( test_grid_txt, testgrid ),
+    "> tests_write_primgrid() failed");
+
+  MeshReader  *mesh_reader = MeshReader_create( test_grid_txt );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+  PrimaryGrid *bingrid     = PrimaryGrid_create();
+
+  MeshReader_read_primgrid( mesh_reader, primgrid );
+
+  /* Use the smallest possible memory budget */
+  check( MeshReader_convert_binary( test_grid_txt, test_grid_bin, 
+                                    64 * 1024 ),
+    "> MeshReader_convert_binary() failed");
+  check( PrimaryGrid_read_binary( bingrid, test_grid_bin ),
+    "> PrimaryGrid_read_binary() failed");
+
+  check( bingrid->n_vertices == primgrid->n_vertices,
+    "> MeshReader_convert_binary() failed");
+  check( bingrid->n_tris == primgrid->n_tris,
+    "> MeshReader_convert_binary() failed");
+  check( bingrid->n_quads == primgrid->n_quads,
+    "> MeshReader_convert_binary() failed");
+  check( bingrid->n_intr_edges == primgrid->n_intr_edges,
+    "> MeshReader_convert_binary() failed");
+  check( bingrid->n_bdry_edges == primgrid->n_bdry_edges,
+    "> MeshReader_convert_binary() failed");
+
+  check( memcmp( bingrid->vertex_coords, primgrid->vertex_coords,
+                 primgrid->n_vertices * 2 * sizeof(double) ) == 0,
+    "> MeshReader_convert_binary() failed");
+  check( memcmp( bingrid->quads, primgrid->quads,
+                 primgrid->n_quads * 4 * sizeof(int) ) == 0,
+    "> MeshReader_convert_binary() failed");
+  check( memcmp( bingrid->tri_neighbors, primgrid->tri_neighbors,
+                 primgrid->n_tris * 3 * sizeof(int) ) == 0,
+    "> MeshReader_convert_binary() failed");
+  check( memcmp( bingrid->intr_edges, primgrid->intr_edges,
+                 primgrid->n_intr_edges * 2 * sizeof(int) ) == 0,
+    "> MeshReader_convert_binary() failed");
+  check( memcmp( bingrid->bdry_edge_nbrs, primgrid->bdry_edge_nbrs,
+                 primgrid->n_bdry_edges * sizeof(int) ) == 0,
+    "> MeshReader_convert_binary() failed");
+
+  PrimaryGrid_destroy( bingrid );
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( testgrid );
+  MeshReader_destroy( mesh_reader );
+
+  remove( test_grid_bin );
+  remove( test_grid_txt );
+
+  return ICF_SUCCESS;
+
+error:
+  remove( test_grid_txt );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_convert_binary() */
+
+
+/*********************************************************************
+* Test building the primary grid connectivity for a grid of one
+* quad and one triangle
+*
+*   3 ---- 2
+*   |      | \
+*   |      |  4
+*   |      | /
+*   0 ---- 1
+*********************************************************************/
+int test_PrimaryGrid_build_topology()
+{
+  static double xy[5][2] = { {0.0,0.0}, {1.0,0.0}, {1.0,1.0}, 
+                             {0.0,1.0}, {2.0,0.5} };
+  static int quads[1][4] = { {0,1,2,3} };
+  static int tris[1][3]  = { {1,4,2} };
+  static int bdry[5][2]  = { {0,1}, {1,4}, {4,2}, {2,3}, {3,0} };
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+  int (*intr_edges)[2]  = NULL;
+  int (*intr_nbrs)[2]   = NULL;
+  int i;
+
+  primgrid->n_vertices   = 5;
+  primgrid->n_quads      = 1;
+  primgrid->n_tris       = 1;
+  primgrid->n_bdry_edges = 5;
+
+  primgrid->vertex_coords    = calloc(5, 2*sizeof(double));
+  primgrid->quads            = calloc(1, 4*sizeof(int));
+  primgrid->tris             = calloc(1, 3*sizeof(int));
+  primgrid->bdry_edges       = calloc(5, 2*sizeof(int));
+  primgrid->bdry_edge_marker = calloc(5, sizeof(int));
+
+  memcpy(primgrid->vertex_coords, xy, sizeof(xy));
+  memcpy(primgrid->quads, quads, sizeof(quads));
+  memcpy(primgrid->tris, tris, sizeof(tris));
+  memcpy(primgrid->bdry_edges, bdry, sizeof(bdry));
+
+  for ( i = 0; i < 5; i++ )
+    primgrid->bdry_edge_marker[i] = i+1;
+
+  check( PrimaryGrid_build_topology( primgrid, 2 ),
+    "> PrimaryGrid_build_topology() failed");
+
+  check( primgrid->n_intr_edges == 1,
+    "> PrimaryGrid_build_topology() failed");
+  check( primgrid->intr_edges[0][0] == 1 && primgrid->intr_edges[0][1] == 2,
+    "> PrimaryGrid_build_topology() failed");
+  check( primgrid->intr_edge_nbrs[0][0] == 0 
+      && primgrid->intr_edge_nbrs[0][1] == 1,
+    "> PrimaryGrid_build_topology() failed");
+
+  check( primgrid->quad_neighbors[0][0] == -1 
+      && primgrid->quad_neighbors[0][1] ==  1
+      && primgrid->quad_neighbors[0][2] == -1
+      && primgrid->quad_neighbors[0][3] == -1,
+    "> PrimaryGrid_build_topology() failed");
+  check( primgrid->tri_neighbors[0][0] == -1 
+      && primgrid->tri_neighbors[0][1] == -1
+      && primgrid->tri_neighbors[0][2] ==  0,
+    "> PrimaryGrid_build_topology() failed");
+
+  check( primgrid->bdry_edge_nbrs[0] == 0 && primgrid->bdry_edge_nbrs[1] == 1
+      && primgrid->bdry_edge_nbrs[2] == 1 && primgrid->bdry_edge_nbrs[3] == 0
+      && primgrid->bdry_edge_nbrs[4] == 0,
+    "> PrimaryGrid_build_topology() failed");
+
+  /*------------------------------------------------------------------
+  | Missing boundary edges must be detected
+  ------------------------------------------------------------------*/
+  primgrid->n_bdry_edges = 4;
+
+  check( !PrimaryGrid_build_topology( primgrid, 1 ),
+    "> PrimaryGrid_build_topology() accepted missing boundary edge");
+
+  PrimaryGrid_destroy( primgrid );
+  primgrid = NULL;
+
+  /*------------------------------------------------------------------
+  | The buckets are filled concurrently by several threads, but the
+  | result must not depend on the number of threads
+  ------------------------------------------------------------------*/
+  primgrid = tests_create_primgrid(9, 7);
+  check( primgrid, "Failed to create the test grid." );
+
+  check( PrimaryGrid_build_topology( primgrid, 1 ),
+    "> PrimaryGrid_build_topology() failed");
+
+  const int n_intr = primgrid->n_intr_edges;
+  intr_edges = malloc((n_intr + 1) * 2*sizeof(int));
+  intr_nbrs  = malloc((n_intr + 1) * 2*sizeof(int));
+  check_mem(intr_edges);
+  check_mem(intr_nbrs);
+
+  memcpy(intr_edges, primgrid->intr_edges,     n_intr * 2*sizeof(int));
+  memcpy(intr_nbrs,  primgrid->intr_edge_nbrs, n_intr * 2*sizeof(int));
+
+  check( PrimaryGrid_build_topology( primgrid, 7 ),
+    "> PrimaryGrid_build_topology() failed");
+
+  i = ( primgrid->n_intr_edges == n_intr )
+   && memcmp(intr_edges, primgrid->intr_edges, 
+             n_intr * 2*sizeof(int)) == 0
+   && memcmp(intr_nbrs, primgrid->intr_edge_nbrs, 
+             n_intr * 2*sizeof(int)) == 0;
+
+  check( i, "> PrimaryGrid_build_topology() depends on the threads");
+
+  free( intr_edges );
+  free( intr_nbrs );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  free( intr_edges );
+  free( intr_nbrs );
+  if ( primgrid )
+    PrimaryGrid_destroy( primgrid );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_build_topology() */
+
+/*********************************************************************
+* Test reading the test grid without its connectivity sections
+*********************************************************************/
+int test_PrimaryGrid_lean_topology()
+{
+  const int nx = 12, ny = 8;
+
+  PrimaryGrid *testgrid    = tests_create_primgrid(nx, ny);
+  int i, j;
+
+  check( tests_write_primgrid( test_grid_txt, testgrid ),
+    "> tests_write_primgrid() failed");
+
+  MeshReader  *mesh_reader = MeshReader_create_stream( test_grid_txt );
+  MeshReader  *lean_reader = MeshReader_create_stream( test_grid_txt );
+  PrimaryGrid *primgrid    = PrimaryGrid_create();
+  PrimaryGrid *leangrid    = PrimaryGrid_create();
+
+  lean_reader->lean = 1;
+
+  check( MeshReader_stream_primgrid( mesh_reader, primgrid ),
+    "> MeshReader_stream_primgrid() failed");
+  check( MeshReader_stream_primgrid( lean_reader, leangrid ),
+    "> MeshReader_stream_primgrid() failed for lean reader");
+
+  /* Interior edges of the quads, the tris and their diagonals     */
+  check( leangrid->n_intr_edges == primgrid->n_intr_edges
+      && leangrid->n_intr_edges == (nx-1)*ny + nx*(ny-1) + (nx-nx/2)*ny,
+    "> PrimaryGrid_build_topology() failed");
+
+  check( memcmp(leangrid->tri_neighbors, primgrid->tri_neighbors,
+                primgrid->n_tris * 3 * sizeof(int)) == 0,
+    "> PrimaryGrid_build_topology() failed");
+  check( memcmp(leangrid->quad_neighbors, primgrid->quad_neighbors,
+                primgrid->n_quads * 4 * sizeof(int)) == 0,
+    "> PrimaryGrid_build_topology() failed");
+  check( memcmp(leangrid->bdry_edge_nbrs, primgrid->bdry_edge_nbrs,
+                primgrid->n_bdry_edges * sizeof(int)) == 0,
+    "> PrimaryGrid_build_topology() failed");
+
+  /* Interior edges may be ordered and oriented differently         */
+  for ( i = 0; i < primgrid->n_intr_edges; i++ )
+  {
+    int *e = primgrid->intr_edges[i];
+    int *n = primgrid->intr_edge_nbrs[i];
+
+    for ( j = 0; j < leangrid->n_intr_edges; j++ )
+    {
+      int *le = leangrid->intr_edges[j];
+      int *ln = leangrid->intr_edge_nbrs[j];
+
+      if ( ( (le[0] == e[0] && le[1] == e[1]) 
+          || (le[0] == e[1] && le[1] == e[0]) )
+        && ( (ln[0] == n[0] && ln[1] == n[1]) 
+          || (ln[0] == n[1] && ln[1] == n[0]) ) )
+        break;
+    }
+
+    check( j < leangrid->n_intr_edges,
+      "> PrimaryGrid_build_topology() failed for edge %d", i);
+  }
+
+  MeshReader_destroy( mesh_reader );
+  MeshReader_destroy( lean_reader );
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( leangrid );
+  PrimaryGrid_destroy( testgrid );
+
+  remove( test_grid_txt );
+
+  return ICF_SUCCESS;
+
+error:
+  remove( test_grid_txt );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_lean_topology() */
+
+
+/*********************************************************************
+* Test the reverse Cuthill-McKee renumbering for a strip of 
+* 20 x 2 quads with scrambled vertex indices
+*********************************************************************/
+int test_PrimaryGrid_renumber()
+{
+  const int nx = 20, ny = 2;
+  const int n_verts = (nx+1) * (ny+1);
+
+  PrimaryGrid *primgrid = PrimaryGrid_create();
+  double (*xy)[2] = NULL;
+  int i, j, k, bw_before, bw_after;
+
+  /* Vertex (i,j) gets index (11 * (j*(nx+1) + i)) % n_verts          */
+#define RCM_VERTEX(i, j) ( ( 11 * ( (j)*(nx+1) + (i) ) ) % n_verts )
+
+  primgrid->n_vertices   = n_verts;
+  primgrid->n_quads      = nx * ny;
+  primgrid->n_bdry_edges = 2 * ( nx + ny );
+
+  primgrid->vertex_coords    = calloc(n_verts, 2*sizeof(double));
+  primgrid->quads            = calloc(nx*ny, 4*sizeof(int));
+  primgrid->bdry_edges       = calloc(2*(nx+ny), 2*sizeof(int));
+  primgrid->bdry_edge_marker = calloc(2*(nx+ny), sizeof(int));
+
+  for ( j = 0; j <= ny; j++ )
+    for ( i = 0; i <= nx; i++ )
+    {
+      primgrid->vertex_coords[RCM_VERTEX(i,j)][0] = (double) i;
+      primgrid->vertex_coords[RCM_VERTEX(i,j)][1] = (double) j;
+    }
+
+  for ( j = 0; j < ny; j++ )
+    for ( i = 0; i < nx; i++ )
+    {
+      int *q = primgrid->quads[j*nx+i];
+      q[0] = RCM_VERTEX(i,   j);
+      q[1] = RCM_VERTEX(i+1, j);
+      q[2] = RCM_VERTEX(i+1, j+1);
+      q[3] = RCM_VERTEX(i,   j+1);
+    }
+
+  k = 0;
+  for ( i = 0; i < nx; i++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]   = RCM_VERTEX(i,   0);
+    primgrid->bdry_edges[k][1]   = RCM_VERTEX(i+1, 0);
+    primgrid->bdry_edges[k+1][0] = RCM_VERTEX(i+1, ny);
+    primgrid->bdry_edges[k+1][1] = RCM_VERTEX(i,   ny);
+  }
+  for ( j = 0; j < ny; j++, k += 2 )
+  {
+    primgrid->bdry_edges[k][0]   = RCM_VERTEX(nx, j);
+    primgrid->bdry_edges[k][1]   = RCM_VERTEX(nx, j+1);
+    primgrid->bdry_edges[k+1][0] = RCM_VERTEX(0,  j+1);
+    primgrid->bdry_edges[k+1][1] = RCM_VERTEX(0,  j);
+  }
+
+#undef RCM_VERTEX
+
+  check( PrimaryGrid_build_topology( primgrid, 1 ),
+    "> PrimaryGrid_build_topology() failed");
+
+  xy = calloc(n_verts, 2*sizeof(double));
+  memcpy(xy, primgrid->vertex_coords, n_verts * 2 * sizeof(double));
+
+  check( PrimaryGrid_renumber( primgrid, &bw_before, &bw_after ),
+    "> PrimaryGrid_renumber() failed");
+
+  check( bw_before > 20 && bw_after <= ny + 2,
+    "> PrimaryGrid_renumber() failed: bandwidth %d -> %d", 
+    bw_before, bw_after);
+  check( bw_after == PrimaryGrid_bandwidth( primgrid ),
+    "> PrimaryGrid_renumber() failed");
+
+  /* Vertex coordinates are mapped back through vertex_order        */
+  for ( i = 0; i < n_verts; i++ )
+  {
+    const int o = primgrid->vertex_order[i];
+
+    check( primgrid->vertex_coords[i][0] == xy[o][0]
+        && primgrid->vertex_coords[i][1] == xy[o][1],
+      "> PrimaryGrid_renumber() failed for vertex %d", i);
+  }
+
+  /* Elements keep their shape                                       */
+  for ( i = 0; i < primgrid->n_quads; i++ )
+  {
+    double (*v)[2] = primgrid->vertex_coords;
+    int *q = primgrid->quads[i];
+
+    check( v[q[1]][0] - v[q[0]][0] == 1.0 && v[q[3]][1] - v[q[0]][1] == 1.0,
+      "> PrimaryGrid_renumber() failed for quad %d", i);
+  }
+
+  /* Interior edges are sorted by their lower vertex index          */
+  for ( i = 1; i < primgrid->n_intr_edges; i++ )
+    check( MIN(primgrid->intr_edges[i-1][0], primgrid->intr_edges[i-1][1])
+        <= MIN(primgrid->intr_edges[i][0], primgrid->intr_edges[i][1]),
+      "> PrimaryGrid_renumber() failed");
+
+  free( xy );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  free( xy );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_renumber() */
+
+
+/*********************************************************************
+* Returns 1, if vertex <v> belongs to element <e> of a primary grid
+*********************************************************************/
+static int elem_has_vertex(const PrimaryGrid *primgrid, int e, int v)
+{
+  const int *nodes = ( e < primgrid->n_quads ) 
+                   ? primgrid->quads[e]
+                   : primgrid->tris[e - primgrid->n_quads];
+  const int n_nodes = ( e < primgrid->n_quads ) ? 4 : 3;
+  int k;
+
+  for ( k = 0; k < n_nodes; k++ )
+    if ( nodes[k] == v )
+      return 1;
+
+  return 0;
+
+} /* elem_has_vertex() */
+
+/*********************************************************************
+* Test the Morton and Hilbert keys and the reordering of a mixed 
+* grid of quads (left half) and tris (right half) along both curves
+*********************************************************************/
+int test_PrimaryGrid_reorder_sfc()
+{
+  const int nx = 8, ny = 6;
+  const int n_verts = (nx+1) * (ny+1);
+  const int n_quads = nx/2 * ny;
+  const int n_tris  = 2 * (nx - nx/2) * ny;
+  const int n_bdry  = 2 * (nx + ny);
+
+  PrimaryGrid *primgrid = NULL;
+  int i, j, k, curve;
+  uint32_t x, y;
+
+  /*------------------------------------------------------------------
+  | Morton keys interleave the coordinate bits
+  ------------------------------------------------------------------*/
+  check( PrimaryGrid_sfc_key(ICF_SFC_MORTON, 1, 0) == 1
+      && PrimaryGrid_sfc_key(ICF_SFC_MORTON, 0, 1) == 2
+      && PrimaryGrid_sfc_key(ICF_SFC_MORTON, 3, 3) == 15
+      && PrimaryGrid_sfc_key(ICF_SFC_MORTON, 0, 4) == 32,
+    "> PrimaryGrid_sfc_key() failed");
+
+  /*------------------------------------------------------------------
+  | The first 256 Hilbert keys fill the block [0,16)^2 and 
+  | consecutive keys belong to adjacent cells
+  ------------------------------------------------------------------*/
+  {
+    int cells[256][2];
+
+    for ( i = 0; i < 256; i++ )
+      cells[i][0] = -1;
+
+    for ( x = 0; x < 16; x++ )
+      for ( y = 0; y < 16; y++ )
+      {
+        const uint64_t d = PrimaryGrid_sfc_key(ICF_SFC_HILBERT, x, y);
+
+        check( d < 256 && cells[d][0] < 0, 
+          "> PrimaryGrid_sfc_key() failed for (%u,%u)", x, y);
+
+        cells[d][0] = (int) x;
+        cells[d][1] = (int) y;
+      }
+
+    for ( i = 1; i < 256; i++ )
+      check( abs(cells[i][0] - cells[i-1][0]) 
+           + abs(cells[i][1] - cells[i-1][1]) == 1,
+        "> PrimaryGrid_sfc_key() failed for key %d", i);
+  }
+
+  /*------------------------------------------------------------------
+  | Reorder the grid along both curves
+  ------------------------------------------------------------------*/
+  for ( curve = ICF_SFC_MORTON; curve <= ICF_SFC_HILBERT; curve++ )
+  {
+    double (*v)[2];
+
+    primgrid = PrimaryGrid_create();
+
+    primgrid->n_vertices   = n_verts;
+    primgrid->n_quads      = n_quads;
+    primgrid->n_tris       = n_tris;
+    primgrid->n_bdry_edges = n_bdry;
+
+    primgrid->vertex_coords    = calloc(n_verts, 2*sizeof(double));
+    primgrid->quads            = calloc(n_quads, 4*sizeof(int));
+    primgrid->tris             = calloc(n_tris,  3*sizeof(int));
+    primgrid->bdry_edges       = calloc(n_bdry,  2*sizeof(int));
+    primgrid->bdry_edge_marker = calloc(n_bdry,  sizeof(int));
+
+#define SFC_VERTEX(i, j) ( (j)*(nx+1) + (i) )
+
+    for ( j = 0; j <= ny; j++ )
+      for ( i = 0; i <= nx; i++ )
+      {
+        primgrid->vertex_coords[SFC_VERTEX(i,j)][0] = (double) i;
+        primgrid->vertex_coords[SFC_VERTEX(i,j)][1] = (double) j;
+      }
+
+    for ( j = 0; j < ny; j++ )
+      for ( i = 0; i < nx; i++ )
+      {
+        const int v0 = SFC_VERTEX(i,   j);
+        const int v1 = SFC_VERTEX(i+1, j);
+        const int v2 = SFC_VERTEX(i+1, j+1);
+        const int v3 = SFC_VERTEX(i,   j+1);
+
+        if ( i < nx/2 )
+        {
+          int *q = primgrid->quads[j*(nx/2) + i];
+          q[0] = v0; q[1] = v1; q[2] = v2; q[3] = v3;
+        }
+        else
+        {
+          int *t0 = primgrid->tris[2 * ( j*(nx-nx/2) + i-nx/2 )];
+          int *t1 = primgrid->tris[2 * ( j*(nx-nx/2) + i-nx/2 ) + 1];
+          t0[0] = v0; t0[1] = v1; t0[2] = v2; 
+          t1[0] = v0; t1[1] = v2; t1[2] = v3;
+        }
+      }
+
+    /* Markers: 1 bottom, 2 right, 3 top, 4 left                    */
+    k = 0;
+    for ( i = 0; i < nx; i++, k += 2 )
+    {
+      primgrid->bdry_edges[k][0]     = SFC_VERTEX(i,   0);
+      primgrid->bdry_edges[k][1]     = SFC_VERTEX(i+1, 0);
+      primgrid->bdry_edge_marker[k]  = 1;
+      primgrid->bdry_edges[k+1][0]   = SFC_VERTEX(i+1, ny);
+      primgrid->bdry_edges[k+1][1]   = SFC_VERTEX(i,   ny);
+      primgrid->bdry_edge_marker[k+1]= 3;
+    }
+    for ( j = 0; j < ny; j++, k += 2 )
+    {
+      primgrid->bdry_edges[k][0]     = SFC_VERTEX(nx, j);
+      primgrid->bdry_edges[k][1]     = SFC_VERTEX(nx, j+1);
+      primgrid->bdry_edge_marker[k]  = 2;
+      primgrid->bdry_edges[k+1][0]   = SFC_VERTEX(0,  j+1);
+      primgrid->bdry_edges[k+1][1]   = SFC_VERTEX(0,  j);
+      primgrid->bdry_edge_marker[k+1]= 4;
+    }
+
+#undef SFC_VERTEX
+
+    check( PrimaryGrid_build_topology( primgrid, 1 ),
+      "> PrimaryGrid_build_topology() failed");
+
+    check( PrimaryGrid_reorder_sfc( primgrid, (SFCType) curve ),
+      "> PrimaryGrid_reorder_sfc() failed");
+
+    v = primgrid->vertex_coords;
+
+    /* Vertex coordinates are mapped back through vertex_order      */
+    for ( i = 0; i < n_verts; i++ )
+    {
+      const int o = primgrid->vertex_order[i];
+
+      check( v[i][0] == (double) ( o % (nx+1) ) 
+          && v[i][1] == (double) ( o / (nx+1) ),
+        "> PrimaryGrid_reorder_sfc() failed for vertex %d", i);
+    }
+
+    /* Elements keep their shape                                     */
+    for ( i = 0; i < n_quads; i++ )
+    {
+      int *q = primgrid->quads[i];
+
+      check( v[q[1]][0] - v[q[0]][0] == 1.0 
+          && v[q[3]][1] - v[q[0]][1] == 1.0,
+        "> PrimaryGrid_reorder_sfc() failed for quad %d", i);
+    }
+
+    /* Element neighbors share the edge (k, k+1)                     */
+    for ( i = 0; i < n_quads + n_tris; i++ )
+    {
+      const int  n_nodes = ( i < n_quads ) ? 4 : 3;
+      const int *nodes   = ( i < n_quads ) ? primgrid->quads[i] 
+                                           : primgrid->tris[i-n_quads];
+      const int *nbrs    = ( i < n_quads ) ? primgrid->quad_neighbors[i] 
+                                           : primgrid->tri_neighbors[i-n_quads];
+
+      for ( k = 0; k < n_nodes; k++ )
+      {
+        if ( nbrs[k] < 0 )
+          continue;
+
+        check( elem_has_vertex(primgrid, nbrs[k], nodes[k])
+            && elem_has_vertex(primgrid, nbrs[k], nodes[(k+1)%n_nodes]),
+          "> PrimaryGrid_reorder_sfc() failed for element %d", i);
+      }
+    }
+
+    /* Edges are adjacent to their neighbor elements                 */
+    for ( i = 0; i < primgrid->n_intr_edges; i++ )
+      for ( k = 0; k < 2; k++ )
+        check( elem_has_vertex(primgrid, primgrid->intr_edge_nbrs[i][k],
+                               primgrid->intr_edges[i][0])
+            && elem_has_vertex(primgrid, primgrid->intr_edge_nbrs[i][k],
+                               primgrid->intr_edges[i][1]),
+          "> PrimaryGrid_reorder_sfc() failed for interior edge %d", i);
+
+    /* Boundary edges keep their neighbors and markers               */
+    for ( i = 0; i < n_bdry; i++ )
+    {
+      const int *e = primgrid->bdry_edges[i];
+      int side;
+
+      check( elem_has_vertex(primgrid, primgrid->bdry_edge_nbrs[i], e[0])
+          && elem_has_vertex(primgrid, primgrid->bdry_edge_nbrs[i], e[1]),
+        "> PrimaryGrid_reorder_sfc() failed for boundary edge %d", i);
+
+      if ( v[e[0]][1] == 0.0 && v[e[1]][1] == 0.0 )
+        side = 1;
+      else if ( v[e[0]][0] == nx && v[e[1]][0] == nx )
+        side = 2;
+      else if ( v[e[0]][1] == ny && v[e[1]][1] == ny )
+        side = 3;
+      else
+        side = 4;
+
+      check( primgrid->bdry_edge_marker[i] == side,
+        "> PrimaryGrid_reorder_sfc() failed for boundary edge %d", i);
+    }
+
+    PrimaryGrid_destroy( primgrid );
+    primgrid = NULL;
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  if ( primgrid )
+    PrimaryGrid_destroy( primgrid );
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_reorder_sfc() */
+
+
+/*********************************************************************
+* Test the unified element store of a grid with polygons and the 
+* quad and tri views of a grid, that is reordered along a 
+* space-filling curve
+*********************************************************************/
+int test_PrimaryGrid_build_elements()
+{
+  static const int ptr[6]   = { 0, 4, 8, 11, 14, 19 };
+  static const int nbrs[19] = { -1, 2, 1, 4,   0, 3, -1, 4,  
+                                -1, 3, 0,      2, -1, 1,  
+                                -1, 0, 1, -1, -1 };
+  static const int bad_ptr[2]   = { 0, 2 };
+  static const int bad_verts[2] = { 0, 1 };
+
+  PrimaryGrid *primgrid = tests_create_polygrid();
+  PrimaryGrid *ref      = NULL;
+  int i;
+
+  check( primgrid, "Failed to create the polygon grid." );
+
+  /*------------------------------------------------------------------
+  | Element blocks of the polygon grid and their views
+  ------------------------------------------------------------------*/
+  check( primgrid->n_quads == 2 && primgrid->n_tris == 2 
+      && primgrid->n_polys == 1 && primgrid->n_elements == 5,
+    "> PrimaryGrid_build_elements() failed");
+  check( primgrid->elem_blocks[ICF_ELEM_QUAD] == 0 
+      && primgrid->elem_blocks[ICF_ELEM_TRI]  == 2 
+      && primgrid->elem_blocks[ICF_ELEM_POLY] == 4 
+      && primgrid->elem_blocks[ICF_ELEM_N_TYPES] == 5,
+    "> PrimaryGrid_build_elements() failed");
+
+  for ( i = 0; i < 5; i++ )
+    check( primgrid->elem_ptr[i] == ptr[i] 
+        && primgrid->elem_types[i] == ( i < 2 ? ICF_ELEM_QUAD 
+                                      : i < 4 ? ICF_ELEM_TRI 
+                                              : ICF_ELEM_POLY )
+        && ICF_ELEM_N_VERTS(primgrid, i) == ptr[i+1] - ptr[i]
+        && ICF_ELEM_VERTS(primgrid, i) == primgrid->elem_verts + ptr[i],
+      "> PrimaryGrid_build_elements() failed");
+
+  check( primgrid->tris[1][0] == 7 && primgrid->tris[1][1] == 8 
+      && primgrid->tris[1][2] == 5 && primgrid->elem_verts[14] == 0,
+    "> PrimaryGrid_build_elements() failed");
+
+  /*------------------------------------------------------------------
+  | Topology including the polygon
+  ------------------------------------------------------------------*/
+  check( primgrid->n_intr_edges == 6,
+    "> PrimaryGrid_build_topology() failed");
+
+  check( primgrid->quad_neighbors == (int (*)[4]) primgrid->elem_nbrs,
+    "> PrimaryGrid_build_topology() failed");
+
+  for ( i = 0; i < 19; i++ )
+    check( primgrid->elem_nbrs[i] == nbrs[i],
+      "> PrimaryGrid_build_topology() failed");
+
+  check( primgrid->bdry_edge_nbrs[0] == 4 && primgrid->bdry_edge_nbrs[1] == 0
+      && primgrid->bdry_edge_nbrs[2] == 2 && primgrid->bdry_edge_nbrs[3] == 3
+      && primgrid->bdry_edge_nbrs[6] == 4,
+    "> PrimaryGrid_build_topology() failed");
+
+  /* Rebuilding the store keeps the elements and their neighbors     */
+  check( PrimaryGrid_build_elements(primgrid, 0, NULL, NULL),
+    "> PrimaryGrid_build_elements() failed");
+
+  check( primgrid->n_elements == 5 && primgrid->elem_verts[14] == 0
+      && primgrid->elem_nbrs && primgrid->elem_nbrs[15] == 0,
+    "> PrimaryGrid_build_elements() failed");
+
+  check( !PrimaryGrid_build_elements(primgrid, 1, bad_ptr, bad_verts),
+    "> PrimaryGrid_build_elements() accepted invalid polygon");
+  check( !PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT),
+    "> PrimaryGrid_reorder_sfc() accepted polygons");
+
+  PrimaryGrid_destroy( primgrid );
+
+  /*------------------------------------------------------------------
+  | Reordering of a store without polygons gives the same elements 
+  | as the reordering of separate quad and tri arrays
+  ------------------------------------------------------------------*/
+  primgrid = tests_create_primgrid(6, 5);
+  ref      = tests_create_primgrid(6, 5);
+
+  check( primgrid && ref, "Failed to create the test grid." );
+
+  check( PrimaryGrid_build_elements(primgrid, 0, NULL, NULL)
+      && PrimaryGrid_reorder_sfc(primgrid, ICF_SFC_HILBERT)
+      && PrimaryGrid_reorder_sfc(ref, ICF_SFC_HILBERT),
+    "> PrimaryGrid_reorder_sfc() failed");
+
+  check( primgrid->n_elements == primgrid->n_quads + primgrid->n_tris
+      && primgrid->quads == (int (*)[4]) primgrid->elem_verts
+      && primgrid->tri_neighbors == (int (*)[3]) ( primgrid->elem_nbrs 
+                                               + 4 * primgrid->n_quads ),
+    "> PrimaryGrid_reorder_sfc() did not rebuild the element store");
+
+  check( !memcmp(primgrid->quads, ref->quads, 
+                 ref->n_quads * 4*sizeof(int))
+      && !memcmp(primgrid->tris, ref->tris, 
+                 ref->n_tris * 3*sizeof(int))
+      && !memcmp(primgrid->quad_neighbors, ref->quad_neighbors, 
+                 ref->n_quads * 4*sizeof(int))
+      && !memcmp(primgrid->tri_neighbors, ref->tri_neighbors, 
+                 ref->n_tris * 3*sizeof(int)),
+    "> PrimaryGrid_reorder_sfc() failed");
+
+  PrimaryGrid_destroy( primgrid );
+  PrimaryGrid_destroy( ref );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_PrimaryGrid_build_elements() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_PrimaryGrid()
+{
+  check( test_PrimaryGrid_build_topology(), 
+      "> test_PrimaryGrid_build_topology() failed" ); 
+
+  check( test_PrimaryGrid_renumber(), 
+      "> test_PrimaryGrid_renumber() failed" ); 
+
+  check( test_PrimaryGrid_reorder_sfc(), 
+      "> test_PrimaryGrid_reorder_sfc() failed" ); 
+
+  check( test_PrimaryGrid_build_elements(), 
+      "> test_PrimaryGrid_build_elements() failed" ); 
+
+  check( test_PrimaryGrid_lean_topology(), 
+      "> test_PrimaryGrid_lean_topology() failed" ); 
+
+  check( test_PrimaryGrid_binary_header(), 
+      "> test_PrimaryGrid_binary_header() failed" ); 
+
+  check( test_PrimaryGrid_binary_io(), 
+      "> test_PrimaryGrid_binary_io() failed" ); 
+
+  check( test_PrimaryGrid_convert_binary(), 
+      "> test_PrimaryGrid_convert_binary() failed" ); 
+
+  fprintf(stderr, "> test_PrimaryGrid() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_PrimaryGrid() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_PrimaryGrid() */
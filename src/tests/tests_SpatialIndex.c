@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "SpatialIndex.h"
+
+#include "run_tests.h"
+
+/*********************************************************************
+* Returns a pseudo-random number in [0, 1)
+*********************************************************************/
+static double test_rand(unsigned *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return (double) ( ( *state >> 8 ) & 0xFFFFFFu ) / (double) 0x1000000u;
+
+} /* test_rand() */
+
+/*********************************************************************
+* Creates the test grid with randomly displaced interior vertices
+*********************************************************************/
+static PrimaryGrid *create_jittered_primgrid(int nx, int ny, 
+                                             unsigned *seed)
+{
+  PrimaryGrid *primgrid = tests_create_primgrid(nx, ny);
+  int i;
+
+  if ( !primgrid )
+    return NULL;
+
+  for ( i = 0; i < primgrid->n_vertices; i++ )
+  {
+    double *xy = primgrid->vertex_coords[i];
+
+    if ( xy[0] > 0.0 && xy[0] < 1.0 && xy[1] > 0.0 && xy[1] < 1.0 )
+    {
+      xy[0] += 0.3 / nx * ( test_rand(seed) - 0.5 );
+      xy[1] += 0.3 / ny * ( test_rand(seed) - 0.5 );
+    }
+  }
+
+  return primgrid;
+
+} /* create_jittered_primgrid() */
+
+/*********************************************************************
+* Checks if the point (x,y) lies in element <elem> by comparing the 
+* element area with the sum of the triangle areas towards the point
+*********************************************************************/
+static int point_in_elem(const PrimaryGrid *primgrid, int elem,
+                         double x, double y)
+{
+  const double (*xy)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  const int *v = ( elem < primgrid->n_quads ) 
+               ? primgrid->quads[elem] 
+               : primgrid->tris[elem - primgrid->n_quads];
+  const int  n = ( elem < primgrid->n_quads ) ? 4 : 3;
+  double area = 0.0, sum = 0.0;
+  int k;
+
+  for ( k = 0; k < n; k++ )
+  {
+    const double *a = xy[v[k]];
+    const double *b = xy[v[(k+1) % n]];
+
+    area += a[0] * b[1] - b[0] * a[1];
+    sum  += fabs( ( a[0] - x ) * ( b[1] - y ) - ( b[0] - x ) * ( a[1] - y ) );
+  }
+
+  return fabs( sum - fabs(area) ) <= 1.0E-9 * fabs(area);
+
+} /* point_in_elem() */
+
+/*********************************************************************
+* Test the point location against a brute-force search for random 
+* points, grid vertices and points outside of the grid
+*********************************************************************/
+int test_SpatialIndex_locate()
+{
+  const int n_points = 4000;
+
+  unsigned      seed     = 7;
+  PrimaryGrid  *primgrid = create_jittered_primgrid(23, 17, &seed);
+  SpatialIndex *index    = SpatialIndex_create();
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  int     *elems  = calloc(n_points, sizeof(int));
+  int i, e;
+
+  check( primgrid && xy && elems, "Failed to create the test data." );
+  check( SpatialIndex_build(index, primgrid), 
+      "SpatialIndex_build() failed." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    if ( i % 4 == 0 )
+    {
+      const int v = i / 4 % primgrid->n_vertices;
+      xy[i][0] = primgrid->vertex_coords[v][0];
+      xy[i][1] = primgrid->vertex_coords[v][1];
+    }
+    else
+    {
+      xy[i][0] = 1.2 * test_rand(&seed) - 0.1;
+      xy[i][1] = 1.2 * test_rand(&seed) - 0.1;
+    }
+  }
+
+  check( SpatialIndex_locate_batch(index, n_points, 
+                                   (const double (*)[2]) xy, elems),
+      "SpatialIndex_locate_batch() failed." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const int elem = SpatialIndex_locate(index, xy[i][0], xy[i][1]);
+    int found = -1;
+
+    for ( e = 0; e < primgrid->n_quads + primgrid->n_tris; e++ )
+      if ( point_in_elem(primgrid, e, xy[i][0], xy[i][1]) )
+        found = e;
+
+    if ( found < 0 )
+    {
+      check( elem < 0 && elems[i] < 0, 
+          "Located point %d outside of the grid.", i );
+    }
+    else
+    {
+      check( elem >= 0 && point_in_elem(primgrid, elem, xy[i][0], xy[i][1]),
+          "Wrong element %d of point %d.", elem, i );
+      check( elems[i] >= 0 
+          && point_in_elem(primgrid, elems[i], xy[i][0], xy[i][1]),
+          "Wrong batch element %d of point %d.", elems[i], i );
+    }
+  }
+
+  free( xy );
+  free( elems );
+  SpatialIndex_destroy( index );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_SpatialIndex_locate() */
+
+/*********************************************************************
+* Test the nearest vertex search against a brute-force search
+*********************************************************************/
+int test_SpatialIndex_nearest_vertex()
+{
+  const int n_points = 2000;
+
+  unsigned      seed     = 11;
+  PrimaryGrid  *primgrid = create_jittered_primgrid(31, 12, &seed);
+  SpatialIndex *index    = SpatialIndex_create();
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  int     *verts  = calloc(n_points, sizeof(int));
+  int i, v;
+
+  check( primgrid && xy && verts, "Failed to create the test data." );
+  check( SpatialIndex_build(index, primgrid), 
+      "SpatialIndex_build() failed." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    xy[i][0] = 1.4 * test_rand(&seed) - 0.2;
+    xy[i][1] = 1.4 * test_rand(&seed) - 0.2;
+  }
+
+  check( SpatialIndex_nearest_vertex_batch(index, n_points, 
+                                           (const double (*)[2]) xy, 
+                                           verts),
+      "SpatialIndex_nearest_vertex_batch() failed." );
+
+#define DIST2(v, p) ( SQR(primgrid->vertex_coords[v][0] - xy[p][0]) \
+                    + SQR(primgrid->vertex_coords[v][1] - xy[p][1]) )
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const int vert = SpatialIndex_nearest_vertex(index, xy[i][0], xy[i][1]);
+    int best = 0;
+
+    for ( v = 1; v < primgrid->n_vertices; v++ )
+      if ( DIST2(v, i) < DIST2(best, i) )
+        best = v;
+
+    check( vert >= 0 && DIST2(vert, i) == DIST2(best, i),
+        "Wrong nearest vertex %d of point %d.", vert, i );
+    check( verts[i] >= 0 && DIST2(verts[i], i) == DIST2(best, i),
+        "Wrong batch nearest vertex %d of point %d.", verts[i], i );
+  }
+
+#undef DIST2
+
+  free( xy );
+  free( verts );
+  SpatialIndex_destroy( index );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_SpatialIndex_nearest_vertex() */
+
+
+/*********************************************************************
+* Removes all elements with their centroid in the square 
+* [lo,hi] x [lo,hi] and rebuilds the topology, such that the grid 
+* has a hole with a non-convex boundary
+*********************************************************************/
+static int cut_hole(PrimaryGrid *primgrid, double lo, double hi)
+{
+  const double (*xy)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  int n_quads = 0, n_tris = 0;
+  int e, k;
+
+  for ( e = 0; e < primgrid->n_quads + primgrid->n_tris; e++ )
+  {
+    const int  n = ICF_ELEM_N_VERTS(primgrid, e);
+    const int *v = ICF_ELEM_VERTS(primgrid, e);
+    double c[2] = { 0.0, 0.0 };
+
+    for ( k = 0; k < n; k++ )
+    {
+      c[0] += xy[v[k]][0] / n;
+      c[1] += xy[v[k]][1] / n;
+    }
+
+    if ( c[0] > lo && c[0] < hi && c[1] > lo && c[1] < hi )
+      continue;
+
+    if ( n == 4 )
+      memmove(primgrid->quads[n_quads++], v, 4 * sizeof(int));
+    else
+      memmove(primgrid->tris[n_tris++], v, 3 * sizeof(int));
+  }
+
+  primgrid->n_quads = n_quads;
+  primgrid->n_tris  = n_tris;
+
+  return DualGrid_build_local_topology(primgrid, 0, NULL, NULL);
+
+} /* cut_hole() */
+
+/*********************************************************************
+* Checks the element of point (x,y) against a brute-force search
+*********************************************************************/
+static int check_located(const PrimaryGrid *primgrid, int elem, 
+                         double x, double y)
+{
+  int e;
+
+  if ( elem >= 0 )
+    return point_in_elem(primgrid, elem, x, y);
+
+  for ( e = 0; e < primgrid->n_quads + primgrid->n_tris; e++ )
+    if ( point_in_elem(primgrid, e, x, y) )
+      return ICF_FALSE;
+
+  return ICF_TRUE;
+
+} /* check_located() */
+
+/*********************************************************************
+* Test the neighbor walk from random hints, along a path, which 
+* crosses a hole in the grid, and in batches
+*********************************************************************/
+int test_SpatialIndex_walk()
+{
+  const int n_points = 3000;
+
+  unsigned      seed     = 5;
+  PrimaryGrid  *primgrid = create_jittered_primgrid(26, 19, &seed);
+  SpatialIndex *index    = SpatialIndex_create();
+  double (*xy)[2] = calloc(n_points, sizeof(*xy));
+  int     *elems  = calloc(n_points, sizeof(int));
+  int i, hole;
+
+  check( primgrid && xy && elems, "Failed to create the test data." );
+  check( PrimaryGrid_build_topology(primgrid, 1),
+      "PrimaryGrid_build_topology() failed." );
+
+  for ( hole = 0; hole < 2; hole++ )
+  {
+    const int n_elems = primgrid->n_quads + primgrid->n_tris;
+
+    if ( hole )
+    {
+      check( cut_hole(primgrid, 0.3, 0.7), "Failed to cut the hole." );
+    }
+
+    check( SpatialIndex_build(index, primgrid), 
+        "SpatialIndex_build() failed." );
+
+    /* Random points from random hints                               */
+    for ( i = 0; i < n_points; i++ )
+    {
+      const double x    = 1.2 * test_rand(&seed) - 0.1;
+      const double y    = 1.2 * test_rand(&seed) - 0.1;
+      const int    hint = (int) ( test_rand(&seed) * n_elems ) - 1;
+      const int    elem = SpatialIndex_walk(index, hint, x, y);
+
+      check( check_located(primgrid, elem, x, y),
+          "Wrong element %d of point (%lf,%lf).", elem, x, y );
+    }
+
+    /* Spiral path through the grid and around the hole              */
+    for ( i = 0; i < n_points; i++ )
+    {
+      const double t = (double) i / n_points;
+      const double r = 0.05 + 0.55 * t;
+
+      xy[i][0] = 0.5 + r * cos(40.0 * t);
+      xy[i][1] = 0.5 + r * sin(40.0 * t);
+    }
+
+    SpatialIndex_locate_path(index, n_points, (const double (*)[2]) xy, 
+                             -1, elems);
+
+    for ( i = 0; i < n_points; i++ )
+      check( check_located(primgrid, elems[i], xy[i][0], xy[i][1]),
+          "Wrong element %d of path point %d.", elems[i], i );
+
+    check( SpatialIndex_locate_batch(index, n_points, 
+                                     (const double (*)[2]) xy, elems),
+        "SpatialIndex_locate_batch() failed." );
+
+    for ( i = 0; i < n_points; i++ )
+      check( check_located(primgrid, elems[i], xy[i][0], xy[i][1]),
+          "Wrong batch element %d of point %d.", elems[i], i );
+  }
+
+  free( xy );
+  free( elems );
+  SpatialIndex_destroy( index );
+  PrimaryGrid_destroy( primgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* test_SpatialIndex_walk() */
+
+
+/*********************************************************************
+* 
+*********************************************************************/
+int run_tests_SpatialIndex()
+{
+  check( test_SpatialIndex_locate(), 
+      "> test_SpatialIndex_locate() failed" ); 
+
+  check( test_SpatialIndex_nearest_vertex(), 
+      "> test_SpatialIndex_nearest_vertex() failed" ); 
+
+  check( test_SpatialIndex_walk(), 
+      "> test_SpatialIndex_walk() failed" ); 
+
+  fprintf(stderr, "> test_SpatialIndex() succeeded\n");
+  return ICF_SUCCESS;
+
+error:
+  fprintf(stderr, "> test_SpatialIndex() failed\n");
+  return ICF_ERROR;
+
+} /* run_tests_SpatialIndex() */
@@ -0,0 +1,110 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "MeshReader.h"
+#include "GmshReader.h"
+#include "PrimaryGrid.h"
+
+/***********************************************************************
+* Converts an ASCII mesh file to the binary primary grid format
+*
+* Usage: icf_mesh2bin [-m <budget-MB>] <input-mesh> <output-mesh>
+*
+* By default, the mesh is loaded as a whole with the streaming reader.
+* With -m, the mesh is converted out-of-core in blocks, such that the
+* memory usage is bounded by the given budget instead of the file size.
+* Gmsh files (*.msh) are imported with the Gmsh reader.
+***********************************************************************/
+int main(int argc, char *argv[])
+{
+  MeshReader  *mesh_reader = NULL;
+  PrimaryGrid *primgrid    = NULL;
+  long         budget_mb   = 0;
+  int          i_arg       = 1;
+
+  if ( argc == 5 && strcmp(argv[1], "-m") == 0 )
+  {
+    budget_mb = atol(argv[2]);
+    i_arg     = 3;
+  }
+
+  if ( argc - i_arg != 2 || ( i_arg > 1 && budget_mb < 1 ) )
+  {
+    fprintf(stderr, 
+        "Usage: %s [-m <budget-MB>] <input-mesh> <output-mesh>\n", 
+        argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *in_path  = argv[i_arg];
+  const char *out_path = argv[i_arg+1];
+  size_t      in_len   = strlen(in_path);
+  int         is_gmsh  = in_len > 4 
+                      && strcmp(in_path + in_len - 4, ".msh") == 0;
+
+  /*--------------------------------------------------------------------
+  | Out-of-core conversion with bounded memory
+  --------------------------------------------------------------------*/
+  if ( budget_mb > 0 && !is_gmsh )
+  {
+    check( MeshReader_convert_binary( in_path, out_path, 
+                                      (size_t) budget_mb << 20 ),
+        "Failed to convert mesh %s.", in_path );
+
+    log_info("Converted %s -> %s (memory budget %ld MB)",
+        in_path, out_path, budget_mb);
+
+    return EXIT_SUCCESS;
+  }
+
+  /*--------------------------------------------------------------------
+  | In-core conversion
+  --------------------------------------------------------------------*/
+  primgrid = PrimaryGrid_create();
+  check_mem( primgrid );
+
+  if ( is_gmsh )
+  {
+    check( GmshReader_read_primgrid( in_path, primgrid, 0 ),
+        "Failed to read Gmsh mesh %s.", in_path );
+  }
+  else
+  {
+    mesh_reader = MeshReader_create_mmap( in_path );
+    check( mesh_reader, "Failed to open mesh %s.", in_path );
+
+    check( MeshReader_stream_primgrid( mesh_reader, primgrid ),
+        "Failed to read mesh %s.", in_path );
+
+    MeshReader_destroy( mesh_reader );
+    mesh_reader = NULL;
+  }
+
+  check( PrimaryGrid_write_binary( primgrid, out_path ),
+      "Failed to write mesh %s.", out_path );
+
+  log_info("Converted %s -> %s (%d vertices, %d tris, %d quads)",
+      in_path, out_path, primgrid->n_vertices, 
+      primgrid->n_tris, primgrid->n_quads);
+
+  PrimaryGrid_destroy( primgrid );
+
+  return EXIT_SUCCESS;
+
+error:
+  if ( mesh_reader )
+    MeshReader_destroy( mesh_reader );
+  if ( primgrid )
+    PrimaryGrid_destroy( primgrid );
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,903 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mpi.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "Boundary.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "DistGrid.h"
+
+/* Message tag of the halo updates */
+#define ICF_DIST_TAG 4711
+
+/***********************************************************************
+* Returns the first vertex of rank <r>
+***********************************************************************/
+static inline int dist_begin(int r, int n_global, int n_ranks)
+{
+  return (int) ( (int64_t) n_global * r / n_ranks );
+
+} /* dist_begin() */
+
+/***********************************************************************
+* Returns the rank, which owns a global vertex
+***********************************************************************/
+int DistGrid_owner(int v, int n_global, int n_ranks)
+{
+  int r = (int) ( ( (int64_t) (v+1) * n_ranks - 1 ) / n_global );
+
+  while ( r > 0 && dist_begin(r, n_global, n_ranks) > v )
+    --r;
+
+  while ( r < n_ranks-1 && dist_begin(r+1, n_global, n_ranks) <= v )
+    ++r;
+
+  return r;
+
+} /* DistGrid_owner() */
+
+/***********************************************************************
+* Function to create a new distributed dualgrid 
+***********************************************************************/
+DistGrid *DistGrid_create(MPI_Comm comm)
+{
+  DistGrid *dist = calloc(1, sizeof(DistGrid));
+  check_mem(dist);
+
+  dist->comm = comm;
+  MPI_Comm_rank(comm, &dist->rank);
+  MPI_Comm_size(comm, &dist->n_ranks);
+
+  dist->dualgrid = NULL;
+
+  dist->inner_faces = NULL;
+  dist->halo_faces  = NULL;
+
+  dist->requests = NULL;
+  dist->send_buf = NULL;
+  dist->recv_buf = NULL;
+  dist->values   = NULL;
+
+  return dist;
+error:
+  return NULL;
+
+} /* DistGrid_create() */
+
+/***********************************************************************
+* Function to destroy a distributed dualgrid
+***********************************************************************/
+void DistGrid_destroy(DistGrid *dist)
+{
+  if ( dist->dualgrid )
+    DualGrid_destroy( dist->dualgrid );
+
+  free( dist->inner_faces );
+  free( dist->halo_faces );
+  free( dist->requests );
+  free( dist->send_buf );
+  free( dist->recv_buf );
+
+  free( dist );
+
+} /* DistGrid_destroy() */
+
+/***********************************************************************
+* Function to check, that a step succeeded on all ranks
+***********************************************************************/
+static int dist_all_ok(DistGrid *dist, int status)
+{
+  int all_ok = 0;
+
+  if ( MPI_Allreduce(&status, &all_ok, 1, MPI_INT, MPI_LAND, 
+                     dist->comm) != MPI_SUCCESS )
+    return ICF_ERROR;
+
+  return all_ok;
+
+} /* dist_all_ok() */
+
+/***********************************************************************
+* Function to compare two integers for qsort() and bsearch()
+***********************************************************************/
+static int cmp_int(const void *a, const void *b)
+{
+  const int ia = *(const int *) a;
+  const int ib = *(const int *) b;
+
+  return ( ia > ib ) - ( ia < ib );
+
+} /* cmp_int() */
+
+/***********************************************************************
+* Function to read the entries <first> ... <first>+<n>-1 of a section 
+* of a binary grid file, where every entry consists of <n_scalars>
+* scalars of size <scalar>
+***********************************************************************/
+static int dist_read_entries(int                      fd,
+                             const PrimaryGridHeader *header,
+                             int                      section,
+                             size_t                   scalar,
+                             size_t                   n_scalars,
+                             int64_t                  first,
+                             int64_t                  n,
+                             void                    *buf)
+{
+  char  *dst     = buf;
+  size_t n_bytes = (size_t) n * n_scalars * scalar;
+  off_t  offset  = (off_t) ( header->offsets[section] 
+                 + (uint64_t) first * n_scalars * scalar );
+
+  check( (uint64_t) (first + n) * n_scalars * scalar 
+         <= header->sizes[section],
+      "Read beyond section %d of the grid file.", section);
+
+  while ( n_bytes > 0 )
+  {
+    ssize_t n_read = pread(fd, dst, n_bytes, offset);
+    check( n_read > 0, "Failed to read section %d of the grid file.",
+        section);
+
+    dst     += n_read;
+    offset  += n_read;
+    n_bytes -= (size_t) n_read;
+  }
+
+  PrimaryGrid_swap_to_le(buf, (size_t) n * n_scalars, scalar);
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* dist_read_entries() */
+
+/***********************************************************************
+* Function to append <n> integers to a growing array 
+***********************************************************************/
+static int dist_append(int **array, int *n, int *cap, 
+                       const int *values, int n_values)
+{
+  if ( *n + n_values > *cap )
+  {
+    int  new_cap = MAX( 2 * (*cap), MAX(*n + n_values, 1024) );
+    int *tmp     = realloc( *array, (size_t) new_cap * sizeof(int) );
+    check_mem(tmp);
+
+    *array = tmp;
+    *cap   = new_cap;
+  }
+
+  memcpy(*array + *n, values, n_values * sizeof(int));
+  *n += n_values;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* dist_append() */
+
+/***********************************************************************
+* Function to stream the elements of a section in chunks and to 
+* collect all elements with <n_nodes> vertices, which are adjacent 
+* to an owned vertex
+***********************************************************************/
+static int dist_read_elems(DistGrid                *dist,
+                           int                      fd,
+                           const PrimaryGridHeader *header,
+                           int                      section,
+                           int                      n_nodes,
+                           int64_t                  n_elems,
+                           int                    **elems,
+                           int                     *n_loc)
+{
+  int *chunk = malloc( ICF_DIST_CHUNK * n_nodes * sizeof(int) );
+  int  n = 0, cap = 0;
+  int64_t first;
+  int i, k;
+
+  check_mem(chunk);
+
+  for ( first = 0; first < n_elems; first += ICF_DIST_CHUNK )
+  {
+    const int n_chunk = (int) MIN(n_elems - first, ICF_DIST_CHUNK);
+
+    check( dist_read_entries(fd, header, section, sizeof(int), n_nodes,
+                             first, n_chunk, chunk),
+        "Failed to read the elements.");
+
+    for ( i = 0; i < n_chunk; i++ )
+    {
+      const int *elem = chunk + i * n_nodes;
+
+      for ( k = 0; k < n_nodes; k++ )
+        if ( elem[k] >= dist->vtx_begin && elem[k] < dist->vtx_end )
+          break;
+
+      if ( k == n_nodes )
+        continue;
+
+      check( dist_append(elems, &n, &cap, elem, n_nodes),
+          "Failed to collect the elements.");
+    }
+  }
+
+  *n_loc = n / n_nodes;
+
+  free( chunk );
+
+  return ICF_SUCCESS;
+
+error:
+  free( chunk );
+
+  return ICF_ERROR;
+
+} /* dist_read_elems() */
+
+/***********************************************************************
+* Returns the local index of a global vertex or -1, if the vertex is
+* neither owned nor a ghost
+***********************************************************************/
+static inline int dist_local_index(const DistGrid *dist, 
+                                   const int      *ghosts, 
+                                   int             n_ghosts,
+                                   int             v)
+{
+  if ( v >= dist->vtx_begin && v < dist->vtx_end )
+    return v - dist->vtx_begin;
+
+  const int *g = bsearch(&v, ghosts, n_ghosts, sizeof(int), cmp_int);
+
+  if ( !g )
+    return -1;
+
+  return ( dist->vtx_end - dist->vtx_begin ) + (int) ( g - ghosts );
+
+} /* dist_local_index() */
+
+/***********************************************************************
+* Local part of the grid, which is read by a single rank
+***********************************************************************/
+typedef struct
+{
+  PrimaryGrid *primgrid;
+  int         *ghosts;
+  int          n_ghosts;
+
+} DistLocal;
+
+/***********************************************************************
+* Function to read the local elements, vertices and boundary edges 
+* of this rank and to set up its local primary grid
+***********************************************************************/
+static int dist_read_local(DistGrid                *dist,
+                           int                      fd,
+                           const PrimaryGridHeader *header,
+                           DistLocal               *loc)
+{
+  PrimaryGrid *prim = loc->primgrid;
+  int *quads = NULL, *tris = NULL;
+  int *bdry = NULL, *markers = NULL;
+  int *chunk = NULL, *marker_chunk = NULL;
+  int  n_bdry = 0, cap_bdry = 0, n_markers = 0, cap_markers = 0;
+  int  n_ghosts = 0, cap_ghosts = 0;
+  int64_t first;
+  int i, k;
+
+  const int n_owned = dist->vtx_end - dist->vtx_begin;
+
+  /*--------------------------------------------------------------------
+  | Stream the elements, that are adjacent to owned vertices
+  --------------------------------------------------------------------*/
+  check( dist_read_elems(dist, fd, header, ICF_GRID_QUADS, 4, 
+                         header->n_quads, &quads, &prim->n_quads),
+      "Failed to read the quads.");
+  check( dist_read_elems(dist, fd, header, ICF_GRID_TRIS, 3, 
+                         header->n_tris, &tris, &prim->n_tris),
+      "Failed to read the tris.");
+
+  prim->quads = (int (*)[4]) quads;
+  prim->tris  = (int (*)[3]) tris;
+  quads = tris = NULL;
+
+  /*--------------------------------------------------------------------
+  | The ghosts are sorted by their global indices, which also groups 
+  | them by their owners
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < 4 * prim->n_quads + 3 * prim->n_tris; i++ )
+  {
+    const int v = ( i < 4 * prim->n_quads ) 
+                ? prim->quads[i/4][i%4]
+                : prim->tris[(i - 4*prim->n_quads)/3]
+                            [(i - 4*prim->n_quads)%3];
+
+    check( v >= 0 && v < dist->n_global, "Invalid vertex %d.", v);
+
+    if ( v >= dist->vtx_begin && v < dist->vtx_end )
+      continue;
+
+    check( dist_append(&loc->ghosts, &n_ghosts, &cap_ghosts, &v, 1),
+        "Failed to collect the ghosts.");
+  }
+
+  qsort(loc->ghosts, n_ghosts, sizeof(int), cmp_int);
+
+  for ( i = 0, k = 0; i < n_ghosts; i++ )
+    if ( k == 0 || loc->ghosts[i] != loc->ghosts[k-1] )
+      loc->ghosts[k++] = loc->ghosts[i];
+
+  loc->n_ghosts = n_ghosts = k;
+
+  for ( i = 0; i < prim->n_quads; i++ )
+    for ( k = 0; k < 4; k++ )
+      prim->quads[i][k] = dist_local_index(dist, loc->ghosts, n_ghosts,
+                                           prim->quads[i][k]);
+
+  for ( i = 0; i < prim->n_tris; i++ )
+    for ( k = 0; k < 3; k++ )
+      prim->tris[i][k] = dist_local_index(dist, loc->ghosts, n_ghosts,
+                                          prim->tris[i][k]);
+
+  /*--------------------------------------------------------------------
+  | Read the owned vertex coordinates in one block and the ghost 
+  | coordinates in runs of consecutive indices
+  --------------------------------------------------------------------*/
+  prim->n_vertices    = n_owned + n_ghosts;
+  prim->vertex_coords = calloc( prim->n_vertices, 2*sizeof(double) );
+  check_mem(prim->vertex_coords);
+
+  check( dist_read_entries(fd, header, ICF_GRID_VERTEX_COORDS, 
+                           sizeof(double), 2, dist->vtx_begin, n_owned,
+                           prim->vertex_coords),
+      "Failed to read the vertex coordinates.");
+
+  for ( i = 0; i < n_ghosts; i = k )
+  {
+    for ( k = i+1; k < n_ghosts && loc->ghosts[k] == loc->ghosts[k-1]+1;
+          k++ );
+
+    check( dist_read_entries(fd, header, ICF_GRID_VERTEX_COORDS, 
+                             sizeof(double), 2, loc->ghosts[i], k - i,
+                             prim->vertex_coords[n_owned + i]),
+        "Failed to read the ghost coordinates.");
+  }
+
+  /*--------------------------------------------------------------------
+  | Stream the boundary edges and keep the edges of local vertices
+  --------------------------------------------------------------------*/
+  chunk        = malloc( 2 * ICF_DIST_CHUNK * sizeof(int) );
+  marker_chunk = malloc( ICF_DIST_CHUNK * sizeof(int) );
+  check_mem(chunk);
+  check_mem(marker_chunk);
+
+  for ( first = 0; first < header->n_bdry_edges; first += ICF_DIST_CHUNK )
+  {
+    const int n_chunk = (int) MIN(header->n_bdry_edges - first, 
+                                  ICF_DIST_CHUNK);
+
+    check( dist_read_entries(fd, header, ICF_GRID_BDRY_EDGES, 
+                             sizeof(int), 2, first, n_chunk, chunk),
+        "Failed to read the boundary edges.");
+    check( dist_read_entries(fd, header, ICF_GRID_BDRY_EDGE_MARKER, 
+                             sizeof(int), 1, first, n_chunk, 
+                             marker_chunk),
+        "Failed to read the boundary markers.");
+
+    for ( i = 0; i < n_chunk; i++ )
+    {
+      int edge[2];
+
+      edge[0] = dist_local_index(dist, loc->ghosts, n_ghosts, chunk[2*i]);
+      edge[1] = dist_local_index(dist, loc->ghosts, n_ghosts, chunk[2*i+1]);
+
+      if ( edge[0] < 0 || edge[1] < 0 )
+        continue;
+
+      check( dist_append(&bdry, &n_bdry, &cap_bdry, edge, 2)
+          && dist_append(&markers, &n_markers, &cap_markers, 
+                         &marker_chunk[i], 1),
+          "Failed to collect the boundary edges.");
+    }
+  }
+
+  check( DualGrid_build_local_topology(prim, n_markers, 
+                                       (int (*)[2]) bdry, markers),
+      "Failed to build the local grid of rank %d.", dist->rank);
+
+  free( bdry );
+  free( markers );
+  free( chunk );
+  free( marker_chunk );
+
+  return ICF_SUCCESS;
+
+error:
+  free( quads );
+  free( tris );
+  free( bdry );
+  free( markers );
+  free( chunk );
+  free( marker_chunk );
+
+  return ICF_ERROR;
+
+} /* dist_read_local() */
+
+/***********************************************************************
+* Function to set up the halo of this rank: The receive lists follow 
+* from the sorted ghosts, the send lists are requested by the 
+* neighbors, which send the global indices of their ghosts
+***********************************************************************/
+static int dist_build_halo(DistGrid     *dist, 
+                           DistLocal    *loc, 
+                           DualGridHalo *halo)
+{
+  const int n_ranks = dist->n_ranks;
+  const int n_owned = dist->vtx_end - dist->vtx_begin;
+
+  int *recv_counts = calloc( n_ranks, sizeof(int) );
+  int *send_counts = calloc( n_ranks, sizeof(int) );
+  int *recv_displs = calloc( n_ranks, sizeof(int) );
+  int *send_displs = calloc( n_ranks, sizeof(int) );
+  int *requested   = NULL;
+  int i, j, q;
+
+  check_mem(recv_counts);
+  check_mem(send_counts);
+  check_mem(recv_displs);
+  check_mem(send_displs);
+
+  halo->part     = dist->rank;
+  halo->n_parts  = n_ranks;
+  halo->n_owned  = n_owned;
+  halo->n_ghosts = loc->n_ghosts;
+
+  halo->global_index = calloc( n_owned + loc->n_ghosts, sizeof(int) );
+  halo->recv_idx     = calloc( MAX(loc->n_ghosts, 1), sizeof(int) );
+  check_mem(halo->global_index);
+  check_mem(halo->recv_idx);
+
+  for ( i = 0; i < n_owned; i++ )
+    halo->global_index[i] = dist->vtx_begin + i;
+
+  for ( i = 0; i < loc->n_ghosts; i++ )
+  {
+    halo->global_index[n_owned + i] = loc->ghosts[i];
+    halo->recv_idx[i] = n_owned + i;
+    ++recv_counts[ DistGrid_owner(loc->ghosts[i], dist->n_global, 
+                                  n_ranks) ];
+  }
+
+  /*--------------------------------------------------------------------
+  | Exchange the ghost indices with the owners
+  --------------------------------------------------------------------*/
+  check( MPI_Alltoall(recv_counts, 1, MPI_INT, send_counts, 1, MPI_INT,
+                      dist->comm) == MPI_SUCCESS,
+      "Failed to exchange the halo sizes.");
+
+  int n_requested = 0;
+
+  for ( q = 0; q < n_ranks; q++ )
+  {
+    recv_displs[q] = ( q > 0 ) ? recv_displs[q-1] + recv_counts[q-1] : 0;
+    send_displs[q] = n_requested;
+    n_requested   += send_counts[q];
+
+    if ( recv_counts[q] > 0 )
+      ++halo->n_nbr_parts;
+  }
+
+  requested = calloc( MAX(n_requested, 1), sizeof(int) );
+  check_mem(requested);
+
+  check( MPI_Alltoallv(loc->ghosts, recv_counts, recv_displs, MPI_INT,
+                       requested, send_counts, send_displs, MPI_INT,
+                       dist->comm) == MPI_SUCCESS,
+      "Failed to exchange the ghost indices.");
+
+  /*--------------------------------------------------------------------
+  | Set up the send and receive lists -> The halo is symmetric, 
+  | since ghosts are defined by joint primary grid elements
+  --------------------------------------------------------------------*/
+  const int n_nbrs = halo->n_nbr_parts;
+
+  halo->nbr_parts = calloc( MAX(n_nbrs, 1), sizeof(int) );
+  halo->send_ptr  = calloc( n_nbrs + 1, sizeof(int) );
+  halo->recv_ptr  = calloc( n_nbrs + 1, sizeof(int) );
+  halo->send_idx  = calloc( MAX(n_requested, 1), sizeof(int) );
+  check_mem(halo->nbr_parts);
+  check_mem(halo->send_ptr);
+  check_mem(halo->recv_ptr);
+  check_mem(halo->send_idx);
+
+  for ( q = 0, j = 0; q < n_ranks; q++ )
+  {
+    check( ( recv_counts[q] > 0 ) == ( send_counts[q] > 0 ),
+        "Halo of ranks %d and %d is not symmetric.", dist->rank, q);
+
+    if ( recv_counts[q] < 1 )
+      continue;
+
+    halo->nbr_parts[j]  = q;
+    halo->recv_ptr[j+1] = halo->recv_ptr[j] + recv_counts[q];
+    halo->send_ptr[j+1] = halo->send_ptr[j] + send_counts[q];
+
+    for ( i = 0; i < send_counts[q]; i++ )
+    {
+      const int v = requested[ send_displs[q] + i ];
+
+      check( v >= dist->vtx_begin && v < dist->vtx_end,
+          "Rank %d requested vertex %d, which is not owned by rank %d.",
+          q, v, dist->rank);
+
+      halo->send_idx[ halo->send_ptr[j] + i ] = v - dist->vtx_begin;
+    }
+
+    ++j;
+  }
+
+  free( recv_counts );
+  free( send_counts );
+  free( recv_displs );
+  free( send_displs );
+  free( requested );
+
+  return ICF_SUCCESS;
+
+error:
+  free( recv_counts );
+  free( send_counts );
+  free( recv_displs );
+  free( send_displs );
+  free( requested );
+
+  return ICF_ERROR;
+
+} /* dist_build_halo() */
+
+/***********************************************************************
+* Function to read the part of this rank from a binary grid file
+***********************************************************************/
+int DistGrid_read(DistGrid    *dist,
+                  BoundaryDef *bdry_def,
+                  const char  *file_path)
+{
+  PrimaryGridHeader header;
+  DistLocal     loc;
+  DualGridHalo *halo   = NULL;
+  DualGrid     *dual   = NULL;
+  int           fd     = -1;
+  int           status = ICF_SUCCESS;
+  int i, f;
+
+  memset(&loc, 0, sizeof(loc));
+
+  check( !dist->dualgrid, "Distributed grid is already set up.");
+
+  /*--------------------------------------------------------------------
+  | Read and validate the header
+  --------------------------------------------------------------------*/
+  fd = open(file_path, O_RDONLY);
+
+  if ( fd < 0 )
+  {
+    log_err("Failed to open %s.", file_path);
+    status = ICF_ERROR;
+  }
+  else if ( pread(fd, &header, sizeof(header), 0) != sizeof(header) )
+  {
+    log_err("Failed to read header from %s.", file_path);
+    status = ICF_ERROR;
+  }
+  else
+  {
+    PrimaryGrid_swap_header_to_le(&header);
+
+    if ( strncmp(header.magic, ICF_GRID_MAGIC, 8) != 0 
+      || header.version != ICF_GRID_VERSION 
+      || header.n_sections != ICF_GRID_N_SECTIONS )
+    {
+      log_err("%s is not a valid binary grid file.", file_path);
+      status = ICF_ERROR;
+    }
+    else if ( header.n_vertices < dist->n_ranks 
+           || header.n_vertices > INT32_MAX )
+    {
+      log_err("Invalid number of vertices %ld for %d ranks.", 
+          (long) header.n_vertices, dist->n_ranks);
+      status = ICF_ERROR;
+    }
+  }
+
+  check( dist_all_ok(dist, status), "Failed to open %s.", file_path);
+
+  dist->n_global  = (int) header.n_vertices;
+  dist->vtx_begin = dist_begin(dist->rank, dist->n_global, dist->n_ranks);
+  dist->vtx_end   = dist_begin(dist->rank+1, dist->n_global, 
+                               dist->n_ranks);
+
+  /*--------------------------------------------------------------------
+  | Read the local grid of every rank
+  --------------------------------------------------------------------*/
+  loc.primgrid = PrimaryGrid_create();
+  status = loc.primgrid 
+        && dist_read_local(dist, fd, &header, &loc);
+
+  check( dist_all_ok(dist, status), "Failed to read %s.", file_path);
+
+  close(fd);
+  fd = -1;
+
+  /*--------------------------------------------------------------------
+  | Set up the halo and build the local dualgrid
+  --------------------------------------------------------------------*/
+  halo = calloc(1, sizeof(DualGridHalo));
+  check_mem(halo);
+
+  status = dist_build_halo(dist, &loc, halo);
+
+  check( dist_all_ok(dist, status), 
+      "Failed to set up the halo of rank %d.", dist->rank);
+
+  dual = DualGrid_create();
+  status = dual && DualGrid_build(dual, bdry_def, loc.primgrid);
+
+  check( dist_all_ok(dist, status), 
+      "Failed to build the dualgrid of rank %d.", dist->rank);
+
+  dual->halo    = halo;
+  halo          = NULL;
+  loc.primgrid  = NULL;
+  dist->dualgrid = dual;
+
+  /*--------------------------------------------------------------------
+  | Split the faces into inner faces and faces at the halo, where 
+  | the second element is a ghost
+  --------------------------------------------------------------------*/
+  const int n_owned = dist->vtx_end - dist->vtx_begin;
+  const int n_nbrs  = dual->halo->n_nbr_parts;
+
+  for ( f = 0; f < dual->n_intr_faces; f++ )
+  {
+    if ( dual->face_nbrs[f][1] < n_owned )
+      ++dist->n_inner_faces;
+    else if ( dual->face_nbrs[f][0] < n_owned )
+      ++dist->n_halo_faces;
+  }
+
+  dist->inner_faces = calloc( MAX(dist->n_inner_faces, 1), sizeof(int) );
+  dist->halo_faces  = calloc( MAX(dist->n_halo_faces, 1), sizeof(int) );
+  dist->requests    = calloc( MAX(2 * n_nbrs, 1), sizeof(MPI_Request) );
+  check_mem(dist->inner_faces);
+  check_mem(dist->halo_faces);
+  check_mem(dist->requests);
+
+  for ( f = 0, i = 0; f < dual->n_intr_faces; f++ )
+    if ( dual->face_nbrs[f][1] < n_owned )
+      dist->inner_faces[i++] = f;
+
+  for ( f = 0, i = 0; f < dual->n_intr_faces; f++ )
+    if ( dual->face_nbrs[f][1] >= n_owned && dual->face_nbrs[f][0] < n_owned )
+      dist->halo_faces[i++] = f;
+
+  free( loc.ghosts );
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fd >= 0 )
+    close(fd);
+  if ( dual && dual != dist->dualgrid )
+    DualGrid_destroy( dual );
+  if ( loc.primgrid )
+    PrimaryGrid_destroy( loc.primgrid );
+  if ( halo )
+    DualGridHalo_destroy( halo );
+
+  free( loc.ghosts );
+
+  return ICF_ERROR;
+
+} /* DistGrid_read() */
+
+/***********************************************************************
+* Function to start a nonblocking halo update
+***********************************************************************/
+int DistGrid_update_begin(DistGrid *dist, double *values, int n_vars)
+{
+  const DualGridHalo *halo = dist->dualgrid->halo;
+  const int n_nbrs = halo->n_nbr_parts;
+  const int n_send = halo->send_ptr[n_nbrs];
+  const int n_recv = halo->recv_ptr[n_nbrs];
+  int j, k, v;
+
+  check( !dist->values, "A halo update is already pending.");
+  check( n_vars > 0, "Invalid number of variables %d.", n_vars);
+
+  if ( n_vars > dist->buf_vars )
+  {
+    free( dist->send_buf );
+    free( dist->recv_buf );
+
+    dist->send_buf = calloc( MAX(n_send, 1) * n_vars, sizeof(double) );
+    dist->recv_buf = calloc( MAX(n_recv, 1) * n_vars, sizeof(double) );
+    dist->buf_vars = 0;
+    check_mem(dist->send_buf);
+    check_mem(dist->recv_buf);
+    dist->buf_vars = n_vars;
+  }
+
+  for ( j = 0; j < n_nbrs; j++ )
+  {
+    const int n = halo->recv_ptr[j+1] - halo->recv_ptr[j];
+
+    check( MPI_Irecv(dist->recv_buf + halo->recv_ptr[j] * n_vars, 
+                     n * n_vars, MPI_DOUBLE, halo->nbr_parts[j], 
+                     ICF_DIST_TAG, dist->comm, 
+                     &dist->requests[j]) == MPI_SUCCESS,
+        "Failed to post the halo receive from rank %d.", 
+        halo->nbr_parts[j]);
+  }
+
+  for ( j = 0; j < n_nbrs; j++ )
+  {
+    const int *idx = halo->send_idx + halo->send_ptr[j];
+    const int  n   = halo->send_ptr[j+1] - halo->send_ptr[j];
+    double    *buf = dist->send_buf + halo->send_ptr[j] * n_vars;
+
+    for ( k = 0; k < n; k++ )
+      for ( v = 0; v < n_vars; v++ )
+        buf[k*n_vars + v] = values[idx[k]*n_vars + v];
+
+    check( MPI_Isend(buf, n * n_vars, MPI_DOUBLE, halo->nbr_parts[j],
+                     ICF_DIST_TAG, dist->comm, 
+                     &dist->requests[n_nbrs + j]) == MPI_SUCCESS,
+        "Failed to send the halo to rank %d.", halo->nbr_parts[j]);
+  }
+
+  dist->values = values;
+  dist->n_vars = n_vars;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* DistGrid_update_begin() */
+
+/***********************************************************************
+* Function to complete a halo update
+***********************************************************************/
+int DistGrid_update_end(DistGrid *dist)
+{
+  const DualGridHalo *halo = dist->dualgrid->halo;
+  const int n_vars = dist->n_vars;
+  double   *values = dist->values;
+  int k, v;
+
+  check( values, "No halo update is pending.");
+
+  dist->values = NULL;
+
+  check( MPI_Waitall(2 * halo->n_nbr_parts, dist->requests, 
+                     MPI_STATUSES_IGNORE) == MPI_SUCCESS,
+      "Failed to complete the halo update.");
+
+  for ( k = 0; k < halo->n_ghosts; k++ )
+    for ( v = 0; v < n_vars; v++ )
+      values[halo->recv_idx[k]*n_vars + v] = dist->recv_buf[k*n_vars + v];
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* DistGrid_update_end() */
+
+/***********************************************************************
+* Function to compute global sums over all ranks 
+***********************************************************************/
+int DistGrid_sum(DistGrid *dist, const double *local, double *global,
+                 int n)
+{
+  check( MPI_Allreduce(local, global, n, MPI_DOUBLE, MPI_SUM, 
+                       dist->comm) == MPI_SUCCESS,
+      "Failed to compute the global sum.");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* DistGrid_sum() */
+
+/***********************************************************************
+* Returns the global volume of all dualgrid elements
+***********************************************************************/
+double DistGrid_volume(DistGrid *dist)
+{
+  const DualGrid *dual = dist->dualgrid;
+  double vol = 0.0, total = 0.0;
+  int i;
+
+  for ( i = 0; i < dual->halo->n_owned; i++ )
+    vol += dual->vol[i];
+
+  if ( !DistGrid_sum(dist, &vol, &total, 1) )
+    return -1.0;
+
+  return total;
+
+} /* DistGrid_volume() */
+
+/***********************************************************************
+* Returns the global L2 norm of a residual
+***********************************************************************/
+double DistGrid_residual_norm(DistGrid     *dist, 
+                              const double *res, 
+                              int           n_vars)
+{
+  const int n = dist->dualgrid->halo->n_owned * n_vars;
+  double sum = 0.0, total = 0.0;
+  int i;
+
+  for ( i = 0; i < n; i++ )
+    sum += res[i] * res[i];
+
+  if ( !DistGrid_sum(dist, &sum, &total, 1) )
+    return -1.0;
+
+  return sqrt(total);
+
+} /* DistGrid_residual_norm() */
+
+/***********************************************************************
+* Function to compute the global boundary fluxes
+***********************************************************************/
+int DistGrid_boundary_fluxes(DistGrid *dist, double *fluxes)
+{
+  const DualGrid *dual = dist->dualgrid;
+  const int n_bdry = dual->boundaries->n_boundaries;
+  double   *local  = calloc( MAX(n_bdry, 1), sizeof(double) );
+  Boundary *bdry;
+  int i, k;
+
+  check_mem(local);
+
+  for ( bdry = dual->boundaries->start, k = 0; bdry && k < n_bdry; 
+        bdry = bdry->next, k++ )
+    for ( i = 0; i < bdry->n_bdry_points; i++ )
+      if ( bdry->bdry_points[i] < dual->halo->n_owned )
+        local[k] += bdry->bdry_mflux[i];
+
+  check( DistGrid_sum(dist, local, fluxes, n_bdry), 
+      "Failed to sum the boundary fluxes.");
+
+  free( local );
+
+  return ICF_SUCCESS;
+
+error:
+  free( local );
+
+  return ICF_ERROR;
+
+} /* DistGrid_boundary_fluxes() */
@@ -0,0 +1,139 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef DISTGRID_H
+#define DISTGRID_H
+
+#include <mpi.h>
+
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Boundary.h"
+
+/***********************************************************************
+* Distributed dualgrids for the MPI backend
+*
+* Every rank reads its part of a binary grid file (see 
+* PrimaryGrid_write_binary) and builds a rank-local dualgrid with one
+* layer of ghost elements (see DualGrid_extract_partition). 
+* The vertices are partitioned in contiguous ranges of their indices,
+* such that every rank knows the owner of every vertex without any 
+* communication. Grid files should therefore be ordered along a 
+* space-filling curve (see PrimaryGrid_reorder_sfc), which turns the
+* ranges into compact regions.
+* The element and boundary sections of the file are streamed in 
+* chunks of ICF_DIST_CHUNK entries, such that no rank holds the 
+* global grid in memory.
+***********************************************************************/
+#define ICF_DIST_CHUNK 65536
+
+/***********************************************************************
+* DistGrid structure
+***********************************************************************/
+typedef struct DistGrid
+{
+  MPI_Comm comm;
+  int      rank;
+  int      n_ranks;
+
+  /* Global number of vertices and the owned range of vertices */
+  int      n_global;
+  int      vtx_begin;
+  int      vtx_end;
+
+  /* The rank-local dualgrid, which owns its primary grid and halo */
+  DualGrid *dualgrid;
+
+  /* Faces between two owned elements and faces between an owned 
+   * and a ghost element -> Faces between two ghosts are not needed 
+   * for the owned elements */
+  int  n_inner_faces;
+  int *inner_faces;
+  int  n_halo_faces;
+  int *halo_faces;
+
+  /* State of a pending halo update */
+  MPI_Request *requests;
+  double      *send_buf;
+  double      *recv_buf;
+  double      *values;
+  int          n_vars;
+  int          buf_vars;
+
+} DistGrid;
+
+/***********************************************************************
+* Function to create a new distributed dualgrid on <comm>
+***********************************************************************/
+DistGrid *DistGrid_create(MPI_Comm comm);
+
+/***********************************************************************
+* Function to destroy a distributed dualgrid
+***********************************************************************/
+void DistGrid_destroy(DistGrid *dist);
+
+/***********************************************************************
+* Returns the rank, which owns the global vertex <v> of a grid with 
+* <n_global> vertices on <n_ranks> ranks
+***********************************************************************/
+int DistGrid_owner(int v, int n_global, int n_ranks);
+
+/***********************************************************************
+* Function to read the part of this rank from a binary grid file and 
+* to build its rank-local dualgrid and halo. This is a collective 
+* operation on the communicator of the distributed grid.
+* Returns ICF_SUCCESS or ICF_ERROR, if it failed on any rank
+***********************************************************************/
+int DistGrid_read(DistGrid    *dist,
+                  BoundaryDef *bdry_def,
+                  const char  *file_path);
+
+/***********************************************************************
+* Function to start the update of the ghost values of <values>
+* ([n_local][n_vars]) with nonblocking messages. The owned values 
+* must not be modified and the ghost values must not be accessed, 
+* until the update is completed with DistGrid_update_end(). 
+* Meanwhile, loops over the inner faces can be executed.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DistGrid_update_begin(DistGrid *dist, double *values, int n_vars);
+
+/***********************************************************************
+* Function to complete a halo update
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DistGrid_update_end(DistGrid *dist);
+
+/***********************************************************************
+* Function to compute the global sums of <n> values over all ranks 
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DistGrid_sum(DistGrid *dist, const double *local, double *global,
+                 int n);
+
+/***********************************************************************
+* Returns the global volume of all dualgrid elements
+***********************************************************************/
+double DistGrid_volume(DistGrid *dist);
+
+/***********************************************************************
+* Returns the global L2 norm of a residual <res> ([n_local][n_vars]) 
+* over all owned elements
+***********************************************************************/
+double DistGrid_residual_norm(DistGrid     *dist, 
+                              const double *res, 
+                              int           n_vars);
+
+/***********************************************************************
+* Function to compute the global boundary fluxes, i.e. the sums of 
+* the boundary mass fluxes <bdry_mflux> of the owned boundary 
+* vertices, for every boundary of the boundary list in <fluxes>
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DistGrid_boundary_fluxes(DistGrid *dist, double *fluxes);
+
+#endif /* DISTGRID_H */
@@ -7,6 +7,8 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 
 #include "dbg.h"
 #include "icf_utils.h"
@@ -14,89 +16,271 @@
 #include "Boundary.h"
 #include "DualGrid.h"
 #include "PrimaryGrid.h"
+#include "ThreadPool.h"
 
 /***********************************************************************
-* Function to compute the center of a primary grid triangle 
+* Number of elements, whose metrics are computed at once, before they
+* are scattered to the dualgrid
 ***********************************************************************/
-static inline void calc_tri_centroid(const double coords[3][2],
-                                     double       center[2]);
+#define DUALGRID_METRIC_CHUNK 256
 
 /***********************************************************************
-* Function to compute the edge centroids of a primary grid triangle 
+* Kernel template for the median dual metrics of elements with <N> 
+* vertices, where <verts> holds the vertices of the <n> elements. 
+* The element is split by its centroid and its edge midpoints into 
+* sub-triangles, such that local vertex k receives the dual area 
+* <area>[i][k] and the dual face, which crosses the local edge 
+* (k, k+1), receives the normal <norm>[i][k] (pointing from vertex k 
+* to vertex k+1 for counter-clockwise elements).
+* All loops over the vertices have constant trip counts and are 
+* unrolled, such that the element loop is free of branches and can 
+* be vectorized by the compiler.
 ***********************************************************************/
-static inline void calc_tri_edge_centroids(const double coords[3][2],
-                                           double       centroids[3][2]);
+#define DUALGRID_METRIC_KERNEL(NAME, N)                                  \
+static void NAME(const double (*restrict xy)[2],                        \
+                 const int    (*restrict verts)[N],                     \
+                 int                      n,                            \
+                 double       (*restrict area)[N],                      \
+                 double       (*restrict norm)[N][2])                   \
+{                                                                       \
+  int i, k;                                                             \
+                                                                        \
+  for ( i = 0; i < n; i++ )                                             \
+  {                                                                     \
+    double x[N], y[N], mx[N], my[N];                                    \
+    double cx = 0.0;                                                    \
+    double cy = 0.0;                                                    \
+                                                                        \
+    for ( k = 0; k < N; k++ )                                           \
+    {                                                                   \
+      x[k] = xy[verts[i][k]][0];                                        \
+      y[k] = xy[verts[i][k]][1];                                        \
+      cx  += x[k];                                                      \
+      cy  += y[k];                                                      \
+    }                                                                   \
+                                                                        \
+    cx /= N;                                                            \
+    cy /= N;                                                            \
+                                                                        \
+    /* Edge midpoints and face normals (CCW rotation of the face) */    \
+    for ( k = 0; k < N; k++ )                                           \
+    {                                                                   \
+      const int k1 = ( k + 1 ) % N;                                     \
+                                                                        \
+      mx[k] = 0.5 * ( x[k] + x[k1] );                                   \
+      my[k] = 0.5 * ( y[k] + y[k1] );                                   \
+                                                                        \
+      norm[i][k][0] = cy - my[k];                                       \
+      norm[i][k][1] = mx[k] - cx;                                       \
+    }                                                                   \
+                                                                        \
+    /* Sub-triangles of vertex k at the edges (k, k+1) and (k-1, k) */  \
+    for ( k = 0; k < N; k++ )                                           \
+    {                                                                   \
+      const int    km = ( k + N - 1 ) % N;                              \
+      const double bx = cx - x[k];                                      \
+      const double by = cy - y[k];                                      \
+                                                                        \
+      area[i][k] = 0.5 * ( ( mx[k]  - x[k] ) * by                       \
+                         - ( my[k]  - y[k] ) * bx )                     \
+                 - 0.5 * ( ( mx[km] - x[k] ) * by                       \
+                         - ( my[km] - y[k] ) * bx );                    \
+    }                                                                   \
+  }                                                                     \
+}
+
+DUALGRID_METRIC_KERNEL(dual_metrics_tri,  3)
+DUALGRID_METRIC_KERNEL(dual_metrics_quad, 4)
 
 /***********************************************************************
-* Function to compute the center of a primary grid quad 
+* Generic fallback of the metric kernels for a single polygon with 
+* <n> vertices <verts>
 ***********************************************************************/
-static inline void calc_quad_centroid(const double coords[4][2],
-                                      double       center[2]);
+static void dual_metrics_poly(const double (*xy)[2],
+                              const int     *verts,
+                              int            n,
+                              double        *area,
+                              double       (*norm)[2])
+{
+  double cx = 0.0;
+  double cy = 0.0;
+  int k;
+
+  for ( k = 0; k < n; k++ )
+  {
+    cx += xy[verts[k]][0];
+    cy += xy[verts[k]][1];
+  }
+
+  cx /= n;
+  cy /= n;
+
+  for ( k = 0; k < n; k++ )
+  {
+    const double *p  = xy[verts[k]];
+    const double *p1 = xy[verts[ k+1 < n ? k+1 : 0 ]];
+    const double *pm = xy[verts[ k > 0 ? k-1 : n-1 ]];
+
+    const double mx  = 0.5 * ( p[0] + p1[0] );
+    const double my  = 0.5 * ( p[1] + p1[1] );
+    const double mxm = 0.5 * ( pm[0] + p[0] );
+    const double mym = 0.5 * ( pm[1] + p[1] );
+    const double bx  = cx - p[0];
+    const double by  = cy - p[1];
+
+    norm[k][0] = cy - my;
+    norm[k][1] = mx - cx;
+
+    area[k] = 0.5 * ( ( mx  - p[0] ) * by - ( my  - p[1] ) * bx )
+            - 0.5 * ( ( mxm - p[0] ) * by - ( mym - p[1] ) * bx );
+  }
+
+} /* dual_metrics_poly() */
 
 /***********************************************************************
-* Function to compute the edge centroids of a primary grid quad 
+* Adds the metrics of <n> elements with <n_verts> vertices each, which
+* have been computed by a metric kernel, to the dualgrid. <verts> 
+* holds the element vertices and <faces> their entries of the element
+* edge map.
 ***********************************************************************/
-static inline void calc_quad_edge_centroids(const double coords[4][2],
-                                            double       centroids[4][2]);
+static inline void dual_metrics_scatter(DualGrid      *dualgrid,
+                                        const int     *verts,
+                                        const int     *faces,
+                                        int            n_verts,
+                                        int            n,
+                                        const double  *area,
+                                        const double (*norm)[2])
+{
+  double  *vol            = dualgrid->vol;
+  double (*face_norms)[2] = dualgrid->face_norms;
+  int i, k;
+
+  for ( i = 0; i < n; i++ )
+  {
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const int j  = n_verts * i + k;
+      const int p0 = verts[j];
+      const int p1 = verts[ k+1 < n_verts ? j+1 : j+1-n_verts ];
+
+      /* The normal points from the first to the second edge vertex, 
+       * the face normal from the lower to the higher element        */
+      const double sign = ( p0 < p1 ) ? 1.0 : -1.0;
+
+      vol[p0] += area[j];
+
+      face_norms[faces[j]][0] += sign * norm[j][0];
+      face_norms[faces[j]][1] += sign * norm[j][1];
+    }
+  }
+
+} /* dual_metrics_scatter() */
 
 /***********************************************************************
-* 
+* Releases the element edge map of a dualgrid
 ***********************************************************************/
-static inline void calc_tri_centroid(const double coords[3][2],
-                                     double       center[2]) 
+static void edge_faces_free(DualGrid *dualgrid)
 {
-  center[0] = (coords[0][0] + coords[1][0] + coords[2][0]) / 3.0;
-  center[1] = (coords[0][1] + coords[1][1] + coords[2][1]) / 3.0;
-}
+  free(dualgrid->edge_faces);
+
+  dualgrid->n_edge_faces = 0;
+  dualgrid->edge_faces   = NULL;
+  dualgrid->quad_faces   = NULL;
+  dualgrid->tri_faces    = NULL;
+
+} /* edge_faces_free() */
 
 /***********************************************************************
-* 
+* Sets <edge_faces> as element edge map of a dualgrid, which holds an
+* entry for all element edges of its primary grid
 ***********************************************************************/
-static inline void calc_tri_edge_centroids(const double coords[3][2],
-                                           double       centroids[3][2])
+static void edge_faces_attach(DualGrid *dualgrid, int *edge_faces)
 {
-  centroids[0][0] = 0.5 * ( coords[0][0] + coords[1][0] );
-  centroids[0][1] = 0.5 * ( coords[0][1] + coords[1][1] );
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
 
-  centroids[1][0] = 0.5 * ( coords[1][0] + coords[2][0] );
-  centroids[1][1] = 0.5 * ( coords[1][1] + coords[2][1] );
+  dualgrid->n_edge_faces = primgrid->n_elements > 0 
+                         ? primgrid->elem_ptr[primgrid->n_elements]
+                         : 4 * primgrid->n_quads + 3 * primgrid->n_tris;
 
-  centroids[2][0] = 0.5 * ( coords[2][0] + coords[0][0] );
-  centroids[2][1] = 0.5 * ( coords[2][1] + coords[0][1] );
-}
+  dualgrid->edge_faces = edge_faces;
+  dualgrid->quad_faces = (int (*)[4]) edge_faces;
+  dualgrid->tri_faces  = (int (*)[3]) ( edge_faces 
+                                      + 4 * primgrid->n_quads );
+
+} /* edge_faces_attach() */
 
 /***********************************************************************
-* 
+* Allocates the element edge map of a dualgrid for all element edges
+* of its primary grid
 ***********************************************************************/
-static inline void calc_quad_centroid(const double coords[4][2],
-                                      double       center[2])
+static int edge_faces_alloc(DualGrid *dualgrid)
 {
-  center[0] = 0.25 * ( coords[0][0] + coords[1][0] 
-                     + coords[2][0] + coords[3][0] );
-  center[1] = 0.25 * ( coords[0][1] + coords[1][1] 
-                     + coords[2][1] + coords[3][1] );
-}
+  edge_faces_free( dualgrid );
+  edge_faces_attach( dualgrid, NULL );
+
+  int *edge_faces = malloc(( (size_t) dualgrid->n_edge_faces + 1 ) 
+                           * sizeof(int));
+  check_mem(edge_faces);
+
+  edge_faces_attach( dualgrid, edge_faces );
+
+  return ICF_SUCCESS;
+
+error:
+  edge_faces_free( dualgrid );
+
+  return ICF_ERROR;
+
+} /* edge_faces_alloc() */
 
 /***********************************************************************
-* 
+* Sets the map entries of <n> elements with <n_verts> vertices each,
+* whose vertices <verts> are stored contiguously and whose first edge
+* is located at position <pos> of the map: The row of the first 
+* vertex of every element edge in the dualgrid adjacency holds the 
+* face to the second vertex.
 ***********************************************************************/
-static inline void calc_quad_edge_centroids(const double coords[4][2],
-                                            double       centroids[4][2])
+static inline int edge_faces_lookup(DualGrid  *dualgrid,
+                                    const int *verts,
+                                    int        n_verts,
+                                    int        n,
+                                    int        pos)
 {
-  centroids[0][0] = 0.5 * ( coords[0][0] + coords[1][0] );
-  centroids[0][1] = 0.5 * ( coords[0][1] + coords[1][1] );
+  const int *ptr   = dualgrid->elem_face_ptr;
+  const int *nbrs  = dualgrid->elem_nbrs;
+  const int *faces = dualgrid->elem_faces;
 
-  centroids[1][0] = 0.5 * ( coords[1][0] + coords[2][0] );
-  centroids[1][1] = 0.5 * ( coords[1][1] + coords[2][1] );
+  int *edge_faces = dualgrid->edge_faces + pos;
+  int i, k;
 
-  centroids[2][0] = 0.5 * ( coords[2][0] + coords[3][0] );
-  centroids[2][1] = 0.5 * ( coords[2][1] + coords[3][1] );
+  for ( i = 0; i < n; i++, verts += n_verts )
+  {
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const int p0 = verts[k];
+      const int p1 = verts[ k+1 < n_verts ? k+1 : 0 ];
 
-  centroids[3][0] = 0.5 * ( coords[3][0] + coords[0][0] );
-  centroids[3][1] = 0.5 * ( coords[3][1] + coords[0][1] );
-}
+      check( p0 >= 0 && p0 < dualgrid->n_elements, 
+          "Invalid element vertex %d.", p0);
+
+      int j = ptr[p0];
 
+      while ( j < ptr[p0+1] && nbrs[j] != p1 )
+        ++j;
 
+      check( j < ptr[p0+1],
+          "Element edge (%d,%d) has no dualgrid face.", p0, p1);
+
+      edge_faces[n_verts*i+k] = faces[j];
+    }
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* edge_faces_lookup() */
 
 /***********************************************************************
 * Function to create and initialize a new dualgrid structure
@@ -116,8 +300,32 @@ DualGrid *DualGrid_create()
 
   dualgrid->vol        = NULL; 
   dualgrid->face_norms = NULL; 
+
+  dualgrid->face_ptr      = NULL;
+  dualgrid->bdry_face_ptr = NULL;
+
+  dualgrid->elem_face_ptr   = NULL;
+  dualgrid->elem_faces      = NULL;
+  dualgrid->elem_face_signs = NULL;
+  dualgrid->elem_nbrs       = NULL;
+
+  dualgrid->n_edge_faces = 0;
+  dualgrid->edge_faces   = NULL;
+  dualgrid->quad_faces   = NULL;
+  dualgrid->tri_faces    = NULL;
+
+  dualgrid->n_colors         = 0;
+  dualgrid->color_block_size = 0;
+  dualgrid->color_ptr        = NULL;
+  dualgrid->color_blocks     = NULL;
+
   dualgrid->boundaries = BoundaryList_create();
 
+  dualgrid->halo = NULL;
+
+  dualgrid->cache_map = NULL;
+  dualgrid->cache_len = 0;
+
   return dualgrid;
 error:
   return NULL;
@@ -129,12 +337,38 @@ error:
 ***********************************************************************/
 void DualGrid_destroy(DualGrid* dualgrid)
 {
-  free(dualgrid->vol);
-  free(dualgrid->face_nbrs);
-  free(dualgrid->face_norms);
+  if ( dualgrid->cache_map )
+  {
+    munmap(dualgrid->cache_map, dualgrid->cache_len);
+  }
+  else
+  {
+    free(dualgrid->vol);
+    free(dualgrid->face_nbrs);
+    free(dualgrid->face_norms);
+  }
+
+  free(dualgrid->face_ptr);
+  free(dualgrid->bdry_face_ptr);
+
+  free(dualgrid->elem_face_ptr);
+  free(dualgrid->elem_faces);
+  free(dualgrid->elem_face_signs);
+  free(dualgrid->elem_nbrs);
+
+  free(dualgrid->edge_faces);
+
+  free(dualgrid->color_ptr);
+  free(dualgrid->color_blocks);
 
   BoundaryList_destroy( dualgrid->boundaries );
 
+  if ( dualgrid->halo )
+  {
+    DualGridHalo_destroy( dualgrid->halo );
+    PrimaryGrid_destroy( dualgrid->primgrid );
+  }
+
   free(dualgrid);
 
 } /* DualGrid_destroy() */
@@ -203,280 +437,1310 @@ DualGrid *DualGrid_build(DualGrid    *dualgrid,
     }
   }
 
+  /*--------------------------------------------------------------------
+  | Create connectivity between dual elements and their 
+  | corresponding joint median dual faces
+  --------------------------------------------------------------------*/
+  check( DualGrid_build_adjacency(dualgrid),
+      "Failed to build the dualgrid adjacency.");
+
+  /*--------------------------------------------------------------------
+  | The faces are numbered as the primary grid edges, such that the 
+  | element edge map, which has been recorded with the grid topology,
+  | is taken over. Otherwise, the map is looked up with the metrics.
+  --------------------------------------------------------------------*/
+  edge_faces_free( dualgrid );
+
+  if ( primgrid->elem_edges )
+  {
+    edge_faces_attach( dualgrid, primgrid->elem_edges );
+    primgrid->elem_edges = NULL;
+  }
+
   /*--------------------------------------------------------------------
   | Compute dualgrid volumes and interface normals
   --------------------------------------------------------------------*/
-  int n_tris  = primgrid->n_tris;
-  int n_quads = primgrid->n_quads;
-  int n_elems = dualgrid->n_elements;
-  int n_faces = dualgrid->n_intr_faces;
 
-  int (*tris)[3]  = primgrid->tris;
-  int (*quads)[4] = primgrid->quads;
+  check( DualGrid_compute_metrics(dualgrid),
+      "Failed to compute the dualgrid metrics.");
 
-  double (*v_coords)[2]   = primgrid->vertex_coords;
-  double  *vol            = dualgrid->vol;
-  int    (*face_nbrs)[2]  = dualgrid->face_nbrs;
-  double (*face_norms)[2] = dualgrid->face_norms;
 
-  int i_tri, i_quad, i_elem, i_face, k;
+  return dualgrid;
+
+error:
+  return NULL;
+
+} /* DualGrid_setup() */
+
+
+/***********************************************************************
+* Function to compute the volumes and face normals of a dualgrid 
+* from the elements of its primary grid
+***********************************************************************/
+int DualGrid_compute_metrics(DualGrid *dualgrid)
+{
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
+  const double (*xy)[2] = (const double (*)[2]) primgrid->vertex_coords;
+
+  const int n_tris  = primgrid->n_tris;
+  const int n_quads = primgrid->n_quads;
+
+  double area[4 * DUALGRID_METRIC_CHUNK];
+  double norm[4 * DUALGRID_METRIC_CHUNK][2];
+  int i, n;
 
   /*--------------------------------------------------------------------
-  | Count the total number of joint dualgrid faces of each median
-  | dual element
+  | A missing element edge map is set up chunk by chunk, while the 
+  | element vertices are in cache
   --------------------------------------------------------------------*/
-  int *n_elem_faces = calloc(dualgrid->n_elements, sizeof(int)); 
-   
-  for ( i_elem = 0; i_elem < n_elems; i_elem++ )
-    n_elem_faces[i_elem] = 0;
+  const int build_map = !dualgrid->edge_faces;
 
-  for ( i_face = 0; i_face < n_faces; i_face++ )
+  if ( build_map )
   {
-    int p0 = face_nbrs[i_face][0];
-    int p1 = face_nbrs[i_face][1];
-
-    ++n_elem_faces[p0];
-    ++n_elem_faces[p1];
+    check( dualgrid->elem_face_ptr, 
+        "Dualgrid has neither an element edge map nor an adjacency.");
+    check( edge_faces_alloc(dualgrid),
+        "Failed to allocate the element edge map.");
   }
 
+  const int *faces = dualgrid->edge_faces;
+
   /*--------------------------------------------------------------------
-  | Count maximum occuring face number of all elements
-  | --> Needed for memory allocation
+  | Initialize arrays for element volume and face normals
   --------------------------------------------------------------------*/
-  int n_max_faces = 0;
-  for ( i_elem = 0; i_elem < n_elems; i_elem++ )
-    n_max_faces = MAX( n_max_faces, n_elem_faces[i_elem] );
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+    dualgrid->vol[i] = 0.0;
+
+  for ( i = 0; i < dualgrid->n_intr_faces; i++ )
+    dualgrid->face_norms[i][0] = dualgrid->face_norms[i][1] = 0.0;
 
   /*--------------------------------------------------------------------
-  | Create connectivity list between dual elements and their 
-  | corresponding joint median dual faces
+  | Compute dualgrid metrics that arise from triangular elements
   --------------------------------------------------------------------*/
-  int **elem_to_face = malloc( n_elems * sizeof(int*) );
+  for ( i = 0; i < n_tris; i += DUALGRID_METRIC_CHUNK )
+  {
+    const int pos = 4 * n_quads + 3 * i;
 
-  for ( i_elem = 0; i_elem < n_elems; i_elem++ )
+    n = MIN(DUALGRID_METRIC_CHUNK, n_tris - i);
+
+    dual_metrics_tri(xy, (const int (*)[3]) primgrid->tris + i, n,
+                     (double (*)[3]) area, (double (*)[3][2]) norm);
+
+    if ( build_map )
+    {
+      check( edge_faces_lookup(dualgrid, primgrid->tris[i], 3, n, pos),
+          "Failed to map the tri edges.");
+    }
+
+    dual_metrics_scatter(dualgrid, primgrid->tris[i], faces + pos, 3, n,
+                         area, (const double (*)[2]) norm);
+  }
+
+  /*--------------------------------------------------------------------
+  | Compute dualgrid metrics that arise from quadrilateral elements
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_quads; i += DUALGRID_METRIC_CHUNK )
   {
-    elem_to_face[i_elem] = malloc( (n_max_faces + 1) * sizeof(int) );
-    
-    for ( i_face = 0; i_face < n_max_faces + 1; i_face++ )
-      elem_to_face[i_elem][i_face] = 0;
+    const int pos = 4 * i;
+
+    n = MIN(DUALGRID_METRIC_CHUNK, n_quads - i);
+
+    dual_metrics_quad(xy, (const int (*)[4]) primgrid->quads + i, n,
+                      (double (*)[4]) area, (double (*)[4][2]) norm);
+
+    if ( build_map )
+    {
+      check( edge_faces_lookup(dualgrid, primgrid->quads[i], 4, n, pos),
+          "Failed to map the quad edges.");
+    }
+
+    dual_metrics_scatter(dualgrid, primgrid->quads[i], faces + pos, 4, n,
+                         area, (const double (*)[2]) norm);
   }
 
-  for ( i_face = 0; i_face < n_faces; i_face++ )
+  /*--------------------------------------------------------------------
+  | Compute dualgrid metrics that arise from the polygons of the 
+  | element store
+  --------------------------------------------------------------------*/
+  for ( i = n_quads + n_tris; i < primgrid->n_elements; i++ )
   {
-    int p0 = face_nbrs[i_face][0];
-    int p1 = face_nbrs[i_face][1];
+    const int *verts = ICF_ELEM_VERTS(primgrid, i);
 
-    int off_p0 = elem_to_face[p0][0] + 1;
-    int off_p1 = elem_to_face[p1][0] + 1;
+    n = ICF_ELEM_N_VERTS(primgrid, i);
 
-    elem_to_face[p0][off_p0] = i_face;
-    elem_to_face[p1][off_p1] = i_face;
+    check( n <= 4 * DUALGRID_METRIC_CHUNK, 
+        "Polygon %d has too many vertices.", i);
 
-    ++elem_to_face[p0][0];
-    ++elem_to_face[p1][0];
+    const int pos = primgrid->elem_ptr[i];
+
+    if ( build_map )
+    {
+      check( edge_faces_lookup(dualgrid, verts, n, 1, pos),
+          "Failed to map the edges of polygon %d.", i);
+    }
+
+    dual_metrics_poly(xy, verts, n, area, norm);
+    dual_metrics_scatter(dualgrid, verts, faces + pos, n, 1,
+                         area, (const double (*)[2]) norm);
   }
 
+  return ICF_SUCCESS;
+
+error:
+  if ( build_map )
+    edge_faces_free( dualgrid );
+
+  return ICF_ERROR;
+
+} /* DualGrid_compute_metrics() */
+
+/***********************************************************************
+* Function to set up the element-to-face and element-to-element 
+* adjacency of a dualgrid from its face neighbors
+***********************************************************************/
+int DualGrid_build_adjacency(DualGrid *dualgrid)
+{
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = dualgrid->n_intr_faces;
+  int (*face_nbrs)[2] = dualgrid->face_nbrs;
+
+  int *offsets = NULL;
+  int i_elem, i_face;
+
+  free(dualgrid->elem_face_ptr);
+  free(dualgrid->elem_faces);
+  free(dualgrid->elem_face_signs);
+  free(dualgrid->elem_nbrs);
+
+  dualgrid->elem_face_ptr   = calloc(n_elems + 1, sizeof(int));
+  dualgrid->elem_faces      = malloc((2 * (size_t) n_faces + 1) * sizeof(int));
+  dualgrid->elem_face_signs = malloc((2 * (size_t) n_faces + 1) * sizeof(int));
+  dualgrid->elem_nbrs       = malloc((2 * (size_t) n_faces + 1) * sizeof(int));
+  offsets                   = malloc((n_elems + 1) * sizeof(int));
+
+  check_mem(dualgrid->elem_face_ptr);
+  check_mem(dualgrid->elem_faces);
+  check_mem(dualgrid->elem_face_signs);
+  check_mem(dualgrid->elem_nbrs);
+  check_mem(offsets);
+
+  int *ptr = dualgrid->elem_face_ptr;
+
   /*--------------------------------------------------------------------
-  | Initialize arrays for element volume and face normals
+  | Count the faces of every element
   --------------------------------------------------------------------*/
+  for ( i_face = 0; i_face < n_faces; i_face++ )
+  {
+    const int p0 = face_nbrs[i_face][0];
+    const int p1 = face_nbrs[i_face][1];
+
+    check( p0 >= 0 && p0 < n_elems && p1 >= 0 && p1 < n_elems 
+        && p0 != p1,
+        "Invalid neighbors (%d,%d) of dualgrid face %d.", p0, p1, i_face);
+
+    ++ptr[p0+1];
+    ++ptr[p1+1];
+  }
+
   for ( i_elem = 0; i_elem < n_elems; i_elem++ )
-    vol[i_elem] = 0.0;
+    ptr[i_elem+1] += ptr[i_elem];
+
+  /*--------------------------------------------------------------------
+  | Distribute the faces to their elements
+  --------------------------------------------------------------------*/
+  memcpy(offsets, ptr, n_elems * sizeof(int));
 
   for ( i_face = 0; i_face < n_faces; i_face++ )
-    face_norms[i_face][0] = face_norms[i_face][1] = 0.0;
+  {
+    const int p0 = face_nbrs[i_face][0];
+    const int p1 = face_nbrs[i_face][1];
+
+    const int k0 = offsets[p0]++;
+    const int k1 = offsets[p1]++;
+
+    dualgrid->elem_faces[k0]      = i_face;
+    dualgrid->elem_face_signs[k0] = 1;
+    dualgrid->elem_nbrs[k0]       = p1;
+
+    dualgrid->elem_faces[k1]      = i_face;
+    dualgrid->elem_face_signs[k1] = -1;
+    dualgrid->elem_nbrs[k1]       = p0;
+  }
+
+  free( offsets );
+
+  return ICF_SUCCESS;
+
+error:
+  free( offsets );
+
+  free(dualgrid->elem_face_ptr);
+  free(dualgrid->elem_faces);
+  free(dualgrid->elem_face_signs);
+  free(dualgrid->elem_nbrs);
+
+  dualgrid->elem_face_ptr   = NULL;
+  dualgrid->elem_faces      = NULL;
+  dualgrid->elem_face_signs = NULL;
+  dualgrid->elem_nbrs       = NULL;
+
+  return ICF_ERROR;
+
+} /* DualGrid_build_adjacency() */
+
+/***********************************************************************
+* Function to set up the map of the primary grid element edges to 
+* the dualgrid faces
+***********************************************************************/
+int DualGrid_build_edge_faces(DualGrid *dualgrid)
+{
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
+
+  const int n_quads = primgrid->n_quads;
+  const int n_tris  = primgrid->n_tris;
+  int i_elem;
+
+  check( edge_faces_alloc(dualgrid),
+      "Failed to allocate the element edge map.");
+
+  if ( !dualgrid->elem_face_ptr )
+  {
+    check( DualGrid_build_adjacency(dualgrid),
+        "Failed to build the dualgrid adjacency.");
+  }
+
+  if ( n_quads > 0 )
+  {
+    check( edge_faces_lookup(dualgrid, primgrid->quads[0], 4, n_quads, 0),
+        "Failed to map the quad edges.");
+  }
+
+  if ( n_tris > 0 )
+  {
+    check( edge_faces_lookup(dualgrid, primgrid->tris[0], 3, n_tris, 
+                             4 * n_quads),
+        "Failed to map the tri edges.");
+  }
+
+  for ( i_elem = n_quads + n_tris; i_elem < primgrid->n_elements; 
+        i_elem++ )
+  {
+    check( edge_faces_lookup(dualgrid, ICF_ELEM_VERTS(primgrid, i_elem),
+                             ICF_ELEM_N_VERTS(primgrid, i_elem), 1, 
+                             primgrid->elem_ptr[i_elem]),
+        "Failed to map the edges of polygon %d.", i_elem);
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  edge_faces_free( dualgrid );
+
+  return ICF_ERROR;
+
+} /* DualGrid_build_edge_faces() */
+
+/***********************************************************************
+* Function to sort the dualgrid faces <i_start> ... <i_end>-1 by their
+* element indices with two stable counting sorts, first by the second 
+* and then by the first element. The row pointer of the sorted faces 
+* is stored in <face_ptr> and the new index of every face i in 
+* new_index[i], if <new_index> is not NULL.
+***********************************************************************/
+static int sort_face_range(DualGrid *dualgrid, 
+                           int       i_start,
+                           int       i_end,
+                           int      *face_ptr,
+                           int      *new_index)
+{
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = i_end - i_start;
+
+  int    (*face_nbrs)[2]  = dualgrid->face_nbrs  + i_start;
+  double (*face_norms)[2] = dualgrid->face_norms + i_start;
+
+  int    *counts    = calloc(n_elems + 1, sizeof(int));
+  int    *order     = malloc(( 2 * (size_t) n_faces + 1 ) * sizeof(int));
+  int   (*nbrs)[2]  = malloc(( (size_t) n_faces + 1 ) * 2*sizeof(int));
+  double (*norms)[2]= malloc(( (size_t) n_faces + 1 ) * 2*sizeof(double));
+  int i, k;
+
+  check_mem(counts);
+  check_mem(order);
+  check_mem(nbrs);
+  check_mem(norms);
+
+  int *by_second = order;
+  int *by_first  = order + n_faces;
 
   /*--------------------------------------------------------------------
-  | Compute dualgrid metrics that arise from triangular elements
+  | Order the faces by their second element
   --------------------------------------------------------------------*/
-  for ( i_tri = 0; i_tri < n_tris; i_tri++ )
-  {
-    int *tri = tris[i_tri];
+  for ( i = 0; i < n_faces; i++ )
+    ++counts[ face_nbrs[i][1] + 1 ];
 
-    double tri_coords[3][2] = {
-      { v_coords[tri[0]][0], v_coords[tri[0]][1] },
-      { v_coords[tri[1]][0], v_coords[tri[1]][1] },
-      { v_coords[tri[2]][0], v_coords[tri[2]][1] },
-    };
+  for ( k = 0; k < n_elems; k++ )
+    counts[k+1] += counts[k];
 
-    double tri_centroid[2]      = { 0.0 };
-    double edge_centroids[3][2] = { 0.0 };
+  for ( i = 0; i < n_faces; i++ )
+    by_second[ counts[ face_nbrs[i][1] ]++ ] = i;
 
-    calc_tri_centroid(tri_coords, tri_centroid);
-    calc_tri_edge_centroids(tri_coords, edge_centroids);
+  /*--------------------------------------------------------------------
+  | Stable reordering by their first element
+  --------------------------------------------------------------------*/
+  memset(counts, 0, ( n_elems + 1 ) * sizeof(int));
 
-    /* Loop over all triangle edges and compute forward sub-triangles */
-    for ( i_edge = 0; i_edge < 3; i_edge++ )
-    {
-      /* Local vertex indices -> range from 0 to 2 */ 
-      const int p0_loc = i_edge;
-      const int p1_loc = MOD(i_edge+1,3);
-      
-      /* Global vertex indices */
-      int p0 = tri[p0_loc];
-      int p1 = tri[p1_loc];
-
-      const double a0[2] = {
-        edge_centroids[i_edge][0] - tri_coords[p0_loc][0],
-        edge_centroids[i_edge][1] - tri_coords[p0_loc][1],
-      };
-
-      const double b0[2] = {
-        tri_centroid[0] - tri_coords[p0_loc][0],
-        tri_centroid[1] - tri_coords[p0_loc][1],
-      };
-
-
-      const double a1[2] = {
-        edge_centroids[i_edge][0] - tri_coords[p1_loc][0],
-        edge_centroids[i_edge][1] - tri_coords[p1_loc][1],
-      };
-
-      const double b1[2] = {
-        tri_centroid[0] - tri_coords[p1_loc][0],
-        tri_centroid[1] - tri_coords[p1_loc][1],
-      };
-
-      /* Sub-triangle area */
-      const double area0 = 0.5 * ( a0[0] * b0[1] - a0[1] * b0[0] ) ;
-      const double area1 = 0.5 * ( a1[0] * b1[1] - a1[1] * b1[0] ) ;
-
-      vol[p0] += area0;
-      vol[p1] -= area1;
-
-
-      /* Normal contribution of sub-triangle interface 
-       * --> Rotation in CCW */
-      const double norm[2] = {
-        -edge_centroids[i_edge][1] + tri_centroid[1],
-         edge_centroids[i_edge][0] - tri_centroid[0],
-      };
-
-      /* Find global index of current face and compute face normal 
-       * --> Normal points from p0 to p1 */
-      int *faces_p0 = elem_to_face[p0];
-
-      for ( k = 0; k < faces_p0[0]; k++ )
-      {
-        i_face = faces_p0[k+1];
+  for ( i = 0; i < n_faces; i++ )
+    ++counts[ face_nbrs[i][0] + 1 ];
 
-        if (face_nbrs[i_face][0] == p1)
-        {
-          face_norms[i_face][0] -= norm[0];
-          face_norms[i_face][1] -= norm[1];
-          break;
-        }
+  for ( k = 0; k < n_elems; k++ )
+    counts[k+1] += counts[k];
 
-        if (face_nbrs[i_face][1] == p1)
-        {
-          face_norms[i_face][0] += norm[0];
-          face_norms[i_face][1] += norm[1];
-          break;
-        }
-      }
-    } /* for ( i_edge = ... ) */
-  } /* for( i_tri = ... ) */
+  for ( k = 0; k <= n_elems; k++ )
+    face_ptr[k] = i_start + counts[k];
+
+  for ( i = 0; i < n_faces; i++ )
+  {
+    const int j = by_second[i];
+    by_first[ counts[ face_nbrs[j][0] ]++ ] = j;
+  }
 
   /*--------------------------------------------------------------------
-  | Compute dualgrid metrics that arise from quadrilateral elements
+  | Permute the face arrays in place, since they may point into 
+  | the grid cache mapping
   --------------------------------------------------------------------*/
-  for ( i_quad = 0; i_quad < n_quads; i_quad++ )
+  for ( i = 0; i < n_faces; i++ )
   {
-    int *quad = quads[i_quad];
+    const int j = by_first[i];
+
+    nbrs[i][0]  = face_nbrs[j][0];
+    nbrs[i][1]  = face_nbrs[j][1];
+    norms[i][0] = face_norms[j][0];
+    norms[i][1] = face_norms[j][1];
+  }
 
-    double quad_coords[4][2] = {
-      { v_coords[quad[0]][0], v_coords[quad[0]][1] },
-      { v_coords[quad[1]][0], v_coords[quad[1]][1] },
-      { v_coords[quad[2]][0], v_coords[quad[2]][1] },
-      { v_coords[quad[3]][0], v_coords[quad[3]][1] },
-    };
+  memcpy(face_nbrs,  nbrs,  n_faces * 2 * sizeof(int));
+  memcpy(face_norms, norms, n_faces * 2 * sizeof(double));
 
-    double quad_centroid[2]     = { 0.0 };
-    double edge_centroids[4][2] = { 0.0 };
+  if ( new_index )
+    for ( i = 0; i < n_faces; i++ )
+      new_index[ i_start + by_first[i] ] = i_start + i;
 
-    calc_quad_centroid(quad_coords, quad_centroid);
-    calc_quad_edge_centroids(quad_coords, edge_centroids);
+  free( counts );
+  free( order );
+  free( nbrs );
+  free( norms );
 
-    /* Loop over all quad edges and compute forward sub-triangles */
-    for ( i_edge = 0; i_edge < 4; i_edge++ )
-    {
-      /* Local vertex indices -> range from 0 to 2 */ 
-      const int p0_loc = i_edge;
-      const int p1_loc = MOD(i_edge+1,4);
+  return ICF_SUCCESS;
 
-      /* Global vertex indices */
-      int p0 = quad[p0_loc];
-      int p1 = quad[p1_loc];
+error:
+  free( counts );
+  free( order );
+  free( nbrs );
+  free( norms );
 
-      const double a0[2] = {
-        edge_centroids[i_edge][0] - quad_coords[p0_loc][0],
-        edge_centroids[i_edge][1] - quad_coords[p0_loc][1],
-      };
+  return ICF_ERROR;
 
-      const double b0[2] = {
-        quad_centroid[0] - quad_coords[p0_loc][0],
-        quad_centroid[1] - quad_coords[p0_loc][1],
-      };
+} /* sort_face_range() */
 
+/***********************************************************************
+* Function to sort the faces of a dualgrid by their element indices 
+***********************************************************************/
+int DualGrid_sort_faces(DualGrid *dualgrid)
+{
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = dualgrid->n_intr_faces;
+  const int n_bdry  = dualgrid->primgrid->n_bdry_edges;
 
-      const double a1[2] = {
-        edge_centroids[i_edge][0] - quad_coords[p1_loc][0],
-        edge_centroids[i_edge][1] - quad_coords[p1_loc][1],
-      };
+  int *new_index = NULL;
+  int i;
 
-      const double b1[2] = {
-        quad_centroid[0] - quad_coords[p1_loc][0],
-        quad_centroid[1] - quad_coords[p1_loc][1],
-      };
+  check( n_bdry >= 0 && n_bdry <= n_faces,
+      "Dualgrid faces do not match the primary grid.");
 
-      /* Sub-triangle area */
-      const double area0 = 0.5 * ( a0[0] * b0[1] - a0[1] * b0[0] ) ;
-      const double area1 = 0.5 * ( a1[0] * b1[1] - a1[1] * b1[0] ) ;
+  /* The faces of an element edge map are renumbered afterwards      */
+  if ( dualgrid->edge_faces )
+  {
+    new_index = malloc(( (size_t) n_faces + 1 ) * sizeof(int));
+    check_mem(new_index);
+  }
 
-      vol[p0] += area0;
-      vol[p1] -= area1;
+  if ( !dualgrid->face_ptr )
+    dualgrid->face_ptr = calloc(n_elems + 1, sizeof(int));
+  if ( !dualgrid->bdry_face_ptr )
+    dualgrid->bdry_face_ptr = calloc(n_elems + 1, sizeof(int));
 
+  check_mem(dualgrid->face_ptr);
+  check_mem(dualgrid->bdry_face_ptr);
 
-      /* Normal contribution of sub-triangle interface 
-       * --> Rotation in CCW */
-      const double norm[2] = {
-        -edge_centroids[i_edge][1] + quad_centroid[1],
-         edge_centroids[i_edge][0] - quad_centroid[0],
-      };
+  check( sort_face_range(dualgrid, 0, n_faces - n_bdry, 
+                         dualgrid->face_ptr, new_index),
+      "Failed to sort the interior dualgrid faces.");
 
-      /* Find global index of current face and compute face normal 
-       * --> Normal points from p0 to p1 */
-      int *faces_p0 = elem_to_face[p0];
+  check( sort_face_range(dualgrid, n_faces - n_bdry, n_faces,
+                         dualgrid->bdry_face_ptr, new_index),
+      "Failed to sort the boundary dualgrid faces.");
 
-      for ( k = 0; k < faces_p0[0]; k++ )
-      {
-        i_face = faces_p0[k+1];
+  check( DualGrid_build_adjacency(dualgrid),
+      "Failed to build the dualgrid adjacency.");
 
-        if (face_nbrs[i_face][0] == p1)
-        {
-          face_norms[i_face][0] -= norm[0];
-          face_norms[i_face][1] -= norm[1];
-          break;
-        }
+  /* The face neighbors keep their order, such that the lower element
+   * of every face still orients its normal                          */
+  if ( new_index )
+  {
+    for ( i = 0; i < dualgrid->n_edge_faces; i++ )
+      dualgrid->edge_faces[i] = new_index[ dualgrid->edge_faces[i] ];
 
-        if (face_nbrs[i_face][1] == p1)
-        {
-          face_norms[i_face][0] += norm[0];
-          face_norms[i_face][1] += norm[1];
-          break;
-        }
+    free( new_index );
+    new_index = NULL;
+  }
+
+  /* The coloring refers to the old face indices */
+  free(dualgrid->color_ptr);
+  free(dualgrid->color_blocks);
+
+  dualgrid->n_colors     = 0;
+  dualgrid->color_ptr    = NULL;
+  dualgrid->color_blocks = NULL;
+
+  return ICF_SUCCESS;
+
+error:
+  free( new_index );
+  return ICF_ERROR;
+
+} /* DualGrid_sort_faces() */
+
+
+/***********************************************************************
+* Function to mark the colors of all blocks, which share an element 
+* with block <i_block>, with the stamp <i_block> in <marks>
+***********************************************************************/
+static inline void mark_block_colors(const DualGrid *dualgrid,
+                                     const int      *colors,
+                                     int             block_size,
+                                     int             i_block,
+                                     int            *marks)
+{
+  const int *ptr = dualgrid->elem_face_ptr;
+  const int  i_start = i_block * block_size;
+  const int  i_end   = MIN( i_start + block_size, dualgrid->n_intr_faces );
+  int i_face, k, j;
+
+  for ( i_face = i_start; i_face < i_end; i_face++ )
+    for ( k = 0; k < 2; k++ )
+    {
+      const int p = dualgrid->face_nbrs[i_face][k];
+
+      for ( j = ptr[p]; j < ptr[p+1]; j++ )
+      {
+        const int c = colors[ dualgrid->elem_faces[j] / block_size ];
+
+        if ( c >= 0 )
+          marks[c] = i_block;
       }
-    } /* for ( i_edge = ... ) */
-  } /* for( i_quad = ... ) */
+    }
+
+} /* mark_block_colors() */
+
+/***********************************************************************
+* Function to color the faces of a dualgrid in blocks
+***********************************************************************/
+int DualGrid_color_faces(DualGrid *dualgrid, 
+                         int       block_size, 
+                         int       balance)
+{
+  const int n_elems = dualgrid->n_elements;
+  const int n_faces = dualgrid->n_intr_faces;
+
+  int *colors = NULL;
+  int *marks  = NULL;
+  int *counts = NULL;
+  int i_elem, i_block, c, n_colors, n_blocks, max_colors;
+
+  check( block_size > 0, "Invalid block size %d.", block_size);
+
+  if ( !dualgrid->elem_face_ptr )
+  {
+    check( DualGrid_build_adjacency(dualgrid),
+        "Failed to build the dualgrid adjacency.");
+  }
 
+  const int *ptr = dualgrid->elem_face_ptr;
+
+  n_blocks = ( n_faces + block_size - 1 ) / block_size;
 
   /*--------------------------------------------------------------------
-  | Free temporary memory
+  | A block shares elements with at most 2 * block_size * max_valence 
+  | other blocks, which bounds the number of colors
   --------------------------------------------------------------------*/
-  free( n_elem_faces );
-
+  max_colors = 1;
   for ( i_elem = 0; i_elem < n_elems; i_elem++ )
-    free( elem_to_face[i_elem] );
-  free( elem_to_face );
+    max_colors = MAX( max_colors, 2 * (ptr[i_elem+1] - ptr[i_elem]) );
 
+  max_colors = MIN( (long) max_colors * block_size, n_blocks ) + 1;
 
-} /* DualGrid_setup() */
+  colors = malloc( ( n_blocks + 1 ) * sizeof(int) );
+  marks  = malloc( max_colors * sizeof(int) );
+  counts = calloc( max_colors + 1, sizeof(int) );
+
+  check_mem(colors);
+  check_mem(marks);
+  check_mem(counts);
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+    colors[i_block] = -1;
+  for ( c = 0; c < max_colors; c++ )
+    marks[c] = -1;
+
+#define BLOCK_N_FACES(b) \
+  ( MIN( ((b)+1) * block_size, n_faces ) - (b) * block_size )
+
+  /*--------------------------------------------------------------------
+  | Greedy coloring: Every block gets the lowest color, which is not 
+  | used by any block it shares an element with 
+  | -> counts holds the number of faces of every color
+  --------------------------------------------------------------------*/
+  n_colors = 0;
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+  {
+    mark_block_colors(dualgrid, colors, block_size, i_block, marks);
+
+    for ( c = 0; marks[c] == i_block; c++ );
+
+    colors[i_block] = c;
+    counts[c] += BLOCK_N_FACES(i_block);
+    n_colors = MAX( n_colors, c + 1 );
+  }
+
+  /*--------------------------------------------------------------------
+  | Balancing: Move blocks from colors above the mean size to the 
+  | first color below the mean size, that is not used by any of 
+  | the blocks they share an element with
+  --------------------------------------------------------------------*/
+  if ( balance && n_colors > 1 )
+  {
+    const int target = ( n_faces + n_colors - 1 ) / n_colors;
+
+    for ( c = 0; c < max_colors; c++ )
+      marks[c] = -1;
+
+    for ( i_block = 0; i_block < n_blocks; i_block++ )
+    {
+      const int c_old = colors[i_block];
+      const int n_blk = BLOCK_N_FACES(i_block);
+
+      if ( counts[c_old] <= target )
+        continue;
+
+      mark_block_colors(dualgrid, colors, block_size, i_block, marks);
+
+      for ( c = 0; c < n_colors; c++ )
+        if ( counts[c] + n_blk <= target && marks[c] != i_block )
+          break;
+
+      if ( c == n_colors )
+        continue;
+
+      colors[i_block] = c;
+      counts[c_old] -= n_blk;
+      counts[c]     += n_blk;
+    }
+  }
+
+#undef BLOCK_N_FACES
+
+  /*--------------------------------------------------------------------
+  | Store the blocks of every color in index order
+  --------------------------------------------------------------------*/
+  free(dualgrid->color_ptr);
+  free(dualgrid->color_blocks);
+
+  dualgrid->n_colors         = n_colors;
+  dualgrid->color_block_size = block_size;
+  dualgrid->color_ptr        = calloc( n_colors + 1, sizeof(int) );
+  dualgrid->color_blocks     = malloc( ( n_blocks + 1 ) * sizeof(int) );
+
+  check_mem(dualgrid->color_ptr);
+  check_mem(dualgrid->color_blocks);
+
+  memset(counts, 0, ( max_colors + 1 ) * sizeof(int));
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+    ++dualgrid->color_ptr[ colors[i_block] + 1 ];
+
+  for ( c = 0; c < n_colors; c++ )
+  {
+    dualgrid->color_ptr[c+1] += dualgrid->color_ptr[c];
+    counts[c] = dualgrid->color_ptr[c];
+  }
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+    dualgrid->color_blocks[ counts[colors[i_block]]++ ] = i_block;
+
+  free( colors );
+  free( marks );
+  free( counts );
+
+  return ICF_SUCCESS;
+
+error:
+  free( colors );
+  free( marks );
+  free( counts );
+
+  free(dualgrid->color_ptr);
+  free(dualgrid->color_blocks);
+
+  dualgrid->n_colors     = 0;
+  dualgrid->color_ptr    = NULL;
+  dualgrid->color_blocks = NULL;
+
+  return ICF_ERROR;
+
+} /* DualGrid_color_faces() */
+
+/***********************************************************************
+* Function to compute the imbalance of a face coloring
+***********************************************************************/
+double DualGrid_color_imbalance(const DualGrid *dualgrid,
+                                double         *color_imbalance)
+{
+  const int bs      = dualgrid->color_block_size;
+  const int n_faces = dualgrid->n_intr_faces;
+  int c, j, n_max = 0;
+
+  if ( dualgrid->n_colors < 1 || n_faces < 1 )
+  {
+    for ( c = 0; color_imbalance && c < dualgrid->n_colors; c++ )
+      color_imbalance[c] = 1.0;
+    return 1.0;
+  }
+
+  const double mean = (double) n_faces / (double) dualgrid->n_colors;
+
+  for ( c = 0; c < dualgrid->n_colors; c++ )
+  {
+    int n_color = 0;
+
+    for ( j = dualgrid->color_ptr[c]; j < dualgrid->color_ptr[c+1]; j++ )
+    {
+      const int b = dualgrid->color_blocks[j];
+      n_color += MIN( (b+1) * bs, n_faces ) - b * bs;
+    }
+
+    if ( color_imbalance )
+      color_imbalance[c] = (double) n_color / mean;
+
+    n_max = MAX( n_max, n_color );
+  }
+
+  return (double) n_max / mean;
+
+} /* DualGrid_color_imbalance() */
+
+/***********************************************************************
+* Context of the face loop tasks of a single color
+***********************************************************************/
+typedef struct 
+{
+  DualGridFaceTask *task;
+  void             *ctx;
+  const int        *blocks;
+  int               n_blocks;
+  int               block_size;
+  int               n_faces;
+  int               n_chunks;
+
+} ColorLoopCtx;
+
+static void color_loop_task(void *ctx, int i_task, int i_thread)
+{
+  ColorLoopCtx *c = ctx;
+  const int bs = c->block_size;
+
+  const int j_start = (int) ( (long) c->n_blocks * i_task / c->n_chunks );
+  const int j_end   = (int) ( (long) c->n_blocks * (i_task+1) / c->n_chunks );
+  int j;
+
+  for ( j = j_start; j < j_end; j++ )
+  {
+    const int b = c->blocks[j];
+    c->task(c->ctx, b * bs, MIN( (b+1) * bs, c->n_faces ), i_thread);
+  }
+
+} /* color_loop_task() */
+
+/***********************************************************************
+* Function to execute a face loop color by color on a thread pool
+***********************************************************************/
+void DualGrid_color_loop(const DualGrid   *dualgrid,
+                         ThreadPool       *pool,
+                         DualGridFaceTask *task,
+                         void             *ctx)
+{
+  ColorLoopCtx color_ctx;
+  int c;
+
+  color_ctx.task       = task;
+  color_ctx.ctx        = ctx;
+  color_ctx.block_size = dualgrid->color_block_size;
+  color_ctx.n_faces    = dualgrid->n_intr_faces;
+  color_ctx.n_chunks   = pool ? pool->n_threads : 1;
+
+  for ( c = 0; c < dualgrid->n_colors; c++ )
+  {
+    color_ctx.blocks   = dualgrid->color_blocks + dualgrid->color_ptr[c];
+    color_ctx.n_blocks = dualgrid->color_ptr[c+1] - dualgrid->color_ptr[c];
+
+    if ( pool )
+      ThreadPool_run(pool, color_ctx.n_chunks, color_loop_task, &color_ctx);
+    else
+      color_loop_task(&color_ctx, 0, 0);
+  }
+
+} /* DualGrid_color_loop() */
+
+/***********************************************************************
+* Edge of a partition-local grid with its orientation in the first 
+* adjacent element and the number of adjacent local elements
+***********************************************************************/
+typedef struct
+{
+  int lo, hi;
+  int p0, p1;
+  int count;
+
+} LocalEdge;
+
+static int cmp_local_edges(const void *a, const void *b)
+{
+  const LocalEdge *ea = a;
+  const LocalEdge *eb = b;
+
+  if ( ea->lo != eb->lo )
+    return ea->lo < eb->lo ? -1 : 1;
+
+  if ( ea->hi != eb->hi )
+    return ea->hi < eb->hi ? -1 : 1;
+
+  return 0;
+
+} /* cmp_local_edges() */
+
+/***********************************************************************
+* Function to check if a primary grid element with <n> vertices is 
+* adjacent to a vertex of partition <i_part>
+***********************************************************************/
+static inline int elem_in_part(const int *elem, int n, 
+                               const int *part, int i_part)
+{
+  int k;
+
+  for ( k = 0; k < n; k++ )
+    if ( part[elem[k]] == i_part )
+      return 1;
+
+  return 0;
+
+} /* elem_in_part() */
+
+/***********************************************************************
+* Function to mark the ghost vertices of a local primary grid element
+* and to count them for their owning partitions
+***********************************************************************/
+static inline void mark_ghosts(const int *elem, int n, const int *part,
+                               int *loc_index, int *n_part_ghosts)
+{
+  int k;
+
+  for ( k = 0; k < n; k++ )
+  {
+    if ( loc_index[elem[k]] != -1 )
+      continue;
+
+    loc_index[elem[k]] = -2;
+    ++n_part_ghosts[ part[elem[k]] ];
+  }
+
+} /* mark_ghosts() */
+
+/***********************************************************************
+* Function to mark the owned vertices of a local primary grid element
+* with <stamp>, if the element is adjacent to a ghost of <nbr_part>
+***********************************************************************/
+static inline void stamp_send(const int *elem, int n, 
+                              const int *part, const int *global_index,
+                              int n_owned, int nbr_part, 
+                              int *stamps, int stamp)
+{
+  int k;
+
+  for ( k = 0; k < n; k++ )
+    if ( elem[k] >= n_owned && part[global_index[elem[k]]] == nbr_part )
+      break;
+
+  if ( k == n )
+    return;
+
+  for ( k = 0; k < n; k++ )
+    if ( elem[k] < n_owned )
+      stamps[elem[k]] = stamp;
+
+} /* stamp_send() */
+
+/***********************************************************************
+* Function to set up the boundary edges and the connectivity of a 
+* partition-local primary grid
+***********************************************************************/
+int DualGrid_build_local_topology(PrimaryGrid *loc_prim,
+                                  int          n_bdry_edges,
+                                  int        (*bdry_edges)[2],
+                                  const int   *bdry_markers)
+{
+  LocalEdge *edges = NULL;
+  int i, j, k, pass;
+
+  free( loc_prim->bdry_edges );
+  free( loc_prim->bdry_edge_marker );
+  free( loc_prim->bdry_edge_nbrs );
+  loc_prim->bdry_edges       = NULL;
+  loc_prim->bdry_edge_marker = NULL;
+  loc_prim->bdry_edge_nbrs   = NULL;
+  loc_prim->n_bdry_edges     = 0;
+
+  /*--------------------------------------------------------------------
+  | Collect the edges of all local elements. Edges with a single 
+  | adjacent local element are either on the primary grid boundary
+  | or at the outer rim of the ghost layer.
+  --------------------------------------------------------------------*/
+  int n_edges = 4 * loc_prim->n_quads + 3 * loc_prim->n_tris;
+
+  edges = calloc( n_edges, sizeof(LocalEdge) );
+  check_mem(edges);
+
+  for ( i = 0, j = 0; i < loc_prim->n_quads + loc_prim->n_tris; i++ )
+  {
+    const int  n    = ( i < loc_prim->n_quads ) ? 4 : 3;
+    const int *elem = ( i < loc_prim->n_quads ) 
+                    ? loc_prim->quads[i] 
+                    : loc_prim->tris[i - loc_prim->n_quads];
+
+    for ( k = 0; k < n; k++, j++ )
+    {
+      edges[j].p0    = elem[k];
+      edges[j].p1    = elem[(k+1) % n];
+      edges[j].lo    = MIN(edges[j].p0, edges[j].p1);
+      edges[j].hi    = MAX(edges[j].p0, edges[j].p1);
+      edges[j].count = 1;
+    }
+  }
+
+  qsort(edges, n_edges, sizeof(LocalEdge), cmp_local_edges);
+
+  for ( i = 0, j = 0; i < n_edges; i++ )
+  {
+    if ( j > 0 && cmp_local_edges(&edges[j-1], &edges[i]) == 0 )
+      ++edges[j-1].count;
+    else
+      edges[j++] = edges[i];
+  }
+
+  n_edges = j;
+
+  /*--------------------------------------------------------------------
+  | Keep the given boundary edges of the local elements with their 
+  | markers and close the ghost layer with halo boundary edges
+  --------------------------------------------------------------------*/
+  int n_bdry = 0;
+
+  for ( pass = 0; pass < 2; pass++ )
+  {
+    if ( pass == 1 )
+    {
+      for ( i = 0; i < n_edges; i++ )
+        if ( edges[i].count == 1 )
+          ++n_bdry;
+
+      loc_prim->n_bdry_edges     = n_bdry;
+      loc_prim->bdry_edges       = calloc( MAX(n_bdry, 1), 2*sizeof(int) );
+      loc_prim->bdry_edge_marker = calloc( MAX(n_bdry, 1), sizeof(int) );
+      check_mem(loc_prim->bdry_edges);
+      check_mem(loc_prim->bdry_edge_marker);
+
+      n_bdry = 0;
+    }
+
+    for ( i = 0; i < n_bdry_edges; i++ )
+    {
+      LocalEdge key;
+
+      const int p0 = bdry_edges[i][0];
+      const int p1 = bdry_edges[i][1];
+
+      check( p0 >= 0 && p0 < loc_prim->n_vertices 
+          && p1 >= 0 && p1 < loc_prim->n_vertices,
+          "Invalid boundary edge (%d,%d).", p0, p1);
+
+      key.lo = MIN(p0, p1);
+      key.hi = MAX(p0, p1);
+
+      LocalEdge *edge = bsearch(&key, edges, n_edges, sizeof(LocalEdge),
+                                cmp_local_edges);
+
+      if ( !edge )
+        continue;
+
+      if ( pass == 0 )
+      {
+        check( edge->count == 1, 
+            "Boundary edge (%d,%d) is an interior edge.", p0, p1);
+        continue;
+      }
+
+      loc_prim->bdry_edges[n_bdry][0]    = p0;
+      loc_prim->bdry_edges[n_bdry][1]    = p1;
+      loc_prim->bdry_edge_marker[n_bdry] = bdry_markers[i];
+      edge->count = 0;
+      ++n_bdry;
+    }
+  }
+
+  for ( i = 0; i < n_edges; i++ )
+  {
+    if ( edges[i].count != 1 )
+      continue;
+
+    loc_prim->bdry_edges[n_bdry][0]    = edges[i].p0;
+    loc_prim->bdry_edges[n_bdry][1]    = edges[i].p1;
+    loc_prim->bdry_edge_marker[n_bdry] = ICF_HALO_MARKER;
+    ++n_bdry;
+  }
+
+  check( PrimaryGrid_build_topology(loc_prim, 1),
+      "Failed to build the topology of the local grid.");
+
+  free( edges );
+
+  return ICF_SUCCESS;
+
+error:
+  free( edges );
+
+  return ICF_ERROR;
+
+} /* DualGrid_build_local_topology() */
+
+/***********************************************************************
+* Function to extract a partition of a dualgrid as a self-contained
+* local primary grid and dualgrid
+***********************************************************************/
+DualGrid *DualGrid_extract_partition(const DualGrid *dualgrid,
+                                     BoundaryDef    *bdry_def,
+                                     const int      *part,
+                                     int             n_parts,
+                                     int             i_part)
+{
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
+
+  PrimaryGrid  *loc_prim = NULL;
+  DualGrid     *loc_dual = NULL;
+  DualGridHalo *halo     = NULL;
+
+  int  *loc_index      = NULL;
+  int  *n_ghosts       = NULL;
+  int  *stamps         = NULL;
+  int (*bdry_edges)[2] = NULL;
+  int  *bdry_markers   = NULL;
+
+  int i, j, k, v, pass;
+
+  check( primgrid, "Dualgrid has no primary grid.");
+  check( primgrid->n_polys == 0, 
+      "Partitions of grids with polygons are not supported.");
+  check( part, "No partition defined.");
+  check( n_parts > 0 && i_part >= 0 && i_part < n_parts,
+      "Invalid partition %d of %d partitions.", i_part, n_parts);
+
+  const int n_verts = primgrid->n_vertices;
+
+  loc_index = malloc( MAX(n_verts, 1) * sizeof(int) );
+  n_ghosts  = calloc( n_parts + 1, sizeof(int) );
+  halo      = calloc( 1, sizeof(DualGridHalo) );
+  loc_prim  = PrimaryGrid_create();
+  check_mem(loc_index);
+  check_mem(n_ghosts);
+  check_mem(halo);
+  check_mem(loc_prim);
+
+  halo->part    = i_part;
+  halo->n_parts = n_parts;
+
+  /*--------------------------------------------------------------------
+  | Number the owned vertices in the order of their global indices
+  --------------------------------------------------------------------*/
+  int n_owned = 0;
+
+  for ( v = 0; v < n_verts; v++ )
+  {
+    check( part[v] >= 0 && part[v] < n_parts,
+        "Invalid partition %d of element %d.", part[v], v);
+
+    loc_index[v] = ( part[v] == i_part ) ? n_owned++ : -1;
+  }
+
+  check( n_owned > 0, "Partition %d is empty.", i_part);
+
+  /*--------------------------------------------------------------------
+  | Collect all primary grid elements, which are adjacent to an 
+  | owned vertex, and mark their other vertices as ghosts
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < primgrid->n_quads; i++ )
+    if ( elem_in_part(primgrid->quads[i], 4, part, i_part) )
+      ++loc_prim->n_quads;
+
+  for ( i = 0; i < primgrid->n_tris; i++ )
+    if ( elem_in_part(primgrid->tris[i], 3, part, i_part) )
+      ++loc_prim->n_tris;
+
+  loc_prim->quads = calloc( MAX(loc_prim->n_quads, 1), 4*sizeof(int) );
+  loc_prim->tris  = calloc( MAX(loc_prim->n_tris, 1),  3*sizeof(int) );
+  check_mem(loc_prim->quads);
+  check_mem(loc_prim->tris);
+
+  for ( i = 0, j = 0; i < primgrid->n_quads; i++ )
+  {
+    if ( !elem_in_part(primgrid->quads[i], 4, part, i_part) )
+      continue;
+
+    memcpy(loc_prim->quads[j++], primgrid->quads[i], 4*sizeof(int));
+    mark_ghosts(primgrid->quads[i], 4, part, loc_index, n_ghosts);
+  }
+
+  for ( i = 0, j = 0; i < primgrid->n_tris; i++ )
+  {
+    if ( !elem_in_part(primgrid->tris[i], 3, part, i_part) )
+      continue;
+
+    memcpy(loc_prim->tris[j++], primgrid->tris[i], 3*sizeof(int));
+    mark_ghosts(primgrid->tris[i], 3, part, loc_index, n_ghosts);
+  }
+
+  /*--------------------------------------------------------------------
+  | Number the ghosts grouped by their owning partitions and set up 
+  | the receive lists, which are contiguous ranges of ghosts
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_parts; i++ )
+    if ( n_ghosts[i] > 0 )
+      ++halo->n_nbr_parts;
+
+  halo->nbr_parts = calloc( MAX(halo->n_nbr_parts, 1), sizeof(int) );
+  halo->send_ptr  = calloc( halo->n_nbr_parts + 1, sizeof(int) );
+  halo->recv_ptr  = calloc( halo->n_nbr_parts + 1, sizeof(int) );
+  check_mem(halo->nbr_parts);
+  check_mem(halo->send_ptr);
+  check_mem(halo->recv_ptr);
+
+  int n_loc = n_owned;
+
+  for ( i = 0, j = 0; i < n_parts; i++ )
+  {
+    const int n_part_ghosts = n_ghosts[i];
+
+    n_ghosts[i] = n_loc;
+    n_loc      += n_part_ghosts;
+
+    if ( n_part_ghosts < 1 )
+      continue;
+
+    halo->nbr_parts[j]  = i;
+    halo->recv_ptr[j+1] = n_loc - n_owned;
+    ++j;
+  }
+
+  halo->n_owned  = n_owned;
+  halo->n_ghosts = n_loc - n_owned;
+
+  halo->global_index = calloc( n_loc, sizeof(int) );
+  halo->recv_idx     = calloc( MAX(halo->n_ghosts, 1), sizeof(int) );
+  check_mem(halo->global_index);
+  check_mem(halo->recv_idx);
+
+  for ( v = 0; v < n_verts; v++ )
+  {
+    if ( loc_index[v] == -2 )
+      loc_index[v] = n_ghosts[ part[v] ]++;
+
+    if ( loc_index[v] >= 0 )
+      halo->global_index[ loc_index[v] ] = v;
+  }
+
+  for ( i = 0; i < halo->n_ghosts; i++ )
+    halo->recv_idx[i] = n_owned + i;
+
+  /*--------------------------------------------------------------------
+  | Set up the local vertices and renumber the local elements
+  --------------------------------------------------------------------*/
+  loc_prim->n_vertices    = n_loc;
+  loc_prim->vertex_coords = calloc( n_loc, 2*sizeof(double) );
+  check_mem(loc_prim->vertex_coords);
+
+  for ( i = 0; i < n_loc; i++ )
+  {
+    const int g = halo->global_index[i];
+    loc_prim->vertex_coords[i][0] = primgrid->vertex_coords[g][0];
+    loc_prim->vertex_coords[i][1] = primgrid->vertex_coords[g][1];
+  }
+
+  for ( i = 0; i < loc_prim->n_quads; i++ )
+    for ( k = 0; k < 4; k++ )
+      loc_prim->quads[i][k] = loc_index[ loc_prim->quads[i][k] ];
+
+  for ( i = 0; i < loc_prim->n_tris; i++ )
+    for ( k = 0; k < 3; k++ )
+      loc_prim->tris[i][k] = loc_index[ loc_prim->tris[i][k] ];
+
+  /*--------------------------------------------------------------------
+  | Set up the send lists: An owned vertex is a ghost of a neighbor 
+  | partition, if it shares a primary grid element with a vertex of 
+  | this neighbor. The first pass counts the vertices, the second 
+  | pass collects them in the order of their local indices.
+  --------------------------------------------------------------------*/
+  const int n_nbrs = halo->n_nbr_parts;
+
+  stamps = malloc( n_owned * sizeof(int) );
+  check_mem(stamps);
+
+  for ( i = 0; i < n_owned; i++ )
+    stamps[i] = -1;
+
+  for ( pass = 0; pass < 2; pass++ )
+  {
+    if ( pass == 1 )
+    {
+      halo->send_idx = calloc( MAX(halo->send_ptr[n_nbrs], 1), 
+                               sizeof(int) );
+      check_mem(halo->send_idx);
+    }
+
+    for ( j = 0; j < n_nbrs; j++ )
+    {
+      const int stamp = pass * n_nbrs + j;
+      int n_send = 0;
+
+      for ( i = 0; i < loc_prim->n_quads; i++ )
+        stamp_send(loc_prim->quads[i], 4, part, halo->global_index,
+                   n_owned, halo->nbr_parts[j], stamps, stamp);
+
+      for ( i = 0; i < loc_prim->n_tris; i++ )
+        stamp_send(loc_prim->tris[i], 3, part, halo->global_index,
+                   n_owned, halo->nbr_parts[j], stamps, stamp);
+
+      for ( i = 0; i < n_owned; i++ )
+      {
+        if ( stamps[i] != stamp )
+          continue;
+
+        if ( pass == 1 )
+          halo->send_idx[ halo->send_ptr[j] + n_send ] = i;
+
+        ++n_send;
+      }
+
+      if ( pass == 0 )
+        halo->send_ptr[j+1] = halo->send_ptr[j] + n_send;
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Collect the primary grid boundary edges of the local vertices
+  --------------------------------------------------------------------*/
+  int n_bdry = 0;
+
+  for ( pass = 0; pass < 2; pass++ )
+  {
+    if ( pass == 1 )
+    {
+      bdry_edges   = calloc( MAX(n_bdry, 1), 2*sizeof(int) );
+      bdry_markers = calloc( MAX(n_bdry, 1), sizeof(int) );
+      check_mem(bdry_edges);
+      check_mem(bdry_markers);
+      n_bdry = 0;
+    }
+
+    for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+    {
+      const int p0 = loc_index[ primgrid->bdry_edges[i][0] ];
+      const int p1 = loc_index[ primgrid->bdry_edges[i][1] ];
+
+      if ( p0 < 0 || p1 < 0 )
+        continue;
+
+      if ( pass == 1 )
+      {
+        bdry_edges[n_bdry][0] = p0;
+        bdry_edges[n_bdry][1] = p1;
+        bdry_markers[n_bdry]  = primgrid->bdry_edge_marker[i];
+      }
+
+      ++n_bdry;
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Build the connectivity and the local dualgrid
+  --------------------------------------------------------------------*/
+  check( DualGrid_build_local_topology(loc_prim, n_bdry, 
+                                      bdry_edges, bdry_markers),
+      "Failed to build the topology of partition %d.", i_part);
+
+  loc_dual = DualGrid_create();
+  check_mem(loc_dual);
+
+  check( DualGrid_build(loc_dual, bdry_def, loc_prim),
+      "Failed to build the dualgrid of partition %d.", i_part);
+
+  loc_dual->halo = halo;
+
+  free( loc_index );
+  free( n_ghosts );
+  free( stamps );
+  free( bdry_edges );
+  free( bdry_markers );
+
+  return loc_dual;
+
+error:
+  if ( loc_dual )
+    DualGrid_destroy( loc_dual );
+  if ( loc_prim )
+    PrimaryGrid_destroy( loc_prim );
+  if ( halo )
+    DualGridHalo_destroy( halo );
+
+  free( loc_index );
+  free( n_ghosts );
+  free( stamps );
+  free( bdry_edges );
+  free( bdry_markers );
+
+  return NULL;
+
+} /* DualGrid_extract_partition() */
+
+/***********************************************************************
+* Function to destroy a dualgrid halo structure
+***********************************************************************/
+void DualGridHalo_destroy(DualGridHalo *halo)
+{
+  free(halo->global_index);
+  free(halo->nbr_parts);
+  free(halo->send_ptr);
+  free(halo->send_idx);
+  free(halo->recv_ptr);
+  free(halo->recv_idx);
+
+  free(halo);
+
+} /* DualGridHalo_destroy() */
@@ -10,6 +10,54 @@
 
 #include "PrimaryGrid.h"
 #include "Boundary.h"
+#include "ThreadPool.h"
+
+/***********************************************************************
+* Boundary marker of the primary grid edges, that close a 
+* partition-local grid at the outer rim of its ghost layer 
+* (see DualGrid_extract_partition)
+***********************************************************************/
+#define ICF_HALO_MARKER -1
+
+/***********************************************************************
+* Halo of a partition-local dualgrid
+*
+* The local elements are numbered with the owned elements first, 
+* followed by the ghost elements, which are grouped by their owning 
+* partition. Within both groups, the elements keep the order of their
+* global indices. 
+* For the neighbor partition nbr_parts[i]:
+* -> send_idx[send_ptr[i]] ... send_idx[send_ptr[i+1]-1] are the local 
+*    indices of the owned elements, which are ghosts in the neighbor 
+* -> recv_idx[recv_ptr[i]] ... recv_idx[recv_ptr[i+1]-1] are the local
+*    indices of the ghost elements, which are owned by the neighbor
+* The send list of one partition and the receive list of its neighbor
+* hold the same elements in the same order.
+***********************************************************************/
+typedef struct DualGridHalo
+{
+  /* Index of this partition and total number of partitions */
+  int part;
+  int n_parts;
+
+  /* Number of owned and ghost elements */
+  int n_owned;
+  int n_ghosts;
+
+  /* Global index of every local element */
+  int *global_index;
+
+  /* Neighbor partitions and their send and receive lists */
+  int  n_nbr_parts;
+  int *nbr_parts;
+
+  int *send_ptr;
+  int *send_idx;
+
+  int *recv_ptr;
+  int *recv_idx;
+
+} DualGridHalo;
 
 /***********************************************************************
 * DualGrid structure
@@ -38,10 +86,65 @@ typedef struct DualGrid
   /* Associated face normals betwwen dualgrid elements */
   double (*face_norms)[2]; 
 
+  /* Row pointers of the faces, if they have been sorted by their 
+   * elements (see DualGrid_sort_faces), otherwise NULL: 
+   * -> face_ptr[i] ... face_ptr[i+1]-1 are the interior faces with 
+   *    the first element i 
+   * -> bdry_face_ptr[i] ... bdry_face_ptr[i+1]-1 are the faces on the
+   *    primary grid boundary with the first element i */
+  int *face_ptr;
+  int *bdry_face_ptr;
+
+  /* Adjacency of the dualgrid elements in CSR format: 
+   * elem_face_ptr[i] ... elem_face_ptr[i+1]-1 index the faces of 
+   * element i in <elem_faces>, ordered by the face index. 
+   * <elem_face_signs> is +1, if the face normal points out of 
+   * element i, and -1 otherwise. <elem_nbrs> is the element on 
+   * the other side of the face. */
+  int *elem_face_ptr;
+  int *elem_faces;
+  int *elem_face_signs;
+  int *elem_nbrs;
+
+  /* Map of the primary grid element edges to the dualgrid faces, if
+   * it has been set up (see DualGrid_build_edge_faces), otherwise 
+   * NULL: The <n_edge_faces> element edges are stored in the layout 
+   * of the primary grid element store, i.e. quad_faces[i][k] and 
+   * tri_faces[i][k] are the faces of the local edges (k, k+1) of 
+   * quad i and tri i, followed by the polygon edges at 
+   * elem_ptr[e] + k. The face normal points from vertex k to vertex
+   * k+1 of the element, if vertex k is the lower one, since the 
+   * first face neighbor is always the lower element. <quad_faces> 
+   * and <tri_faces> are views of <edge_faces>. */
+  int   n_edge_faces;
+  int  *edge_faces;
+  int (*quad_faces)[4];
+  int (*tri_faces)[3];
+
+  /* Coloring of contiguous blocks of faces into groups without 
+   * joint elements, if set up (see DualGrid_color_faces), otherwise
+   * n_colors = 0: Block b consists of the faces b*color_block_size 
+   * up to (b+1)*color_block_size-1 and color_ptr[c] ... 
+   * color_ptr[c+1]-1 index the blocks of color c in <color_blocks>,
+   * ordered by the block index. */
+  int  n_colors;
+  int  color_block_size;
+  int *color_ptr;
+  int *color_blocks;
 
   /* The mesh boundary */
   BoundaryList *boundaries;
 
+  /* Halo of a partition-local dualgrid, otherwise NULL -> The local 
+   * primary grid is owned by the dualgrid and destroyed with it */
+  DualGridHalo *halo;
+
+  /* Mapping of cached metrics, if the dualgrid was loaded from the 
+   * grid cache (see GridCache.h) -> vol, face_nbrs and face_norms 
+   * point into this mapping and must not be freed */
+  void  *cache_map;
+  size_t cache_len;
+
 } DualGrid;
 
 /***********************************************************************
@@ -55,10 +158,151 @@ DualGrid *DualGrid_create();
 void DualGrid_destroy(DualGrid* dualgrid);
 
 /***********************************************************************
-* Function to setup a dualgrid structure from a primary grid
+* Function to setup a dualgrid structure from a primary grid. 
+* The dualgrid takes over the element edge map of the primary grid
+* (see PrimaryGrid.elem_edges), if it is present.
 ***********************************************************************/
 DualGrid *DualGrid_build(DualGrid    *dualgrid, 
                          BoundaryDef *bdry_def,
                          PrimaryGrid *primgrid);
 
+/***********************************************************************
+* Function to compute the volumes and face normals of a dualgrid from
+* the elements of its primary grid. The elements of every type are 
+* processed in chunks by kernels, that are specialized for their 
+* number of vertices, before their metrics are added to the dualgrid
+* through the element edge map. A missing map is set up from the 
+* dualgrid adjacency along the way, such that the element vertices 
+* are read only once (see DualGrid_build_edge_faces).
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_compute_metrics(DualGrid *dualgrid);
+
+/***********************************************************************
+* Function to set up the map of the primary grid element edges to 
+* the dualgrid faces. Every element edge is looked up once among the
+* faces of its first vertex in the dualgrid adjacency, which is built
+* if necessary. Afterwards, element loops add to the faces without 
+* any search. An existing map is replaced. DualGrid_build sets up the
+* map from the primary grid topology or along with the metrics.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_build_edge_faces(DualGrid *dualgrid);
+
+/***********************************************************************
+* Function to set up the element-to-face and element-to-element 
+* adjacency of a dualgrid from its face neighbors. 
+* Existing adjacency arrays are replaced.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_build_adjacency(DualGrid *dualgrid);
+
+/***********************************************************************
+* Function to sort the faces of a dualgrid lexicographically by 
+* their element indices (face_nbrs[i][0], face_nbrs[i][1]), such that
+* the first-element accesses of face loops are monotonic. 
+* The faces on the primary grid boundary are sorted separately and 
+* are kept as contiguous tail of the face list. The face normals are 
+* permuted accordingly and the row pointers <face_ptr> and 
+* <bdry_face_ptr> are set up for vertex-based face loops and the 
+* element adjacency and the element edge map are rebuilt. An 
+* existing face coloring is discarded. 
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_sort_faces(DualGrid *dualgrid);
+
+/***********************************************************************
+* Default number of faces per block for DualGrid_color_faces()
+***********************************************************************/
+#define ICF_COLOR_BLOCK_SIZE 1024
+
+/***********************************************************************
+* Function template for face loops, that are executed for every 
+* color by DualGrid_color_loop()
+* -> i_start, i_end: The faces i_start ... i_end-1 of one block, which 
+*                    are processed by a single thread
+* -> i_thread:       Index of the executing thread (0 = calling thread)
+***********************************************************************/
+typedef void DualGridFaceTask(void *ctx, 
+                              int   i_start, 
+                              int   i_end, 
+                              int   i_thread);
+
+/***********************************************************************
+* Function to color the faces of a dualgrid in contiguous blocks of 
+* <block_size> faces, such that blocks of the same color do not share
+* an element. Thus, face loops, that scatter to both elements of a 
+* face, can run in parallel over the blocks of a color without 
+* atomics or locks, while every block keeps the memory locality of 
+* the face order. For block_size = 1, the faces are colored 
+* individually. 
+* The blocks are colored greedily in the order of their indices. 
+* If <balance> is set, blocks of overfull colors are moved to 
+* underfull colors afterwards, until all colors hold about the same 
+* number of faces. 
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_color_faces(DualGrid *dualgrid, 
+                         int       block_size, 
+                         int       balance);
+
+/***********************************************************************
+* Function to compute the imbalance of a face coloring, i.e. the 
+* number of faces of the largest color in relation to the mean 
+* number of faces per color. If <color_imbalance> is not NULL, it 
+* must hold n_colors entries, which are set to the number of faces 
+* of every color in relation to the mean.
+***********************************************************************/
+double DualGrid_color_imbalance(const DualGrid *dualgrid,
+                                double         *color_imbalance);
+
+/***********************************************************************
+* Function to execute a face loop color by color on a thread pool. 
+* The blocks of every color are split into contiguous chunks for all
+* threads. For pool = NULL, the loop is executed by the calling thread.
+***********************************************************************/
+void DualGrid_color_loop(const DualGrid   *dualgrid,
+                         ThreadPool       *pool,
+                         DualGridFaceTask *task,
+                         void             *ctx);
+
+/***********************************************************************
+* Function to extract the partition <i_part> of a dualgrid as a 
+* self-contained local primary grid and dualgrid, where <part> holds
+* the partition of every dualgrid element (primary grid vertex) in 
+* the range 0 ... n_parts-1. 
+* The local grid consists of all primary grid elements, which are 
+* adjacent to an owned vertex, such that the owned dual elements and 
+* their faces have the same metrics as in the global dualgrid. 
+* The other vertices of these elements form one layer of ghosts.
+* The local boundary lists only contain the boundary edges of the 
+* local grid, while the edges at the outer rim of the ghost layer 
+* are marked with ICF_HALO_MARKER.
+* Returns the local dualgrid or NULL on error
+***********************************************************************/
+DualGrid *DualGrid_extract_partition(const DualGrid *dualgrid,
+                                     BoundaryDef    *bdry_def,
+                                     const int      *part,
+                                     int             n_parts,
+                                     int             i_part);
+
+/***********************************************************************
+* Function to set up the boundary edges and the connectivity of a 
+* partition-local primary grid, whose vertices and elements are 
+* given. Of the <n_bdry_edges> boundary edges <bdry_edges> with 
+* their markers <bdry_markers>, only the edges of local elements
+* are kept. All other element edges with a single adjacent local 
+* element close the ghost layer and are marked with ICF_HALO_MARKER.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int DualGrid_build_local_topology(PrimaryGrid *loc_prim,
+                                  int          n_bdry_edges,
+                                  int        (*bdry_edges)[2],
+                                  const int   *bdry_markers);
+
+/***********************************************************************
+* Function to destroy a dualgrid halo structure
+***********************************************************************/
+void DualGridHalo_destroy(DualGridHalo *halo);
+
 #endif /* DUALGRID_H */
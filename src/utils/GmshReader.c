@@ -0,0 +1,696 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+#include "NumScan.h"
+#include "MeshReader.h"
+#include "PrimaryGrid.h"
+#include "GmshReader.h"
+
+/***********************************************************************
+* Position within the data of a Gmsh file
+***********************************************************************/
+typedef struct 
+{
+  const char *pos;
+  const char *end;
+  int         binary;
+  int         swap;      /* Binary data in foreign byte order    */
+  int         size_len;  /* Size of size_t values in binary data */
+} GmshStream;
+
+/***********************************************************************
+* Physical marker of a curve entity
+***********************************************************************/
+typedef struct 
+{
+  int tag;
+  int marker;
+} GmshCurve;
+
+/***********************************************************************
+* Returns the number of nodes of a supported element type or -1
+***********************************************************************/
+static int gmsh_n_elem_nodes(int type)
+{
+  switch ( type )
+  {
+    case ICF_GMSH_LINE:  return 2;
+    case ICF_GMSH_TRI:   return 3;
+    case ICF_GMSH_QUAD:  return 4;
+    case ICF_GMSH_POINT: return 1;
+    default:             return -1;
+  }
+
+} /* gmsh_n_elem_nodes() */
+
+/***********************************************************************
+* Moves the stream to the next non-blank character 
+***********************************************************************/
+static inline void gmsh_skip_space(GmshStream *s)
+{
+  while ( s->pos < s->end && ( *s->pos == ' ' || *s->pos == '\t' 
+                            || *s->pos == '\r' || *s->pos == '\n' ) )
+    ++s->pos;
+
+} /* gmsh_skip_space() */
+
+/***********************************************************************
+* Reads <n_bytes> of binary data and converts them to host byte order
+***********************************************************************/
+static inline int gmsh_read_bytes(GmshStream *s, void *val, 
+                                  size_t n_bytes)
+{
+  size_t i;
+
+  check( (size_t) (s->end - s->pos) >= n_bytes, 
+      "Unexpected end of Gmsh file.");
+
+  if ( s->swap )
+    for ( i = 0; i < n_bytes; i++ )
+      ((char *) val)[i] = s->pos[n_bytes-1-i];
+  else
+    memcpy(val, s->pos, n_bytes);
+
+  s->pos += n_bytes;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_bytes() */
+
+/***********************************************************************
+* Reads an int / size_t / double value of the Gmsh file. 
+* size_t values are stored as int and must not exceed INT_MAX.
+***********************************************************************/
+static inline int gmsh_read_int(GmshStream *s, int *val)
+{
+  int32_t i32;
+
+  if ( s->binary )
+  {
+    check( gmsh_read_bytes(s, &i32, sizeof(int32_t)), 
+        "Failed to read Gmsh file.");
+    *val = (int) i32;
+    return ICF_SUCCESS;
+  }
+
+  gmsh_skip_space(s);
+  check( NumScan_int(&s->pos, s->end, val), 
+      "Invalid integer in Gmsh file.");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_int() */
+
+static inline int gmsh_read_size(GmshStream *s, int *val)
+{
+  uint64_t u64;
+  uint32_t u32;
+
+  if ( !s->binary )
+  {
+    check( gmsh_read_int(s, val) && *val >= 0, 
+        "Invalid size in Gmsh file.");
+    return ICF_SUCCESS;
+  }
+
+  if ( s->size_len == 8 )
+  {
+    check( gmsh_read_bytes(s, &u64, 8), "Failed to read Gmsh file.");
+  }
+  else
+  {
+    check( gmsh_read_bytes(s, &u32, 4), "Failed to read Gmsh file.");
+    u64 = u32;
+  }
+
+  check( u64 <= INT_MAX, "Size %llu in Gmsh file is too large.", 
+      (unsigned long long) u64);
+
+  *val = (int) u64;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_size() */
+
+static inline int gmsh_read_double(GmshStream *s, double *val)
+{
+  if ( s->binary )
+    return gmsh_read_bytes(s, val, sizeof(double));
+
+  gmsh_skip_space(s);
+  check( NumScan_double(&s->pos, s->end, val), 
+      "Invalid floating point value in Gmsh file.");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_double() */
+
+/***********************************************************************
+* Skips <n> values of <n_bytes> bytes each in binary files or <n> 
+* ASCII values
+***********************************************************************/
+static int gmsh_skip_values(GmshStream *s, long n, size_t n_bytes)
+{
+  double dummy;
+  long   i;
+
+  if ( s->binary )
+  {
+    check( s->end - s->pos >= n * (long) n_bytes, 
+        "Unexpected end of Gmsh file.");
+    s->pos += n * (long) n_bytes;
+    return ICF_SUCCESS;
+  }
+
+  for ( i = 0; i < n; i++ )
+    check( gmsh_read_double(s, &dummy), "Failed to read Gmsh file.");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_skip_values() */
+
+/***********************************************************************
+* Returns ICF_TRUE, if the line at <pos> starts with <key>
+***********************************************************************/
+static inline int gmsh_is_key(const char *pos, const char *end, 
+                              const char *key)
+{
+  size_t len = strlen(key);
+
+  if ( (size_t) (end - pos) < len || strncmp(pos, key, len) != 0 )
+    return ICF_FALSE;
+
+  return pos + len == end || pos[len] == '\n' || pos[len] == '\r' 
+      || pos[len] == ' ';
+
+} /* gmsh_is_key() */
+
+/***********************************************************************
+* Checks the closing keyword of a section and moves the stream 
+* to the next line
+***********************************************************************/
+static int gmsh_end_section(GmshStream *s, const char *key)
+{
+  gmsh_skip_space(s);
+
+  check( gmsh_is_key(s->pos, s->end, key), 
+      "Missing %s in Gmsh file.", key);
+
+  s->pos = NumScan_skip_lines(s->pos, s->end, 1);
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_end_section() */
+
+/***********************************************************************
+* Reads the $MeshFormat section
+***********************************************************************/
+static int gmsh_read_format(GmshStream *s)
+{
+  double version;
+  int    file_type, one;
+
+  s->binary = 0;
+
+  check( gmsh_read_double(s, &version), "Invalid Gmsh format.");
+  check( gmsh_read_int(s, &file_type), "Invalid Gmsh format.");
+  check( gmsh_read_int(s, &s->size_len), "Invalid Gmsh format.");
+
+  check( version >= 4.1 - ICF_SMALL && version < 5.0,
+      "Gmsh format version %.1lf is not supported (4.1 required).", 
+      version);
+  check( s->size_len == 4 || s->size_len == 8,
+      "Unsupported data size %d in Gmsh file.", s->size_len);
+
+  s->pos = NumScan_skip_lines(s->pos, s->end, 1);
+
+  /*--------------------------------------------------------------------
+  | Binary files store an integer 1 to detect the byte order
+  --------------------------------------------------------------------*/
+  if ( file_type == 1 )
+  {
+    s->binary = 1;
+    s->swap   = 0;
+
+    check( gmsh_read_int(s, &one), "Invalid Gmsh format.");
+
+    if ( one != 1 )
+    {
+      s->swap = 1;
+      s->pos -= sizeof(int32_t);
+      check( gmsh_read_int(s, &one) && one == 1,
+          "Invalid byte order mark in Gmsh file.");
+    }
+  }
+
+  return gmsh_end_section(s, "$EndMeshFormat");
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_format() */
+
+/***********************************************************************
+* Reads the $Entities section and stores the markers of all curves
+***********************************************************************/
+static int gmsh_read_entities(GmshStream *s, 
+                              GmshCurve **curves, 
+                              int        *n_curves)
+{
+  int n_ents[4];
+  int dim, i, j, tag, n_phys, n_bound, phys, other;
+
+  for ( dim = 0; dim < 4; dim++ )
+    check( gmsh_read_size(s, &n_ents[dim]), "Invalid Gmsh entities.");
+
+  free( *curves );
+  *n_curves = n_ents[1];
+  *curves   = calloc(n_ents[1] + 1, sizeof(GmshCurve));
+  check_mem(*curves);
+
+  for ( dim = 0; dim < 4; dim++ )
+    for ( i = 0; i < n_ents[dim]; i++ )
+    {
+      /* Points store their coordinates, all other entities their  */
+      /* bounding box                                               */
+      check( gmsh_read_int(s, &tag) 
+          && gmsh_skip_values(s, ( dim == 0 ) ? 3 : 6, sizeof(double))
+          && gmsh_read_size(s, &n_phys),
+          "Invalid Gmsh entity.");
+
+      phys = tag;
+
+      for ( j = 0; j < n_phys; j++ )
+        check( gmsh_read_int(s, ( j == 0 ) ? &phys : &other), 
+            "Invalid Gmsh entity.");
+
+      if ( dim == 1 )
+      {
+        (*curves)[i].tag    = tag;
+        (*curves)[i].marker = phys;
+      }
+
+      if ( dim == 0 )
+        continue;
+
+      check( gmsh_read_size(s, &n_bound) 
+          && gmsh_skip_values(s, n_bound, sizeof(int32_t)),
+          "Invalid Gmsh entity.");
+    }
+
+  return gmsh_end_section(s, "$EndEntities");
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_entities() */
+
+/***********************************************************************
+* Reads the $Nodes section into the vertex coordinates of the primary
+* grid. <node_index> maps node tags, which are offset by <min_tag>, 
+* to vertex indices.
+***********************************************************************/
+static int gmsh_read_nodes(GmshStream  *s, 
+                           PrimaryGrid *prim_grid,
+                           int        **node_index,
+                           int         *min_tag,
+                           int         *max_tag)
+{
+  int n_blocks, n_nodes, i_block, i, dim, tag, parametric, n_block;
+  int i_node = 0;
+
+  check( gmsh_read_size(s, &n_blocks) && gmsh_read_size(s, &n_nodes)
+      && gmsh_read_size(s, min_tag) && gmsh_read_size(s, max_tag),
+      "Invalid Gmsh nodes.");
+  check( n_nodes > 0 && *min_tag <= *max_tag, "No nodes in Gmsh file.");
+
+  free( prim_grid->vertex_coords );
+  prim_grid->vertex_coords = calloc(n_nodes, 2*sizeof(double));
+  check_mem(prim_grid->vertex_coords);
+  prim_grid->n_vertices = n_nodes;
+
+  free( *node_index );
+  *node_index = malloc( ((size_t) (*max_tag - *min_tag) + 1) 
+                        * sizeof(int) );
+  check_mem(*node_index);
+
+  for ( i = 0; i <= *max_tag - *min_tag; i++ )
+    (*node_index)[i] = -1;
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+  {
+    check( gmsh_read_int(s, &dim) && gmsh_read_int(s, &tag)
+        && gmsh_read_int(s, &parametric) && gmsh_read_size(s, &n_block),
+        "Invalid Gmsh node block.");
+    check( i_node + n_block <= n_nodes, "Too many nodes in Gmsh file.");
+
+    for ( i = 0; i < n_block; i++ )
+    {
+      check( gmsh_read_size(s, &tag), "Invalid Gmsh node tag.");
+      check( tag >= *min_tag && tag <= *max_tag 
+          && (*node_index)[tag - *min_tag] < 0,
+          "Invalid or duplicate Gmsh node tag %d.", tag);
+
+      (*node_index)[tag - *min_tag] = i_node + i;
+    }
+
+    /* Coordinates (x,y,z) are followed by the parametric ones      */
+    for ( i = 0; i < n_block; i++ )
+    {
+      double *xy = prim_grid->vertex_coords[i_node + i];
+
+      check( gmsh_read_double(s, &xy[0]) && gmsh_read_double(s, &xy[1])
+          && gmsh_skip_values(s, 1 + ( parametric ? dim : 0 ), 
+                              sizeof(double)),
+          "Invalid Gmsh node coordinates.");
+    }
+
+    i_node += n_block;
+  }
+
+  check( i_node == n_nodes, "Missing nodes in Gmsh file.");
+
+  return gmsh_end_section(s, "$EndNodes");
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_nodes() */
+
+/***********************************************************************
+* Reads the $Elements section. In the first pass (<fill> == 0), 
+* the elements are only counted and the primary grid arrays are 
+* allocated. The second pass fills the arrays.
+***********************************************************************/
+static int gmsh_read_elements(GmshStream      *s, 
+                              PrimaryGrid     *prim_grid,
+                              int              fill,
+                              const int       *node_index,
+                              int              min_tag,
+                              int              max_tag,
+                              const GmshCurve *curves,
+                              int              n_curves)
+{
+  int n_blocks, n_elems, i_block, i, k, dim, ent_tag, type, n_block;
+  int nodes[4], tag;
+  int i_tri = 0, i_quad = 0, i_line = 0;
+  int marker = 0;
+
+  check( gmsh_read_size(s, &n_blocks) && gmsh_read_size(s, &n_elems)
+      && gmsh_read_size(s, &tag) && gmsh_read_size(s, &tag),
+      "Invalid Gmsh elements.");
+
+  for ( i_block = 0; i_block < n_blocks; i_block++ )
+  {
+    check( gmsh_read_int(s, &dim) && gmsh_read_int(s, &ent_tag)
+        && gmsh_read_int(s, &type) && gmsh_read_size(s, &n_block),
+        "Invalid Gmsh element block.");
+
+    const int n_nodes = gmsh_n_elem_nodes(type);
+
+    check( n_nodes > 0, 
+        "Unsupported Gmsh element type %d (linear lines, triangles "
+        "and quads are supported).", type);
+
+    /*------------------------------------------------------------------
+    | Count elements and skip their data in the first pass
+    ------------------------------------------------------------------*/
+    if ( !fill || type == ICF_GMSH_POINT )
+    {
+      if ( type == ICF_GMSH_LINE ) i_line += n_block;
+      if ( type == ICF_GMSH_TRI  ) i_tri  += n_block;
+      if ( type == ICF_GMSH_QUAD ) i_quad += n_block;
+
+      if ( s->binary )
+      {
+        check( gmsh_skip_values(s, (long) n_block * (n_nodes + 1), 
+                                s->size_len),
+            "Invalid Gmsh element block.");
+      }
+      else
+        s->pos = NumScan_skip_lines(s->pos, s->end, n_block + 1);
+
+      continue;
+    }
+
+    if ( type == ICF_GMSH_LINE )
+    {
+      for ( k = 0; k < n_curves && curves[k].tag != ent_tag; k++ );
+      marker = ( k < n_curves ) ? curves[k].marker : ent_tag;
+    }
+
+    /*------------------------------------------------------------------
+    | Fill the element arrays in the second pass
+    ------------------------------------------------------------------*/
+    for ( i = 0; i < n_block; i++ )
+    {
+      check( gmsh_read_size(s, &tag), "Invalid Gmsh element.");
+
+      for ( k = 0; k < n_nodes; k++ )
+      {
+        check( gmsh_read_size(s, &tag), "Invalid Gmsh element.");
+        check( tag >= min_tag && tag <= max_tag 
+            && node_index[tag - min_tag] >= 0,
+            "Undefined node %d in Gmsh element.", tag);
+        nodes[k] = node_index[tag - min_tag];
+      }
+
+      switch ( type )
+      {
+        case ICF_GMSH_LINE:
+          prim_grid->bdry_edges[i_line][0]    = nodes[0];
+          prim_grid->bdry_edges[i_line][1]    = nodes[1];
+          prim_grid->bdry_edge_marker[i_line] = marker;
+          ++i_line;
+          break;
+
+        case ICF_GMSH_TRI:
+          memcpy(prim_grid->tris[i_tri++], nodes, 3*sizeof(int));
+          break;
+
+        case ICF_GMSH_QUAD:
+          memcpy(prim_grid->quads[i_quad++], nodes, 4*sizeof(int));
+          break;
+      }
+    }
+  }
+
+  check( gmsh_end_section(s, "$EndElements"), 
+      "Invalid Gmsh elements.");
+
+  if ( fill )
+    return ICF_SUCCESS;
+
+  /*--------------------------------------------------------------------
+  | Allocate the primary grid arrays after the first pass
+  --------------------------------------------------------------------*/
+  check( i_tri + i_quad > 0, "No triangles or quads in Gmsh file.");
+  check( i_line > 0, "No boundary lines in Gmsh file.");
+
+  free( prim_grid->tris );
+  free( prim_grid->quads );
+  free( prim_grid->bdry_edges );
+  free( prim_grid->bdry_edge_nbrs );
+  free( prim_grid->bdry_edge_marker );
+
+  prim_grid->tris             = calloc(MAX(i_tri, 1), 3*sizeof(int));
+  prim_grid->quads            = calloc(MAX(i_quad, 1), 4*sizeof(int));
+  prim_grid->bdry_edges       = calloc(i_line, 2*sizeof(int));
+  prim_grid->bdry_edge_nbrs   = calloc(i_line, sizeof(int));
+  prim_grid->bdry_edge_marker = calloc(i_line, sizeof(int));
+  check_mem(prim_grid->tris);
+  check_mem(prim_grid->quads);
+  check_mem(prim_grid->bdry_edges);
+  check_mem(prim_grid->bdry_edge_nbrs);
+  check_mem(prim_grid->bdry_edge_marker);
+
+  prim_grid->n_tris       = i_tri;
+  prim_grid->n_quads      = i_quad;
+  prim_grid->n_bdry_edges = i_line;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* gmsh_read_elements() */
+
+/***********************************************************************
+* Reorients all clockwise elements of the primary grid
+***********************************************************************/
+static void gmsh_orient_elements(PrimaryGrid *prim_grid)
+{
+  double (*xy)[2] = prim_grid->vertex_coords;
+  int i, k, tmp;
+
+  for ( i = 0; i < prim_grid->n_tris; i++ )
+  {
+    int *t = prim_grid->tris[i];
+    double area = ( xy[t[1]][0] - xy[t[0]][0] ) 
+                * ( xy[t[2]][1] - xy[t[0]][1] )
+                - ( xy[t[2]][0] - xy[t[0]][0] ) 
+                * ( xy[t[1]][1] - xy[t[0]][1] );
+
+    if ( area < 0.0 )
+    {
+      tmp = t[1]; t[1] = t[2]; t[2] = tmp;
+    }
+  }
+
+  for ( i = 0; i < prim_grid->n_quads; i++ )
+  {
+    int *q = prim_grid->quads[i];
+    double area = 0.0;
+
+    for ( k = 0; k < 4; k++ )
+      area += xy[q[k]][0] * xy[q[(k+1)%4]][1] 
+            - xy[q[(k+1)%4]][0] * xy[q[k]][1];
+
+    if ( area < 0.0 )
+    {
+      tmp = q[1]; q[1] = q[3]; q[3] = tmp;
+    }
+  }
+
+} /* gmsh_orient_elements() */
+
+/***********************************************************************
+* Function to read a primary grid structure from a Gmsh file. 
+* The connectivity is built with <n_threads> threads.
+* For n_threads < 1, the number of online processors is used.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GmshReader_read_primgrid(const char  *file_path,
+                             PrimaryGrid *prim_grid,
+                             int          n_threads)
+{
+  MeshReader *mesh_reader = NULL;
+  GmshCurve  *curves      = NULL;
+  int        *node_index  = NULL;
+  int n_curves = 0, min_tag = 0, max_tag = -1;
+  int has_format = 0, has_nodes = 0;
+
+  GmshStream s;
+  memset(&s, 0, sizeof(GmshStream));
+
+  mesh_reader = MeshReader_create_mmap( file_path );
+  check( mesh_reader, "Failed to open Gmsh file %s.", file_path);
+
+  s.pos = mesh_reader->buffer;
+  s.end = mesh_reader->buffer + mesh_reader->length - 1;
+
+  /*--------------------------------------------------------------------
+  | Walk through all sections
+  --------------------------------------------------------------------*/
+  for ( gmsh_skip_space(&s); s.pos < s.end; gmsh_skip_space(&s) )
+  {
+    const char *key = s.pos;
+
+    check( *key == '$', "Invalid section in Gmsh file %s.", file_path);
+
+    s.pos = NumScan_skip_lines(s.pos, s.end, 1);
+
+    if ( gmsh_is_key(key, s.end, "$MeshFormat") )
+    {
+      check( gmsh_read_format(&s), 
+          "Failed to read Gmsh file %s.", file_path);
+      has_format = 1;
+      continue;
+    }
+
+    check( has_format, "Missing $MeshFormat in Gmsh file %s.", file_path);
+
+    if ( gmsh_is_key(key, s.end, "$Entities") )
+    {
+      check( gmsh_read_entities(&s, &curves, &n_curves),
+          "Failed to read Gmsh file %s.", file_path);
+    }
+    else if ( gmsh_is_key(key, s.end, "$Nodes") )
+    {
+      check( gmsh_read_nodes(&s, prim_grid, &node_index, 
+                             &min_tag, &max_tag),
+          "Failed to read Gmsh file %s.", file_path);
+      has_nodes = 1;
+    }
+    else if ( gmsh_is_key(key, s.end, "$Elements") )
+    {
+      check( has_nodes, "$Elements in front of $Nodes in Gmsh file %s.",
+          file_path);
+
+      const char *elements = s.pos;
+
+      check( gmsh_read_elements(&s, prim_grid, 0, node_index, 
+                                min_tag, max_tag, curves, n_curves),
+          "Failed to read Gmsh file %s.", file_path);
+
+      s.pos = elements;
+
+      check( gmsh_read_elements(&s, prim_grid, 1, node_index, 
+                                min_tag, max_tag, curves, n_curves),
+          "Failed to read Gmsh file %s.", file_path);
+    }
+    else
+    {
+      /* Skip all other sections up to their closing keyword       */
+      while ( s.pos < s.end && !( *s.pos == '$' 
+              && strncmp(s.pos, "$End", 4) == 0 
+              && strncmp(s.pos + 4, key + 1, 
+                         strcspn(key + 1, " \r\n")) == 0 ) )
+        s.pos = NumScan_skip_lines(s.pos, s.end, 1);
+
+      s.pos = NumScan_skip_lines(s.pos, s.end, 1);
+    }
+  }
+
+  check( prim_grid->n_tris + prim_grid->n_quads > 0,
+      "No elements defined in Gmsh file %s.", file_path);
+
+  gmsh_orient_elements(prim_grid);
+
+  check( PrimaryGrid_build_topology(prim_grid, n_threads),
+      "Failed to build connectivity for Gmsh file %s.", file_path);
+
+  MeshReader_destroy( mesh_reader );
+  free( curves );
+  free( node_index );
+
+  return ICF_SUCCESS;
+
+error:
+  if ( mesh_reader )
+    MeshReader_destroy( mesh_reader );
+  free( curves );
+  free( node_index );
+  return ICF_ERROR;
+
+} /* GmshReader_read_primgrid() */
@@ -0,0 +1,41 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef GMSHREADER_H
+#define GMSHREADER_H
+
+#include "PrimaryGrid.h"
+
+/***********************************************************************
+* Reader for the Gmsh mesh file format 4.1 (ASCII and binary).
+*
+* Only the sections $MeshFormat, $Entities, $Nodes and $Elements are 
+* evaluated, all other sections are skipped. Supported elements are 
+* 2-node lines, 3-node triangles, 4-node quads and 1-node points, 
+* which are ignored. 
+* Lines define the boundary edges. Their marker is the first physical
+* tag of their curve or the curve tag itself, if the curve does not 
+* belong to a physical group.
+* Triangles and quads are oriented counter-clockwise and the grid 
+* connectivity is built with PrimaryGrid_build_topology().
+***********************************************************************/
+#define ICF_GMSH_LINE  1
+#define ICF_GMSH_TRI   2
+#define ICF_GMSH_QUAD  3
+#define ICF_GMSH_POINT 15
+
+/***********************************************************************
+* Function to read a primary grid structure from a Gmsh file. 
+* The connectivity is built with <n_threads> threads.
+* For n_threads < 1, the number of online processors is used.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GmshReader_read_primgrid(const char  *file_path,
+                             PrimaryGrid *prim_grid,
+                             int          n_threads);
+
+#endif /* GMSHREADER_H */
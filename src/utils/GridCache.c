@@ -0,0 +1,590 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "Boundary.h"
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "MeshReader.h"
+#include "GridCache.h"
+
+/* Primes of the 64-bit hash function */
+#define HASH_P1 0x9E3779B185EBCA87ULL
+#define HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define HASH_P3 0x165667B19E3779F9ULL
+#define HASH_P4 0x85EBCA77C2B2AE63ULL
+#define HASH_P5 0x27D4EB2F165667C5ULL
+
+/***********************************************************************
+* Helper functions of the hash function 
+***********************************************************************/
+static inline uint64_t hash_rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_read64(const unsigned char *p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(uint64_t));
+  return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t val)
+{
+  acc += val * HASH_P2;
+  acc  = hash_rotl(acc, 31);
+  return acc * HASH_P1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t val)
+{
+  acc ^= hash_round(0, val);
+  return acc * HASH_P1 + HASH_P4;
+}
+
+/***********************************************************************
+* Function to compute a fast 64-bit hash of a chunk of memory
+* -> This follows the structure of the XXH64 hash, i.e. the data 
+*    is processed in four independent lanes of 8 bytes each
+***********************************************************************/
+uint64_t GridCache_hash(const void *data, size_t n_bytes, uint64_t seed)
+{
+  const unsigned char *p   = (const unsigned char *) data;
+  const unsigned char *end = p + n_bytes;
+  uint64_t h;
+
+  if ( n_bytes >= 32 )
+  {
+    const unsigned char *limit = end - 32;
+
+    uint64_t v1 = seed + HASH_P1 + HASH_P2;
+    uint64_t v2 = seed + HASH_P2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - HASH_P1;
+
+    do
+    {
+      v1 = hash_round(v1, hash_read64(p));
+      v2 = hash_round(v2, hash_read64(p+8));
+      v3 = hash_round(v3, hash_read64(p+16));
+      v4 = hash_round(v4, hash_read64(p+24));
+      p += 32;
+    } while ( p <= limit );
+
+    h = hash_rotl(v1, 1) + hash_rotl(v2, 7) 
+      + hash_rotl(v3,12) + hash_rotl(v4,18);
+
+    h = hash_merge(h, v1);
+    h = hash_merge(h, v2);
+    h = hash_merge(h, v3);
+    h = hash_merge(h, v4);
+  }
+  else
+  {
+    h = seed + HASH_P5;
+  }
+
+  h += (uint64_t) n_bytes;
+
+  /*--------------------------------------------------------------------
+  | Remaining bytes
+  --------------------------------------------------------------------*/
+  while ( p + 8 <= end )
+  {
+    h ^= hash_round(0, hash_read64(p));
+    h  = hash_rotl(h, 27) * HASH_P1 + HASH_P4;
+    p += 8;
+  }
+
+  while ( p < end )
+  {
+    h ^= (*p) * HASH_P5;
+    h  = hash_rotl(h, 11) * HASH_P1;
+    p++;
+  }
+
+  /*--------------------------------------------------------------------
+  | Final avalanche
+  --------------------------------------------------------------------*/
+  h ^= h >> 33;
+  h *= HASH_P2;
+  h ^= h >> 29;
+  h *= HASH_P3;
+  h ^= h >> 32;
+
+  return h;
+
+} /* GridCache_hash() */
+
+/***********************************************************************
+* Function to compute the cache key of a mesh file in combination
+* with a boundary definition
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_key(const char        *mesh_path,
+                  const BoundaryDef *bdry_def,
+                  uint64_t          *key)
+{
+  struct stat st;
+  void *map = MAP_FAILED;
+  int   fd  = -1;
+
+  fd = open(mesh_path, O_RDONLY);
+  check(fd >= 0, "Failed to open %s.", mesh_path);
+  check(fstat(fd, &st) == 0, "Failed to read size of %s.", mesh_path);
+
+  /*--------------------------------------------------------------------
+  | Hash the mesh file bytes 
+  --------------------------------------------------------------------*/
+  uint64_t h = ICF_CACHE_VERSION;
+
+  if ( st.st_size > 0 )
+  {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    check(map != MAP_FAILED, "Failed to map %s.", mesh_path);
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    h = GridCache_hash(map, st.st_size, h);
+
+    munmap(map, st.st_size);
+  }
+
+  close(fd);
+
+  /*--------------------------------------------------------------------
+  | Add the boundary definition 
+  --------------------------------------------------------------------*/
+  int n_markers = bdry_def ? bdry_def->n_bdry_markers : 0;
+
+  h = GridCache_hash(&n_markers, sizeof(int), h);
+
+  if ( n_markers > 0 )
+  {
+    h = GridCache_hash(bdry_def->bdry_markers, 
+                       n_markers * sizeof(int), h);
+    h = GridCache_hash(bdry_def->bdry_types, 
+                       n_markers * sizeof(BoundaryType), h);
+  }
+
+  *key = h;
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fd >= 0 )
+    close(fd);
+  return ICF_ERROR;
+
+} /* GridCache_key() */
+
+/***********************************************************************
+* Function to write the metrics and boundaries of a dualgrid 
+* to a cache file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_write_dualgrid(const DualGrid *dualgrid,
+                             uint64_t        key,
+                             const char     *file_path)
+{
+  GridCacheHeader header;
+  const Boundary *bdry;
+  FILE    *fptr = NULL;
+  uint64_t off;
+  int i;
+
+  const size_t n_elems = dualgrid->n_elements;
+  const size_t n_faces = dualgrid->n_intr_faces;
+
+  /*--------------------------------------------------------------------
+  | Set up header 
+  --------------------------------------------------------------------*/
+  memset(&header, 0, sizeof(GridCacheHeader));
+  memcpy(header.magic, ICF_CACHE_MAGIC, sizeof(ICF_CACHE_MAGIC));
+
+  header.version      = ICF_CACHE_VERSION;
+  header.byte_order   = ICF_CACHE_BYTEORDER;
+  header.key          = key;
+  header.n_elements   = n_elems;
+  header.n_intr_faces = n_faces;
+  header.n_boundaries = 0;
+
+  header.sizes[ICF_CACHE_VOL]        = n_elems * sizeof(double);
+  header.sizes[ICF_CACHE_FACE_NBRS]  = n_faces * 2 * sizeof(int);
+  header.sizes[ICF_CACHE_FACE_NORMS] = n_faces * 2 * sizeof(double);
+
+  for ( bdry = dualgrid->boundaries->start; bdry; bdry = bdry->next )
+  {
+    header.sizes[ICF_CACHE_BOUNDARIES] += 
+      ( 3 + bdry->n_bdry_points + 2 * bdry->n_bdry_edges ) * sizeof(int);
+    header.n_boundaries += 1;
+  }
+
+  off = sizeof(GridCacheHeader);
+
+  for ( i = 0; i < ICF_CACHE_N_SECTIONS; i++ )
+  {
+    off = ( off + ICF_CACHE_ALIGNMENT - 1 ) 
+        / ICF_CACHE_ALIGNMENT * ICF_CACHE_ALIGNMENT;
+    header.offsets[i] = off;
+    off += header.sizes[i];
+  }
+
+  fptr = fopen(file_path, "wb");
+  check(fptr, "Failed to open %s.", file_path);
+
+  check( fwrite(&header, sizeof(GridCacheHeader), 1, fptr) == 1,
+      "Failed to write header to %s.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Write the dualgrid metrics 
+  --------------------------------------------------------------------*/
+  const void *data[3] = { 
+    dualgrid->vol, dualgrid->face_nbrs, dualgrid->face_norms 
+  };
+
+  for ( i = 0; i < 3; i++ )
+  {
+    if ( header.sizes[i] < 1 )
+      continue;
+
+    check( fseek(fptr, (long) header.offsets[i], SEEK_SET) == 0,
+        "Failed to write to %s.", file_path);
+    check( fwrite(data[i], 1, header.sizes[i], fptr) == header.sizes[i], 
+        "Failed to write to %s.", file_path);
+  }
+
+  /*--------------------------------------------------------------------
+  | Write the boundaries 
+  --------------------------------------------------------------------*/
+  check( fseek(fptr, (long) header.offsets[ICF_CACHE_BOUNDARIES], 
+               SEEK_SET) == 0,
+      "Failed to write to %s.", file_path);
+
+  for ( bdry = dualgrid->boundaries->start; bdry; bdry = bdry->next )
+  {
+    int sizes[3] = { bdry->type, bdry->n_bdry_points, bdry->n_bdry_edges };
+    size_t n_pnts  = bdry->n_bdry_points;
+    size_t n_edges = bdry->n_bdry_edges;
+
+    check( fwrite(sizes, sizeof(int), 3, fptr) == 3, 
+        "Failed to write to %s.", file_path);
+    check( fwrite(bdry->bdry_points, sizeof(int), n_pnts, fptr) == n_pnts, 
+        "Failed to write to %s.", file_path);
+    check( fwrite(bdry->bdry_edges, 2*sizeof(int), n_edges, fptr) 
+           == n_edges, 
+        "Failed to write to %s.", file_path);
+  }
+
+  check( fclose(fptr) == 0, "Failed to write to %s.", file_path);
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fptr )
+    fclose(fptr);
+  return ICF_ERROR;
+
+} /* GridCache_write_dualgrid() */
+
+/***********************************************************************
+* Function to load a dualgrid from a cache file, which belongs to 
+* the primary grid <primgrid>. The metrics are mapped into memory.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_read_dualgrid(DualGrid    *dualgrid,
+                            PrimaryGrid *primgrid,
+                            uint64_t     key,
+                            const char  *file_path)
+{
+  GridCacheHeader header;
+  struct stat st;
+  char *map = MAP_FAILED;
+  int   fd  = -1;
+  int   i, i_bdry;
+
+  Boundary *first_bdry = NULL;
+  Boundary *prev_bdry  = NULL;
+  Boundary *bdry       = NULL;
+
+  check( dualgrid->cache_map == NULL && dualgrid->vol == NULL
+      && dualgrid->boundaries->start == NULL,
+      "Dualgrid has already been set up.");
+
+  fd = open(file_path, O_RDONLY);
+  check(fd >= 0, "Failed to open %s.", file_path);
+  check(fstat(fd, &st) == 0, "Failed to read size of %s.", file_path);
+  check(st.st_size >= (off_t) sizeof(GridCacheHeader), 
+      "%s is not a grid cache file.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Map the file copy-on-write, such that the metrics can still be 
+  | modified in memory
+  --------------------------------------------------------------------*/
+  map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, 
+             MAP_PRIVATE, fd, 0);
+  check(map != MAP_FAILED, "Failed to map %s.", file_path);
+
+  close(fd);
+  fd = -1;
+
+  /*--------------------------------------------------------------------
+  | Check header 
+  --------------------------------------------------------------------*/
+  memcpy(&header, map, sizeof(GridCacheHeader));
+
+  check( memcmp(header.magic, ICF_CACHE_MAGIC, 
+                sizeof(ICF_CACHE_MAGIC)) == 0,
+      "%s is not a grid cache file.", file_path);
+  check( header.version == ICF_CACHE_VERSION
+      && header.byte_order == ICF_CACHE_BYTEORDER,
+      "Grid cache file %s is outdated.", file_path);
+  check( header.key == key,
+      "Grid cache file %s does not belong to this mesh.", file_path);
+  check( header.n_elements == primgrid->n_vertices
+      && header.n_intr_faces == primgrid->n_intr_edges 
+                              + primgrid->n_bdry_edges,
+      "Grid cache file %s does not belong to this mesh.", file_path);
+
+  const size_t n_elems = header.n_elements;
+  const size_t n_faces = header.n_intr_faces;
+
+  check( header.sizes[ICF_CACHE_VOL]        == n_elems*sizeof(double)
+      && header.sizes[ICF_CACHE_FACE_NBRS]  == n_faces*2*sizeof(int)
+      && header.sizes[ICF_CACHE_FACE_NORMS] == n_faces*2*sizeof(double),
+      "Grid cache file %s is corrupted.", file_path);
+
+  for ( i = 0; i < ICF_CACHE_N_SECTIONS; i++ )
+    check( header.offsets[i] % ICF_CACHE_ALIGNMENT == 0
+        && header.offsets[i] <= (uint64_t) st.st_size
+        && header.sizes[i]   <= (uint64_t) st.st_size - header.offsets[i],
+        "Grid cache file %s is corrupted.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Rebuild the boundary list 
+  --------------------------------------------------------------------*/
+  const int *bdry_data = (const int *)(map + 
+                           header.offsets[ICF_CACHE_BOUNDARIES]);
+  const int *bdry_end  = bdry_data 
+                       + header.sizes[ICF_CACHE_BOUNDARIES] / sizeof(int);
+
+  for ( i_bdry = 0; i_bdry < header.n_boundaries; i_bdry++ )
+  {
+    check( bdry_data + 3 <= bdry_end, 
+        "Grid cache file %s is corrupted.", file_path);
+
+    const int n_pnts  = bdry_data[1];
+    const int n_edges = bdry_data[2];
+
+    check( n_pnts >= 0 && n_edges >= 0 
+        && (size_t) n_pnts + 2 * (size_t) n_edges 
+           <= (size_t)(bdry_end - bdry_data - 3),
+        "Grid cache file %s is corrupted.", file_path);
+
+    bdry = Boundary_create();
+    check_mem(bdry);
+
+    bdry->boundaries    = dualgrid->boundaries;
+    bdry->type          = bdry_data[0];
+    bdry->n_bdry_points = n_pnts;
+    bdry->n_bdry_edges  = n_edges;
+    bdry->prev          = prev_bdry;
+
+    if ( prev_bdry )
+      prev_bdry->next = bdry;
+    else
+      first_bdry = bdry;
+
+    bdry->bdry_points = calloc( n_pnts, sizeof(int) );
+    bdry->bdry_edges  = calloc( n_edges, 2*sizeof(int) );
+    bdry->bdry_norm   = calloc( n_pnts, 2*sizeof(double) );
+    bdry->bdry_mflux  = calloc( n_pnts, sizeof(double) );
+
+    memcpy(bdry->bdry_points, bdry_data + 3, n_pnts * sizeof(int));
+    memcpy(bdry->bdry_edges, bdry_data + 3 + n_pnts, 
+           n_edges * 2 * sizeof(int));
+
+    bdry_data += 3 + n_pnts + 2 * n_edges;
+    prev_bdry  = bdry;
+  }
+
+  dualgrid->boundaries->start        = first_bdry;
+  dualgrid->boundaries->end          = bdry;
+  dualgrid->boundaries->n_boundaries = header.n_boundaries;
+
+  /*--------------------------------------------------------------------
+  | Point the dualgrid metrics into the mapping
+  --------------------------------------------------------------------*/
+  dualgrid->primgrid     = primgrid;
+  dualgrid->n_elements   = n_elems;
+  dualgrid->n_intr_faces = n_faces;
+  dualgrid->xy           = primgrid->vertex_coords;
+
+  dualgrid->vol        = (double *) (map + header.offsets[ICF_CACHE_VOL]);
+  dualgrid->face_nbrs  = (int (*)[2]) 
+                         (map + header.offsets[ICF_CACHE_FACE_NBRS]);
+  dualgrid->face_norms = (double (*)[2]) 
+                         (map + header.offsets[ICF_CACHE_FACE_NORMS]);
+
+  dualgrid->cache_map = map;
+  dualgrid->cache_len = st.st_size;
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fd >= 0 )
+    close(fd);
+  if ( map != MAP_FAILED )
+    munmap(map, st.st_size);
+
+  /* Remove all boundaries, that have been created so far */
+  while ( first_bdry )
+  {
+    Boundary *next = first_bdry->next;
+    Boundary_destroy( first_bdry );
+    first_bdry = next;
+  }
+
+  return ICF_ERROR;
+
+} /* GridCache_read_dualgrid() */
+
+/***********************************************************************
+* Function to write a cache file under a temporary name, which is 
+* renamed afterwards. Thus, concurrent runs never observe partially
+* written cache files.
+***********************************************************************/
+static int cache_write_file(const DualGrid *dualgrid,
+                            PrimaryGrid    *primgrid,
+                            uint64_t        key,
+                            const char     *file_path,
+                            int             is_dual)
+{
+  char tmp_path[4096];
+  int  status;
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", 
+           file_path, (long) getpid());
+
+  if ( is_dual )
+    status = GridCache_write_dualgrid(dualgrid, key, tmp_path);
+  else
+    status = PrimaryGrid_write_binary(primgrid, tmp_path);
+
+  check( status, "Failed to write cache file %s.", file_path );
+  check( rename(tmp_path, file_path) == 0, 
+      "Failed to write cache file %s.", file_path );
+
+  return ICF_SUCCESS;
+
+error:
+  remove(tmp_path);
+  return ICF_ERROR;
+
+} /* cache_write_file() */
+
+/***********************************************************************
+* Function to set up a primary grid and its dualgrid from a mesh file.
+* If <cache_dir> is not NULL, both are loaded from the cache if 
+* possible. Otherwise the mesh is read, the dualgrid is built and 
+* both are stored in the cache for later runs. The adjacency of 
+* cached dualgrids is rebuilt, since it is not stored in the cache.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_load(DualGrid    *dualgrid,
+                   PrimaryGrid *primgrid,
+                   BoundaryDef *bdry_def,
+                   const char  *mesh_path,
+                   const char  *cache_dir)
+{
+  MeshReader *mesh_reader = NULL;
+  uint64_t    key         = 0;
+  char grid_path[4096];
+  char dual_path[4096];
+
+  /*--------------------------------------------------------------------
+  | Try to load the grids from the cache. Missing files are a regular
+  | cache miss, such that they are not reported.
+  --------------------------------------------------------------------*/
+  if ( cache_dir )
+  {
+    check( GridCache_key(mesh_path, bdry_def, &key), 
+        "Failed to compute cache key for %s.", mesh_path );
+
+    snprintf(grid_path, sizeof(grid_path), "%s/%016llx.grid", 
+             cache_dir, (unsigned long long) key);
+    snprintf(dual_path, sizeof(dual_path), "%s/%016llx.dual", 
+             cache_dir, (unsigned long long) key);
+
+    if ( access(grid_path, R_OK) == 0 && access(dual_path, R_OK) == 0 )
+    {
+      if ( PrimaryGrid_read_binary(primgrid, grid_path) 
+        && GridCache_read_dualgrid(dualgrid, primgrid, key, dual_path) )
+      {
+        check( DualGrid_build_adjacency(dualgrid)
+            && DualGrid_build_edge_faces(dualgrid),
+            "Failed to set up the cached dualgrid %s.", dual_path );
+        return ICF_SUCCESS;
+      }
+
+      /* The stream reader replaces all arrays of the primary grid */
+      log_warn("Invalid grid cache entry %s is rebuilt.", dual_path);
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Read mesh and build dualgrid 
+  --------------------------------------------------------------------*/
+  mesh_reader = MeshReader_create_mmap(mesh_path);
+  check(mesh_reader, "Failed to read mesh file %s.", mesh_path);
+
+  check( MeshReader_stream_primgrid(mesh_reader, primgrid),
+      "Failed to read mesh file %s.", mesh_path );
+
+  MeshReader_destroy(mesh_reader);
+  mesh_reader = NULL;
+
+  check( DualGrid_build(dualgrid, bdry_def, primgrid),
+      "Failed to build the dualgrid of %s.", mesh_path );
+
+  /*--------------------------------------------------------------------
+  | Store grids in cache -> failures only cost a rebuild next time
+  --------------------------------------------------------------------*/
+  if ( cache_dir )
+  {
+    if ( mkdir(cache_dir, 0755) != 0 && access(cache_dir, W_OK) != 0 )
+    {
+      log_warn("Grid cache directory %s is not writable.", cache_dir);
+      return ICF_SUCCESS;
+    }
+
+    if ( !cache_write_file(dualgrid, primgrid, key, grid_path, 0)
+      || !cache_write_file(dualgrid, primgrid, key, dual_path, 1) )
+      log_warn("Failed to store grid cache entry for %s.", mesh_path);
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  if ( mesh_reader )
+    MeshReader_destroy(mesh_reader);
+  return ICF_ERROR;
+
+} /* GridCache_load() */
@@ -0,0 +1,121 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef GRIDCACHE_H
+#define GRIDCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "Boundary.h"
+
+/***********************************************************************
+* On-disk cache of built dualgrids.
+*
+* A cache entry consists of two files in the cache directory, which
+* are named after a 64-bit hash of the mesh file bytes and the
+* boundary definition:
+*
+*   <key>.grid : The primary grid in the binary grid format
+*   <key>.dual : The dualgrid metrics and boundaries
+*
+* The dualgrid metrics (vol, face_nbrs, face_norms) of a cached
+* dualgrid are mapped into memory (copy-on-write) instead of being
+* read, such that repeated cases skip both the mesh parsing and the
+* dualgrid build.
+* Cache files are native-endian and are simply rebuilt, if they
+* do not match the current machine or cache version.
+***********************************************************************/
+#define ICF_CACHE_MAGIC     "ICFDUAL"
+#define ICF_CACHE_VERSION   1
+#define ICF_CACHE_BYTEORDER 0x01020304u
+#define ICF_CACHE_ALIGNMENT 64
+
+/***********************************************************************
+* Sections of a cached dualgrid file
+***********************************************************************/
+typedef enum
+{
+  ICF_CACHE_VOL,
+  ICF_CACHE_FACE_NBRS,
+  ICF_CACHE_FACE_NORMS,
+  ICF_CACHE_BOUNDARIES,
+  ICF_CACHE_N_SECTIONS,
+} GridCacheSection;
+
+/***********************************************************************
+* Header of a cached dualgrid file
+* The boundary section holds for every boundary the values
+* (type, n_bdry_points, n_bdry_edges) followed by its points and edges
+***********************************************************************/
+typedef struct GridCacheHeader
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t key;
+
+  int64_t  n_elements;
+  int64_t  n_intr_faces;
+  int64_t  n_boundaries;
+
+  uint64_t offsets[ICF_CACHE_N_SECTIONS];
+  uint64_t sizes[ICF_CACHE_N_SECTIONS];
+
+} GridCacheHeader;
+
+/***********************************************************************
+* Function to compute a fast 64-bit hash of a chunk of memory
+***********************************************************************/
+uint64_t GridCache_hash(const void *data, size_t n_bytes, uint64_t seed);
+
+/***********************************************************************
+* Function to compute the cache key of a mesh file in combination
+* with a boundary definition
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_key(const char        *mesh_path,
+                  const BoundaryDef *bdry_def,
+                  uint64_t          *key);
+
+/***********************************************************************
+* Function to write the metrics and boundaries of a dualgrid
+* to a cache file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_write_dualgrid(const DualGrid *dualgrid,
+                             uint64_t        key,
+                             const char     *file_path);
+
+/***********************************************************************
+* Function to load a dualgrid from a cache file, which belongs to
+* the primary grid <primgrid>. The metrics are mapped into memory.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_read_dualgrid(DualGrid    *dualgrid,
+                            PrimaryGrid *primgrid,
+                            uint64_t     key,
+                            const char  *file_path);
+
+/***********************************************************************
+* Function to set up a primary grid and its dualgrid from a mesh file.
+* If <cache_dir> is not NULL, both are loaded from the cache if
+* possible. Otherwise the mesh is read, the dualgrid is built and
+* both are stored in the cache for later runs. The adjacency and the
+* element edge map of cached dualgrids are rebuilt, since they are 
+* not stored in the cache.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int GridCache_load(DualGrid    *dualgrid,
+                   PrimaryGrid *primgrid,
+                   BoundaryDef *bdry_def,
+                   const char  *mesh_path,
+                   const char  *cache_dir);
+
+#endif /* GRIDCACHE_H */
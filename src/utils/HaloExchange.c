@@ -0,0 +1,547 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "HaloExchange.h"
+
+/* Number of doubles per cache line */
+#define HALO_LINE_DOUBLES ( ICF_HALO_LINE / sizeof(double) )
+
+/* Rounds a number of doubles up to full cache lines */
+#define HALO_ALIGN(n) \
+  ( ( (n) + HALO_LINE_DOUBLES - 1 ) / HALO_LINE_DOUBLES * HALO_LINE_DOUBLES )
+
+/***********************************************************************
+* Function to wait until the shared <counter> reaches <target>.
+* Returns ICF_ERROR, if a worker failed in the meantime.
+***********************************************************************/
+static int halo_wait(HaloShm *shm, const uint64_t *counter, uint64_t target)
+{
+  int n_spins = 0;
+
+  while ( __atomic_load_n(counter, __ATOMIC_ACQUIRE) < target )
+  {
+    if ( __atomic_load_n(&shm->abort, __ATOMIC_RELAXED) )
+      return ICF_ERROR;
+
+    if ( ++n_spins >= ICF_HALO_SPINS )
+    {
+      n_spins = 0;
+      sched_yield();
+    }
+  }
+
+  return ICF_SUCCESS;
+
+} /* halo_wait() */
+
+/***********************************************************************
+* Function to pin the calling process to one of its allowed cores,
+* which are assigned to the partitions in a round-robin fashion
+***********************************************************************/
+static void halo_pin_core(int i_part)
+{
+#ifdef __linux__
+  cpu_set_t allowed, pinned;
+  int cpu, n_cpus, i_cpu = 0;
+
+  if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 )
+    return;
+
+  n_cpus = CPU_COUNT(&allowed);
+
+  if ( n_cpus < 1 )
+    return;
+
+  CPU_ZERO(&pinned);
+
+  for ( cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+  {
+    if ( !CPU_ISSET(cpu, &allowed) )
+      continue;
+
+    if ( i_cpu++ == i_part % n_cpus )
+    {
+      CPU_SET(cpu, &pinned);
+      break;
+    }
+  }
+
+  if ( sched_setaffinity(0, sizeof(pinned), &pinned) != 0 )
+    log_warn("Failed to pin partition %d to a core.", i_part);
+#else
+  (void) i_part;
+#endif
+
+} /* halo_pin_core() */
+
+/***********************************************************************
+* Function to compare two unsigned 64-bit integers for qsort()
+***********************************************************************/
+static int cmp_uint64(const void *a, const void *b)
+{
+  const uint64_t ka = *(const uint64_t *) a;
+  const uint64_t kb = *(const uint64_t *) b;
+
+  return ( ka > kb ) - ( ka < kb );
+
+} /* cmp_uint64() */
+
+/***********************************************************************
+* Function to count the number of halo elements, which partition p
+* sends to partition q, in counts[p*n_parts+q]. An element of p is
+* sent to q, if it shares a primary grid element with an element
+* of q (see DualGrid_extract_partition).
+* The pairs (q, element) of all primary grid elements with vertices
+* of different partitions are collected, sorted and counted once.
+***********************************************************************/
+static int halo_channel_sizes(const PrimaryGrid *primgrid,
+                              const int         *part,
+                              int                n_parts,
+                              int64_t           *counts)
+{
+  uint64_t *pairs   = NULL;
+  size_t    n_pairs = 0;
+  int i, j, k, pass;
+
+  const int n_quads = primgrid->n_quads;
+  const int n_elems = primgrid->n_quads + primgrid->n_tris;
+
+  for ( pass = 0; pass < 2; pass++ )
+  {
+    if ( pass == 1 )
+    {
+      pairs = malloc( MAX(n_pairs, 1) * sizeof(uint64_t) );
+      check_mem(pairs);
+      n_pairs = 0;
+    }
+
+    for ( i = 0; i < n_elems; i++ )
+    {
+      const int  n    = ( i < n_quads ) ? 4 : 3;
+      const int *elem = ( i < n_quads ) ? primgrid->quads[i]
+                                        : primgrid->tris[i - n_quads];
+
+      for ( j = 0; j < n; j++ )
+        for ( k = 0; k < n; k++ )
+        {
+          if ( part[elem[j]] == part[elem[k]] )
+            continue;
+
+          if ( pass == 1 )
+            pairs[n_pairs] = (uint64_t) part[elem[k]] << 32
+                           | (uint64_t) elem[j];
+          ++n_pairs;
+        }
+    }
+  }
+
+  qsort(pairs, n_pairs, sizeof(uint64_t), cmp_uint64);
+
+  for ( i = 0; i < (int) n_pairs; i++ )
+  {
+    if ( i > 0 && pairs[i] == pairs[i-1] )
+      continue;
+
+    const int q = (int) ( pairs[i] >> 32 );
+    const int v = (int) ( pairs[i] & 0xFFFFFFFFu );
+
+    ++counts[ (int64_t) part[v] * n_parts + q ];
+  }
+
+  free( pairs );
+
+  return ICF_SUCCESS;
+
+error:
+  free( pairs );
+
+  return ICF_ERROR;
+
+} /* halo_channel_sizes() */
+
+/***********************************************************************
+* Function to execute a worker in a forked process: The process is
+* pinned to a core, before the partition-local dualgrid is extracted
+***********************************************************************/
+static int halo_worker_main(HaloExchange   *hx,
+                            const DualGrid *dualgrid,
+                            BoundaryDef    *bdry_def,
+                            const int      *part,
+                            HaloWorker     *worker,
+                            void           *ctx)
+{
+  DualGridHalo *halo;
+  int j;
+
+  halo_pin_core(hx->part);
+
+  hx->dualgrid = DualGrid_extract_partition(dualgrid, bdry_def, part,
+                                            hx->n_parts, hx->part);
+  check( hx->dualgrid, "Failed to extract partition %d.", hx->part);
+
+  halo = hx->dualgrid->halo;
+
+  for ( j = 0; j < halo->n_nbr_parts; j++ )
+  {
+    const int q = halo->nbr_parts[j];
+    const HaloChannel *send = &hx->channels[hx->part * hx->n_parts + q];
+    const HaloChannel *recv = &hx->channels[q * hx->n_parts + hx->part];
+
+    check( send->n_values == halo->send_ptr[j+1] - halo->send_ptr[j]
+        && recv->n_values == halo->recv_ptr[j+1] - halo->recv_ptr[j],
+        "Halo of partitions %d and %d does not match.", hx->part, q);
+  }
+
+  check( worker(hx, ctx), "Worker of partition %d failed.", hx->part);
+
+  DualGrid_destroy( hx->dualgrid );
+
+  return ICF_SUCCESS;
+
+error:
+  __atomic_store_n(&hx->shm->abort, 1, __ATOMIC_RELAXED);
+
+  if ( hx->dualgrid )
+    DualGrid_destroy( hx->dualgrid );
+
+  return ICF_ERROR;
+
+} /* halo_worker_main() */
+
+/***********************************************************************
+* Function to run a worker in one process per partition of a dualgrid
+***********************************************************************/
+int HaloExchange_run(const DualGrid *dualgrid,
+                     BoundaryDef    *bdry_def,
+                     const int      *part,
+                     int             n_parts,
+                     int             n_vars,
+                     double         *result,
+                     HaloWorker     *worker,
+                     void           *ctx)
+{
+  HaloExchange hx;
+  HaloShm     *shm     = MAP_FAILED;
+  int64_t     *counts  = NULL;
+  pid_t       *pids    = NULL;
+  size_t       map_len = 0;
+  int          n_started = 0;
+  int          n_running = 0;
+  int          failed    = 0;
+  int p, q;
+
+  check( dualgrid->primgrid, "Dualgrid has no primary grid.");
+  check( n_parts > 0, "Invalid number of partitions %d.", n_parts);
+  check( n_vars > 0, "Invalid number of variables %d.", n_vars);
+
+  const int n_elems = dualgrid->n_elements;
+
+  for ( p = 0; p < n_elems; p++ )
+    check( part[p] >= 0 && part[p] < n_parts,
+        "Invalid partition %d of element %d.", part[p], p);
+
+  counts = calloc( (size_t) n_parts * n_parts, sizeof(int64_t) );
+  pids   = calloc( n_parts, sizeof(pid_t) );
+  check_mem(counts);
+  check_mem(pids);
+
+  check( halo_channel_sizes(dualgrid->primgrid, part, n_parts, counts),
+      "Failed to compute the halo sizes.");
+
+  /*--------------------------------------------------------------------
+  | Layout of the shared memory in doubles: Header, reduction slots
+  | (one cache line per partition), channels, output and the message
+  | slots of all channels
+  --------------------------------------------------------------------*/
+  const size_t n_header   = HALO_ALIGN( sizeof(HaloShm) / sizeof(double) );
+  const size_t n_reduce   = (size_t) n_parts * HALO_LINE_DOUBLES;
+  const size_t n_channels = HALO_ALIGN( (size_t) n_parts * n_parts
+                          * sizeof(HaloChannel) / sizeof(double) );
+  const size_t n_output   = HALO_ALIGN( (size_t) n_elems * n_vars );
+
+  size_t n_data = 0;
+
+  for ( p = 0; p < n_parts * n_parts; p++ )
+    n_data += HALO_ALIGN( (size_t) ICF_HALO_N_SLOTS * counts[p] * n_vars );
+
+  map_len = ( n_header + n_reduce + n_channels + n_output + n_data )
+          * sizeof(double);
+
+  shm = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  check( shm != MAP_FAILED, "Failed to map %zu bytes of shared memory.",
+      map_len);
+
+  memset(&hx, 0, sizeof(hx));
+
+  hx.n_parts  = n_parts;
+  hx.n_vars   = n_vars;
+  hx.shm      = shm;
+  hx.reduce   = (double *) shm + n_header;
+  hx.channels = (HaloChannel *) ( hx.reduce + n_reduce );
+  hx.output   = hx.reduce + n_reduce + n_channels;
+  hx.data     = hx.output + n_output;
+
+  shm->n_parts    = n_parts;
+  shm->n_vars     = n_vars;
+  shm->n_elements = n_elems;
+
+  /*--------------------------------------------------------------------
+  | The message slots are not touched here, such that their pages
+  | are placed by the sending workers
+  --------------------------------------------------------------------*/
+  n_data = 0;
+
+  for ( p = 0; p < n_parts * n_parts; p++ )
+  {
+    hx.channels[p].n_values = counts[p];
+    hx.channels[p].offset   = (int64_t) n_data;
+    n_data += HALO_ALIGN( (size_t) ICF_HALO_N_SLOTS * counts[p] * n_vars );
+  }
+
+  /*--------------------------------------------------------------------
+  | Fork the workers
+  --------------------------------------------------------------------*/
+  fflush(NULL);
+
+  for ( p = 0; p < n_parts; p++ )
+  {
+    pids[p] = fork();
+
+    if ( pids[p] < 0 )
+    {
+      log_err("Failed to fork the worker of partition %d.", p);
+      __atomic_store_n(&shm->abort, 1, __ATOMIC_RELAXED);
+      failed = 1;
+      break;
+    }
+
+    if ( pids[p] == 0 )
+    {
+      int status;
+
+      hx.part = p;
+      status  = halo_worker_main(&hx, dualgrid, bdry_def, part,
+                                 worker, ctx);
+
+      fflush(NULL);
+      _exit( status ? 0 : 1 );
+    }
+
+    ++n_started;
+  }
+
+  /*--------------------------------------------------------------------
+  | Wait for all workers -> Release the remaining workers, if one of
+  | them terminates abnormally. Other children of the host process 
+  | are not counted.
+  --------------------------------------------------------------------*/
+  n_running = n_started;
+
+  while ( n_running > 0 )
+  {
+    int   status = 0;
+    pid_t pid    = waitpid(-1, &status, 0);
+
+    if ( pid < 0 && errno == EINTR )
+      continue;
+
+    if ( pid < 0 )
+    {
+      log_err("Failed to wait for the partition workers.");
+      failed = 1;
+      break;
+    }
+
+    for ( q = 0; q < n_started && pids[q] != pid; q++ );
+
+    if ( q == n_started )
+      continue;
+
+    --n_running;
+
+    if ( !WIFEXITED(status) || WEXITSTATUS(status) != 0 )
+    {
+      log_err("Worker of partition %d failed.", q);
+
+      __atomic_store_n(&shm->abort, 1, __ATOMIC_RELAXED);
+      failed = 1;
+    }
+  }
+
+  check( !failed, "Execution of %d partitions failed.", n_parts);
+
+  if ( result )
+    memcpy(result, hx.output, (size_t) n_elems * n_vars * sizeof(double));
+
+  munmap(shm, map_len);
+  free( counts );
+  free( pids );
+
+  return ICF_SUCCESS;
+
+error:
+  if ( shm != MAP_FAILED )
+    munmap(shm, map_len);
+
+  free( counts );
+  free( pids );
+
+  return ICF_ERROR;
+
+} /* HaloExchange_run() */
+
+/***********************************************************************
+* Function to update the ghost values with the values of the owning
+* partitions: All messages are sent first, such that the workers
+* only wait for messages, which are already on their way
+***********************************************************************/
+int HaloExchange_update(HaloExchange *hx, double *values, int n_vars)
+{
+  const DualGridHalo *halo = hx->dualgrid->halo;
+  const int p = hx->part;
+  int j, k, v;
+
+  check( n_vars > 0 && n_vars <= hx->n_vars,
+      "Invalid number of variables %d for the halo exchange.", n_vars);
+
+  /*--------------------------------------------------------------------
+  | Send the owned values to all neighbors
+  --------------------------------------------------------------------*/
+  for ( j = 0; j < halo->n_nbr_parts; j++ )
+  {
+    HaloChannel   *ch   = &hx->channels[p * hx->n_parts
+                                        + halo->nbr_parts[j]];
+    const int     *idx  = halo->send_idx + halo->send_ptr[j];
+    const int      n    = halo->send_ptr[j+1] - halo->send_ptr[j];
+    const uint64_t head = ch->head;
+
+    if ( head >= ICF_HALO_N_SLOTS )
+    {
+      if ( !halo_wait(hx->shm, &ch->tail, head - ICF_HALO_N_SLOTS + 1) )
+        return ICF_ERROR;
+    }
+
+    double *msg = hx->data + ch->offset
+                + ( head % ICF_HALO_N_SLOTS ) * n * hx->n_vars;
+
+    for ( k = 0; k < n; k++ )
+      for ( v = 0; v < n_vars; v++ )
+        msg[k*n_vars + v] = values[idx[k]*n_vars + v];
+
+    __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+  }
+
+  /*--------------------------------------------------------------------
+  | Receive the ghost values from all neighbors
+  --------------------------------------------------------------------*/
+  for ( j = 0; j < halo->n_nbr_parts; j++ )
+  {
+    HaloChannel   *ch   = &hx->channels[halo->nbr_parts[j] * hx->n_parts
+                                        + p];
+    const int     *idx  = halo->recv_idx + halo->recv_ptr[j];
+    const int      n    = halo->recv_ptr[j+1] - halo->recv_ptr[j];
+    const uint64_t tail = ch->tail;
+
+    if ( !halo_wait(hx->shm, &ch->head, tail + 1) )
+      return ICF_ERROR;
+
+    const double *msg = hx->data + ch->offset
+                      + ( tail % ICF_HALO_N_SLOTS ) * n * hx->n_vars;
+
+    for ( k = 0; k < n; k++ )
+      for ( v = 0; v < n_vars; v++ )
+        values[idx[k]*n_vars + v] = msg[k*n_vars + v];
+
+    __atomic_store_n(&ch->tail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* HaloExchange_update() */
+
+/***********************************************************************
+* Function to wait until all workers have reached the barrier
+***********************************************************************/
+int HaloExchange_barrier(HaloExchange *hx)
+{
+  HaloShm *shm = hx->shm;
+
+  const uint64_t gen = __atomic_load_n(&shm->barrier_gen,
+                                       __ATOMIC_ACQUIRE);
+
+  if ( __atomic_add_fetch(&shm->barrier_count, 1, __ATOMIC_ACQ_REL)
+       == (uint64_t) hx->n_parts )
+  {
+    __atomic_store_n(&shm->barrier_count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shm->barrier_gen, gen + 1, __ATOMIC_RELEASE);
+    return ICF_SUCCESS;
+  }
+
+  return halo_wait(shm, &shm->barrier_gen, gen + 1);
+
+} /* HaloExchange_barrier() */
+
+/***********************************************************************
+* Function to compute the sum of a value over all workers
+***********************************************************************/
+int HaloExchange_sum(HaloExchange *hx, double value, double *sum)
+{
+  int p;
+
+  hx->reduce[hx->part * HALO_LINE_DOUBLES] = value;
+
+  if ( !HaloExchange_barrier(hx) )
+    return ICF_ERROR;
+
+  *sum = 0.0;
+
+  for ( p = 0; p < hx->n_parts; p++ )
+    *sum += hx->reduce[p * HALO_LINE_DOUBLES];
+
+  /* The slots must not be overwritten, before all workers read them */
+  return HaloExchange_barrier(hx);
+
+} /* HaloExchange_sum() */
+
+/***********************************************************************
+* Function to store the values of all owned elements in the output
+***********************************************************************/
+void HaloExchange_store(HaloExchange *hx, const double *values, int n_vars)
+{
+  const DualGridHalo *halo = hx->dualgrid->halo;
+  const int n_out = MIN(n_vars, hx->n_vars);
+  int i, v;
+
+  for ( i = 0; i < halo->n_owned; i++ )
+  {
+    double *out = hx->output + (size_t) halo->global_index[i] * hx->n_vars;
+
+    for ( v = 0; v < n_out; v++ )
+      out[v] = values[i*n_vars + v];
+  }
+
+} /* HaloExchange_store() */
@@ -0,0 +1,161 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef HALOEXCHANGE_H
+#define HALOEXCHANGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DualGrid.h"
+#include "Boundary.h"
+
+/***********************************************************************
+* Shared-memory execution of dualgrid partitions
+*
+* HaloExchange_run() forks one worker process per partition. Every
+* worker pins itself to a core and extracts its own partition-local
+* dualgrid (see DualGrid_extract_partition), such that the local
+* data is first touched by the process, that works on it.
+* The workers exchange halo values through single-producer ring
+* buffers in a shared memory mapping, which is set up before the
+* fork. Waiting workers spin on the ring buffer counters and yield
+* their core after ICF_HALO_SPINS unsuccessful polls.
+*
+* -> ICF_HALO_N_SLOTS: Number of messages per ring buffer
+* -> ICF_HALO_SPINS:   Number of polls before a waiting worker yields
+***********************************************************************/
+#define ICF_HALO_N_SLOTS 4
+#define ICF_HALO_SPINS   1000
+#define ICF_HALO_LINE    64
+
+/***********************************************************************
+* Ring buffer for the messages from one partition to another one.
+* The message counters are kept on separate cache lines.
+***********************************************************************/
+typedef struct HaloChannel
+{
+  /* Number of messages written by the sender */
+  uint64_t head;
+  char     pad_head[ICF_HALO_LINE - sizeof(uint64_t)];
+
+  /* Number of messages read by the receiver */
+  uint64_t tail;
+  char     pad_tail[ICF_HALO_LINE - sizeof(uint64_t)];
+
+  /* Number of elements per message and offset of the message slots
+   * in the data section of the shared memory */
+  int64_t  n_values;
+  int64_t  offset;
+  char     pad_size[ICF_HALO_LINE - 2*sizeof(int64_t)];
+
+} HaloChannel;
+
+/***********************************************************************
+* Header of the shared memory mapping, which is followed by the
+* reduction slots, the channels, the output and the data section
+***********************************************************************/
+typedef struct HaloShm
+{
+  int64_t  n_parts;
+  int64_t  n_vars;
+  int64_t  n_elements;
+
+  /* Set by a failing worker to release all waiting workers */
+  int64_t  abort;
+  char     pad_head[ICF_HALO_LINE - 4*sizeof(int64_t)];
+
+  /* Centralized barrier */
+  uint64_t barrier_count;
+  char     pad_count[ICF_HALO_LINE - sizeof(uint64_t)];
+  uint64_t barrier_gen;
+  char     pad_gen[ICF_HALO_LINE - sizeof(uint64_t)];
+
+} HaloShm;
+
+/***********************************************************************
+* HaloExchange structure -> The view of a single worker on the
+* shared memory
+***********************************************************************/
+typedef struct HaloExchange
+{
+  /* Partition of this worker */
+  int part;
+  int n_parts;
+
+  /* Maximum number of values per element of a single exchange */
+  int n_vars;
+
+  /* Partition-local dualgrid of this worker */
+  DualGrid *dualgrid;
+
+  /* Shared memory sections */
+  HaloShm     *shm;
+  double      *reduce;
+  HaloChannel *channels;
+  double      *output;
+  double      *data;
+
+} HaloExchange;
+
+/***********************************************************************
+* Function template for the workers of HaloExchange_run()
+* -> hx:       The halo exchange of the worker, where hx->dualgrid is
+*              the partition-local dualgrid
+* -> ctx:      User context, which is copied into every worker
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+typedef int HaloWorker(HaloExchange *hx, void *ctx);
+
+/***********************************************************************
+* Function to run <worker> in one process per partition of a
+* dualgrid, where <part> holds the partition of every dualgrid
+* element in the range 0 ... n_parts-1.
+* Exchanges hold up to <n_vars> values per element. The workers
+* may store up to <n_vars> values for every owned element with
+* HaloExchange_store(), which are copied into <result>
+* ([n_elements][n_vars]), if it is not NULL.
+* Returns ICF_SUCCESS, if all workers succeeded, and ICF_ERROR
+* otherwise
+***********************************************************************/
+int HaloExchange_run(const DualGrid *dualgrid,
+                     BoundaryDef    *bdry_def,
+                     const int      *part,
+                     int             n_parts,
+                     int             n_vars,
+                     double         *result,
+                     HaloWorker     *worker,
+                     void           *ctx);
+
+/***********************************************************************
+* Function to update the ghost values of <values> ([n_local][n_vars])
+* with the values of the owning partitions
+* Returns ICF_SUCCESS or ICF_ERROR, if another worker failed
+***********************************************************************/
+int HaloExchange_update(HaloExchange *hx, double *values, int n_vars);
+
+/***********************************************************************
+* Function to compute the sum of <value> over all workers. The sum
+* is accumulated in the order of the partitions, such that all
+* workers obtain the same result.
+* Returns ICF_SUCCESS or ICF_ERROR, if another worker failed
+***********************************************************************/
+int HaloExchange_sum(HaloExchange *hx, double value, double *sum);
+
+/***********************************************************************
+* Function to wait until all workers have reached the barrier
+* Returns ICF_SUCCESS or ICF_ERROR, if another worker failed
+***********************************************************************/
+int HaloExchange_barrier(HaloExchange *hx);
+
+/***********************************************************************
+* Function to store the values of all owned elements of <values>
+* ([n_local][n_vars]) in the output of HaloExchange_run()
+***********************************************************************/
+void HaloExchange_store(HaloExchange *hx, const double *values, int n_vars);
+
+#endif /* HALOEXCHANGE_H */
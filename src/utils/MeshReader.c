@@ -5,17 +5,35 @@
 * Refer to the accompanying documentation for details
 * on usage and license.
 */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "icf_utils.h"
 #include "dbg.h"
 #include "bstrlib.h"
 #include "bstrlib_wrapper.h"
 #include "PrimaryGrid.h"
+#include "ThreadPool.h"
+#include "NumScan.h"
 #include "MeshReader.h"
 
+/* Size of parsed text after which mapped pages are released again */
+#define ICF_MMAP_RELEASE_BYTES (64L * 1024L * 1024L)
+
+/* Number of rows of a section that are parsed by one thread task   */
+#define ICF_PARSE_CHUNK_ROWS (1 << 16)
+
+/* Minimum memory budget of the out-of-core mesh conversion          */
+#define ICF_CONVERT_MIN_BUDGET (64L * 1024L)
+
 void test_mesh_io()
 {
   printf("test_mesh_io() works like a charm, too.");
@@ -61,6 +79,11 @@ MeshReader *MeshReader_create(const char *file_path)
   mesh_reader->txtlist = bsplit(bbuffer, splitter);
   mesh_reader->nlines = mesh_reader->txtlist->qty;
 
+  /* Index all section keywords                                      */
+  mesh_reader->txtindex = bstrlib_index_create(mesh_reader->txtlist);
+  check(mesh_reader->txtindex, 
+      "Failed to create keyword index for %s.", mesh_reader->path);
+
   fclose(fptr);
   free(buffer);
 
@@ -70,35 +93,208 @@ error:
 
 } /* MeshReader_create() */
 
+/***********************************************************************
+* Function to create a new mesh reader structure for the single-pass
+* streaming parser. The file data is only kept as raw char buffer, 
+* i.e. no bstring copy and no list of lines is created.
+***********************************************************************/
+MeshReader *MeshReader_create_stream(const char *file_path)
+{
+  FILE *fptr = NULL;
+
+  /*-------------------------------------------------------------------
+  | Allocate memory for reader structure 
+  -------------------------------------------------------------------*/
+  MeshReader *mesh_reader = calloc(1, sizeof(MeshReader));
+  check_mem(mesh_reader);
+
+  mesh_reader->path = file_path;
+
+  /*-------------------------------------------------------------------
+  | Open text file and copy its data 
+  -------------------------------------------------------------------*/
+  fptr = fopen(mesh_reader->path, "rb");
+  check(fptr, "Failed to open %s.", mesh_reader->path);
+
+  /* Estimate length of chars in whole file                          */
+  fseek(fptr, 0, SEEK_END);
+  long length = ftell(fptr);
+  fseek(fptr, 0, SEEK_SET);
+
+  /* Read total file into buffer -> the buffer is kept, since the    */
+  /* streaming parser works directly on it                           */
+  mesh_reader->buffer = malloc(length + 1);
+  check_mem(mesh_reader->buffer);
+
+  check( fread(mesh_reader->buffer, 1, length, fptr) == (size_t) length,
+      "Failed to read %s.", mesh_reader->path);
+  mesh_reader->buffer[length] = '\0';
+
+  mesh_reader->length = length + 1;
+  mesh_reader->nlines = 0;
+
+  fclose(fptr);
+
+  return mesh_reader;
+error:
+  if ( fptr )
+    fclose(fptr);
+  if ( mesh_reader )
+    MeshReader_destroy(mesh_reader);
+  return NULL;
+
+} /* MeshReader_create_stream() */
+
+/***********************************************************************
+* Function to create a new mesh reader structure for the single-pass
+* streaming parser, which maps the file into memory instead of 
+* copying it. The mapped pages are released again while parsing, 
+* such that the peak memory is dominated by the final primary grid.
+***********************************************************************/
+MeshReader *MeshReader_create_mmap(const char *file_path)
+{
+  int fd = -1;
+  struct stat st;
+  char *base = MAP_FAILED;
+
+  /*-------------------------------------------------------------------
+  | Allocate memory for reader structure 
+  -------------------------------------------------------------------*/
+  MeshReader *mesh_reader = calloc(1, sizeof(MeshReader));
+  check_mem(mesh_reader);
+
+  mesh_reader->path = file_path;
+
+  fd = open(mesh_reader->path, O_RDONLY);
+  check(fd >= 0, "Failed to open %s.", mesh_reader->path);
+  check(fstat(fd, &st) == 0, "Failed to stat %s.", mesh_reader->path);
+
+  /*-------------------------------------------------------------------
+  | Reserve the file size plus one additional zero page, such that
+  | the data is always terminated by '\0' -> then map the file on 
+  | top of the reserved range
+  -------------------------------------------------------------------*/
+  long   length   = (long) st.st_size;
+  size_t page_len = (size_t) sysconf(_SC_PAGESIZE);
+  size_t map_len  = ( (size_t) length / page_len + 1 ) * page_len;
+
+  base = mmap(NULL, map_len, PROT_READ, 
+              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  check(base != MAP_FAILED, "Failed to map %s.", mesh_reader->path);
+
+  mesh_reader->buffer  = base;
+  mesh_reader->map_len = map_len;
+
+  if ( length > 0 )
+  {
+    char *fmap = mmap(base, (size_t) length, PROT_READ, 
+                      MAP_PRIVATE | MAP_FIXED, fd, 0);
+    check(fmap == base, "Failed to map %s.", mesh_reader->path);
+
+    madvise(base, (size_t) length, MADV_SEQUENTIAL);
+  }
+
+  mesh_reader->length = length + 1;
+  mesh_reader->nlines = 0;
+
+  close(fd);
+
+  return mesh_reader;
+error:
+  if ( fd >= 0 )
+    close(fd);
+  if ( mesh_reader )
+    MeshReader_destroy(mesh_reader);
+  return NULL;
+
+} /* MeshReader_create_mmap() */
+
 /***********************************************************************
 * Function to destroy a mesh reader structure
 ***********************************************************************/
 int MeshReader_destroy(MeshReader *mesh_reader)
 {
-  bstrListDestroy(mesh_reader->txtlist);
-  bdestroy(mesh_reader->txt);
+  if ( mesh_reader->txtindex )
+    bstrlib_index_destroy(mesh_reader->txtindex);
+  if ( mesh_reader->txtlist )
+    bstrListDestroy(mesh_reader->txtlist);
+  if ( mesh_reader->txt )
+    bdestroy(mesh_reader->txt);
+  if ( mesh_reader->map_len > 0 )
+    munmap(mesh_reader->buffer, mesh_reader->map_len);
+  else
+    free(mesh_reader->buffer);
   free(mesh_reader);
   return ICF_SUCCESS;
 
 } /* MeshReader_destroy() */
 
+/***********************************************************************
+* Function to locate a section of a grid file by its keyword.
+* The number of rows of the section is stored in <n_rows>.
+* Returns the line index of the section keyword or -1 if the 
+* section is not defined.
+***********************************************************************/
+static int MeshReader_find_section(MeshReader *mesh_reader,
+                                   const char *key,
+                                   int        *n_rows)
+{
+  int i_line = -1;
+
+  *n_rows = 0;
+
+  if ( bstrlib_index_find(mesh_reader->txtindex, key, &i_line) < 1 )
+    return -1;
+
+  check( bstrlib_index_extract_param(mesh_reader->txtindex, 
+                                     key, 0, n_rows) > 0, 
+      "Failed to read size of section %s.", key);
+
+  check( i_line + *n_rows < mesh_reader->nlines,
+      "Section %s exceeds the end of the mesh file.", key);
+
+  return i_line;
+
+error:
+  *n_rows = 0;
+  return -1;
+
+} /* MeshReader_find_section() */
+
 /***********************************************************************
 * Function to read a primary grid structure from a given grid file 
 ***********************************************************************/
 void MeshReader_read_primgrid(MeshReader  *mesh_reader, 
                               PrimaryGrid *prim_grid)
 {
+  int n_rows;
+  int lean = mesh_reader->lean 
+    || MeshReader_find_section(mesh_reader, "INTERIOREDGES", &n_rows) < 0;
+
   MeshReader_read_vertices(mesh_reader, prim_grid);
 
   MeshReader_read_quads(mesh_reader, prim_grid);
-  MeshReader_read_quad_neighbors(mesh_reader, prim_grid);
+  if ( !lean )
+    MeshReader_read_quad_neighbors(mesh_reader, prim_grid);
 
   MeshReader_read_tris(mesh_reader, prim_grid);
-  MeshReader_read_tri_neighbors(mesh_reader, prim_grid);
+  if ( !lean )
+    MeshReader_read_tri_neighbors(mesh_reader, prim_grid);
 
-  MeshReader_read_intr_edges(mesh_reader, prim_grid);
+  if ( !lean )
+    MeshReader_read_intr_edges(mesh_reader, prim_grid);
   MeshReader_read_bdry_edges(mesh_reader, prim_grid);
 
+  if ( lean )
+    check( PrimaryGrid_build_topology(prim_grid, 0),
+        "Failed to build connectivity for mesh file %s.", 
+        mesh_reader->path);
+
+  return;
+
+error:
+  return;
+
 } /* MeshReader_read_primgrid() */
 
 /***********************************************************************
@@ -113,24 +309,15 @@ void MeshReader_read_vertices(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
 
   /*--------------------------------------------------------------------
   | Get total number of nodes 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "VERTICES", 0, &nNodes);
+  i = MeshReader_find_section(mesh_reader, "VERTICES", &nNodes);
   check(nNodes > 0, "No nodes defined in mesh file.");
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather nodes
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "VERTICES" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nNodes + 1;
 
@@ -140,25 +327,18 @@ void MeshReader_read_vertices(MeshReader  *mesh_reader,
 
   for (i = i+1; i < iMax; i++)
   {
-    line  = flPtr[i];
-
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    line    = flPtr[i];
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_doubles(&pos, pos + line->slen, 
+                                  xyNodes[i_node], 2);
 
     check (nValues == 2, 
-        "Wrong definition for node coordinates.");
-
-    xyNodes[i_node][0] = atof(valPtr[0]->data);
-    xyNodes[i_node][1] = atof(valPtr[1]->data);
+        "Wrong definition for node coordinates in line %d.", i+1);
 
     ++i_node;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->vertex_coords = xyNodes;
   prim_grid->n_vertices    = nNodes;
@@ -182,13 +362,13 @@ void MeshReader_read_tris(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "TRIANGLES", 0, &nTris);
+  i = MeshReader_find_section(mesh_reader, "TRIANGLES", &nTris);
 
   if ( nTris < 1 )
   {
@@ -196,15 +376,7 @@ void MeshReader_read_tris(MeshReader  *mesh_reader,
     return;
   }
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "TRIANGLES" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nTris + 1;
 
@@ -215,24 +387,20 @@ void MeshReader_read_tris(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 3);
 
     check (nValues == 3, 
-        "Wrong definition for triangles.");
+        "Wrong definition for triangles in line %d.", i+1);
 
-    idxTris[i_tri][0] = atoi(valPtr[0]->data);
-    idxTris[i_tri][1] = atoi(valPtr[1]->data);
-    idxTris[i_tri][2] = atoi(valPtr[2]->data);
+    idxTris[i_tri][0] = ivals[0];
+    idxTris[i_tri][1] = ivals[1];
+    idxTris[i_tri][2] = ivals[2];
     
     i_tri++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->tris   = idxTris;
   prim_grid->n_tris = nTris;
@@ -256,26 +424,18 @@ void MeshReader_read_tri_neighbors(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "TRIANGLENEIGHBORS", 0, &nTris);
+  i = MeshReader_find_section(mesh_reader, "TRIANGLENEIGHBORS", &nTris);
 
   if ( nTris < 1 )
     return;
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "TRIANGLENEIGHBORS" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nTris + 1;
 
@@ -286,24 +446,20 @@ void MeshReader_read_tri_neighbors(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 3);
 
     check (nValues == 3, 
-        "Wrong definition for triangles.");
+        "Wrong definition for triangles in line %d.", i+1);
 
-    idxTriNbrs[i_tri][0] = atoi(valPtr[0]->data);
-    idxTriNbrs[i_tri][1] = atoi(valPtr[1]->data);
-    idxTriNbrs[i_tri][2] = atoi(valPtr[2]->data);
+    idxTriNbrs[i_tri][0] = ivals[0];
+    idxTriNbrs[i_tri][1] = ivals[1];
+    idxTriNbrs[i_tri][2] = ivals[2];
 
     i_tri++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->tri_neighbors = idxTriNbrs;
 
@@ -326,13 +482,13 @@ void MeshReader_read_quads(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "QUADS", 0, &nQuads);
+  i = MeshReader_find_section(mesh_reader, "QUADS", &nQuads);
 
   if ( nQuads < 1 )
   {
@@ -340,15 +496,7 @@ void MeshReader_read_quads(MeshReader  *mesh_reader,
     return;
   }
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "QUADS" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nQuads + 1;
 
@@ -359,25 +507,21 @@ void MeshReader_read_quads(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 4);
 
     check (nValues == 4, 
-        "Wrong definition for quads.");
+        "Wrong definition for quads in line %d.", i+1);
 
-    idxQuads[i_quad][0] = atoi(valPtr[0]->data);
-    idxQuads[i_quad][1] = atoi(valPtr[1]->data);
-    idxQuads[i_quad][2] = atoi(valPtr[2]->data);
-    idxQuads[i_quad][3] = atoi(valPtr[3]->data);
+    idxQuads[i_quad][0] = ivals[0];
+    idxQuads[i_quad][1] = ivals[1];
+    idxQuads[i_quad][2] = ivals[2];
+    idxQuads[i_quad][3] = ivals[3];
     
     i_quad++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->quads   = idxQuads;
   prim_grid->n_quads = nQuads;
@@ -401,26 +545,18 @@ void MeshReader_read_quad_neighbors(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "QUADNEIGHBORS", 0, &nQuads);
+  i = MeshReader_find_section(mesh_reader, "QUADNEIGHBORS", &nQuads);
 
   if ( nQuads < 1 )
     return;
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "QUADNEIGHBORS" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nQuads + 1;
 
@@ -431,25 +567,21 @@ void MeshReader_read_quad_neighbors(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 4);
 
     check (nValues == 4, 
-        "Wrong definition for quads.");
+        "Wrong definition for quads in line %d.", i+1);
 
-    idxQuadNbrs[i_quad][0] = atoi(valPtr[0]->data);
-    idxQuadNbrs[i_quad][1] = atoi(valPtr[1]->data);
-    idxQuadNbrs[i_quad][2] = atoi(valPtr[2]->data);
-    idxQuadNbrs[i_quad][3] = atoi(valPtr[3]->data);
+    idxQuadNbrs[i_quad][0] = ivals[0];
+    idxQuadNbrs[i_quad][1] = ivals[1];
+    idxQuadNbrs[i_quad][2] = ivals[2];
+    idxQuadNbrs[i_quad][3] = ivals[3];
 
     i_quad++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->quad_neighbors = idxQuadNbrs;
 
@@ -472,24 +604,16 @@ void MeshReader_read_intr_edges(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "INTERIOREDGES", 0, &nEdges);
+  i = MeshReader_find_section(mesh_reader, "INTERIOREDGES", &nEdges);
   check(nEdges > 0, "No interior edges defined in mesh file.");
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "INTERIOREDGES" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nEdges + 1;
 
@@ -501,26 +625,22 @@ void MeshReader_read_intr_edges(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 4);
 
-    check(nValues == 4, 
-        "Wrong definition for interior edges.");
+    check (nValues == 4, 
+        "Wrong definition for interior edges in line %d.", i+1);
 
-    idxEdges[i_edge][0] = atoi(valPtr[0]->data);
-    idxEdges[i_edge][1] = atoi(valPtr[1]->data);
+    idxEdges[i_edge][0] = ivals[0];
+    idxEdges[i_edge][1] = ivals[1];
 
-    idxEdgeNbrs[i_edge][0] = atoi(valPtr[2]->data);
-    idxEdgeNbrs[i_edge][1] = atoi(valPtr[3]->data);
+    idxEdgeNbrs[i_edge][0] = ivals[2];
+    idxEdgeNbrs[i_edge][1] = ivals[3];
     
     i_edge++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->intr_edges     = idxEdges;
   prim_grid->intr_edge_nbrs = idxEdgeNbrs;
@@ -547,24 +667,16 @@ void MeshReader_read_bdry_edges(MeshReader  *mesh_reader,
   int i, iMax, nValues;
 
   bstring line;
-  bstring *valPtr;
-  struct bstrList *values;
+  const char *pos;
+  int ivals[4];
 
   /*--------------------------------------------------------------------
   | Get total number of triangles 
   --------------------------------------------------------------------*/
-  bstrlib_extract_param(mesh_reader->txtlist, "BOUNDARYEDGES", 0, &nEdges);
+  i = MeshReader_find_section(mesh_reader, "BOUNDARYEDGES", &nEdges);
   check(nEdges > 0, "No boundary edges defined in mesh file.");
 
-  /*--------------------------------------------------------------------
-  | Get line index where we start to gather tris
-  --------------------------------------------------------------------*/
-  bstring *flPtr  = mesh_reader->txtlist->entry;
-  bstring markStr = bfromcstr( "BOUNDARYEDGES" );
-
-  for (i = 0; i < mesh_reader->txtlist->qty; i++)
-    if ( binstr(flPtr[i], 0, markStr) != BSTR_ERR )
-      break;
+  bstring *flPtr = mesh_reader->txtlist->entry;
 
   iMax = i + nEdges + 1;
 
@@ -577,25 +689,22 @@ void MeshReader_read_bdry_edges(MeshReader  *mesh_reader,
   for (i = i+1; i < iMax; i++)
   {
     line    = flPtr[i];
-    values  = bsplit(line, ',');
-    nValues = values->qty;
-    valPtr  = values->entry;
+    pos     = (const char *) line->data;
+    nValues = NumScan_row_ints(&pos, pos + line->slen, ivals, 4);
 
-    check (nValues == 4, 
-        "Wrong definition for boundary edges.");
+    /* Rows of lean grid files do not contain the adjacent element */
+    check (nValues == 4 || nValues == 3, 
+        "Wrong definition for boundary edges in line %d.", i+1);
 
-    idxEdges[i_edge][0] = atoi(valPtr[0]->data);
-    idxEdges[i_edge][1] = atoi(valPtr[1]->data);
-    idxEdgeNbrs[i_edge] = atoi(valPtr[2]->data);
-    edgeMarker[i_edge]  = atoi(valPtr[3]->data);
+    idxEdges[i_edge][0] = ivals[0];
+    idxEdges[i_edge][1] = ivals[1];
+    idxEdgeNbrs[i_edge] = ( nValues == 4 ) ? ivals[2] : -1;
+    edgeMarker[i_edge]  = ivals[nValues-1];
     
     i_edge++;
 
-    bstrListDestroy( values );
-
   }
 
-  bdestroy( markStr );
 
   prim_grid->bdry_edges       = idxEdges;
   prim_grid->bdry_edge_nbrs   = idxEdgeNbrs;
@@ -608,3 +717,981 @@ error:
   return;
 
 } /* MeshReader_read_bdry_edges() */
+
+
+/***********************************************************************
+* Sections of the mesh file format, which are handled by the 
+* single-pass streaming parser
+***********************************************************************/
+typedef enum
+{
+  SECTION_VERTICES,
+  SECTION_TRIANGLES,
+  SECTION_TRIANGLENEIGHBORS,
+  SECTION_QUADS,
+  SECTION_QUADNEIGHBORS,
+  SECTION_INTERIOREDGES,
+  SECTION_BOUNDARYEDGES,
+  SECTION_UNKNOWN,
+} MeshSection;
+
+static const char *mesh_section_keys[SECTION_UNKNOWN] = {
+  "VERTICES",
+  "TRIANGLES",
+  "TRIANGLENEIGHBORS",
+  "QUADS",
+  "QUADNEIGHBORS",
+  "INTERIOREDGES",
+  "BOUNDARYEDGES",
+};
+
+/* Number of comma-separated values in every row of a section */
+static const int mesh_section_nvals[SECTION_UNKNOWN] = {
+  2, 3, 3, 4, 4, 4, 4
+};
+
+/***********************************************************************
+* Returns ICF_TRUE, if a section holds connectivity data, which is 
+* skipped and rebuilt for lean grid files
+***********************************************************************/
+static inline int stream_is_derived(MeshSection section)
+{
+  return section == SECTION_TRIANGLENEIGHBORS 
+      || section == SECTION_QUADNEIGHBORS
+      || section == SECTION_INTERIOREDGES;
+
+} /* stream_is_derived() */
+
+/***********************************************************************
+* Returns the section, which is defined by the keyword at the 
+* beginning of a line. <pos> is moved behind the keyword.
+***********************************************************************/
+static inline MeshSection stream_read_section(const char **pos)
+{
+  const char *c = *pos;
+  int i, len;
+
+  while ( *c == ' ' || *c == '\t' )
+    ++c;
+
+  for ( len = 0; c[len] >= 'A' && c[len] <= 'Z'; len++ );
+
+  if ( len < 1 )
+    return SECTION_UNKNOWN;
+
+  for ( i = 0; i < SECTION_UNKNOWN; i++ )
+  {
+    if ( strncmp(c, mesh_section_keys[i], len) == 0 
+         && mesh_section_keys[i][len] == '\0' )
+    {
+      *pos = c + len;
+      return (MeshSection) i;
+    }
+  }
+
+  return SECTION_UNKNOWN;
+
+} /* stream_read_section() */
+
+/***********************************************************************
+* Moves <pos> to the beginning of the next line
+***********************************************************************/
+static inline const char *stream_next_line(const char *pos, 
+                                           const char *end)
+{
+  return NumScan_skip_lines(pos, end, 1);
+
+} /* stream_next_line() */
+
+/***********************************************************************
+* Releases all mapped pages in front of <pos>, if the mesh reader 
+* works on a memory mapped file. The pages are file-backed, hence 
+* they are simply dropped from the resident set.
+***********************************************************************/
+static inline void stream_release_pages(MeshReader *mesh_reader,
+                                        const char *pos)
+{
+  if ( mesh_reader->map_len < 1 )
+    return;
+
+  size_t page_len = (size_t) sysconf(_SC_PAGESIZE);
+  size_t n_bytes  = (size_t) (pos - mesh_reader->buffer);
+
+  n_bytes = ( n_bytes / page_len ) * page_len;
+
+  if ( n_bytes > 0 )
+    madvise(mesh_reader->buffer, n_bytes, MADV_DONTNEED);
+
+} /* stream_release_pages() */
+
+/***********************************************************************
+* Allocates the primary grid arrays of a given section with <n_rows>
+* entries. The arrays are directly attached to the primary grid, 
+* such that they are freed on errors.
+***********************************************************************/
+static int stream_alloc_section(MeshSection   section,
+                                int           n_rows,
+                                PrimaryGrid  *prim_grid)
+{
+  switch ( section )
+  {
+    case SECTION_VERTICES:
+      free( prim_grid->vertex_coords );
+      prim_grid->vertex_coords = calloc(n_rows, 2*sizeof(double));
+      check_mem(prim_grid->vertex_coords);
+      prim_grid->n_vertices = n_rows;
+      break;
+
+    case SECTION_TRIANGLES:
+      free( prim_grid->tris );
+      prim_grid->tris = calloc(n_rows, 3*sizeof(int));
+      check_mem(prim_grid->tris);
+      prim_grid->n_tris = n_rows;
+      break;
+
+    case SECTION_TRIANGLENEIGHBORS:
+      free( prim_grid->tri_neighbors );
+      prim_grid->tri_neighbors = calloc(n_rows, 3*sizeof(int));
+      check_mem(prim_grid->tri_neighbors);
+      break;
+
+    case SECTION_QUADS:
+      free( prim_grid->quads );
+      prim_grid->quads = calloc(n_rows, 4*sizeof(int));
+      check_mem(prim_grid->quads);
+      prim_grid->n_quads = n_rows;
+      break;
+
+    case SECTION_QUADNEIGHBORS:
+      free( prim_grid->quad_neighbors );
+      prim_grid->quad_neighbors = calloc(n_rows, 4*sizeof(int));
+      check_mem(prim_grid->quad_neighbors);
+      break;
+
+    case SECTION_INTERIOREDGES:
+      free( prim_grid->intr_edges );
+      free( prim_grid->intr_edge_nbrs );
+      prim_grid->intr_edges     = calloc(n_rows, 2*sizeof(int));
+      prim_grid->intr_edge_nbrs = calloc(n_rows, 2*sizeof(int));
+      check_mem(prim_grid->intr_edges);
+      check_mem(prim_grid->intr_edge_nbrs);
+      prim_grid->n_intr_edges = n_rows;
+      break;
+
+    case SECTION_BOUNDARYEDGES:
+      free( prim_grid->bdry_edges );
+      free( prim_grid->bdry_edge_nbrs );
+      free( prim_grid->bdry_edge_marker );
+      prim_grid->bdry_edges       = calloc(n_rows, 2*sizeof(int));
+      prim_grid->bdry_edge_nbrs   = calloc(n_rows, sizeof(int));
+      prim_grid->bdry_edge_marker = calloc(n_rows, sizeof(int));
+      check_mem(prim_grid->bdry_edges);
+      check_mem(prim_grid->bdry_edge_nbrs);
+      check_mem(prim_grid->bdry_edge_marker);
+      prim_grid->n_bdry_edges = n_rows;
+      break;
+
+    default:
+      sentinel("Unknown mesh file section.");
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* stream_alloc_section() */
+
+/***********************************************************************
+* Parses <n_rows> rows of a given section, starting at <pos>, and 
+* stores them in the preallocated primary grid arrays, beginning 
+* at row <row_begin>. <line> is the file line number of the first row.
+* If <mesh_reader> is given, parsed pages of memory mapped files
+* are released.
+***********************************************************************/
+static int stream_parse_rows(MeshReader   *mesh_reader,
+                             const char  **pos, 
+                             const char   *end,
+                             int           line,
+                             MeshSection   section,
+                             int           row_begin,
+                             int           n_rows,
+                             PrimaryGrid  *prim_grid)
+{
+  const int n_vals = mesh_section_nvals[section];
+  const char *sec_name = mesh_section_keys[section];
+
+  int    ivals[4];
+  int    i_row, n;
+
+  const char *released = *pos;
+
+  for ( i_row = row_begin; i_row < row_begin + n_rows; i_row++ )
+  {
+    check( *pos < end, 
+        "Unexpected end of file in section %s.", sec_name);
+
+    if ( section == SECTION_VERTICES )
+      n = NumScan_row_doubles(pos, end, prim_grid->vertex_coords[i_row],
+                              n_vals);
+    else
+      n = NumScan_row_ints(pos, end, ivals, n_vals);
+
+    /* Boundary edge rows of lean grid files lack the element */
+    check( n == n_vals || ( section == SECTION_BOUNDARYEDGES && n == 3 ), 
+        "Wrong definition for %s in line %d.", 
+        sec_name, line + i_row - row_begin);
+
+    switch ( section )
+    {
+      case SECTION_TRIANGLES:
+        memcpy(prim_grid->tris[i_row], ivals, 3*sizeof(int));
+        break;
+
+      case SECTION_TRIANGLENEIGHBORS:
+        memcpy(prim_grid->tri_neighbors[i_row], ivals, 3*sizeof(int));
+        break;
+
+      case SECTION_QUADS:
+        memcpy(prim_grid->quads[i_row], ivals, 4*sizeof(int));
+        break;
+
+      case SECTION_QUADNEIGHBORS:
+        memcpy(prim_grid->quad_neighbors[i_row], ivals, 4*sizeof(int));
+        break;
+
+      case SECTION_INTERIOREDGES:
+        prim_grid->intr_edges[i_row][0]     = ivals[0];
+        prim_grid->intr_edges[i_row][1]     = ivals[1];
+        prim_grid->intr_edge_nbrs[i_row][0] = ivals[2];
+        prim_grid->intr_edge_nbrs[i_row][1] = ivals[3];
+        break;
+
+      case SECTION_BOUNDARYEDGES:
+        prim_grid->bdry_edges[i_row][0]    = ivals[0];
+        prim_grid->bdry_edges[i_row][1]    = ivals[1];
+        prim_grid->bdry_edge_nbrs[i_row]   = ( n == 4 ) ? ivals[2] : -1;
+        prim_grid->bdry_edge_marker[i_row] = ivals[n-1];
+        break;
+
+      default:
+        break;
+    }
+
+    if ( mesh_reader && *pos - released > ICF_MMAP_RELEASE_BYTES )
+    {
+      stream_release_pages(mesh_reader, *pos);
+      released = *pos;
+    }
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* stream_parse_rows() */
+
+/***********************************************************************
+* Reads the number of entries behind a section keyword. 
+* Returns -1 if no valid number is found.
+***********************************************************************/
+static inline long stream_read_count(const char **pos)
+{
+  const char *c = *pos;
+  char *stop;
+
+  while ( *c == ' ' || *c == '\t' )
+    ++c;
+
+  if ( *c < '0' || *c > '9' )
+    return -1;
+
+  long n_rows = strtol(c, &stop, 10);
+  *pos = stop;
+
+  return n_rows;
+
+} /* stream_read_count() */
+
+/***********************************************************************
+* Checks that all mandatory sections have been read. The connectivity
+* is rebuilt, if it has been skipped (<lean>) or is not present.
+***********************************************************************/
+static int stream_check_primgrid(PrimaryGrid *prim_grid,
+                                 int          n_tri_nbrs,
+                                 int          n_quad_nbrs,
+                                 int          lean,
+                                 int          n_threads)
+{
+  check(prim_grid->n_vertices > 0, 
+      "No nodes defined in mesh file.");
+
+  if ( lean || prim_grid->n_intr_edges < 1 )
+  {
+    check( PrimaryGrid_build_topology(prim_grid, n_threads),
+        "Failed to build connectivity of primary grid.");
+    n_tri_nbrs  = -1;
+    n_quad_nbrs = -1;
+  }
+
+  check(prim_grid->n_intr_edges > 0, 
+      "No interior edges defined in mesh file.");
+  check(prim_grid->n_bdry_edges > 0, 
+      "No boundary edges defined in mesh file.");
+
+  check( n_tri_nbrs < 0 || n_tri_nbrs == prim_grid->n_tris,
+      "Number of triangle neighbors does not match number of triangles.");
+  check( n_quad_nbrs < 0 || n_quad_nbrs == prim_grid->n_quads,
+      "Number of quad neighbors does not match number of quads.");
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* stream_check_primgrid() */
+
+/***********************************************************************
+* Function to read a primary grid structure from a given grid file 
+* in a single pass over the raw file buffer. Every section is 
+* dispatched directly into the primary grid arrays, without any 
+* allocations for single lines or values.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_stream_primgrid(MeshReader  *mesh_reader, 
+                               PrimaryGrid *prim_grid)
+{
+  check( mesh_reader->buffer, 
+      "Mesh reader has not been created for streaming.");
+
+  const char *pos = mesh_reader->buffer;
+  const char *end = mesh_reader->buffer + mesh_reader->length - 1;
+
+  int n_tri_nbrs  = -1;
+  int n_quad_nbrs = -1;
+  int line = 0;
+
+  prim_grid->n_tris       = 0;
+  prim_grid->n_quads      = 0;
+  prim_grid->n_intr_edges = 0;
+
+  /*--------------------------------------------------------------------
+  | Walk through the file once and dispatch every section header 
+  | to its row parser
+  --------------------------------------------------------------------*/
+  while ( pos < end )
+  {
+    ++line;
+
+    MeshSection section = stream_read_section(&pos);
+
+    if ( section == SECTION_UNKNOWN )
+    {
+      pos = stream_next_line(pos, end);
+      continue;
+    }
+
+    long n_rows = stream_read_count(&pos);
+
+    check( n_rows >= 0 && n_rows <= INT_MAX, 
+        "Invalid number of entries for %s in line %d.", 
+        mesh_section_keys[section], line);
+
+    pos = stream_next_line(pos, end);
+
+    if ( mesh_reader->lean && stream_is_derived(section) )
+    {
+      pos   = NumScan_skip_lines(pos, end, n_rows);
+      line += (int) n_rows;
+      continue;
+    }
+
+    if ( section == SECTION_TRIANGLENEIGHBORS )
+      n_tri_nbrs = (int) n_rows;
+    if ( section == SECTION_QUADNEIGHBORS )
+      n_quad_nbrs = (int) n_rows;
+
+    if ( n_rows < 1 )
+      continue;
+
+    check( stream_alloc_section(section, (int) n_rows, prim_grid),
+        "Failed to read section %s.", mesh_section_keys[section]);
+    check( stream_parse_rows(mesh_reader, &pos, end, line+1, section, 
+                             0, (int) n_rows, prim_grid),
+        "Failed to read section %s.", mesh_section_keys[section]);
+
+    line += (int) n_rows;
+  }
+
+  mesh_reader->nlines = line;
+
+  check( stream_check_primgrid(prim_grid, n_tri_nbrs, n_quad_nbrs,
+                               mesh_reader->lean, 0),
+      "Invalid mesh file %s.", mesh_reader->path);
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* MeshReader_stream_primgrid() */
+
+/***********************************************************************
+* Table of contents entry of a mesh file section for the parallel
+* reader. Large sections are split into chunks of 
+* ICF_PARSE_CHUNK_ROWS rows, which are parsed independently.
+***********************************************************************/
+typedef struct 
+{
+  int          n_rows;
+  int          line;     /* File line number of the first row */
+  int          n_chunks;
+  const char **chunks;   /* Location of the first row of every chunk */
+} MeshSectionToc;
+
+typedef struct 
+{
+  MeshSection  section;
+  int          row_begin;
+  int          n_rows;
+  int          line;
+  const char  *pos;
+  int          status;
+} MeshParseTask;
+
+typedef struct 
+{
+  MeshParseTask *tasks;
+  const char    *end;
+  PrimaryGrid   *prim_grid;
+} MeshParseCtx;
+
+/***********************************************************************
+* Thread pool task, which parses a single chunk of a section
+***********************************************************************/
+static void stream_parse_task(void *ctx, int i_task, int i_thread)
+{
+  MeshParseCtx  *pctx = ctx;
+  MeshParseTask *task = &pctx->tasks[i_task];
+  const char    *pos  = task->pos;
+
+  task->status = stream_parse_rows(NULL, &pos, pctx->end, task->line, 
+                                   task->section, task->row_begin, 
+                                   task->n_rows, pctx->prim_grid);
+
+} /* stream_parse_task() */
+
+/***********************************************************************
+* Function to read a primary grid structure from a given grid file 
+* with multiple threads. A table of contents of all sections is built 
+* first, afterwards all sections and chunks of large sections are 
+* parsed concurrently into the preallocated primary grid arrays.
+* The mesh reader must be created for streaming or memory mapping.
+* For n_threads < 1, the number of online processors is used.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_read_primgrid_parallel(MeshReader  *mesh_reader, 
+                                      PrimaryGrid *prim_grid,
+                                      int          n_threads)
+{
+  MeshSectionToc toc[SECTION_UNKNOWN];
+  MeshParseTask *tasks = NULL;
+  ThreadPool    *pool  = NULL;
+  int i, i_row, i_chunk;
+
+  memset(toc, 0, sizeof(toc));
+
+  check( mesh_reader->buffer, 
+      "Mesh reader has not been created for streaming.");
+
+  const char *pos = mesh_reader->buffer;
+  const char *end = mesh_reader->buffer + mesh_reader->length - 1;
+
+  int n_tri_nbrs  = -1;
+  int n_quad_nbrs = -1;
+  int line = 0;
+
+  prim_grid->n_tris       = 0;
+  prim_grid->n_quads      = 0;
+  prim_grid->n_intr_edges = 0;
+
+  /*--------------------------------------------------------------------
+  | Build the table of contents: locate all section headers and the 
+  | first row of every chunk, without parsing any values
+  --------------------------------------------------------------------*/
+  while ( pos < end )
+  {
+    ++line;
+
+    MeshSection section = stream_read_section(&pos);
+
+    if ( section == SECTION_UNKNOWN )
+    {
+      pos = stream_next_line(pos, end);
+      continue;
+    }
+
+    long n_rows = stream_read_count(&pos);
+
+    check( n_rows >= 0 && n_rows <= INT_MAX, 
+        "Invalid number of entries for %s in line %d.", 
+        mesh_section_keys[section], line);
+
+    pos = stream_next_line(pos, end);
+
+    if ( mesh_reader->lean && stream_is_derived(section) )
+    {
+      pos   = NumScan_skip_lines(pos, end, n_rows);
+      line += (int) n_rows;
+      continue;
+    }
+
+    if ( section == SECTION_TRIANGLENEIGHBORS )
+      n_tri_nbrs = (int) n_rows;
+    if ( section == SECTION_QUADNEIGHBORS )
+      n_quad_nbrs = (int) n_rows;
+
+    MeshSectionToc *entry = &toc[section];
+
+    free( entry->chunks );
+
+    entry->n_rows   = (int) n_rows;
+    entry->line     = line + 1;
+    entry->n_chunks = ( entry->n_rows + ICF_PARSE_CHUNK_ROWS - 1 ) 
+                    / ICF_PARSE_CHUNK_ROWS;
+    entry->chunks   = calloc(entry->n_chunks + 1, sizeof(const char*));
+    check_mem(entry->chunks);
+
+    for ( i_row = 0; i_row < entry->n_rows; i_row += ICF_PARSE_CHUNK_ROWS )
+    {
+      check( pos < end, 
+          "Unexpected end of file in section %s.", 
+          mesh_section_keys[section]);
+
+      entry->chunks[i_row / ICF_PARSE_CHUNK_ROWS] = pos;
+
+      pos = NumScan_skip_lines(pos, end, 
+                               MIN(ICF_PARSE_CHUNK_ROWS, 
+                                   entry->n_rows - i_row));
+    }
+
+    line += entry->n_rows;
+  }
+
+  mesh_reader->nlines = line;
+
+  /*--------------------------------------------------------------------
+  | Allocate all sections and create one task per chunk
+  --------------------------------------------------------------------*/
+  int n_tasks = 0;
+
+  for ( i = 0; i < SECTION_UNKNOWN; i++ )
+  {
+    if ( toc[i].n_rows < 1 )
+      continue;
+
+    check( stream_alloc_section(i, toc[i].n_rows, prim_grid),
+        "Failed to read section %s.", mesh_section_keys[i]);
+
+    n_tasks += toc[i].n_chunks;
+  }
+
+  tasks = calloc(n_tasks + 1, sizeof(MeshParseTask));
+  check_mem(tasks);
+
+  n_tasks = 0;
+
+  for ( i = 0; i < SECTION_UNKNOWN; i++ )
+  {
+    for ( i_chunk = 0; i_chunk < toc[i].n_chunks; i_chunk++ )
+    {
+      MeshParseTask *task = &tasks[n_tasks++];
+
+      task->section   = i;
+      task->row_begin = i_chunk * ICF_PARSE_CHUNK_ROWS;
+      task->n_rows    = MIN(ICF_PARSE_CHUNK_ROWS, 
+                            toc[i].n_rows - task->row_begin);
+      task->line      = toc[i].line + task->row_begin;
+      task->pos       = toc[i].chunks[i_chunk];
+      task->status    = ICF_ERROR;
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Parse all chunks concurrently
+  --------------------------------------------------------------------*/
+  MeshParseCtx ctx = { tasks, end, prim_grid };
+
+  pool = ThreadPool_create(n_threads);
+  check( pool, "Failed to create thread pool.");
+
+  ThreadPool_run(pool, n_tasks, stream_parse_task, &ctx);
+
+  ThreadPool_destroy( pool );
+  pool = NULL;
+
+  for ( i = 0; i < n_tasks; i++ )
+    check( tasks[i].status, "Failed to read section %s.", 
+        mesh_section_keys[tasks[i].section]);
+
+  check( stream_check_primgrid(prim_grid, n_tri_nbrs, n_quad_nbrs,
+                               mesh_reader->lean, n_threads),
+      "Invalid mesh file %s.", mesh_reader->path);
+
+  for ( i = 0; i < SECTION_UNKNOWN; i++ )
+    free( toc[i].chunks );
+  free( tasks );
+
+  return ICF_SUCCESS;
+
+error:
+  for ( i = 0; i < SECTION_UNKNOWN; i++ )
+    free( toc[i].chunks );
+  free( tasks );
+  return ICF_ERROR;
+
+} /* MeshReader_read_primgrid_parallel() */
+
+/***********************************************************************
+* Binary grid sections, which are written for every section of the 
+* mesh file by the out-of-core converter
+***********************************************************************/
+static const int convert_n_out[SECTION_UNKNOWN] = {
+  1, 1, 1, 1, 1, 2, 3
+};
+
+static const PrimaryGridSection convert_out[SECTION_UNKNOWN][3] = {
+  { ICF_GRID_VERTEX_COORDS },
+  { ICF_GRID_TRIS },
+  { ICF_GRID_TRI_NEIGHBORS },
+  { ICF_GRID_QUADS },
+  { ICF_GRID_QUAD_NEIGHBORS },
+  { ICF_GRID_INTR_EDGES, ICF_GRID_INTR_EDGE_NBRS },
+  { ICF_GRID_BDRY_EDGES, ICF_GRID_BDRY_EDGE_NBRS, 
+    ICF_GRID_BDRY_EDGE_MARKER },
+};
+
+/* Size of a single row of every binary grid section */
+static const size_t convert_row_size[ICF_GRID_N_SECTIONS] = {
+  2 * sizeof(double),
+  3 * sizeof(int32_t),
+  4 * sizeof(int32_t),
+  3 * sizeof(int32_t),
+  4 * sizeof(int32_t),
+  2 * sizeof(int32_t),
+  2 * sizeof(int32_t),
+  2 * sizeof(int32_t),
+  1 * sizeof(int32_t),
+  1 * sizeof(int32_t),
+};
+
+/***********************************************************************
+* Moves the unparsed rest of the input block to its beginning and 
+* fills the block with the next bytes of the mesh file. 
+* The block is always terminated by '\0'.
+***********************************************************************/
+static int convert_fill_block(FILE        *fptr,
+                              char        *block,
+                              size_t       block_size,
+                              const char **pos,
+                              size_t      *n_data,
+                              int         *eof)
+{
+  size_t n_rest = block + *n_data - *pos;
+
+  check( n_rest < block_size, 
+      "Line exceeds the memory budget of the mesh conversion.");
+
+  memmove(block, *pos, n_rest);
+
+  size_t n_read = fread(block + n_rest, 1, block_size - n_rest, fptr);
+  check( !ferror(fptr), "Failed to read mesh file.");
+
+  *eof    = ( n_read < block_size - n_rest );
+  *n_data = n_rest + n_read;
+  *pos    = block;
+
+  block[*n_data] = '\0';
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* convert_fill_block() */
+
+/***********************************************************************
+* Returns the end of the last complete line within the input block
+***********************************************************************/
+static inline const char *convert_complete_end(const char *block,
+                                               size_t      n_data,
+                                               int         eof)
+{
+  const char *c = block + n_data;
+
+  if ( eof )
+    return c;
+
+  while ( c > block && c[-1] != '\n' )
+    --c;
+
+  return c;
+
+} /* convert_complete_end() */
+
+/***********************************************************************
+* Function to convert an ASCII grid file into the binary grid format 
+* without loading it as a whole. The file is read in blocks and every
+* section is written in chunks of rows, such that the total memory 
+* is limited by <mem_budget> bytes instead of the file size.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_convert_binary(const char *mesh_path,
+                              const char *bin_path,
+                              size_t      mem_budget)
+{
+  PrimaryGridHeader header;
+  PrimaryGrid       chunk;
+  PrimaryGrid       counts;
+
+  FILE *in_fptr  = NULL;
+  FILE *out_fptr = NULL;
+  char *block    = NULL;
+  char *out_buf  = NULL;
+
+  uint64_t offsets[ICF_GRID_N_SECTIONS] = { 0 };
+  uint64_t file_end = sizeof(PrimaryGridHeader);
+  int      seen[SECTION_UNKNOWN] = { 0 };
+
+  int n_tri_nbrs  = -1;
+  int n_quad_nbrs = -1;
+  int line = 0;
+  int eof  = 0;
+  int i, k;
+
+  check( sizeof(int) == sizeof(int32_t), 
+      "Binary grid format requires 32-bit integers.");
+  check( mem_budget >= ICF_CONVERT_MIN_BUDGET, 
+      "Memory budget for mesh conversion must be at least %ld bytes.",
+      ICF_CONVERT_MIN_BUDGET);
+
+  /*--------------------------------------------------------------------
+  | One half of the budget is used for the input block and the other 
+  | half for the rows of the current output chunk. Every mesh section
+  | has at most 16 bytes of binary data per row.
+  --------------------------------------------------------------------*/
+  const size_t block_size = mem_budget / 2;
+  const size_t out_size   = mem_budget - block_size;
+  const int    chunk_rows = (int) MIN(out_size / 16, (size_t) INT_MAX);
+
+  block   = malloc(block_size + 1);
+  out_buf = malloc(out_size);
+  check_mem(block);
+  check_mem(out_buf);
+
+  in_fptr = fopen(mesh_path, "rb");
+  check(in_fptr, "Failed to open %s.", mesh_path);
+
+  out_fptr = fopen(bin_path, "wb");
+  check(out_fptr, "Failed to open %s.", bin_path);
+
+  memset(&counts, 0, sizeof(PrimaryGrid));
+
+  const char *pos    = block;
+  size_t      n_data = 0;
+
+  check( convert_fill_block(in_fptr, block, block_size, 
+                            &pos, &n_data, &eof),
+      "Failed to read %s.", mesh_path);
+
+  /*--------------------------------------------------------------------
+  | Walk through the file once and convert every section
+  --------------------------------------------------------------------*/
+  while ( 1 )
+  {
+    const char *end = convert_complete_end(block, n_data, eof);
+
+    if ( pos >= end )
+    {
+      if ( eof )
+        break;
+
+      check( convert_fill_block(in_fptr, block, block_size, 
+                                &pos, &n_data, &eof),
+          "Failed to read %s.", mesh_path);
+      continue;
+    }
+
+    ++line;
+
+    MeshSection section = stream_read_section(&pos);
+
+    if ( section == SECTION_UNKNOWN )
+    {
+      pos = stream_next_line(pos, end);
+      continue;
+    }
+
+    const char *sec_name = mesh_section_keys[section];
+    long n_rows = stream_read_count(&pos);
+
+    check( n_rows >= 0 && n_rows <= INT_MAX, 
+        "Invalid number of entries for %s in line %d.", sec_name, line);
+    check( !seen[section], 
+        "Section %s is defined twice in line %d.", sec_name, line);
+
+    seen[section] = 1;
+    pos = stream_next_line(pos, end);
+
+    switch ( section )
+    {
+      case SECTION_VERTICES:      counts.n_vertices   = n_rows; break;
+      case SECTION_TRIANGLES:     counts.n_tris       = n_rows; break;
+      case SECTION_QUADS:         counts.n_quads      = n_rows; break;
+      case SECTION_INTERIOREDGES: counts.n_intr_edges = n_rows; break;
+      case SECTION_BOUNDARYEDGES: counts.n_bdry_edges = n_rows; break;
+      case SECTION_TRIANGLENEIGHBORS: n_tri_nbrs      = n_rows; break;
+      case SECTION_QUADNEIGHBORS:     n_quad_nbrs     = n_rows; break;
+      default: break;
+    }
+
+    /*------------------------------------------------------------------
+    | Reserve the space of all associated binary sections and 
+    | partition the output buffer accordingly
+    ------------------------------------------------------------------*/
+    char *out_ptr[3];
+    size_t out_off = 0;
+
+    for ( k = 0; k < convert_n_out[section]; k++ )
+    {
+      const PrimaryGridSection s = convert_out[section][k];
+
+      file_end = ( file_end + ICF_GRID_ALIGNMENT - 1 ) 
+               / ICF_GRID_ALIGNMENT * ICF_GRID_ALIGNMENT;
+      offsets[s] = file_end;
+      file_end  += (uint64_t) n_rows * convert_row_size[s];
+
+      out_ptr[k] = out_buf + out_off;
+      out_off   += (size_t) chunk_rows * convert_row_size[s];
+    }
+
+    memset(&chunk, 0, sizeof(PrimaryGrid));
+    chunk.vertex_coords    = (double (*)[2]) out_ptr[0];
+    chunk.tris             = (int (*)[3]) out_ptr[0];
+    chunk.tri_neighbors    = (int (*)[3]) out_ptr[0];
+    chunk.quads            = (int (*)[4]) out_ptr[0];
+    chunk.quad_neighbors   = (int (*)[4]) out_ptr[0];
+    chunk.intr_edges       = (int (*)[2]) out_ptr[0];
+    chunk.intr_edge_nbrs   = (int (*)[2]) out_ptr[1];
+    chunk.bdry_edges       = (int (*)[2]) out_ptr[0];
+    chunk.bdry_edge_nbrs   = (int *) out_ptr[1];
+    chunk.bdry_edge_marker = (int *) out_ptr[2];
+
+    /*------------------------------------------------------------------
+    | Parse and write the section in chunks of complete lines
+    ------------------------------------------------------------------*/
+    long i_row = 0;
+
+    while ( i_row < n_rows )
+    {
+      end = convert_complete_end(block, n_data, eof);
+
+      const int   n_need = (int) MIN(n_rows - i_row, (long) chunk_rows);
+      const char *limit  = NumScan_skip_lines(pos, end, n_need);
+      int         n_avail = (int) NumScan_count_lines(pos, limit);
+
+      if ( eof && limit == end && limit > pos && limit[-1] != '\n' )
+        ++n_avail;
+
+      if ( n_avail < 1 )
+      {
+        check( !eof, "Unexpected end of file in section %s.", sec_name);
+        check( convert_fill_block(in_fptr, block, block_size, 
+                                  &pos, &n_data, &eof),
+            "Failed to read %s.", mesh_path);
+        continue;
+      }
+
+      const int n = MIN(n_avail, n_need);
+
+      check( stream_parse_rows(NULL, &pos, end, line + 1 + (int) i_row, 
+                               section, 0, n, &chunk),
+          "Failed to read section %s.", sec_name);
+
+      for ( k = 0; k < convert_n_out[section]; k++ )
+      {
+        const PrimaryGridSection s = convert_out[section][k];
+        const size_t scalar = ( s == ICF_GRID_VERTEX_COORDS ) 
+                            ? sizeof(double) : sizeof(int32_t);
+        const size_t n_vals = n * convert_row_size[s] / scalar;
+
+        PrimaryGrid_swap_to_le(out_ptr[k], n_vals, scalar);
+
+        check( fseek(out_fptr, (long) ( offsets[s] 
+                     + i_row * convert_row_size[s] ), SEEK_SET) == 0,
+            "Failed to write to %s.", bin_path);
+        check( fwrite(out_ptr[k], scalar, n_vals, out_fptr) == n_vals,
+            "Failed to write to %s.", bin_path);
+      }
+
+      i_row += n;
+    }
+
+    line += (int) n_rows;
+  }
+
+  /* The connectivity of lean grid files requires the whole grid    */
+  check( counts.n_intr_edges > 0, 
+      "Lean mesh file %s can not be converted out-of-core.", mesh_path);
+  check( stream_check_primgrid(&counts, n_tri_nbrs, n_quad_nbrs, 0, 1),
+      "Invalid mesh file %s.", mesh_path);
+
+  /*--------------------------------------------------------------------
+  | Write header with the actual section locations
+  --------------------------------------------------------------------*/
+  memset(&header, 0, sizeof(PrimaryGridHeader));
+
+  header.n_vertices   = counts.n_vertices;
+  header.n_tris       = counts.n_tris;
+  header.n_quads      = counts.n_quads;
+  header.n_intr_edges = counts.n_intr_edges;
+  header.n_bdry_edges = counts.n_bdry_edges;
+
+  PrimaryGrid_init_binary_header(&header, n_tri_nbrs > 0, 
+                                 n_quad_nbrs > 0);
+
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+    header.offsets[i] = header.sizes[i] > 0 ? offsets[i] : 0;
+
+  PrimaryGrid_swap_header_to_le(&header);
+
+  check( fseek(out_fptr, 0, SEEK_SET) == 0, 
+      "Failed to write to %s.", bin_path);
+  check( fwrite(&header, sizeof(PrimaryGridHeader), 1, out_fptr) == 1,
+      "Failed to write header to %s.", bin_path);
+
+  fclose(in_fptr);
+  in_fptr = NULL;
+
+  check( fclose(out_fptr) == 0, "Failed to write to %s.", bin_path);
+  out_fptr = NULL;
+
+  free(block);
+  free(out_buf);
+
+  return ICF_SUCCESS;
+
+error:
+  if ( in_fptr )
+    fclose(in_fptr);
+  if ( out_fptr )
+  {
+    fclose(out_fptr);
+    remove(bin_path);
+  }
+  free(block);
+  free(out_buf);
+  return ICF_ERROR;
+
+} /* MeshReader_convert_binary() */
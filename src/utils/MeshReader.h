@@ -13,6 +13,7 @@
 #include <stdlib.h>
 
 #include "bstrlib.h"
+#include "bstrlib_wrapper.h"
 #include "PrimaryGrid.h"
 
 #define ICF_FILE_IO_ERROR -1
@@ -28,11 +29,17 @@ typedef struct MeshReader {
   const char      *path;    /* Path of file                 */
   bstring          txt;     /* bstring with file data       */
   struct bstrList *txtlist; /* file, splitted for newlines  */
+  bstrIndex       *txtindex;/* keyword index of txtlist     */
+  char            *buffer;  /* raw file data (stream mode)  */
+  size_t           map_len; /* length of mapping (mmap mode)*/
 
   long             length;  /* Number of chars in total file*/
                             /* -> including '\0' at end     */
   int              nlines;  /* Number of lines in total file*/
 
+  int              lean;    /* Skip the connectivity        */
+                            /* -> see MeshReader_read_primgrid */
+
 } MeshReader;
 
 /***********************************************************************
@@ -40,17 +47,75 @@ typedef struct MeshReader {
 ***********************************************************************/
 MeshReader *MeshReader_create(const char *file_path);
 
+/***********************************************************************
+* Function to create a new mesh reader structure for the single-pass
+* streaming parser. The file data is only kept as raw char buffer, 
+* i.e. no bstring copy and no list of lines is created.
+***********************************************************************/
+MeshReader *MeshReader_create_stream(const char *file_path);
+
+/***********************************************************************
+* Function to create a new mesh reader structure for the single-pass
+* streaming parser, which maps the file into memory instead of 
+* copying it. The mapped pages are released again while parsing, 
+* such that the peak memory is dominated by the final primary grid.
+***********************************************************************/
+MeshReader *MeshReader_create_mmap(const char *file_path);
+
 /***********************************************************************
 * Function to destroy a mesh reader structure
 ***********************************************************************/
 int MeshReader_destroy(MeshReader *mesh_reader);
 
 /***********************************************************************
-* Function to read a primary grid structure from a given grid file 
+* Function to read a primary grid structure from a given grid file.
+*
+* The sections TRIANGLENEIGHBORS, QUADNEIGHBORS and INTERIOREDGES 
+* as well as the element column of BOUNDARYEDGES are derived data. 
+* Lean grid files omit them and define their boundary edges by rows 
+* "p0,p1,marker". For such files, or if <lean> is set for the mesh 
+* reader, these sections are skipped and the connectivity is 
+* rebuilt with PrimaryGrid_build_topology().
 ***********************************************************************/
 void MeshReader_read_primgrid(MeshReader  *mesh_reader, 
                               PrimaryGrid *prim_grid);
 
+/***********************************************************************
+* Function to read a primary grid structure from a given grid file 
+* in a single pass over the raw file buffer. Every section is 
+* dispatched directly into the primary grid arrays, without any 
+* allocations for single lines or values.
+* Lean grid files are handled as for MeshReader_read_primgrid().
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_stream_primgrid(MeshReader  *mesh_reader, 
+                               PrimaryGrid *prim_grid);
+
+/***********************************************************************
+* Function to read a primary grid structure from a given grid file 
+* with multiple threads. A table of contents of all sections is built 
+* first, afterwards all sections and chunks of large sections are 
+* parsed concurrently into the preallocated primary grid arrays.
+* The mesh reader must be created for streaming or memory mapping.
+* For n_threads < 1, the number of online processors is used.
+* Lean grid files are handled as for MeshReader_read_primgrid().
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_read_primgrid_parallel(MeshReader  *mesh_reader, 
+                                      PrimaryGrid *prim_grid,
+                                      int          n_threads);
+
+/***********************************************************************
+* Function to convert an ASCII grid file into the binary grid format 
+* without loading it as a whole. The file is read in blocks and every
+* section is written in chunks of rows, such that the total memory 
+* is limited by <mem_budget> bytes instead of the file size.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int MeshReader_convert_binary(const char *mesh_path,
+                              const char *bin_path,
+                              size_t      mem_budget);
+
 /***********************************************************************
 * Function to read the primary grid vertices from a grid file
 ***********************************************************************/
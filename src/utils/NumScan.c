@@ -0,0 +1,766 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "NumScan.h"
+
+/* Maximum number of significant digits for the fast double path    */
+#define NUMSCAN_MAX_DIGITS 19
+
+/* Largest integer, that is exactly representable as double         */
+#define NUMSCAN_MAX_MANTISSA ( (uint64_t) 1 << 53 )
+
+/* Exact powers of ten, that are representable as double            */
+static const double numscan_pow10[23] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+  1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+  1e22
+};
+
+/* Powers of ten for the digits of a word                            */
+static const uint64_t numscan_pow10_word[9] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 
+  10000000ULL, 100000000ULL
+};
+
+/* Byte masks for word-at-a-time scanning                            */
+#define NUMSCAN_BYTES(b) ( 0x0101010101010101ULL * (uint64_t) (b) )
+
+#if defined(__SIZEOF_INT128__)
+/* Range of decimal exponents, covered by the Eisel-Lemire path      */
+#define NUMSCAN_MIN_POW5 (-27)
+#define NUMSCAN_MAX_POW5 ( 55)
+
+/* 128-bit normalized powers of five (high word, low word). Negative */
+/* powers are rounded up, positive powers are exact.                 */
+static const uint64_t numscan_pow5[] = {
+  0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL, /* 5^-27 */
+  0xc612062576589ddaULL, 0x95364afe032a819eULL, /* 5^-26 */
+  0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL, /* 5^-25 */
+  0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, /* 5^-24 */
+  0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL, /* 5^-23 */
+  0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, /* 5^-22 */
+  0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL, /* 5^-21 */
+  0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, /* 5^-20 */
+  0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL, /* 5^-19 */
+  0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, /* 5^-18 */
+  0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL, /* 5^-17 */
+  0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, /* 5^-16 */
+  0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL, /* 5^-15 */
+  0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, /* 5^-14 */
+  0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL, /* 5^-13 */
+  0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, /* 5^-12 */
+  0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL, /* 5^-11 */
+  0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, /* 5^-10 */
+  0x89705f4136b4a597ULL, 0x31680a88f8953031ULL, /* 5^-9 */
+  0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, /* 5^-8 */
+  0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL, /* 5^-7 */
+  0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, /* 5^-6 */
+  0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL, /* 5^-5 */
+  0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, /* 5^-4 */
+  0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL, /* 5^-3 */
+  0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, /* 5^-2 */
+  0xccccccccccccccccULL, 0xcccccccccccccccdULL, /* 5^-1 */
+  0x8000000000000000ULL, 0x0000000000000000ULL, /* 5^0 */
+  0xa000000000000000ULL, 0x0000000000000000ULL, /* 5^1 */
+  0xc800000000000000ULL, 0x0000000000000000ULL, /* 5^2 */
+  0xfa00000000000000ULL, 0x0000000000000000ULL, /* 5^3 */
+  0x9c40000000000000ULL, 0x0000000000000000ULL, /* 5^4 */
+  0xc350000000000000ULL, 0x0000000000000000ULL, /* 5^5 */
+  0xf424000000000000ULL, 0x0000000000000000ULL, /* 5^6 */
+  0x9896800000000000ULL, 0x0000000000000000ULL, /* 5^7 */
+  0xbebc200000000000ULL, 0x0000000000000000ULL, /* 5^8 */
+  0xee6b280000000000ULL, 0x0000000000000000ULL, /* 5^9 */
+  0x9502f90000000000ULL, 0x0000000000000000ULL, /* 5^10 */
+  0xba43b74000000000ULL, 0x0000000000000000ULL, /* 5^11 */
+  0xe8d4a51000000000ULL, 0x0000000000000000ULL, /* 5^12 */
+  0x9184e72a00000000ULL, 0x0000000000000000ULL, /* 5^13 */
+  0xb5e620f480000000ULL, 0x0000000000000000ULL, /* 5^14 */
+  0xe35fa931a0000000ULL, 0x0000000000000000ULL, /* 5^15 */
+  0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, /* 5^16 */
+  0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL, /* 5^17 */
+  0xde0b6b3a76400000ULL, 0x0000000000000000ULL, /* 5^18 */
+  0x8ac7230489e80000ULL, 0x0000000000000000ULL, /* 5^19 */
+  0xad78ebc5ac620000ULL, 0x0000000000000000ULL, /* 5^20 */
+  0xd8d726b7177a8000ULL, 0x0000000000000000ULL, /* 5^21 */
+  0x878678326eac9000ULL, 0x0000000000000000ULL, /* 5^22 */
+  0xa968163f0a57b400ULL, 0x0000000000000000ULL, /* 5^23 */
+  0xd3c21bcecceda100ULL, 0x0000000000000000ULL, /* 5^24 */
+  0x84595161401484a0ULL, 0x0000000000000000ULL, /* 5^25 */
+  0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, /* 5^26 */
+  0xcecb8f27f4200f3aULL, 0x0000000000000000ULL, /* 5^27 */
+  0x813f3978f8940984ULL, 0x4000000000000000ULL, /* 5^28 */
+  0xa18f07d736b90be5ULL, 0x5000000000000000ULL, /* 5^29 */
+  0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, /* 5^30 */
+  0xfc6f7c4045812296ULL, 0x4d00000000000000ULL, /* 5^31 */
+  0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, /* 5^32 */
+  0xc5371912364ce305ULL, 0x6c28000000000000ULL, /* 5^33 */
+  0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, /* 5^34 */
+  0x9a130b963a6c115cULL, 0x3c7f400000000000ULL, /* 5^35 */
+  0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, /* 5^36 */
+  0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL, /* 5^37 */
+  0x96769950b50d88f4ULL, 0x1314448000000000ULL, /* 5^38 */
+  0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL, /* 5^39 */
+  0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, /* 5^40 */
+  0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL, /* 5^41 */
+  0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, /* 5^42 */
+  0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL, /* 5^43 */
+  0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, /* 5^44 */
+  0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL, /* 5^45 */
+  0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, /* 5^46 */
+  0x8c213d9da502de45ULL, 0x4526f422cc340000ULL, /* 5^47 */
+  0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, /* 5^48 */
+  0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL, /* 5^49 */
+  0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, /* 5^50 */
+  0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL, /* 5^51 */
+  0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, /* 5^52 */
+  0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL, /* 5^53 */
+  0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, /* 5^54 */
+  0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL, /* 5^55 */
+};
+#endif
+
+/***********************************************************************
+* Character classes
+***********************************************************************/
+static inline int numscan_is_digit(char c)
+{
+  return (unsigned) (c - '0') < 10u;
+}
+
+static inline int numscan_is_delim(char c)
+{
+  return c == ',' || c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline int numscan_is_end(const char *c, const char *end)
+{
+  return c >= end || *c == '\n' || numscan_is_delim(*c);
+}
+
+/***********************************************************************
+* Word-at-a-time scanning: Eight chars are loaded into a 64-bit word 
+* with the first char in the lowest byte, such that the length of a 
+* digit run, i.e. the location of the following delimiter, follows 
+* from the lowest nonzero byte of a mask.
+***********************************************************************/
+static inline uint64_t numscan_load_word(const char *c)
+{
+  uint64_t w;
+
+  memcpy(&w, c, sizeof(w));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+
+  return w;
+}
+
+/* Number of chars before the first nonzero byte of a mask          */
+static inline int numscan_word_run(uint64_t mask)
+{
+  return mask ? __builtin_ctzll(mask) / 8 : 8;
+}
+
+/* Mask of the bytes, which are no digits -> A digit has the upper 
+ * nibble 3, also after adding 6. A carry of this addition only 
+ * spoils the bytes behind a non-digit.                              */
+static inline uint64_t numscan_word_nondigits(uint64_t w)
+{
+  const uint64_t hi = NUMSCAN_BYTES(0xF0);
+
+  return ( ( w & hi ) ^ NUMSCAN_BYTES('0') )
+       | ( ( ( w + NUMSCAN_BYTES(6) ) & hi ) ^ NUMSCAN_BYTES('0') );
+}
+
+/* Value of the <n> leading digits of a word (1 <= n <= 8): The digits
+ * are moved to the upper bytes and combined pairwise in three steps */
+static inline uint64_t numscan_word_value(uint64_t w, int n)
+{
+  w <<= 8 * ( 8 - n );
+  w = ( ( w & NUMSCAN_BYTES(0x0F) ) * 2561 ) >> 8;
+  w = ( ( w & 0x00FF00FF00FF00FFULL ) * 6553601 ) >> 16;
+
+  return ( ( w & 0x0000FFFF0000FFFFULL ) * 42949672960001ULL ) >> 32;
+}
+
+/***********************************************************************
+* Adds the digits at <c> word by word to the mantissa <mant>, as long
+* as it holds at most NUMSCAN_MAX_DIGITS significant digits 
+* <n_digits>. Leading zeros are no significant digits. 
+* Returns the location behind the added digits and their number, 
+* including leading zeros, in <n_read>. The remaining digits are 
+* left to the char-wise loops.
+***********************************************************************/
+static inline const char *numscan_digit_words(const char *c, 
+                                              const char *end,
+                                              uint64_t   *mant,
+                                              int        *n_digits,
+                                              int        *n_read)
+{
+  *n_read = 0;
+
+  while ( end - c >= 8 )
+  {
+    const uint64_t w = numscan_load_word(c);
+    const int n = numscan_word_run(numscan_word_nondigits(w));
+
+    if ( n == 0 )
+      break;
+
+    int n_sig = n;
+
+    if ( *mant == 0 )
+      n_sig -= MIN( n, numscan_word_run(w ^ NUMSCAN_BYTES('0')) );
+
+    if ( *n_digits + n_sig > NUMSCAN_MAX_DIGITS )
+      break;
+
+    *mant      = *mant * numscan_pow10_word[n] + numscan_word_value(w, n);
+    *n_digits += n_sig;
+    *n_read   += n;
+    c         += n;
+
+    if ( n < 8 )
+      break;
+  }
+
+  return c;
+
+} /* numscan_digit_words() */
+
+/***********************************************************************
+* Returns the location of the next '\n' in [pos, end) or <end>
+***********************************************************************/
+const char *NumScan_find_eol(const char *pos, const char *end)
+{
+#if defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  while ( end - pos >= 16 )
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) pos);
+    int     mask  = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+
+    if ( mask )
+      return pos + __builtin_ctz(mask);
+
+    pos += 16;
+  }
+#endif
+
+  while ( pos < end && *pos != '\n' )
+    ++pos;
+
+  return pos;
+
+} /* NumScan_find_eol() */
+
+/***********************************************************************
+* Returns the location behind the <n_lines>-th '\n' in [pos, end) 
+* or <end>, if the range contains less lines
+***********************************************************************/
+const char *NumScan_skip_lines(const char *pos, const char *end,
+                               long n_lines)
+{
+  if ( n_lines < 1 )
+    return pos;
+
+#if defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  /*--------------------------------------------------------------------
+  | Count newlines in blocks of 16 chars, as long as the target 
+  | line is not located in the current block
+  --------------------------------------------------------------------*/
+  while ( end - pos >= 16 )
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) pos);
+    int     mask  = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+    int     n_nl  = __builtin_popcount(mask);
+
+    if ( n_nl >= n_lines )
+    {
+      /* Drop the first n_lines-1 newlines of this block           */
+      while ( --n_lines > 0 )
+        mask &= mask - 1;
+
+      return pos + __builtin_ctz(mask) + 1;
+    }
+
+    n_lines -= n_nl;
+    pos += 16;
+  }
+#endif
+
+  while ( pos < end )
+  {
+    if ( *pos++ == '\n' && --n_lines == 0 )
+      return pos;
+  }
+
+  return end;
+
+} /* NumScan_skip_lines() */
+
+/***********************************************************************
+* Returns the number of '\n' characters in [pos, end)
+***********************************************************************/
+long NumScan_count_lines(const char *pos, const char *end)
+{
+  long n_lines = 0;
+
+#if defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  while ( end - pos >= 16 )
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) pos);
+    n_lines += __builtin_popcount(
+                 _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)) );
+    pos += 16;
+  }
+#endif
+
+  for ( ; pos < end; pos++ )
+    n_lines += ( *pos == '\n' );
+
+  return n_lines;
+
+} /* NumScan_count_lines() */
+
+/***********************************************************************
+* Parses a single integer at <pos> and moves <pos> behind it.
+***********************************************************************/
+static inline int numscan_int(const char **pos, const char *end, 
+                              int *val)
+{
+  const char *c = *pos;
+  int64_t v = 0;
+  int neg = 0;
+
+  if ( c < end && ( *c == '-' || *c == '+' ) )
+  {
+    neg = ( *c == '-' );
+    ++c;
+  }
+
+  if ( c >= end || !numscan_is_digit(*c) )
+    return 0;
+
+  while ( end - c >= 8 )
+  {
+    const uint64_t w = numscan_load_word(c);
+    const int n = numscan_word_run(numscan_word_nondigits(w));
+
+    if ( n == 0 )
+      break;
+
+    v  = v * (int64_t) numscan_pow10_word[n] 
+       + (int64_t) numscan_word_value(w, n);
+    c += n;
+
+    if ( v > (int64_t) INT_MAX + 1 )
+      return 0;
+
+    if ( n < 8 )
+      break;
+  }
+
+  while ( c < end && numscan_is_digit(*c) )
+  {
+    v = 10 * v + (*c - '0');
+
+    if ( v > (int64_t) INT_MAX + 1 )
+      return 0;
+
+    ++c;
+  }
+
+  if ( !numscan_is_end(c, end) )
+    return 0;
+
+  v = neg ? -v : v;
+
+  if ( v > INT_MAX || v < INT_MIN )
+    return 0;
+
+  *val = (int) v;
+  *pos = c;
+
+  return 1;
+
+} /* numscan_int() */
+
+/***********************************************************************
+* Fallback for doubles, which can not be handled by the fast path.
+* strtod() is correctly rounded, but requires a terminated string.
+***********************************************************************/
+static int numscan_double_slow(const char **pos, const char *end,
+                               const char *tok_end, double *val)
+{
+  char buffer[128];
+  char *stop;
+  size_t len = (size_t) (tok_end - *pos);
+
+  if ( len >= sizeof(buffer) )
+    return 0;
+
+  memcpy(buffer, *pos, len);
+  buffer[len] = '\0';
+
+  *val = strtod(buffer, &stop);
+
+  if ( stop != buffer + len )
+    return 0;
+
+  *pos = tok_end;
+
+  return 1;
+
+} /* numscan_double_slow() */
+
+/***********************************************************************
+* Computes the correctly rounded double w * 10^q for a mantissa with 
+* at most 19 digits, following the algorithm by Eisel and Lemire 
+* ("Number Parsing at a Gigabyte per Second", 2021).
+* Returns 0 if the result can not be determined safely, such that 
+* the caller has to fall back to strtod().
+***********************************************************************/
+static inline int numscan_eisel_lemire(uint64_t w, int q, int neg, 
+                                       double *val)
+{
+#if defined(__SIZEOF_INT128__)
+  if ( w == 0 || q < NUMSCAN_MIN_POW5 || q > NUMSCAN_MAX_POW5 )
+    return 0;
+
+  const uint64_t *pow5 = &numscan_pow5[2 * (q - NUMSCAN_MIN_POW5)];
+
+  int64_t exponent = ( ( (152170 + 65536) * (int64_t) q ) >> 16 ) 
+                   + 1024 + 63;
+
+  int lz = __builtin_clzll(w);
+  w <<= lz;
+
+  /*--------------------------------------------------------------------
+  | Product with the high word of the power of five. If the lower
+  | bits are all set, the result might be affected by a carry from
+  | the product with the low word.
+  --------------------------------------------------------------------*/
+  __uint128_t prod = (__uint128_t) w * pow5[0];
+  uint64_t upper = (uint64_t) (prod >> 64);
+  uint64_t lower = (uint64_t) prod;
+
+  if ( ( upper & 0x1FF ) == 0x1FF )
+  {
+    __uint128_t prod_lo = (__uint128_t) w * pow5[1];
+    uint64_t    carry   = (uint64_t) (prod_lo >> 64);
+
+    lower += carry;
+    if ( carry > lower )
+      ++upper;
+
+    if ( ( upper & 0x1FF ) == 0x1FF && lower == UINT64_MAX )
+      return 0;
+  }
+
+  uint64_t upperbit = upper >> 63;
+  uint64_t mantissa = upper >> (upperbit + 9);
+  lz += (int) (1 ^ upperbit);
+
+  /* Possible halfway case -> round-to-even is not decidable here    */
+  if ( lower == 0 && ( upper & 0x1FF ) == 0 && ( mantissa & 3 ) == 1 )
+    return 0;
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+
+  if ( mantissa >= ( (uint64_t) 1 << 53 ) )
+  {
+    mantissa = (uint64_t) 1 << 52;
+    --lz;
+  }
+
+  mantissa &= ~( (uint64_t) 1 << 52 );
+
+  int64_t real_exponent = exponent - lz;
+
+  /* Subnormals and overflow are left to strtod()                    */
+  if ( real_exponent < 1 || real_exponent > 2046 )
+    return 0;
+
+  uint64_t bits = mantissa 
+                | ( (uint64_t) real_exponent << 52 )
+                | ( (uint64_t) neg << 63 );
+
+  memcpy(val, &bits, sizeof(double));
+
+  return 1;
+#else
+  return 0;
+#endif
+
+} /* numscan_eisel_lemire() */
+
+/***********************************************************************
+* Parses a single double at <pos> and moves <pos> behind it.
+*
+* Values with a mantissa below 2^53 and a decimal exponent within 
+* [-22,22] are exactly representable as mantissa and power of ten, 
+* such that a single multiplication or division yields the correctly
+* rounded result (Clinger's fast path). Other values with at most 19 
+* significant digits are handled by the Eisel-Lemire algorithm. 
+* Everything else is passed to strtod().
+***********************************************************************/
+static inline int numscan_double(const char **pos, const char *end, 
+                                 double *val)
+{
+  const char *start = *pos;
+  const char *c     = start;
+
+  uint64_t mant     = 0;
+  int      n_digits = 0;
+  int      exp10    = 0;
+  int      neg      = 0;
+  int      any      = 0;
+  int      n_read;
+
+  if ( c < end && ( *c == '-' || *c == '+' ) )
+  {
+    neg = ( *c == '-' );
+    ++c;
+  }
+
+  /*--------------------------------------------------------------------
+  | Integer part
+  --------------------------------------------------------------------*/
+  c   = numscan_digit_words(c, end, &mant, &n_digits, &n_read);
+  any = ( n_read > 0 );
+
+  for ( ; c < end && numscan_is_digit(*c); c++ )
+  {
+    any = 1;
+
+    if ( mant == 0 && *c == '0' )
+      continue;
+
+    if ( n_digits < NUMSCAN_MAX_DIGITS )
+      mant = 10 * mant + (uint64_t) (*c - '0');
+    else
+      ++exp10;
+
+    ++n_digits;
+  }
+
+  /*--------------------------------------------------------------------
+  | Fractional part
+  --------------------------------------------------------------------*/
+  if ( c < end && *c == '.' )
+  {
+    c      = numscan_digit_words(c + 1, end, &mant, &n_digits, &n_read);
+    any   |= ( n_read > 0 );
+    exp10 -= n_read;
+
+    for ( ; c < end && numscan_is_digit(*c); c++ )
+    {
+      any = 1;
+
+      if ( mant == 0 && *c == '0' )
+      {
+        --exp10;
+        continue;
+      }
+
+      if ( n_digits < NUMSCAN_MAX_DIGITS )
+      {
+        mant = 10 * mant + (uint64_t) (*c - '0');
+        --exp10;
+      }
+
+      ++n_digits;
+    }
+  }
+
+  if ( !any )
+    return 0;
+
+  /*--------------------------------------------------------------------
+  | Exponent
+  --------------------------------------------------------------------*/
+  if ( c < end && ( *c == 'e' || *c == 'E' ) )
+  {
+    int e = 0;
+    int e_neg = 0;
+
+    ++c;
+
+    if ( c < end && ( *c == '-' || *c == '+' ) )
+    {
+      e_neg = ( *c == '-' );
+      ++c;
+    }
+
+    if ( c >= end || !numscan_is_digit(*c) )
+      return 0;
+
+    for ( ; c < end && numscan_is_digit(*c); c++ )
+      if ( e < 100000 )
+        e = 10 * e + (*c - '0');
+
+    exp10 += e_neg ? -e : e;
+  }
+
+  if ( !numscan_is_end(c, end) )
+    return 0;
+
+  /*--------------------------------------------------------------------
+  | Remove trailing zeros of the mantissa, e.g. for "1.000000"
+  --------------------------------------------------------------------*/
+  if ( n_digits <= NUMSCAN_MAX_DIGITS )
+  {
+    while ( mant > NUMSCAN_MAX_MANTISSA && mant % 10 == 0 )
+    {
+      mant /= 10;
+      ++exp10;
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Fast path or fallback to strtod()
+  --------------------------------------------------------------------*/
+  if ( n_digits > NUMSCAN_MAX_DIGITS 
+       || mant > NUMSCAN_MAX_MANTISSA 
+       || exp10 < -22 || exp10 > 22 )
+  {
+    if ( mant == 0 )
+    {
+      *val = neg ? -0.0 : 0.0;
+      *pos = c;
+      return 1;
+    }
+
+    if ( n_digits <= NUMSCAN_MAX_DIGITS 
+         && numscan_eisel_lemire(mant, exp10, neg, val) )
+    {
+      *pos = c;
+      return 1;
+    }
+
+    return numscan_double_slow(pos, end, c, val);
+  }
+
+  double v = (double) mant;
+
+  if ( exp10 < 0 )
+    v /= numscan_pow10[-exp10];
+  else
+    v *= numscan_pow10[exp10];
+
+  *val = neg ? -v : v;
+  *pos = c;
+
+  return 1;
+
+} /* numscan_double() */
+
+/***********************************************************************
+* Parses a single integer / double at <pos> and moves <pos> behind it.
+* The value must be followed by a delimiter, '\n' or <end>.
+* Returns ICF_SUCCESS or ICF_ERROR for malformed values.
+***********************************************************************/
+int NumScan_int(const char **pos, const char *end, int *val)
+{
+  return numscan_int(pos, end, val);
+}
+
+int NumScan_double(const char **pos, const char *end, double *val)
+{
+  return numscan_double(pos, end, val);
+}
+
+/***********************************************************************
+* Parses a row of up to <n_vals> integers into <vals> and moves <pos> 
+* to the beginning of the next row.
+* Returns the number of values in the row or -1 if the row contains 
+* malformed values or more than <n_vals> values.
+***********************************************************************/
+int NumScan_row_ints(const char **pos, const char *end,
+                     int *vals, int n_vals)
+{
+  const char *c = *pos;
+  int n = 0;
+
+  for ( ;; )
+  {
+    while ( c < end && numscan_is_delim(*c) )
+      ++c;
+
+    if ( c >= end || *c == '\n' )
+      break;
+
+    if ( n == n_vals || !numscan_int(&c, end, &vals[n]) )
+    {
+      *pos = NumScan_skip_lines(c, end, 1);
+      return -1;
+    }
+
+    ++n;
+  }
+
+  *pos = ( c < end ) ? c + 1 : end;
+
+  return n;
+
+} /* NumScan_row_ints() */
+
+/***********************************************************************
+* Parses a row of up to <n_vals> doubles into <vals> and moves <pos> 
+* to the beginning of the next row.
+* Returns the number of values in the row or -1 if the row contains 
+* malformed values or more than <n_vals> values.
+***********************************************************************/
+int NumScan_row_doubles(const char **pos, const char *end,
+                        double *vals, int n_vals)
+{
+  const char *c = *pos;
+  int n = 0;
+
+  for ( ;; )
+  {
+    while ( c < end && numscan_is_delim(*c) )
+      ++c;
+
+    if ( c >= end || *c == '\n' )
+      break;
+
+    if ( n == n_vals || !numscan_double(&c, end, &vals[n]) )
+    {
+      *pos = NumScan_skip_lines(c, end, 1);
+      return -1;
+    }
+
+    ++n;
+  }
+
+  *pos = ( c < end ) ? c + 1 : end;
+
+  return n;
+
+} /* NumScan_row_doubles() */
@@ -0,0 +1,59 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef NUMSCAN_H
+#define NUMSCAN_H
+
+/***********************************************************************
+* Numeric scanning of ASCII rows
+*
+* All functions work in place on a character range [pos, end), which
+* must be readable up to <end>. Values within a row are separated by 
+* commas, blanks, tabs or carriage returns, rows are terminated by 
+* '\n' or <end>. In contrast to atof() / strtod(), the parsers do not 
+* depend on the current locale.
+***********************************************************************/
+
+/***********************************************************************
+* Returns the location of the next '\n' in [pos, end) or <end>
+***********************************************************************/
+const char *NumScan_find_eol(const char *pos, const char *end);
+
+/***********************************************************************
+* Returns the location behind the <n_lines>-th '\n' in [pos, end) 
+* or <end>, if the range contains less lines
+***********************************************************************/
+const char *NumScan_skip_lines(const char *pos, const char *end,
+                               long n_lines);
+
+/***********************************************************************
+* Returns the number of '\n' characters in [pos, end)
+***********************************************************************/
+long NumScan_count_lines(const char *pos, const char *end);
+
+/***********************************************************************
+* Parses a single integer / double at <pos> and moves <pos> behind it.
+* The value must be followed by a delimiter, '\n' or <end>.
+* Returns ICF_SUCCESS or ICF_ERROR for malformed values.
+***********************************************************************/
+int NumScan_int(const char **pos, const char *end, int *val);
+
+int NumScan_double(const char **pos, const char *end, double *val);
+
+/***********************************************************************
+* Parses a row of up to <n_vals> integers / doubles into <vals> and 
+* moves <pos> to the beginning of the next row.
+* Returns the number of values in the row or -1 if the row contains 
+* malformed values or more than <n_vals> values.
+***********************************************************************/
+int NumScan_row_ints(const char **pos, const char *end,
+                     int *vals, int n_vals);
+
+int NumScan_row_doubles(const char **pos, const char *end,
+                        double *vals, int n_vals);
+
+#endif /* NUMSCAN_H */
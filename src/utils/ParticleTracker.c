@@ -0,0 +1,834 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "PrimaryGrid.h"
+#include "DualGrid.h"
+#include "SpatialIndex.h"
+#include "ParticleTracker.h"
+
+/***********************************************************************
+* Boundary edge with its vertices in ascending order and its marker
+***********************************************************************/
+typedef struct ParticleBdryEdge
+{
+  int lo;
+  int hi;
+  int marker;
+
+} ParticleBdryEdge;
+
+static int cmp_bdry_edges(const void *a, const void *b)
+{
+  const ParticleBdryEdge *ea = a;
+  const ParticleBdryEdge *eb = b;
+
+  if ( ea->lo != eb->lo )
+    return ( ea->lo < eb->lo ) ? -1 : 1;
+  if ( ea->hi != eb->hi )
+    return ( ea->hi < eb->hi ) ? -1 : 1;
+  return 0;
+
+} /* cmp_bdry_edges() */
+
+/***********************************************************************
+* Context of the thread pool tasks of a particle step
+***********************************************************************/
+typedef struct ParticleStepCtx
+{
+  ParticleTracker *tracker;
+  const double    *u_field;
+  const double    *v_field;
+  const double    *field;
+  double          *values;
+  double           dt;
+
+  /* Number of exited and deposited particles of every task */
+  int             *n_exited;
+  int             *n_deposited;
+
+} ParticleStepCtx;
+
+/***********************************************************************
+* Function to free the particle arrays of a particle tracker
+***********************************************************************/
+static void particle_free_arrays(ParticleTracker *tracker)
+{
+  free( tracker->x );
+  free( tracker->y );
+  free( tracker->u );
+  free( tracker->v );
+  free( tracker->elem );
+  free( tracker->id );
+  free( tracker->state );
+
+  tracker->x     = NULL;
+  tracker->y     = NULL;
+  tracker->u     = NULL;
+  tracker->v     = NULL;
+  tracker->elem  = NULL;
+  tracker->id    = NULL;
+  tracker->state = NULL;
+
+  tracker->n_particles = 0;
+  tracker->capacity    = 0;
+  tracker->n_inactive  = 0;
+
+} /* particle_free_arrays() */
+
+/***********************************************************************
+* Function to resize the particle arrays to <capacity> particles
+***********************************************************************/
+static int particle_reserve(ParticleTracker *tracker, int capacity)
+{
+  void *p;
+
+#define PARTICLE_REALLOC(arr)                                          \
+  p = realloc(tracker->arr, (size_t) capacity * sizeof(*tracker->arr)); \
+  check_mem(p);                                                         \
+  tracker->arr = p;
+
+  PARTICLE_REALLOC(x);
+  PARTICLE_REALLOC(y);
+  PARTICLE_REALLOC(u);
+  PARTICLE_REALLOC(v);
+  PARTICLE_REALLOC(elem);
+  PARTICLE_REALLOC(id);
+  PARTICLE_REALLOC(state);
+
+#undef PARTICLE_REALLOC
+
+  tracker->capacity = capacity;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* particle_reserve() */
+
+/***********************************************************************
+* Returns the key of the local edge <loc> of element <elem>, i.e. the
+* position of the edge in the layout of the element store
+***********************************************************************/
+static inline int particle_edge_key(const PrimaryGrid *primgrid,
+                                    int elem, int loc)
+{
+  const int n_quads = primgrid->n_quads;
+
+  if ( elem < n_quads )
+    return 4 * elem + loc;
+
+  if ( elem < n_quads + primgrid->n_tris )
+    return 4 * n_quads + 3 * ( elem - n_quads ) + loc;
+
+  return primgrid->elem_ptr[elem] + loc;
+
+} /* particle_edge_key() */
+
+/***********************************************************************
+* Returns the boundary type of the local edge <loc> of element <elem>
+***********************************************************************/
+static BoundaryType particle_bdry_type(const ParticleTracker *tracker,
+                                       int elem, int loc)
+{
+  const int key = particle_edge_key(tracker->primgrid, elem, loc);
+  int lo = 0;
+  int hi = tracker->n_bdry - 1;
+
+  while ( lo <= hi )
+  {
+    const int mid = ( lo + hi ) / 2;
+
+    if ( tracker->bdry_keys[mid] == key )
+      return tracker->bdry_types[mid];
+
+    if ( tracker->bdry_keys[mid] < key )
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+
+  return OUTLET;
+
+} /* particle_bdry_type() */
+
+/***********************************************************************
+* Computes the linear interpolation weights <w> of the vertices <vi>
+* for the point (x,y) in element <elem>. Quads and polygons are split
+* into the fan of triangles (0,j,j+1) of their first vertex, e.g. 
+* (0,1,2) and (0,2,3) for quads.
+***********************************************************************/
+static inline void particle_weights(const PrimaryGrid *primgrid,
+                                    int elem, double x, double y,
+                                    int *vi, double *w)
+{
+  const double (*coords)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  const int *verts   = ICF_ELEM_VERTS(primgrid, elem);
+  const int  n_verts = ICF_ELEM_N_VERTS(primgrid, elem);
+  int j = 1;
+
+  /* The point lies in the first fan triangle, for which it is on the
+   * side of vertex j of the diagonal (0,j+1)                         */
+  while ( j < n_verts - 2 )
+  {
+    const double *a = coords[verts[0]];
+    const double *b = coords[verts[j]];
+    const double *c = coords[verts[j+1]];
+
+    const double s_p = ( c[0] - a[0] ) * ( y    - a[1] ) 
+                     - ( c[1] - a[1] ) * ( x    - a[0] );
+    const double s_d = ( c[0] - a[0] ) * ( b[1] - a[1] ) 
+                     - ( c[1] - a[1] ) * ( b[0] - a[0] );
+
+    if ( s_p * s_d >= 0.0 )
+      break;
+
+    ++j;
+  }
+
+  vi[0] = verts[0];
+  vi[1] = verts[j];
+  vi[2] = verts[j+1];
+
+  const double *a = coords[vi[0]];
+  const double *b = coords[vi[1]];
+  const double *c = coords[vi[2]];
+
+  const double det = ( b[1] - c[1] ) * ( a[0] - c[0] ) 
+                   + ( c[0] - b[0] ) * ( a[1] - c[1] );
+
+  w[0] = ( ( b[1] - c[1] ) * ( x - c[0] ) 
+         + ( c[0] - b[0] ) * ( y - c[1] ) ) / det;
+  w[1] = ( ( c[1] - a[1] ) * ( x - c[0] ) 
+         + ( a[0] - c[0] ) * ( y - c[1] ) ) / det;
+  w[2] = 1.0 - w[0] - w[1];
+
+} /* particle_weights() */
+
+/***********************************************************************
+* Moves a particle from its position to (x1,y1) by walking along the
+* displacement through the element neighbors, starting at its host 
+* element. At boundary edges, the particle is reflected, deposited or
+* exits the grid. Returns the new particle state.
+***********************************************************************/
+static ParticleState particle_move(const ParticleTracker *tracker, 
+                                   int p, double x1, double y1)
+{
+  const PrimaryGrid *primgrid = tracker->primgrid;
+  const double (*coords)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  const double e = tracker->restitution;
+
+  double x0   = tracker->x[p];
+  double y0   = tracker->y[p];
+  int    elem = tracker->elem[p];
+  int    step, k;
+
+  for ( step = 0; step < ICF_WALK_MAX_STEPS; step++ )
+  {
+    const int  n_verts = ICF_ELEM_N_VERTS(primgrid, elem);
+    const int *verts   = ICF_ELEM_VERTS(primgrid, elem);
+    double area   = 0.0;
+    double t_exit = 2.0;
+    int    k_exit = -1;
+
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const double *a = coords[verts[k]];
+      const double *b = coords[verts[ k+1 < n_verts ? k+1 : 0 ]];
+      area += a[0] * b[1] - b[0] * a[1];
+    }
+
+    const double s = ( area < 0.0 ) ? -1.0 : 1.0;
+
+    /*------------------------------------------------------------------
+    | The displacement leaves the element through the first edge, 
+    | beyond which its end point lies
+    ------------------------------------------------------------------*/
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const double *a = coords[verts[k]];
+      const double *b = coords[verts[ k+1 < n_verts ? k+1 : 0 ]];
+
+      const double ex = b[0] - a[0];
+      const double ey = b[1] - a[1];
+      const double c1 = s * ( ex * ( y1 - a[1] ) - ey * ( x1 - a[0] ) );
+
+      if ( c1 >= -ICF_SPATIAL_TOL * ( ex*ex + ey*ey ) )
+        continue;
+
+      const double c0 = s * ( ex * ( y0 - a[1] ) - ey * ( x0 - a[0] ) );
+      const double t  = ( c0 > 0.0 ) ? c0 / ( c0 - c1 ) : 0.0;
+
+      if ( t < t_exit )
+      {
+        t_exit = t;
+        k_exit = k;
+      }
+    }
+
+    if ( k_exit < 0 )
+    {
+      tracker->x[p]    = x1;
+      tracker->y[p]    = y1;
+      tracker->elem[p] = elem;
+      return ICF_PARTICLE_ACTIVE;
+    }
+
+    /* Continue from the exit point in the next element               */
+    x0 += t_exit * ( x1 - x0 );
+    y0 += t_exit * ( y1 - y0 );
+
+    const int nbr = ICF_ELEM_NBRS(primgrid, elem)[k_exit];
+
+    if ( nbr >= 0 )
+    {
+      elem = nbr;
+      continue;
+    }
+
+    /*------------------------------------------------------------------
+    | Boundary interaction
+    ------------------------------------------------------------------*/
+    const BoundaryType type = particle_bdry_type(tracker, elem, k_exit);
+
+    tracker->x[p]    = x0;
+    tracker->y[p]    = y0;
+    tracker->elem[p] = elem;
+
+    if ( type != WALL && type != SYMMETRY )
+      return ICF_PARTICLE_EXITED;
+
+    if ( type == WALL && tracker->deposit )
+    {
+      tracker->u[p] = 0.0;
+      tracker->v[p] = 0.0;
+      return ICF_PARTICLE_DEPOSITED;
+    }
+
+    /* Reflect the remaining displacement and the velocity at the 
+     * edge with the outward unit normal (nx, ny)                     */
+    const double *a  = coords[verts[k_exit]];
+    const double *b  = coords[verts[ k_exit+1 < n_verts ? k_exit+1 : 0 ]];
+    const double len = sqrt( SQR(b[0] - a[0]) + SQR(b[1] - a[1]) );
+    const double nx  =  s * ( b[1] - a[1] ) / len;
+    const double ny  = -s * ( b[0] - a[0] ) / len;
+
+    const double dn = ( x1 - x0 ) * nx + ( y1 - y0 ) * ny;
+    const double un = tracker->u[p] * nx + tracker->v[p] * ny;
+
+    x1 -= ( 1.0 + e ) * dn * nx;
+    y1 -= ( 1.0 + e ) * dn * ny;
+
+    if ( un > 0.0 )
+    {
+      tracker->u[p] -= ( 1.0 + e ) * un * nx;
+      tracker->v[p] -= ( 1.0 + e ) * un * ny;
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | The walk did not terminate -> Locate the end point globally
+  --------------------------------------------------------------------*/
+  elem = SpatialIndex_locate(tracker->index, x1, y1);
+
+  if ( elem < 0 )
+    return ICF_PARTICLE_EXITED;
+
+  tracker->x[p]    = x1;
+  tracker->y[p]    = y1;
+  tracker->elem[p] = elem;
+
+  return ICF_PARTICLE_ACTIVE;
+
+} /* particle_move() */
+
+/***********************************************************************
+* Interpolates the vertex fields <f> and <g> (if not NULL) to the 
+* particles begin ... end-1. The weights are gathered first, such 
+* that the interpolation loop can be vectorized.
+***********************************************************************/
+static void particle_interpolate_batch(const ParticleTracker *tracker,
+                                       int begin, int end,
+                                       const double *f, double *f_p,
+                                       const double *g, double *g_p)
+{
+  int    vi[ICF_PARTICLE_BATCH][3];
+  double w[ICF_PARTICLE_BATCH][3];
+  int i;
+
+  for ( i = begin; i < end; i++ )
+  {
+    if ( tracker->state[i] == ICF_PARTICLE_ACTIVE )
+    {
+      particle_weights(tracker->primgrid, tracker->elem[i], 
+                       tracker->x[i], tracker->y[i], 
+                       vi[i-begin], w[i-begin]);
+    }
+    else
+    {
+      vi[i-begin][0] = vi[i-begin][1] = vi[i-begin][2] = 0;
+      w[i-begin][0]  = w[i-begin][1]  = w[i-begin][2]  = 0.0;
+    }
+  }
+
+  for ( i = 0; i < end - begin; i++ )
+    f_p[i] = w[i][0] * f[vi[i][0]] 
+           + w[i][1] * f[vi[i][1]] 
+           + w[i][2] * f[vi[i][2]];
+
+  if ( !g )
+    return;
+
+  for ( i = 0; i < end - begin; i++ )
+    g_p[i] = w[i][0] * g[vi[i][0]] 
+           + w[i][1] * g[vi[i][1]] 
+           + w[i][2] * g[vi[i][2]];
+
+} /* particle_interpolate_batch() */
+
+/***********************************************************************
+* Thread pool task: Advances the particles of one batch
+***********************************************************************/
+static void particle_step_task(void *ctx, int i_task, int i_thread)
+{
+  ParticleStepCtx *sctx    = ctx;
+  ParticleTracker *tracker = sctx->tracker;
+  const double     dt      = sctx->dt;
+  const int        begin   = i_task * ICF_PARTICLE_BATCH;
+  const int        end     = MIN(begin + ICF_PARTICLE_BATCH, 
+                                 tracker->n_particles);
+  const double     relax   = ( tracker->tau > 0.0 ) 
+                           ? exp( -dt / tracker->tau ) : 0.0;
+
+  double u_f[ICF_PARTICLE_BATCH];
+  double v_f[ICF_PARTICLE_BATCH];
+  int i;
+
+  particle_interpolate_batch(tracker, begin, end, 
+                             sctx->u_field, u_f, sctx->v_field, v_f);
+
+  sctx->n_exited[i_task]    = 0;
+  sctx->n_deposited[i_task] = 0;
+
+  for ( i = begin; i < end; i++ )
+  {
+    if ( tracker->state[i] != ICF_PARTICLE_ACTIVE )
+      continue;
+
+    /* Exact relaxation towards the fluid velocity over the step     */
+    tracker->u[i] = u_f[i-begin] + ( tracker->u[i] - u_f[i-begin] ) * relax;
+    tracker->v[i] = v_f[i-begin] + ( tracker->v[i] - v_f[i-begin] ) * relax;
+
+    const ParticleState state = particle_move(tracker, i,
+                                              tracker->x[i] + dt * tracker->u[i],
+                                              tracker->y[i] + dt * tracker->v[i]);
+
+    tracker->state[i] = (unsigned char) state;
+
+    if ( state == ICF_PARTICLE_EXITED )
+      ++sctx->n_exited[i_task];
+    else if ( state == ICF_PARTICLE_DEPOSITED )
+      ++sctx->n_deposited[i_task];
+  }
+
+} /* particle_step_task() */
+
+/***********************************************************************
+* Thread pool task: Interpolates a field to the particles of one batch
+***********************************************************************/
+static void particle_interpolate_task(void *ctx, int i_task, int i_thread)
+{
+  ParticleStepCtx *sctx  = ctx;
+  const int        begin = i_task * ICF_PARTICLE_BATCH;
+  const int        end   = MIN(begin + ICF_PARTICLE_BATCH, 
+                               sctx->tracker->n_particles);
+
+  particle_interpolate_batch(sctx->tracker, begin, end, sctx->field, 
+                             sctx->values + begin, NULL, NULL);
+
+} /* particle_interpolate_task() */
+
+/***********************************************************************
+* Runs <n_tasks> tasks on the thread pool or on the calling thread
+***********************************************************************/
+static void particle_run(ThreadPool *pool, int n_tasks, 
+                         ThreadPoolTask *task, void *ctx)
+{
+  int i;
+
+  if ( pool )
+  {
+    ThreadPool_run(pool, n_tasks, task, ctx);
+    return;
+  }
+
+  for ( i = 0; i < n_tasks; i++ )
+    task(ctx, i, 0);
+
+} /* particle_run() */
+
+/***********************************************************************
+* Function to create and initialize a new particle tracker structure
+***********************************************************************/
+ParticleTracker *ParticleTracker_create()
+{
+  ParticleTracker *tracker = calloc(1, sizeof(ParticleTracker));
+  check_mem(tracker);
+
+  tracker->restitution = 1.0;
+
+  return tracker;
+error:
+  return NULL;
+
+} /* ParticleTracker_create() */
+
+/***********************************************************************
+* Function to destroy a particle tracker structure
+***********************************************************************/
+void ParticleTracker_destroy(ParticleTracker *tracker)
+{
+  if ( tracker->index )
+    SpatialIndex_destroy( tracker->index );
+
+  free( tracker->bdry_keys );
+  free( tracker->bdry_types );
+
+  particle_free_arrays( tracker );
+
+  free( tracker );
+
+} /* ParticleTracker_destroy() */
+
+/***********************************************************************
+* Function to set up a particle tracker for a primary grid
+***********************************************************************/
+int ParticleTracker_init(ParticleTracker   *tracker,
+                         const PrimaryGrid *primgrid,
+                         const BoundaryDef *bdry_def)
+{
+  const int n_elems = primgrid->n_quads + primgrid->n_tris 
+                    + primgrid->n_polys;
+  ParticleBdryEdge *edges = NULL;
+  int i, j, k, pass;
+
+  check( ( primgrid->n_quads == 0 || primgrid->quad_neighbors )
+      && ( primgrid->n_tris  == 0 || primgrid->tri_neighbors  )
+      && ( primgrid->n_polys == 0 || primgrid->elem_nbrs      ),
+      "Particle tracking requires the element neighbors." );
+
+  particle_free_arrays( tracker );
+  free( tracker->bdry_keys );
+  free( tracker->bdry_types );
+  tracker->bdry_keys  = NULL;
+  tracker->bdry_types = NULL;
+  tracker->n_bdry     = 0;
+
+  tracker->primgrid = primgrid;
+
+  if ( !tracker->index )
+    tracker->index = SpatialIndex_create();
+
+  check_mem(tracker->index);
+  check( SpatialIndex_build(tracker->index, primgrid),
+      "Failed to build the spatial index." );
+
+  /*--------------------------------------------------------------------
+  | Match the element edges without neighbor with the boundary edges
+  --------------------------------------------------------------------*/
+  edges = malloc(( (size_t) primgrid->n_bdry_edges + 1 ) 
+                 * sizeof(ParticleBdryEdge));
+  check_mem(edges);
+
+  for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+  {
+    edges[i].lo     = MIN(primgrid->bdry_edges[i][0], 
+                          primgrid->bdry_edges[i][1]);
+    edges[i].hi     = MAX(primgrid->bdry_edges[i][0], 
+                          primgrid->bdry_edges[i][1]);
+    edges[i].marker = primgrid->bdry_edge_marker[i];
+  }
+
+  qsort(edges, primgrid->n_bdry_edges, sizeof(ParticleBdryEdge), 
+        cmp_bdry_edges);
+
+  for ( pass = 0; pass < 2; pass++ )
+  {
+    if ( pass == 1 )
+    {
+      tracker->bdry_keys  = malloc(( tracker->n_bdry + 1 ) * sizeof(int));
+      tracker->bdry_types = malloc(( tracker->n_bdry + 1 ) 
+                                   * sizeof(BoundaryType));
+      check_mem(tracker->bdry_keys);
+      check_mem(tracker->bdry_types);
+
+      tracker->n_bdry = 0;
+    }
+
+    for ( i = 0; i < n_elems; i++ )
+    {
+      const int  n_verts = ICF_ELEM_N_VERTS(primgrid, i);
+      const int *verts   = ICF_ELEM_VERTS(primgrid, i);
+      const int *nbrs    = ICF_ELEM_NBRS(primgrid, i);
+
+      for ( k = 0; k < n_verts; k++ )
+      {
+        ParticleBdryEdge key, *edge;
+
+        if ( nbrs[k] >= 0 )
+          continue;
+
+        if ( pass == 0 )
+        {
+          ++tracker->n_bdry;
+          continue;
+        }
+
+        key.lo = MIN(verts[k], verts[ (k+1) % n_verts ]);
+        key.hi = MAX(verts[k], verts[ (k+1) % n_verts ]);
+
+        edge = bsearch(&key, edges, primgrid->n_bdry_edges, 
+                       sizeof(ParticleBdryEdge), cmp_bdry_edges);
+
+        check( edge, "Element edge (%d,%d) is not a boundary edge.", 
+            key.lo, key.hi );
+
+        /* Rim edges of partition-local grids are outflow edges       */
+        BoundaryType type = OUTLET;
+
+        if ( edge->marker != ICF_HALO_MARKER )
+        {
+          for ( j = 0; j < bdry_def->n_bdry_markers; j++ )
+            if ( bdry_def->bdry_markers[j] == edge->marker )
+              break;
+
+          check( j < bdry_def->n_bdry_markers, 
+              "Boundary marker %d is not defined.", edge->marker );
+
+          type = bdry_def->bdry_types[j];
+        }
+
+        tracker->bdry_keys[tracker->n_bdry]  = particle_edge_key(primgrid, 
+                                                                 i, k);
+        tracker->bdry_types[tracker->n_bdry] = type;
+        ++tracker->n_bdry;
+      }
+    }
+  }
+
+  free( edges );
+
+  return ICF_SUCCESS;
+
+error:
+  free( edges );
+  return ICF_ERROR;
+
+} /* ParticleTracker_init() */
+
+/***********************************************************************
+* Function to add particles
+***********************************************************************/
+int ParticleTracker_add(ParticleTracker *tracker,
+                        int              n,
+                        const double   (*xy)[2],
+                        const double   (*uv)[2])
+{
+  int *elems = malloc(( (size_t) n + 1 ) * sizeof(int));
+  int i;
+
+  check_mem(elems);
+  check( tracker->index, "The particle tracker is not initialized." );
+
+  check( SpatialIndex_locate_batch(tracker->index, n, xy, elems),
+      "Failed to locate the particles." );
+
+  if ( tracker->n_particles + n > tracker->capacity )
+  {
+    check( particle_reserve(tracker, 
+                            MAX(tracker->n_particles + n, 
+                                2 * tracker->capacity)),
+        "Failed to allocate the particle arrays." );
+  }
+
+  for ( i = 0; i < n; i++ )
+  {
+    const int p = tracker->n_particles;
+
+    if ( elems[i] < 0 )
+      continue;
+
+    tracker->x[p]     = xy[i][0];
+    tracker->y[p]     = xy[i][1];
+    tracker->u[p]     = uv ? uv[i][0] : 0.0;
+    tracker->v[p]     = uv ? uv[i][1] : 0.0;
+    tracker->elem[p]  = elems[i];
+    tracker->id[p]    = tracker->next_id++;
+    tracker->state[p] = ICF_PARTICLE_ACTIVE;
+
+    ++tracker->n_particles;
+  }
+
+  free( elems );
+  return ICF_SUCCESS;
+
+error:
+  free( elems );
+  return ICF_ERROR;
+
+} /* ParticleTracker_add() */
+
+/***********************************************************************
+* Function to interpolate a vertex field to the particles
+***********************************************************************/
+void ParticleTracker_interpolate(const ParticleTracker *tracker,
+                                 ThreadPool            *pool,
+                                 const double          *field,
+                                 double                *values)
+{
+  ParticleStepCtx ctx;
+
+  memset(&ctx, 0, sizeof(ParticleStepCtx));
+  ctx.tracker = (ParticleTracker *) tracker;
+  ctx.field   = field;
+  ctx.values  = values;
+
+  particle_run(pool, 
+               ( tracker->n_particles + ICF_PARTICLE_BATCH - 1 ) 
+               / ICF_PARTICLE_BATCH, 
+               particle_interpolate_task, &ctx);
+
+} /* ParticleTracker_interpolate() */
+
+/***********************************************************************
+* Function to advance all active particles by one time step
+***********************************************************************/
+int ParticleTracker_step(ParticleTracker *tracker,
+                         ThreadPool      *pool,
+                         const double    *u_field,
+                         const double    *v_field,
+                         double           dt)
+{
+  const int n_tasks = ( tracker->n_particles + ICF_PARTICLE_BATCH - 1 ) 
+                    / ICF_PARTICLE_BATCH;
+  ParticleStepCtx ctx;
+  int i;
+
+  memset(&ctx, 0, sizeof(ParticleStepCtx));
+  ctx.tracker     = tracker;
+  ctx.u_field     = u_field;
+  ctx.v_field     = v_field;
+  ctx.dt          = dt;
+  ctx.n_exited    = calloc(n_tasks + 1, sizeof(int));
+  ctx.n_deposited = calloc(n_tasks + 1, sizeof(int));
+
+  check_mem(ctx.n_exited);
+  check_mem(ctx.n_deposited);
+
+  particle_run(pool, n_tasks, particle_step_task, &ctx);
+
+  for ( i = 0; i < n_tasks; i++ )
+  {
+    tracker->n_exited    += ctx.n_exited[i];
+    tracker->n_deposited += ctx.n_deposited[i];
+    tracker->n_inactive  += ctx.n_exited[i] + ctx.n_deposited[i];
+  }
+
+  free( ctx.n_exited );
+  free( ctx.n_deposited );
+
+  if ( tracker->n_inactive > ICF_PARTICLE_COMPACT * tracker->n_particles )
+  {
+    check( ParticleTracker_compact(tracker),
+        "Failed to compact the particle arrays." );
+  }
+
+  return ICF_SUCCESS;
+
+error:
+  free( ctx.n_exited );
+  free( ctx.n_deposited );
+  return ICF_ERROR;
+
+} /* ParticleTracker_step() */
+
+/***********************************************************************
+* Function to remove all inactive particles and to sort the remaining
+* particles by their host elements
+***********************************************************************/
+int ParticleTracker_compact(ParticleTracker *tracker)
+{
+  const int n_elems = tracker->index ? tracker->index->n_elements : 0;
+  const int n       = tracker->n_particles;
+  ParticleTracker sorted;
+  int *ptr = calloc(( (size_t) n_elems + 1 ), sizeof(int));
+  int i, n_active = 0;
+
+  memset(&sorted, 0, sizeof(ParticleTracker));
+  check_mem(ptr);
+
+  /*--------------------------------------------------------------------
+  | Counting sort of the active particles by their host elements
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n; i++ )
+    if ( tracker->state[i] == ICF_PARTICLE_ACTIVE )
+    {
+      ++ptr[ tracker->elem[i] + 1 ];
+      ++n_active;
+    }
+
+  for ( i = 0; i < n_elems; i++ )
+    ptr[i+1] += ptr[i];
+
+  check( particle_reserve(&sorted, MAX(n_active, 1)),
+      "Failed to allocate the particle arrays." );
+
+  for ( i = 0; i < n; i++ )
+  {
+    if ( tracker->state[i] != ICF_PARTICLE_ACTIVE )
+      continue;
+
+    const int j = ptr[ tracker->elem[i] ]++;
+
+    sorted.x[j]     = tracker->x[i];
+    sorted.y[j]     = tracker->y[i];
+    sorted.u[j]     = tracker->u[i];
+    sorted.v[j]     = tracker->v[i];
+    sorted.elem[j]  = tracker->elem[i];
+    sorted.id[j]    = tracker->id[i];
+    sorted.state[j] = ICF_PARTICLE_ACTIVE;
+  }
+
+  particle_free_arrays( tracker );
+
+  tracker->x           = sorted.x;
+  tracker->y           = sorted.y;
+  tracker->u           = sorted.u;
+  tracker->v           = sorted.v;
+  tracker->elem        = sorted.elem;
+  tracker->id          = sorted.id;
+  tracker->state       = sorted.state;
+  tracker->capacity    = sorted.capacity;
+  tracker->n_particles = n_active;
+
+  free( ptr );
+  return ICF_SUCCESS;
+
+error:
+  particle_free_arrays( &sorted );
+  free( ptr );
+  return ICF_ERROR;
+
+} /* ParticleTracker_compact() */
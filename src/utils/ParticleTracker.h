@@ -0,0 +1,165 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef PARTICLETRACKER_H
+#define PARTICLETRACKER_H
+
+#include "PrimaryGrid.h"
+#include "Boundary.h"
+#include "ThreadPool.h"
+#include "SpatialIndex.h"
+
+/***********************************************************************
+* Lagrangian particle tracking on a primary grid
+*
+* The particles are stored as structure of arrays together with their
+* host elements. Every step interpolates the fluid velocity from 
+* vertex fields (e.g. SimData.vars) to the particles, relaxes the 
+* particle velocities towards the fluid velocity with the response 
+* time <tau> (tau = 0 -> tracer particles) and moves the particles 
+* along their displacement through the element neighbors. 
+* A particle, whose displacement crosses a boundary edge, interacts
+* with the boundary according to the type of the edge marker:
+* -> WALL, SYMMETRY: The particle is reflected with the coefficient 
+*                    of restitution or, for walls in deposition mode, 
+*                    sticks to the wall
+* -> Other types:    The particle exits the grid. This includes the 
+*                    edges with ICF_HALO_MARKER of partition-local 
+*                    grids.
+* Particles, that have exited or have been deposited, stay in the 
+* arrays until the next compaction, which removes them and sorts the 
+* remaining particles by their host elements.
+*
+* -> ICF_PARTICLE_BATCH:   Number of particles per thread pool task
+* -> ICF_PARTICLE_COMPACT: Fraction of inactive particles, above which
+*                          a step compacts the particle arrays
+***********************************************************************/
+#define ICF_PARTICLE_BATCH   1024
+#define ICF_PARTICLE_COMPACT 0.25
+
+/***********************************************************************
+* Particle states
+***********************************************************************/
+typedef enum
+{
+  ICF_PARTICLE_ACTIVE,
+  ICF_PARTICLE_EXITED,
+  ICF_PARTICLE_DEPOSITED,
+} ParticleState;
+
+/***********************************************************************
+* ParticleTracker structure
+***********************************************************************/
+struct ParticleTracker;
+typedef struct ParticleTracker 
+{
+  /* Primary grid, which must provide the element neighbors 
+   * (see PrimaryGrid_build_topology), and its spatial index */
+  const PrimaryGrid *primgrid;
+  SpatialIndex      *index;
+
+  /* Boundary element edges in ascending order, given by their 
+   * position in the layout of the element store (i.e. 4*elem+loc for
+   * quads), and their boundary types */
+  int           n_bdry;
+  int          *bdry_keys;
+  BoundaryType *bdry_types;
+
+  /* Particle response time, coefficient of restitution and wall 
+   * deposition flag */
+  double tau;
+  double restitution;
+  int    deposit;
+
+  /* Particle arrays */
+  int            n_particles;
+  int            capacity;
+  double        *x;
+  double        *y;
+  double        *u;
+  double        *v;
+  int           *elem;
+  int           *id;
+  unsigned char *state;
+
+  /* Next particle id */
+  int next_id;
+
+  /* Number of inactive particles in the arrays */
+  int n_inactive;
+
+  /* Total number of exited and deposited particles */
+  long n_exited;
+  long n_deposited;
+
+} ParticleTracker;
+
+/***********************************************************************
+* Function to create and initialize a new particle tracker structure
+***********************************************************************/
+ParticleTracker *ParticleTracker_create();
+
+/***********************************************************************
+* Function to destroy a particle tracker structure
+***********************************************************************/
+void ParticleTracker_destroy(ParticleTracker *tracker);
+
+/***********************************************************************
+* Function to set up a particle tracker for a primary grid with 
+* element neighbors. The boundary types of the edge markers are 
+* taken from <bdry_def>. Existing particles are removed.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int ParticleTracker_init(ParticleTracker   *tracker,
+                         const PrimaryGrid *primgrid,
+                         const BoundaryDef *bdry_def);
+
+/***********************************************************************
+* Function to add <n> particles at the positions <xy> with the 
+* velocities <uv> (or zero velocities for uv = NULL). Particles 
+* outside of the grid are skipped.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int ParticleTracker_add(ParticleTracker *tracker,
+                        int              n,
+                        const double   (*xy)[2],
+                        const double   (*uv)[2]);
+
+/***********************************************************************
+* Function to interpolate the vertex field <field> linearly to the 
+* positions of all particles, where quads and polygons are split 
+* into a fan of triangles. The values of inactive particles are set 
+* to zero.
+***********************************************************************/
+void ParticleTracker_interpolate(const ParticleTracker *tracker,
+                                 ThreadPool            *pool,
+                                 const double          *field,
+                                 double                *values);
+
+/***********************************************************************
+* Function to advance all active particles by the time step <dt> in 
+* the fluid velocity field (<u_field>, <v_field>) at the grid vertices.
+* The particles are processed in batches on the thread pool <pool> 
+* (or by the calling thread for pool = NULL). The particle arrays are
+* compacted afterwards, if the fraction of inactive particles exceeds
+* ICF_PARTICLE_COMPACT.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int ParticleTracker_step(ParticleTracker *tracker,
+                         ThreadPool      *pool,
+                         const double    *u_field,
+                         const double    *v_field,
+                         double           dt);
+
+/***********************************************************************
+* Function to remove all inactive particles and to sort the remaining
+* particles by their host elements
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int ParticleTracker_compact(ParticleTracker *tracker);
+
+#endif /* PARTICLETRACKER_H */
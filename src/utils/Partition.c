@@ -0,0 +1,1313 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "DualGrid.h"
+#include "Partition.h"
+
+/***********************************************************************
+* Weighted graph in CSR format, which is coarsened by the k-way 
+* partitioner. The finest graph refers to the adjacency of the 
+* dualgrid, such that its xadj and adjncy arrays are not owned.
+***********************************************************************/
+typedef struct PartGraph 
+{
+  int  n;
+  int *xadj;
+  int *adjncy;
+  int *adjwgt;
+  int *vwgt;
+
+  /* Vertex of the next coarser graph for every vertex */
+  int *cmap;
+
+  int  owns_adjncy;
+
+} PartGraph;
+
+#define ICF_PART_MAX_LEVELS 64
+
+/***********************************************************************
+* Work arrays of the Fiduccia-Mattheyses refinement, which are sized 
+* for the finest graph:
+* -> heap, hpos, hkey: Max-heap of the movable vertices by their gain,
+*                      where hpos[v] = -1 for vertices outside the heap
+* -> moved:            Pass stamp of every vertex, that has been moved
+* -> moves, from:      Moved vertices and their former partitions
+***********************************************************************/
+typedef struct PartFM
+{
+  int  n_heap;
+  int *heap;
+  int *hpos;
+  int *hkey;
+  int *moved;
+  int *moves;
+  int *from;
+  int  stamp;
+
+} PartFM;
+
+/***********************************************************************
+* Function to destroy a graph of the k-way partitioner
+***********************************************************************/
+static void part_graph_destroy(PartGraph *g)
+{
+  if ( !g )
+    return;
+
+  if ( g->owns_adjncy )
+  {
+    free( g->xadj );
+    free( g->adjncy );
+  }
+
+  free( g->adjwgt );
+  free( g->vwgt );
+  free( g->cmap );
+  free( g );
+
+} /* part_graph_destroy() */
+
+/***********************************************************************
+* Simple linear congruential generator for reproducible matchings
+***********************************************************************/
+static inline unsigned part_rand(unsigned *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return *state >> 8;
+
+} /* part_rand() */
+
+/***********************************************************************
+* Function to allocate the partition vector and weights for 
+* <n_elems> elements and <n_parts> partitions
+***********************************************************************/
+static int partition_init(Partition *partition, int n_elems, int n_parts)
+{
+  check( n_parts >= 1 && n_parts <= MAX(n_elems, 1),
+      "Invalid number of partitions %d for %d elements.", 
+      n_parts, n_elems);
+
+  free( partition->part );
+  free( partition->part_weights );
+
+  partition->n_parts      = n_parts;
+  partition->n_elements   = n_elems;
+  partition->part         = calloc( n_elems + 1, sizeof(int) );
+  partition->part_weights = calloc( n_parts, sizeof(long) );
+  partition->edge_cut     = 0;
+  partition->imbalance    = 1.0;
+
+  check_mem( partition->part );
+  check_mem( partition->part_weights );
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* partition_init() */
+
+/***********************************************************************
+* Function to create and initialize a new partition structure
+***********************************************************************/
+Partition *Partition_create()
+{
+  Partition *partition = calloc(1, sizeof(Partition));
+  check_mem(partition);
+
+  partition->n_parts      = 0;
+  partition->n_elements   = 0;
+  partition->part         = NULL;
+  partition->part_weights = NULL;
+  partition->edge_cut     = 0;
+  partition->imbalance    = 1.0;
+
+  return partition;
+error:
+  return NULL;
+
+} /* Partition_create() */
+
+/***********************************************************************
+* Function to destroy a partition structure
+***********************************************************************/
+void Partition_destroy(Partition *partition)
+{
+  free( partition->part );
+  free( partition->part_weights );
+  free( partition );
+
+} /* Partition_destroy() */
+
+/***********************************************************************
+* Function to compute the partition weights, the edge-cut and the 
+* imbalance of a partition
+***********************************************************************/
+void Partition_evaluate(Partition      *partition, 
+                        const DualGrid *dualgrid,
+                        const int      *weights)
+{
+  const int *part = partition->part;
+  long total = 0;
+  long w_max = 0;
+  int i;
+
+  memset(partition->part_weights, 0, partition->n_parts * sizeof(long));
+
+  for ( i = 0; i < partition->n_elements; i++ )
+    partition->part_weights[part[i]] += weights ? weights[i] : 1;
+
+  for ( i = 0; i < partition->n_parts; i++ )
+  {
+    total += partition->part_weights[i];
+    w_max  = MAX( w_max, partition->part_weights[i] );
+  }
+
+  partition->edge_cut = 0;
+
+  for ( i = 0; i < dualgrid->n_intr_faces; i++ )
+    if ( part[dualgrid->face_nbrs[i][0]] != part[dualgrid->face_nbrs[i][1]] )
+      ++partition->edge_cut;
+
+  partition->imbalance = ( total > 0 ) 
+                       ? (double) w_max * partition->n_parts / total 
+                       : 1.0;
+
+} /* Partition_evaluate() */
+
+/***********************************************************************
+* Function to create element weights, that are larger at the boundary
+***********************************************************************/
+int *Partition_boundary_weights(const DualGrid *dualgrid, 
+                                int             bdry_weight)
+{
+  const PrimaryGrid *primgrid = dualgrid->primgrid;
+  int *weights = malloc( ( dualgrid->n_elements + 1 ) * sizeof(int) );
+  int i;
+
+  check_mem(weights);
+
+  for ( i = 0; i < dualgrid->n_elements; i++ )
+    weights[i] = 1;
+
+  for ( i = 0; i < primgrid->n_bdry_edges; i++ )
+  {
+    weights[ primgrid->bdry_edges[i][0] ] = bdry_weight;
+    weights[ primgrid->bdry_edges[i][1] ] = bdry_weight;
+  }
+
+  return weights;
+
+error:
+  return NULL;
+
+} /* Partition_boundary_weights() */
+
+
+/*----------------------------------------------------------------------
+| Recursive coordinate bisection
+----------------------------------------------------------------------*/
+typedef struct 
+{
+  double x;
+  int    i;
+
+} RCBItem;
+
+static int rcb_cmp(const void *a, const void *b)
+{
+  const RCBItem *ia = a;
+  const RCBItem *ib = b;
+
+  if ( ia->x < ib->x ) return -1;
+  if ( ia->x > ib->x ) return  1;
+  return ( ia->i > ib->i ) - ( ia->i < ib->i );
+
+} /* rcb_cmp() */
+
+/***********************************************************************
+* Function to distribute the <n> elements in <items> to the 
+* <n_parts> partitions starting at <p0>
+***********************************************************************/
+static void rcb_split(const DualGrid *dualgrid,
+                      const int      *weights,
+                      RCBItem        *items,
+                      int             n,
+                      int             n_parts,
+                      int             p0,
+                      int            *part)
+{
+  double (*xy)[2] = dualgrid->xy;
+  double lo[2], hi[2];
+  long   total = 0, acc = 0;
+  int    i, axis, m;
+
+  if ( n_parts == 1 || n < 1 )
+  {
+    for ( i = 0; i < n; i++ )
+      part[items[i].i] = p0;
+    return;
+  }
+
+  /*--------------------------------------------------------------------
+  | Split along the longer side of the bounding box
+  --------------------------------------------------------------------*/
+  lo[0] = hi[0] = xy[items[0].i][0];
+  lo[1] = hi[1] = xy[items[0].i][1];
+
+  for ( i = 1; i < n; i++ )
+  {
+    const double *p = xy[items[i].i];
+    lo[0] = MIN( lo[0], p[0] ); hi[0] = MAX( hi[0], p[0] );
+    lo[1] = MIN( lo[1], p[1] ); hi[1] = MAX( hi[1], p[1] );
+  }
+
+  axis = ( hi[1] - lo[1] > hi[0] - lo[0] ) ? 1 : 0;
+
+  for ( i = 0; i < n; i++ )
+  {
+    items[i].x = xy[items[i].i][axis];
+    total += weights ? weights[items[i].i] : 1;
+  }
+
+  qsort(items, n, sizeof(RCBItem), rcb_cmp);
+
+  /*--------------------------------------------------------------------
+  | The first k1 partitions receive the weight fraction k1 / n_parts
+  --------------------------------------------------------------------*/
+  const int  k1     = n_parts / 2;
+  const long target = total * k1 / n_parts;
+
+  for ( m = 0; m < n; m++ )
+  {
+    const long w = weights ? weights[items[m].i] : 1;
+
+    if ( acc + w > target )
+    {
+      /* Take the element, if this is closer to the target weight */
+      if ( acc + w - target < target - acc )
+        ++m;
+      break;
+    }
+
+    acc += w;
+  }
+
+  m = MAX( MIN( m, n-1 ), 1 );
+
+  rcb_split(dualgrid, weights, items,   m,   k1,           p0,    part);
+  rcb_split(dualgrid, weights, items+m, n-m, n_parts - k1, p0+k1, part);
+
+} /* rcb_split() */
+
+/***********************************************************************
+* Function to partition a dualgrid by recursive coordinate bisection
+***********************************************************************/
+int Partition_rcb(Partition      *partition, 
+                  const DualGrid *dualgrid,
+                  const int      *weights,
+                  int             n_parts)
+{
+  const int n_elems = dualgrid->n_elements;
+  RCBItem *items = NULL;
+  int i;
+
+  check( partition_init(partition, n_elems, n_parts),
+      "Failed to initialize partition.");
+
+  items = malloc( ( n_elems + 1 ) * sizeof(RCBItem) );
+  check_mem(items);
+
+  for ( i = 0; i < n_elems; i++ )
+    items[i].i = i;
+
+  rcb_split(dualgrid, weights, items, n_elems, n_parts, 0, partition->part);
+
+  free( items );
+
+  Partition_evaluate(partition, dualgrid, weights);
+
+  return ICF_SUCCESS;
+
+error:
+  free( items );
+  return ICF_ERROR;
+
+} /* Partition_rcb() */
+
+
+/*----------------------------------------------------------------------
+| Multilevel k-way partitioning
+----------------------------------------------------------------------*/
+
+/***********************************************************************
+* Function to coarsen a graph by heavy-edge matching. Every vertex is 
+* matched with the unmatched neighbor of the heaviest joint edge, 
+* as long as the joint vertex weight does not exceed <max_vwgt>.
+* Returns the coarse graph or NULL on failure.
+***********************************************************************/
+static PartGraph *part_coarsen(PartGraph *g, long max_vwgt, unsigned *seed)
+{
+  const int n = g->n;
+  PartGraph *c = NULL;
+  int *match = malloc( ( n + 1 ) * sizeof(int) );
+  int *perm  = malloc( ( n + 1 ) * sizeof(int) );
+  int *cvtx  = malloc( ( 2 * (size_t) n + 1 ) * sizeof(int) );
+  int *table = NULL;
+  int i, j, k, v, cn, n_edges;
+
+  check_mem(match);
+  check_mem(perm);
+  check_mem(cvtx);
+
+  g->cmap = malloc( ( n + 1 ) * sizeof(int) );
+  check_mem(g->cmap);
+
+  /*--------------------------------------------------------------------
+  | Heavy-edge matching in random order
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n; i++ )
+  {
+    match[i] = -1;
+    perm[i]  = i;
+  }
+
+  for ( i = n - 1; i > 0; i-- )
+  {
+    const int r = (int) ( part_rand(seed) % (unsigned) (i + 1) );
+    const int t = perm[i];
+    perm[i] = perm[r];
+    perm[r] = t;
+  }
+
+  cn = 0;
+
+  for ( i = 0; i < n; i++ )
+  {
+    int best = -1, best_w = -1;
+
+    v = perm[i];
+
+    if ( match[v] >= 0 )
+      continue;
+
+    for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+    {
+      const int u = g->adjncy[j];
+
+      if ( match[u] >= 0 || g->vwgt[u] + (long) g->vwgt[v] > max_vwgt )
+        continue;
+
+      if ( g->adjwgt[j] > best_w 
+        || ( g->adjwgt[j] == best_w && g->vwgt[u] < g->vwgt[best] ) )
+      {
+        best   = u;
+        best_w = g->adjwgt[j];
+      }
+    }
+
+    if ( best < 0 )
+      best = v;
+
+    match[v] = best;
+    match[best] = v;
+
+    g->cmap[v] = g->cmap[best] = cn;
+    cvtx[2*cn]   = v;
+    cvtx[2*cn+1] = best;
+    ++cn;
+  }
+
+  /*--------------------------------------------------------------------
+  | Set up the coarse graph and merge parallel edges
+  --------------------------------------------------------------------*/
+  c = calloc(1, sizeof(PartGraph));
+  check_mem(c);
+
+  c->n           = cn;
+  c->owns_adjncy = 1;
+  c->xadj        = malloc( ( cn + 1 ) * sizeof(int) );
+  c->adjncy      = malloc( ( g->xadj[n] + 1 ) * sizeof(int) );
+  c->adjwgt      = malloc( ( g->xadj[n] + 1 ) * sizeof(int) );
+  c->vwgt        = malloc( ( cn + 1 ) * sizeof(int) );
+  table          = malloc( ( cn + 1 ) * sizeof(int) );
+
+  check_mem(c->xadj);
+  check_mem(c->adjncy);
+  check_mem(c->adjwgt);
+  check_mem(c->vwgt);
+  check_mem(table);
+
+  for ( i = 0; i < cn; i++ )
+    table[i] = -1;
+
+  n_edges    = 0;
+  c->xadj[0] = 0;
+
+  for ( i = 0; i < cn; i++ )
+  {
+    const int v0 = cvtx[2*i];
+    const int v1 = cvtx[2*i+1];
+
+    c->vwgt[i] = g->vwgt[v0] + ( v1 != v0 ? g->vwgt[v1] : 0 );
+
+    for ( k = 0; k < ( v1 != v0 ? 2 : 1 ); k++ )
+    {
+      v = cvtx[2*i+k];
+
+      for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+      {
+        const int cu = g->cmap[ g->adjncy[j] ];
+
+        if ( cu == i )
+          continue;
+
+        if ( table[cu] < 0 )
+        {
+          table[cu] = n_edges;
+          c->adjncy[n_edges] = cu;
+          c->adjwgt[n_edges] = g->adjwgt[j];
+          ++n_edges;
+        }
+        else
+          c->adjwgt[table[cu]] += g->adjwgt[j];
+      }
+    }
+
+    for ( j = c->xadj[i]; j < n_edges; j++ )
+      table[c->adjncy[j]] = -1;
+
+    c->xadj[i+1] = n_edges;
+  }
+
+  free( match );
+  free( perm );
+  free( cvtx );
+  free( table );
+
+  return c;
+
+error:
+  free( match );
+  free( perm );
+  free( cvtx );
+  free( table );
+  part_graph_destroy( c );
+  return NULL;
+
+} /* part_coarsen() */
+
+/***********************************************************************
+* Function to compute the gain of moving vertex <v> from partition 
+* <p1> to <p0>, i.e. the weight of its edges to p0 minus the weight 
+* of its edges to p1
+***********************************************************************/
+static inline int part_grow_gain(const PartGraph *g, 
+                                 const int       *where, 
+                                 int              v, 
+                                 int              p0, 
+                                 int              p1)
+{
+  int j, gain = 0;
+
+  for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+  {
+    const int p = where[ g->adjncy[j] ];
+
+    if ( p == p0 )
+      gain += g->adjwgt[j];
+    else if ( p == p1 )
+      gain -= g->adjwgt[j];
+  }
+
+  return gain;
+
+} /* part_grow_gain() */
+
+/***********************************************************************
+* Function to bisect the vertices of partition <p0> of a graph into 
+* the partitions p0 ... p0+k1-1 and p0+k1 ... p0+k-1 by greedy graph 
+* growing, where k1 = k/2. The region grows from a pseudo-peripheral 
+* vertex by always adding the frontier vertex of the largest gain, 
+* until it receives the weight fraction k1 / k. Both halves are 
+* bisected recursively.
+***********************************************************************/
+static void part_grow_bisect(PartGraph *g, 
+                             int       *where, 
+                             int        p0, 
+                             int        k,
+                             int       *queue,
+                             int       *queued,
+                             int       *gain,
+                             unsigned  *rng)
+{
+  const int k1 = k / 2;
+  const int p1 = p0 + k1;
+  long total = 0, grown = 0;
+  int  i, j, head, tail, seed, n_front;
+
+  if ( k < 2 )
+    return;
+
+  for ( i = 0; i < g->n; i++ )
+    if ( where[i] == p0 )
+    {
+      total    += g->vwgt[i];
+      where[i]  = p1;
+      queued[i] = 0;
+    }
+
+  const long target = total * k1 / k;
+
+  /*--------------------------------------------------------------------
+  | Start at a pseudo-peripheral vertex, i.e. the last vertex of a 
+  | breadth-first search from a random vertex of the partition
+  --------------------------------------------------------------------*/
+  seed = (int) ( part_rand(rng) % (unsigned) g->n );
+
+  for ( i = 0; i < g->n && where[seed] != p1; i++ )
+    seed = ( seed + 1 ) % g->n;
+
+  if ( where[seed] != p1 )
+    return;
+
+  head = tail = 0;
+  queue[tail++] = seed;
+  queued[seed]  = 1;
+
+  while ( head < tail )
+  {
+    const int v = queue[head++];
+
+    for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+    {
+      const int u = g->adjncy[j];
+
+      if ( where[u] == p1 && !queued[u] )
+      {
+        queued[u] = 1;
+        queue[tail++] = u;
+      }
+    }
+  }
+
+  seed = queue[tail-1];
+
+  for ( i = 0; i < tail; i++ )
+    queued[queue[i]] = 0;
+
+  /*--------------------------------------------------------------------
+  | Grow the region until it reaches the target weight. The frontier
+  | is kept in <queue>. Disconnected parts are continued at the next 
+  | unassigned vertex.
+  --------------------------------------------------------------------*/
+  n_front = 0;
+  i = 0;
+
+  queue[n_front++] = seed;
+  queued[seed]     = 1;
+  gain[seed]       = part_grow_gain(g, where, seed, p0, p1);
+
+  while ( grown < target )
+  {
+    int best = 0;
+
+    if ( n_front == 0 )
+    {
+      for ( ; i < g->n && ( where[i] != p1 || queued[i] ); i++ );
+
+      if ( i == g->n )
+        break;
+
+      queue[n_front++] = i;
+      queued[i]        = 1;
+      gain[i]          = part_grow_gain(g, where, i, p0, p1);
+    }
+
+    for ( j = 1; j < n_front; j++ )
+      if ( gain[queue[j]] > gain[queue[best]] )
+        best = j;
+
+    const int v = queue[best];
+    queue[best] = queue[--n_front];
+
+    where[v] = p0;
+    grown   += g->vwgt[v];
+
+    for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+    {
+      const int u = g->adjncy[j];
+
+      if ( where[u] != p1 )
+        continue;
+
+      if ( queued[u] )
+        gain[u] += 2 * g->adjwgt[j];
+      else
+      {
+        queue[n_front++] = u;
+        queued[u]        = 1;
+        gain[u]          = part_grow_gain(g, where, u, p0, p1);
+      }
+    }
+  }
+
+  part_grow_bisect(g, where, p0, k1,     queue, queued, gain, rng);
+  part_grow_bisect(g, where, p1, k - k1, queue, queued, gain, rng);
+
+} /* part_grow_bisect() */
+
+/***********************************************************************
+* Function to compute the weighted edge-cut of a graph partition
+***********************************************************************/
+static long part_cut(const PartGraph *g, const int *where)
+{
+  long cut = 0;
+  int v, j;
+
+  for ( v = 0; v < g->n; v++ )
+    for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+      if ( where[ g->adjncy[j] ] != where[v] )
+        cut += g->adjwgt[j];
+
+  return cut / 2;
+
+} /* part_cut() */
+
+/***********************************************************************
+* Function to rate a graph partition by its edge-cut, where a 
+* partition weight above <max_w> adds the total edge weight, such that
+* balanced partitions are preferred over a lower edge-cut
+***********************************************************************/
+static long part_score(const PartGraph *g, 
+                       const int       *where, 
+                       const long      *pwgts,
+                       int              n_parts,
+                       long             max_w)
+{
+  long w_max = 0;
+  int p;
+
+  for ( p = 0; p < n_parts; p++ )
+    w_max = MAX( w_max, pwgts[p] );
+
+  return part_cut(g, where) + ( w_max > max_w ? g->xadj[g->n] : 0 );
+
+} /* part_score() */
+
+/***********************************************************************
+* Function to refine a k-way partition of a graph by moving boundary 
+* vertices to the neighboring partition of the largest edge-cut gain. 
+* Moves must not raise a partition weight above <max_w>. Vertices of 
+* overweight partitions are moved even at negative gain.
+***********************************************************************/
+static void part_refine(PartGraph *g, 
+                        int       *where, 
+                        long      *pwgts, 
+                        long       max_w,
+                        int       *conn,
+                        int       *touched)
+{
+  int pass, v, j, t;
+
+  for ( pass = 0; pass < ICF_PART_N_PASSES; pass++ )
+  {
+    int n_moves = 0;
+
+    for ( v = 0; v < g->n; v++ )
+    {
+      const int from = where[v];
+      const int w    = g->vwgt[v];
+      int id = 0, n_touched = 0;
+      int best = -1, best_gain = 0;
+
+      for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+      {
+        const int p = where[ g->adjncy[j] ];
+
+        if ( p == from )
+        {
+          id += g->adjwgt[j];
+          continue;
+        }
+
+        if ( conn[p] == 0 )
+          touched[n_touched++] = p;
+
+        conn[p] += g->adjwgt[j];
+      }
+
+      if ( n_touched == 0 )
+        continue;
+
+      const int overweight = pwgts[from] > max_w;
+
+      for ( t = 0; t < n_touched; t++ )
+      {
+        const int p    = touched[t];
+        const int gain = conn[p] - id;
+
+        conn[p] = 0;
+
+        if ( pwgts[p] + w > max_w )
+          continue;
+
+        if ( !( gain > 0 || overweight 
+             || ( gain == 0 && pwgts[p] + w < pwgts[from] ) ) )
+          continue;
+
+        if ( best < 0 || gain > best_gain 
+          || ( gain == best_gain && pwgts[p] < pwgts[best] ) )
+        {
+          best      = p;
+          best_gain = gain;
+        }
+      }
+
+      if ( best < 0 )
+        continue;
+
+      where[v]     = best;
+      pwgts[from] -= w;
+      pwgts[best] += w;
+      ++n_moves;
+    }
+
+    if ( n_moves == 0 )
+      break;
+  }
+
+} /* part_refine() */
+
+/***********************************************************************
+* Function to move entry <i> of the heap of the FM refinement up or 
+* down to its place
+***********************************************************************/
+static void part_heap_sift(PartFM *fm, int i)
+{
+  const int v   = fm->heap[i];
+  const int key = fm->hkey[v];
+
+  while ( i > 0 && fm->hkey[ fm->heap[(i-1)/2] ] < key )
+  {
+    fm->heap[i] = fm->heap[(i-1)/2];
+    fm->hpos[ fm->heap[i] ] = i;
+    i = ( i - 1 ) / 2;
+  }
+
+  for ( ;; )
+  {
+    int c = 2 * i + 1;
+
+    if ( c >= fm->n_heap )
+      break;
+
+    if ( c + 1 < fm->n_heap 
+      && fm->hkey[ fm->heap[c+1] ] > fm->hkey[ fm->heap[c] ] )
+      ++c;
+
+    if ( fm->hkey[ fm->heap[c] ] <= key )
+      break;
+
+    fm->heap[i] = fm->heap[c];
+    fm->hpos[ fm->heap[i] ] = i;
+    i = c;
+  }
+
+  fm->heap[i] = v;
+  fm->hpos[v] = i;
+
+} /* part_heap_sift() */
+
+/***********************************************************************
+* Function to insert vertex <v> with the gain <key> into the heap of 
+* the FM refinement or to update its gain
+***********************************************************************/
+static void part_heap_update(PartFM *fm, int v, int key)
+{
+  if ( fm->hpos[v] < 0 )
+  {
+    fm->heap[fm->n_heap] = v;
+    fm->hpos[v] = fm->n_heap++;
+  }
+
+  fm->hkey[v] = key;
+  part_heap_sift(fm, fm->hpos[v]);
+
+} /* part_heap_update() */
+
+/***********************************************************************
+* Function to remove vertex <v> from the heap of the FM refinement
+***********************************************************************/
+static void part_heap_remove(PartFM *fm, int v)
+{
+  const int i = fm->hpos[v];
+
+  if ( i < 0 )
+    return;
+
+  fm->hpos[v] = -1;
+
+  if ( i == --fm->n_heap )
+    return;
+
+  fm->heap[i] = fm->heap[fm->n_heap];
+  fm->hpos[ fm->heap[i] ] = i;
+  part_heap_sift(fm, i);
+
+} /* part_heap_remove() */
+
+/***********************************************************************
+* Function to compute the largest edge-cut gain of moving vertex <v> 
+* to a neighboring partition, whose weight stays below <max_w>. 
+* Ties are resolved in favor of the lighter partition. The target 
+* partition is returned in <to>, which is -1 if there is no such 
+* partition.
+***********************************************************************/
+static inline int part_fm_gain(const PartGraph *g, 
+                               const int       *where, 
+                               const long      *pwgts, 
+                               long             max_w,
+                               int              v,
+                               int             *conn,
+                               int             *touched,
+                               int             *to)
+{
+  const int from = where[v];
+  int id = 0, n_touched = 0;
+  int j, t, best_gain = 0;
+
+  *to = -1;
+
+  for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+  {
+    const int p = where[ g->adjncy[j] ];
+
+    if ( p == from )
+    {
+      id += g->adjwgt[j];
+      continue;
+    }
+
+    if ( conn[p] == 0 )
+      touched[n_touched++] = p;
+
+    conn[p] += g->adjwgt[j];
+  }
+
+  for ( t = 0; t < n_touched; t++ )
+  {
+    const int p    = touched[t];
+    const int gain = conn[p] - id;
+
+    conn[p] = 0;
+
+    if ( pwgts[p] + g->vwgt[v] > max_w )
+      continue;
+
+    if ( *to < 0 || gain > best_gain 
+      || ( gain == best_gain && pwgts[p] < pwgts[*to] ) )
+    {
+      *to       = p;
+      best_gain = gain;
+    }
+  }
+
+  return best_gain;
+
+} /* part_fm_gain() */
+
+/***********************************************************************
+* Function to refine a k-way partition of a graph by passes of 
+* Fiduccia-Mattheyses type: The boundary vertices are moved in the 
+* order of their edge-cut gains to the neighboring partition of the 
+* largest gain, also at negative gains, and every vertex is moved at
+* most once per pass. Moves must not raise a partition weight above 
+* <max_w>. A pass stops after ICF_PART_FM_STALL moves without a lower
+* edge-cut and the moves behind the lowest edge-cut are rolled back, 
+* such that the refinement escapes the local minima of greedy moves.
+***********************************************************************/
+static void part_fm_refine(PartGraph *g, 
+                           int       *where, 
+                           long      *pwgts, 
+                           long       max_w,
+                           PartFM    *fm,
+                           int       *conn,
+                           int       *touched)
+{
+  int pass, v, j, to;
+
+  for ( pass = 0; pass < ICF_PART_N_PASSES; pass++ )
+  {
+    long cut = 0, best_cut = 0;
+    int  n_moves = 0, n_best = 0;
+
+    ++fm->stamp;
+
+    /*------------------------------------------------------------------
+    | Queue all boundary vertices with an admissible move
+    ------------------------------------------------------------------*/
+    for ( v = 0; v < g->n; v++ )
+    {
+      const int gain = part_fm_gain(g, where, pwgts, max_w, v, 
+                                    conn, touched, &to);
+
+      if ( to >= 0 )
+        part_heap_update(fm, v, gain);
+    }
+
+    /*------------------------------------------------------------------
+    | Move the vertex of the largest gain and update the gains of its
+    | neighbors. The gain is recomputed first, since the partition 
+    | weights may have changed since it was queued.
+    ------------------------------------------------------------------*/
+    while ( fm->n_heap > 0 && n_moves - n_best < ICF_PART_FM_STALL )
+    {
+      v = fm->heap[0];
+      part_heap_remove(fm, v);
+
+      const int gain = part_fm_gain(g, where, pwgts, max_w, v, 
+                                    conn, touched, &to);
+
+      if ( to < 0 )
+        continue;
+
+      fm->moves[n_moves] = v;
+      fm->from[n_moves]  = where[v];
+      fm->moved[v]       = fm->stamp;
+      ++n_moves;
+
+      pwgts[where[v]] -= g->vwgt[v];
+      pwgts[to]       += g->vwgt[v];
+      where[v]         = to;
+      cut             -= gain;
+
+      if ( cut < best_cut )
+      {
+        best_cut = cut;
+        n_best   = n_moves;
+      }
+
+      for ( j = g->xadj[v]; j < g->xadj[v+1]; j++ )
+      {
+        const int u = g->adjncy[j];
+
+        if ( fm->moved[u] == fm->stamp )
+          continue;
+
+        const int u_gain = part_fm_gain(g, where, pwgts, max_w, u, 
+                                        conn, touched, &to);
+
+        if ( to >= 0 )
+          part_heap_update(fm, u, u_gain);
+        else
+          part_heap_remove(fm, u);
+      }
+    }
+
+    while ( fm->n_heap > 0 )
+      part_heap_remove(fm, fm->heap[fm->n_heap-1]);
+
+    /*------------------------------------------------------------------
+    | Roll back the moves behind the lowest edge-cut
+    ------------------------------------------------------------------*/
+    while ( n_moves > n_best )
+    {
+      --n_moves;
+      v = fm->moves[n_moves];
+
+      pwgts[where[v]]          -= g->vwgt[v];
+      pwgts[fm->from[n_moves]] += g->vwgt[v];
+      where[v]                  = fm->from[n_moves];
+    }
+
+    if ( n_best == 0 )
+      break;
+  }
+
+} /* part_fm_refine() */
+
+/***********************************************************************
+* Function to partition a dualgrid with the multilevel k-way 
+* partitioner. The refined RCB partition is used instead, if 
+* <rcb_fallback> is set and it rates better.
+***********************************************************************/
+static int part_kway(Partition *partition, 
+                     DualGrid  *dualgrid,
+                     const int *weights,
+                     int        n_parts,
+                     int        rcb_fallback)
+{
+  const int n_elems = dualgrid->n_elements;
+
+  PartGraph *levels[ICF_PART_MAX_LEVELS] = { NULL };
+  int  *where   = NULL;
+  int  *trial   = NULL;
+  int  *queue   = NULL;
+  int  *queued  = NULL;
+  int  *gain    = NULL;
+  int  *conn    = NULL;
+  int  *touched = NULL;
+  long *pwgts   = NULL;
+  PartFM fm     = { 0 };
+  long  total   = 0;
+  long  best_cut = 0;
+  unsigned seed = 12345u;
+  int i, v, n_levels = 0;
+
+  check( partition_init(partition, n_elems, n_parts),
+      "Failed to initialize partition.");
+
+  if ( !dualgrid->elem_face_ptr )
+  {
+    check( DualGrid_build_adjacency(dualgrid),
+        "Failed to build the dualgrid adjacency.");
+  }
+
+  /*--------------------------------------------------------------------
+  | The finest graph is the dualgrid adjacency with unit edge weights
+  --------------------------------------------------------------------*/
+  levels[0] = calloc(1, sizeof(PartGraph));
+  check_mem(levels[0]);
+  n_levels = 1;
+
+  levels[0]->n      = n_elems;
+  levels[0]->xadj   = dualgrid->elem_face_ptr;
+  levels[0]->adjncy = dualgrid->elem_nbrs;
+  levels[0]->adjwgt = malloc( ( 2 * (size_t) dualgrid->n_intr_faces + 1 ) 
+                              * sizeof(int) );
+  levels[0]->vwgt   = malloc( ( n_elems + 1 ) * sizeof(int) );
+
+  check_mem(levels[0]->adjwgt);
+  check_mem(levels[0]->vwgt);
+
+  for ( i = 0; i < 2 * dualgrid->n_intr_faces; i++ )
+    levels[0]->adjwgt[i] = 1;
+
+  for ( i = 0; i < n_elems; i++ )
+  {
+    levels[0]->vwgt[i] = weights ? weights[i] : 1;
+    total += levels[0]->vwgt[i];
+  }
+
+  const long max_w = (long) ( ( 1.0 + ICF_PART_UBFACTOR ) 
+                            * (double) total / n_parts ) + 1;
+
+  /*--------------------------------------------------------------------
+  | Coarsening until the graph is small enough or does not shrink 
+  | any more
+  --------------------------------------------------------------------*/
+  const int  n_coarsest = MAX( ICF_PART_COARSEST * n_parts, 100 );
+  const long max_vwgt   = MAX( (long) ( 1.5 * total / n_coarsest ), 1 );
+
+  while ( levels[n_levels-1]->n > n_coarsest 
+       && n_levels < ICF_PART_MAX_LEVELS )
+  {
+    PartGraph *g = levels[n_levels-1];
+    PartGraph *c = part_coarsen(g, max_vwgt, &seed);
+
+    check( c, "Failed to coarsen the partition graph.");
+
+    levels[n_levels++] = c;
+
+    if ( c->n > 0.95 * g->n )
+      break;
+  }
+
+  /*--------------------------------------------------------------------
+  | Initial partition of the coarsest graph -> The best of several 
+  | trials with different start vertices is kept
+  --------------------------------------------------------------------*/
+  where   = calloc( n_elems + 1, sizeof(int) );
+  trial   = calloc( n_elems + 1, sizeof(int) );
+  queue   = malloc( ( n_elems + 1 ) * sizeof(int) );
+  queued  = calloc( n_elems + 1, sizeof(int) );
+  gain    = calloc( n_elems + 1, sizeof(int) );
+  conn    = calloc( n_parts + 1, sizeof(int) );
+  touched = malloc( ( n_parts + 1 ) * sizeof(int) );
+  pwgts   = calloc( n_parts + 1, sizeof(long) );
+
+  fm.heap   = malloc( ( n_elems + 1 ) * sizeof(int) );
+  fm.hpos   = malloc( ( n_elems + 1 ) * sizeof(int) );
+  fm.hkey   = malloc( ( n_elems + 1 ) * sizeof(int) );
+  fm.moved  = calloc( n_elems + 1, sizeof(int) );
+  fm.moves  = malloc( ( n_elems + 1 ) * sizeof(int) );
+  fm.from   = malloc( ( n_elems + 1 ) * sizeof(int) );
+
+  check_mem(where);
+  check_mem(trial);
+  check_mem(queue);
+  check_mem(queued);
+  check_mem(gain);
+  check_mem(conn);
+  check_mem(touched);
+  check_mem(pwgts);
+  check_mem(fm.heap);
+  check_mem(fm.hpos);
+  check_mem(fm.hkey);
+  check_mem(fm.moved);
+  check_mem(fm.moves);
+  check_mem(fm.from);
+
+  for ( v = 0; v < n_elems; v++ )
+    fm.hpos[v] = -1;
+
+  PartGraph *coarsest = levels[n_levels-1];
+
+  for ( i = 0; i < ICF_PART_N_TRIALS; i++ )
+  {
+    long cut;
+
+    memset(trial, 0, coarsest->n * sizeof(int));
+    memset(pwgts, 0, n_parts * sizeof(long));
+
+    part_grow_bisect(coarsest, trial, 0, n_parts, 
+                     queue, queued, gain, &seed);
+
+    for ( v = 0; v < coarsest->n; v++ )
+      pwgts[trial[v]] += coarsest->vwgt[v];
+
+    part_refine(coarsest, trial, pwgts, max_w, conn, touched);
+    part_fm_refine(coarsest, trial, pwgts, max_w, &fm, conn, touched);
+
+    cut = part_score(coarsest, trial, pwgts, n_parts, max_w);
+
+    if ( i == 0 || cut < best_cut )
+    {
+      best_cut = cut;
+      memcpy(where, trial, coarsest->n * sizeof(int));
+    }
+  }
+
+  memset(pwgts, 0, n_parts * sizeof(long));
+
+  for ( v = 0; v < coarsest->n; v++ )
+    pwgts[where[v]] += coarsest->vwgt[v];
+
+  /*--------------------------------------------------------------------
+  | Project the partition to the finer graphs and refine it on 
+  | every level
+  --------------------------------------------------------------------*/
+  for ( i = n_levels - 2; i >= 0; i-- )
+  {
+    PartGraph *g = levels[i];
+
+    for ( v = 0; v < g->n; v++ )
+      queue[v] = where[ g->cmap[v] ];
+
+    memcpy(where, queue, g->n * sizeof(int));
+
+    part_refine(g, where, pwgts, max_w, conn, touched);
+    part_fm_refine(g, where, pwgts, max_w, &fm, conn, touched);
+  }
+
+  /*--------------------------------------------------------------------
+  | The RCB partition, refined on the finest graph, is kept instead, 
+  | if it rates better, as it does on regular grids
+  --------------------------------------------------------------------*/
+  if ( rcb_fallback )
+  {
+    const long kway_score = part_score(levels[0], where, pwgts, 
+                                       n_parts, max_w);
+
+    check( Partition_rcb(partition, dualgrid, weights, n_parts),
+        "Failed to compute the RCB partition.");
+
+    memcpy(trial, partition->part, n_elems * sizeof(int));
+    memset(pwgts, 0, n_parts * sizeof(long));
+
+    for ( v = 0; v < n_elems; v++ )
+      pwgts[trial[v]] += levels[0]->vwgt[v];
+
+    part_refine(levels[0], trial, pwgts, max_w, conn, touched);
+    part_fm_refine(levels[0], trial, pwgts, max_w, &fm, conn, touched);
+
+    if ( part_score(levels[0], trial, pwgts, n_parts, max_w) 
+         < kway_score )
+      memcpy(where, trial, n_elems * sizeof(int));
+  }
+
+  memcpy(partition->part, where, n_elems * sizeof(int));
+
+  Partition_evaluate(partition, dualgrid, weights);
+
+  for ( i = 0; i < n_levels; i++ )
+    part_graph_destroy( levels[i] );
+
+  free( where );
+  free( trial );
+  free( queue );
+  free( queued );
+  free( gain );
+  free( conn );
+  free( touched );
+  free( pwgts );
+  free( fm.heap );
+  free( fm.hpos );
+  free( fm.hkey );
+  free( fm.moved );
+  free( fm.moves );
+  free( fm.from );
+
+  return ICF_SUCCESS;
+
+error:
+  for ( i = 0; i < n_levels; i++ )
+    part_graph_destroy( levels[i] );
+
+  free( where );
+  free( trial );
+  free( queue );
+  free( queued );
+  free( gain );
+  free( conn );
+  free( touched );
+  free( pwgts );
+  free( fm.heap );
+  free( fm.hpos );
+  free( fm.hkey );
+  free( fm.moved );
+  free( fm.moves );
+  free( fm.from );
+
+  return ICF_ERROR;
+
+} /* part_kway() */
+
+/***********************************************************************
+* Function to partition a dualgrid with the multilevel k-way 
+* partitioner and the RCB partition as fallback
+***********************************************************************/
+int Partition_kway(Partition *partition, 
+                   DualGrid  *dualgrid,
+                   const int *weights,
+                   int        n_parts)
+{
+  return part_kway(partition, dualgrid, weights, n_parts, 1);
+
+} /* Partition_kway() */
+
+/***********************************************************************
+* Function to partition a dualgrid with the multilevel k-way 
+* partitioner only
+***********************************************************************/
+int Partition_multilevel(Partition *partition, 
+                         DualGrid  *dualgrid,
+                         const int *weights,
+                         int        n_parts)
+{
+  return part_kway(partition, dualgrid, weights, n_parts, 0);
+
+} /* Partition_multilevel() */
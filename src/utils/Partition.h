@@ -0,0 +1,133 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "DualGrid.h"
+
+/***********************************************************************
+* Parameters of the multilevel k-way partitioner
+* -> ICF_PART_UBFACTOR:  Allowed excess of the partition weights 
+*                        over the mean partition weight
+* -> ICF_PART_N_PASSES:  Maximum number of refinement passes per level
+* -> ICF_PART_COARSEST:  Number of vertices per partition, below 
+*                        which the coarsening stops
+* -> ICF_PART_N_TRIALS:  Number of initial partitions of the coarsest
+*                        graph, of which the best one is kept
+* -> ICF_PART_FM_STALL:  Number of moves without a lower edge-cut, 
+*                        after which a refinement pass is rolled back
+*                        to its lowest edge-cut
+***********************************************************************/
+#define ICF_PART_UBFACTOR  0.03
+#define ICF_PART_N_PASSES  8
+#define ICF_PART_COARSEST  20
+#define ICF_PART_N_TRIALS  8
+#define ICF_PART_FM_STALL  64
+
+/***********************************************************************
+* Partition structure
+* Partition of the dualgrid elements (i.e. the primary grid vertices)
+* for the domain decomposition
+***********************************************************************/
+struct Partition;
+typedef struct Partition {
+
+  int     n_parts;
+  int     n_elements;
+
+  /* Partition index of every dualgrid element */
+  int    *part;
+
+  /* Sum of the element weights of every partition */
+  long   *part_weights;
+
+  /* Number of dualgrid faces between different partitions */
+  long    edge_cut;
+
+  /* Largest partition weight in relation to the mean weight */
+  double  imbalance;
+
+} Partition;
+
+/***********************************************************************
+* Function to create and initialize a new partition structure
+***********************************************************************/
+Partition *Partition_create();
+
+/***********************************************************************
+* Function to destroy a partition structure
+***********************************************************************/
+void Partition_destroy(Partition *partition);
+
+/***********************************************************************
+* Function to partition a dualgrid into <n_parts> partitions by 
+* recursive coordinate bisection of the element centroids. 
+* Every bisection splits the longer side of the bounding box at the 
+* weighted median. <weights> are the element weights, which are 
+* all one for weights = NULL.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int Partition_rcb(Partition      *partition, 
+                  const DualGrid *dualgrid,
+                  const int      *weights,
+                  int             n_parts);
+
+/***********************************************************************
+* Function to partition the graph of a dualgrid, which is given by 
+* its face neighbors, into <n_parts> partitions with a multilevel 
+* k-way partitioner:
+* -> The graph is coarsened by heavy-edge matching
+* -> The coarsest graph is partitioned by recursive bisection with 
+*    greedy graph growing
+* -> The partition is projected back to the finer graphs and refined 
+*    on every level by moving boundary vertices, which reduce the 
+*    edge-cut without exceeding the allowed imbalance, followed by 
+*    Fiduccia-Mattheyses passes, which also take moves of negative 
+*    gain and roll back to the lowest edge-cut of every pass
+* -> The RCB partition (see Partition_rcb) is refined on the finest 
+*    graph in the same way and replaces the k-way partition, if it 
+*    has a lower edge-cut. This is usually the case on regular grids,
+*    where the bisections cut along straight grid lines.
+* <weights> are the element weights, which are all one for 
+* weights = NULL.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int Partition_kway(Partition *partition, 
+                   DualGrid  *dualgrid,
+                   const int *weights,
+                   int        n_parts);
+
+/***********************************************************************
+* Function to partition a dualgrid like Partition_kway(), but without 
+* the RCB fallback, such that the partition is always the result of 
+* the multilevel k-way partitioner. 
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int Partition_multilevel(Partition *partition, 
+                         DualGrid  *dualgrid,
+                         const int *weights,
+                         int        n_parts);
+
+/***********************************************************************
+* Function to compute the partition weights, the edge-cut and the 
+* imbalance of the partition vector <part> of a partition structure
+***********************************************************************/
+void Partition_evaluate(Partition      *partition, 
+                        const DualGrid *dualgrid,
+                        const int      *weights);
+
+/***********************************************************************
+* Function to create element weights for a dualgrid, which are 
+* <bdry_weight> for the elements on the primary grid boundary and 
+* one for all other elements. The weights must be freed by the caller.
+* Returns NULL on failure.
+***********************************************************************/
+int *Partition_boundary_weights(const DualGrid *dualgrid, 
+                                int             bdry_weight);
+
+#endif /* PARTITION_H */
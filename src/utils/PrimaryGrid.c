@@ -7,10 +7,13 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include "dbg.h"
 #include "icf_utils.h"
 #include "PrimaryGrid.h"
+#include "ThreadPool.h"
 
 /***********************************************************************
 * Function to create and initialize a new primary grid structure
@@ -43,6 +46,17 @@ PrimaryGrid *PrimaryGrid_create()
 
   prim_grid->bdry_edge_marker = NULL;
 
+  prim_grid->elem_edges = NULL;
+
+  prim_grid->vertex_order = NULL;
+
+  prim_grid->n_polys    = 0;
+  prim_grid->n_elements = 0;
+  prim_grid->elem_ptr   = NULL;
+  prim_grid->elem_verts = NULL;
+  prim_grid->elem_nbrs  = NULL;
+  prim_grid->elem_types = NULL;
+  memset(prim_grid->elem_blocks, 0, sizeof(prim_grid->elem_blocks));
 
   return prim_grid;
 error:
@@ -57,18 +71,1953 @@ int PrimaryGrid_destroy(PrimaryGrid *prim_grid)
 {
 
   free(prim_grid->vertex_coords);
-  free(prim_grid->tris);
-  free(prim_grid->quads);
-  free(prim_grid->tri_neighbors);
-  free(prim_grid->quad_neighbors);
+
+  /* The elements are views of the element store, if it is set up */
+  if ( prim_grid->n_elements == 0 )
+  {
+    free(prim_grid->tris);
+    free(prim_grid->quads);
+    free(prim_grid->tri_neighbors);
+    free(prim_grid->quad_neighbors);
+  }
+
+  free(prim_grid->elem_ptr);
+  free(prim_grid->elem_verts);
+  free(prim_grid->elem_nbrs);
+  free(prim_grid->elem_types);
   free(prim_grid->intr_edges);
   free(prim_grid->bdry_edges);
   free(prim_grid->intr_edge_nbrs);
   free(prim_grid->bdry_edge_nbrs);
   free(prim_grid->bdry_edge_marker);
+  free(prim_grid->elem_edges);
+  free(prim_grid->vertex_order);
 
   free(prim_grid);
 
   return ICF_SUCCESS;
 
 } /* PrimaryGrid_destroy() */
+
+/***********************************************************************
+* Returns the element size and the pointer to the array of a given 
+* section of the binary grid format
+***********************************************************************/
+static void **binary_section_data(PrimaryGrid        *prim_grid,
+                                  PrimaryGridSection  section)
+{
+  switch ( section )
+  {
+    case ICF_GRID_VERTEX_COORDS:
+      return (void **) &prim_grid->vertex_coords;
+    case ICF_GRID_TRIS:
+      return (void **) &prim_grid->tris;
+    case ICF_GRID_QUADS:
+      return (void **) &prim_grid->quads;
+    case ICF_GRID_TRI_NEIGHBORS:
+      return (void **) &prim_grid->tri_neighbors;
+    case ICF_GRID_QUAD_NEIGHBORS:
+      return (void **) &prim_grid->quad_neighbors;
+    case ICF_GRID_INTR_EDGES:
+      return (void **) &prim_grid->intr_edges;
+    case ICF_GRID_INTR_EDGE_NBRS:
+      return (void **) &prim_grid->intr_edge_nbrs;
+    case ICF_GRID_BDRY_EDGES:
+      return (void **) &prim_grid->bdry_edges;
+    case ICF_GRID_BDRY_EDGE_NBRS:
+      return (void **) &prim_grid->bdry_edge_nbrs;
+    case ICF_GRID_BDRY_EDGE_MARKER:
+      return (void **) &prim_grid->bdry_edge_marker;
+    default:
+      return NULL;
+  }
+
+} /* binary_section_data() */
+
+/***********************************************************************
+* Size of the scalar type of every section in the binary grid format
+***********************************************************************/
+static size_t binary_scalar_size(PrimaryGridSection section)
+{
+  return ( section == ICF_GRID_VERTEX_COORDS ) 
+         ? sizeof(double) : sizeof(int32_t);
+
+} /* binary_scalar_size() */
+
+/***********************************************************************
+* Function to free the arrays of an element store. The views of the 
+* quads, tris and their neighbors must be reset by the caller.
+***********************************************************************/
+static void elem_store_free(PrimaryGrid *prim_grid)
+{
+  free( prim_grid->elem_ptr );
+  free( prim_grid->elem_verts );
+  free( prim_grid->elem_nbrs );
+  free( prim_grid->elem_types );
+
+  prim_grid->elem_ptr   = NULL;
+  prim_grid->elem_verts = NULL;
+  prim_grid->elem_nbrs  = NULL;
+  prim_grid->elem_types = NULL;
+  prim_grid->n_elements = 0;
+  prim_grid->n_polys    = 0;
+
+  memset(prim_grid->elem_blocks, 0, sizeof(prim_grid->elem_blocks));
+
+} /* elem_store_free() */
+
+/***********************************************************************
+* Function to release the element edge map of a primary grid, once 
+* its elements or edges are reordered
+***********************************************************************/
+static void elem_edges_free(PrimaryGrid *prim_grid)
+{
+  free( prim_grid->elem_edges );
+  prim_grid->elem_edges = NULL;
+
+} /* elem_edges_free() */
+
+/***********************************************************************
+* Function to convert an array between host and little-endian byte 
+* order. This is a no-op on little-endian hosts.
+***********************************************************************/
+void PrimaryGrid_swap_to_le(void *data, size_t n_elems, size_t elem_size)
+{
+  const uint16_t probe = 1;
+
+  if ( *(const uint8_t *) &probe == 1 )
+    return;
+
+  uint8_t *bytes = data;
+  size_t i, k;
+
+  for ( i = 0; i < n_elems; i++ )
+  {
+    uint8_t *e = bytes + i * elem_size;
+
+    for ( k = 0; k < elem_size / 2; k++ )
+    {
+      uint8_t tmp = e[k];
+      e[k] = e[elem_size-1-k];
+      e[elem_size-1-k] = tmp;
+    }
+  }
+
+} /* PrimaryGrid_swap_to_le() */
+
+/***********************************************************************
+* Function to convert a binary grid header between host and 
+* little-endian byte order
+***********************************************************************/
+void PrimaryGrid_swap_header_to_le(PrimaryGridHeader *header)
+{
+  PrimaryGrid_swap_to_le(&header->version,    1, sizeof(uint32_t));
+  PrimaryGrid_swap_to_le(&header->n_sections, 1, sizeof(uint32_t));
+  PrimaryGrid_swap_to_le(&header->n_vertices, 5, sizeof(int64_t));
+  PrimaryGrid_swap_to_le(header->offsets, ICF_GRID_N_SECTIONS, 
+                         sizeof(uint64_t));
+  PrimaryGrid_swap_to_le(header->sizes, ICF_GRID_N_SECTIONS, 
+                         sizeof(uint64_t));
+
+} /* PrimaryGrid_swap_header_to_le() */
+
+/***********************************************************************
+* Function to compute the sizes and offsets of all sections of a 
+* binary grid file from the grid dimensions in <header>
+***********************************************************************/
+void PrimaryGrid_init_binary_header(PrimaryGridHeader *header,
+                                    int has_tri_neighbors,
+                                    int has_quad_neighbors)
+{
+  uint64_t *sizes = header->sizes;
+  int i;
+
+  memset(header->magic, 0, sizeof(header->magic));
+  memcpy(header->magic, ICF_GRID_MAGIC, strlen(ICF_GRID_MAGIC));
+
+  header->version    = ICF_GRID_VERSION;
+  header->n_sections = ICF_GRID_N_SECTIONS;
+
+  sizes[ICF_GRID_VERTEX_COORDS]    = 2 * sizeof(double) 
+                                   * header->n_vertices;
+  sizes[ICF_GRID_TRIS]             = 3 * sizeof(int32_t) 
+                                   * header->n_tris;
+  sizes[ICF_GRID_QUADS]            = 4 * sizeof(int32_t) 
+                                   * header->n_quads;
+  sizes[ICF_GRID_TRI_NEIGHBORS]    = has_tri_neighbors 
+                                   ? sizes[ICF_GRID_TRIS] : 0;
+  sizes[ICF_GRID_QUAD_NEIGHBORS]   = has_quad_neighbors
+                                   ? sizes[ICF_GRID_QUADS] : 0;
+  sizes[ICF_GRID_INTR_EDGES]       = 2 * sizeof(int32_t) 
+                                   * header->n_intr_edges;
+  sizes[ICF_GRID_INTR_EDGE_NBRS]   = sizes[ICF_GRID_INTR_EDGES];
+  sizes[ICF_GRID_BDRY_EDGES]       = 2 * sizeof(int32_t) 
+                                   * header->n_bdry_edges;
+  sizes[ICF_GRID_BDRY_EDGE_NBRS]   = sizeof(int32_t) 
+                                   * header->n_bdry_edges;
+  sizes[ICF_GRID_BDRY_EDGE_MARKER] = sizes[ICF_GRID_BDRY_EDGE_NBRS];
+
+  /*--------------------------------------------------------------------
+  | Sections follow the header in their natural order and are 
+  | aligned to ICF_GRID_ALIGNMENT bytes
+  --------------------------------------------------------------------*/
+  uint64_t offset = sizeof(PrimaryGridHeader);
+
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+  {
+    offset = ( offset + ICF_GRID_ALIGNMENT - 1 ) 
+           / ICF_GRID_ALIGNMENT * ICF_GRID_ALIGNMENT;
+
+    header->offsets[i] = offset;
+    offset += sizes[i];
+  }
+
+} /* PrimaryGrid_init_binary_header() */
+
+/***********************************************************************
+* Function to write a primary grid structure to a binary grid file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_write_binary(PrimaryGrid *prim_grid, 
+                             const char  *file_path)
+{
+  PrimaryGridHeader header;
+  FILE *fptr = NULL;
+  int i;
+
+  check( sizeof(int) == sizeof(int32_t), 
+      "Binary grid format requires 32-bit integers.");
+  check( prim_grid->n_polys == 0,
+      "Binary grid format does not support polygons.");
+
+  memset(&header, 0, sizeof(PrimaryGridHeader));
+
+  header.n_vertices   = prim_grid->n_vertices;
+  header.n_tris       = prim_grid->n_tris;
+  header.n_quads      = prim_grid->n_quads;
+  header.n_intr_edges = prim_grid->n_intr_edges;
+  header.n_bdry_edges = prim_grid->n_bdry_edges;
+
+  PrimaryGrid_init_binary_header(&header, 
+                                 prim_grid->tri_neighbors  != NULL,
+                                 prim_grid->quad_neighbors != NULL);
+
+  fptr = fopen(file_path, "wb");
+  check(fptr, "Failed to open %s.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Write header 
+  --------------------------------------------------------------------*/
+  PrimaryGridHeader le_header = header;
+  PrimaryGrid_swap_header_to_le(&le_header);
+
+  check( fwrite(&le_header, sizeof(PrimaryGridHeader), 1, fptr) == 1,
+      "Failed to write header to %s.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Write all sections as one bulk chunk each
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+  {
+    if ( header.sizes[i] < 1 )
+      continue;
+
+    void  *data   = *binary_section_data(prim_grid, i);
+    size_t scalar = binary_scalar_size(i);
+    size_t n      = header.sizes[i] / scalar;
+
+    check( data, "Missing data for binary grid section %d.", i);
+    check( fseek(fptr, (long) header.offsets[i], SEEK_SET) == 0,
+        "Failed to write to %s.", file_path);
+
+    PrimaryGrid_swap_to_le(data, n, scalar);
+    size_t n_written = fwrite(data, scalar, n, fptr);
+    PrimaryGrid_swap_to_le(data, n, scalar);
+
+    check( n_written == n, "Failed to write to %s.", file_path);
+  }
+
+  check( fclose(fptr) == 0, "Failed to write to %s.", file_path);
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fptr )
+    fclose(fptr);
+  return ICF_ERROR;
+
+} /* PrimaryGrid_write_binary() */
+
+/***********************************************************************
+* Function to read a primary grid structure from a binary grid file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_read_binary(PrimaryGrid *prim_grid,
+                            const char  *file_path)
+{
+  PrimaryGridHeader header;
+  FILE *fptr = NULL;
+  int i;
+
+  check( sizeof(int) == sizeof(int32_t), 
+      "Binary grid format requires 32-bit integers.");
+
+  elem_edges_free( prim_grid );
+
+  /* The quads, tris and their neighbors of an element store are views
+   * into the store and are released with it                         */
+  if ( prim_grid->n_elements > 0 )
+  {
+    elem_store_free( prim_grid );
+    prim_grid->quads          = NULL;
+    prim_grid->tris           = NULL;
+    prim_grid->quad_neighbors = NULL;
+    prim_grid->tri_neighbors  = NULL;
+  }
+
+  fptr = fopen(file_path, "rb");
+  check(fptr, "Failed to open %s.", file_path);
+
+  /*--------------------------------------------------------------------
+  | Read and validate header 
+  --------------------------------------------------------------------*/
+  check( fread(&header, sizeof(PrimaryGridHeader), 1, fptr) == 1,
+      "Failed to read header from %s.", file_path);
+
+  PrimaryGrid_swap_header_to_le(&header);
+
+  check( strncmp(header.magic, ICF_GRID_MAGIC, 8) == 0,
+      "%s is not a binary grid file.", file_path);
+  check( header.version == ICF_GRID_VERSION,
+      "Unsupported binary grid version %u in %s.", 
+      header.version, file_path);
+  check( header.n_sections == ICF_GRID_N_SECTIONS,
+      "Invalid number of sections in %s.", file_path);
+
+  /* The counts are stored as int in the primary grid                */
+  check( header.n_vertices   >= 0 && header.n_vertices   <= INT_MAX
+      && header.n_tris       >= 0 && header.n_tris       <= INT_MAX
+      && header.n_quads      >= 0 && header.n_quads      <= INT_MAX
+      && header.n_intr_edges >= 0 && header.n_intr_edges <= INT_MAX
+      && header.n_bdry_edges >= 0 && header.n_bdry_edges <= INT_MAX,
+      "Invalid number of grid entities in %s.", file_path);
+
+  PrimaryGridHeader expected = header;
+  PrimaryGrid_init_binary_header(&expected,
+                                 header.sizes[ICF_GRID_TRI_NEIGHBORS]  > 0,
+                                 header.sizes[ICF_GRID_QUAD_NEIGHBORS] > 0);
+
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+    check( header.sizes[i] == expected.sizes[i],
+        "Invalid size of section %d in %s.", i, file_path);
+
+  prim_grid->n_vertices   = (int) header.n_vertices;
+  prim_grid->n_tris       = (int) header.n_tris;
+  prim_grid->n_quads      = (int) header.n_quads;
+  prim_grid->n_intr_edges = (int) header.n_intr_edges;
+  prim_grid->n_bdry_edges = (int) header.n_bdry_edges;
+
+  /*--------------------------------------------------------------------
+  | Read all sections with one bulk read each -> arrays are 
+  | attached to the grid directly, such that they are freed on errors
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+  {
+    void **data = binary_section_data(prim_grid, i);
+
+    free( *data );
+    *data = NULL;
+
+    if ( header.sizes[i] < 1 )
+      continue;
+
+    size_t scalar = binary_scalar_size(i);
+    size_t n      = header.sizes[i] / scalar;
+
+    *data = malloc( header.sizes[i] );
+    check_mem( *data );
+
+    check( fseek(fptr, (long) header.offsets[i], SEEK_SET) == 0,
+        "Failed to read from %s.", file_path);
+    check( fread(*data, scalar, n, fptr) == n,
+        "Failed to read from %s.", file_path);
+
+    PrimaryGrid_swap_to_le(*data, n, scalar);
+  }
+
+  fclose(fptr);
+
+  return ICF_SUCCESS;
+
+error:
+  if ( fptr )
+    fclose(fptr);
+
+  /* Leave an empty grid behind, such that it can be read again */
+  for ( i = 0; i < ICF_GRID_N_SECTIONS; i++ )
+  {
+    void **data = binary_section_data(prim_grid, i);
+    free( *data );
+    *data = NULL;
+  }
+
+  prim_grid->n_vertices   = 0;
+  prim_grid->n_tris       = 0;
+  prim_grid->n_quads      = 0;
+  prim_grid->n_intr_edges = 0;
+  prim_grid->n_bdry_edges = 0;
+
+  return ICF_ERROR;
+
+} /* PrimaryGrid_read_binary() */
+
+/***********************************************************************
+* Element edge of the topology builder, which is stored in the 
+* bucket of its lower vertex index. <edge> encodes the adjacent 
+* element and the local edge index as position of the edge in the
+* element store layout (see topology_edge_pos).
+***********************************************************************/
+typedef struct 
+{
+  int hi;
+  int edge;
+} TopologyEdge;
+
+typedef struct 
+{
+  PrimaryGrid  *prim_grid;
+  int           n_tasks;
+  int          *offsets;   /* Fill position of every vertex bucket */
+  int          *buckets;   /* Start of every vertex bucket         */
+  TopologyEdge *edges;
+  int          *n_intr;    /* Interior edges of every task         */
+  int          *n_single;  /* Unmatched element edges of every task */
+  int          *status;
+} TopologyCtx;
+
+/***********************************************************************
+* Returns the vertices of the local edge <loc> of element <elem>.
+* Elements are numbered with the quads first, followed by the tris
+* and the polygons.
+***********************************************************************/
+static inline void topology_elem_edge(const PrimaryGrid *prim_grid,
+                                      int elem, int loc,
+                                      int *p0, int *p1)
+{
+  const int *verts = ICF_ELEM_VERTS(prim_grid, elem);
+  const int  n_loc = ICF_ELEM_N_VERTS(prim_grid, elem);
+
+  *p0 = verts[loc];
+  *p1 = verts[ loc+1 < n_loc ? loc+1 : 0 ];
+
+} /* topology_elem_edge() */
+
+/***********************************************************************
+* Returns the neighbor entry of element <elem>, which is adjacent 
+* to its local edge <loc>
+***********************************************************************/
+static inline int *topology_nbr(PrimaryGrid *prim_grid, int elem, int loc)
+{
+  return &ICF_ELEM_NBRS(prim_grid, elem)[loc];
+
+} /* topology_nbr() */
+
+/***********************************************************************
+* Returns the position of the local edge <loc> of element <elem> in 
+* the layout of the element store, i.e. 4 * elem + loc for quads, 
+* followed by three positions per tri and the polygon edges
+***********************************************************************/
+static inline int topology_edge_pos(const PrimaryGrid *prim_grid,
+                                    int elem, int loc)
+{
+  const int n_quads = prim_grid->n_quads;
+
+  if ( elem < n_quads )
+    return 4 * elem + loc;
+
+  if ( elem < n_quads + prim_grid->n_tris )
+    return 4 * n_quads + 3 * ( elem - n_quads ) + loc;
+
+  return prim_grid->elem_ptr[elem] + loc;
+
+} /* topology_edge_pos() */
+
+/***********************************************************************
+* Returns the element and the local edge of the edge position <pos>
+***********************************************************************/
+static inline void topology_edge_elem(const PrimaryGrid *prim_grid,
+                                      int pos, int *elem, int *loc)
+{
+  const int n_quads = prim_grid->n_quads;
+  const int n_tris  = prim_grid->n_tris;
+
+  if ( pos < 4 * n_quads )
+  {
+    *elem = pos / 4;
+    *loc  = pos % 4;
+    return;
+  }
+
+  if ( pos < 4 * n_quads + 3 * n_tris )
+  {
+    *elem = n_quads + ( pos - 4 * n_quads ) / 3;
+    *loc  = ( pos - 4 * n_quads ) % 3;
+    return;
+  }
+
+  /* Polygons: Last element, that starts at or before the position   */
+  int lo = n_quads + n_tris;
+  int hi = prim_grid->n_elements - 1;
+
+  while ( lo < hi )
+  {
+    const int mid = ( lo + hi + 1 ) / 2;
+
+    if ( prim_grid->elem_ptr[mid] <= pos )
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  *elem = lo;
+  *loc  = pos - prim_grid->elem_ptr[lo];
+
+} /* topology_edge_elem() */
+
+/***********************************************************************
+* Returns the range [*begin, *end) of task <i_task>, if <n> items 
+* are distributed evenly over <n_tasks> tasks
+***********************************************************************/
+static inline void topology_range(int n, int n_tasks, int i_task,
+                                  int *begin, int *end)
+{
+  *begin = (int) ( (long) n * i_task       / n_tasks );
+  *end   = (int) ( (long) n * (i_task + 1) / n_tasks );
+
+} /* topology_range() */
+
+/***********************************************************************
+* Increments the bucket counter <counter> and returns its old value.
+* The increment is atomic, if the counters are <shared> by tasks.
+***********************************************************************/
+static inline int topology_fetch_inc(int *counter, int shared)
+{
+  if ( shared )
+    return __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+
+  return (*counter)++;
+
+} /* topology_fetch_inc() */
+
+/***********************************************************************
+* Thread pool task: Counts the element edges of a range of elements
+* for the bucket of their lower vertex index. The counts of vertex v
+* are added atomically to buckets[v+1].
+***********************************************************************/
+static void topology_count_task(void *ctx, int i_task, int i_thread)
+{
+  TopologyCtx *tctx      = ctx;
+  PrimaryGrid *prim_grid = tctx->prim_grid;
+  const int    n_verts   = prim_grid->n_vertices;
+  int         *counts    = tctx->buckets + 1;
+  const int    shared    = ( tctx->n_tasks > 1 );
+  int elem, elem_begin, elem_end, loc, p0, p1;
+
+  topology_range(prim_grid->n_quads + prim_grid->n_tris 
+                 + prim_grid->n_polys, tctx->n_tasks,
+                 i_task, &elem_begin, &elem_end);
+
+  for ( elem = elem_begin; elem < elem_end; elem++ )
+  {
+    const int n_loc = ICF_ELEM_N_VERTS(prim_grid, elem);
+
+    for ( loc = 0; loc < n_loc; loc++ )
+    {
+      topology_elem_edge(prim_grid, elem, loc, &p0, &p1);
+
+      if ( p0 < 0 || p0 >= n_verts || p1 < 0 || p1 >= n_verts 
+           || p0 == p1 )
+      {
+        log_err("Invalid edge (%d,%d) of element %d.", p0, p1, elem);
+        tctx->status[i_task] = ICF_ERROR;
+        return;
+      }
+
+      topology_fetch_inc(&counts[MIN(p0, p1)], shared);
+    }
+  }
+
+  tctx->status[i_task] = ICF_SUCCESS;
+
+} /* topology_count_task() */
+
+/***********************************************************************
+* Thread pool task: Scatters the element edges of a range of elements
+* into the vertex buckets. The order within a bucket depends on the 
+* threads until the buckets are sorted (see topology_sort_task).
+***********************************************************************/
+static void topology_scatter_task(void *ctx, int i_task, int i_thread)
+{
+  TopologyCtx *tctx      = ctx;
+  PrimaryGrid *prim_grid = tctx->prim_grid;
+  int         *offsets   = tctx->offsets;
+  const int    shared    = ( tctx->n_tasks > 1 );
+  int elem, elem_begin, elem_end, loc, p0, p1;
+
+  topology_range(prim_grid->n_quads + prim_grid->n_tris 
+                 + prim_grid->n_polys, tctx->n_tasks,
+                 i_task, &elem_begin, &elem_end);
+
+  for ( elem = elem_begin; elem < elem_end; elem++ )
+  {
+    const int n_loc = ICF_ELEM_N_VERTS(prim_grid, elem);
+
+    for ( loc = 0; loc < n_loc; loc++ )
+    {
+      topology_elem_edge(prim_grid, elem, loc, &p0, &p1);
+
+      const int i = topology_fetch_inc(&offsets[MIN(p0, p1)], shared);
+
+      TopologyEdge *e = &tctx->edges[i];
+      e->hi   = MAX(p0, p1);
+      e->edge = topology_edge_pos(prim_grid, elem, loc);
+    }
+  }
+
+} /* topology_scatter_task() */
+
+/***********************************************************************
+* Thread pool task: Sorts the vertex buckets of a range of vertices 
+* and counts their interior and unmatched edges
+***********************************************************************/
+static void topology_sort_task(void *ctx, int i_task, int i_thread)
+{
+  TopologyCtx  *tctx    = ctx;
+  TopologyEdge *edges   = tctx->edges;
+  int v, v_begin, v_end, i, j, n_run;
+  int n_intr   = 0;
+  int n_single = 0;
+
+  topology_range(tctx->prim_grid->n_vertices, tctx->n_tasks, i_task,
+                 &v_begin, &v_end);
+
+  for ( v = v_begin; v < v_end; v++ )
+  {
+    const int b_begin = tctx->buckets[v];
+    const int b_end   = tctx->buckets[v+1];
+
+    /* Buckets hold only a few edges -> insertion sort by (hi, edge) */
+    for ( i = b_begin + 1; i < b_end; i++ )
+    {
+      TopologyEdge e = edges[i];
+
+      for ( j = i; j > b_begin && ( edges[j-1].hi > e.hi 
+            || ( edges[j-1].hi == e.hi && edges[j-1].edge > e.edge ) );
+            j-- )
+        edges[j] = edges[j-1];
+
+      edges[j] = e;
+    }
+
+    for ( i = b_begin; i < b_end; i += n_run )
+    {
+      for ( n_run = 1; i + n_run < b_end 
+            && edges[i+n_run].hi == edges[i].hi; n_run++ );
+
+      if ( n_run > 2 )
+      {
+        log_err("Edge (%d,%d) is shared by more than two elements.",
+            v, edges[i].hi);
+        tctx->status[i_task] = ICF_ERROR;
+        return;
+      }
+
+      if ( n_run == 2 )
+        ++n_intr;
+      else
+        ++n_single;
+    }
+  }
+
+  tctx->n_intr[i_task]   = n_intr;
+  tctx->n_single[i_task] = n_single;
+  tctx->status[i_task]   = ICF_SUCCESS;
+
+} /* topology_sort_task() */
+
+/***********************************************************************
+* Thread pool task: Creates the interior edges and the element 
+* neighbors of a range of vertex buckets. <n_intr> holds the index 
+* of the first interior edge of every task.
+***********************************************************************/
+static void topology_match_task(void *ctx, int i_task, int i_thread)
+{
+  TopologyCtx  *tctx      = ctx;
+  PrimaryGrid  *prim_grid = tctx->prim_grid;
+  TopologyEdge *edges     = tctx->edges;
+  int v, v_begin, v_end, i;
+  int i_edge = tctx->n_intr[i_task];
+
+  topology_range(prim_grid->n_vertices, tctx->n_tasks, i_task,
+                 &v_begin, &v_end);
+
+  for ( v = v_begin; v < v_end; v++ )
+  {
+    const int b_end = tctx->buckets[v+1];
+
+    for ( i = tctx->buckets[v]; i < b_end; i++ )
+    {
+      int elem_0, loc_0, elem_1, loc_1;
+
+      topology_edge_elem(prim_grid, edges[i].edge, &elem_0, &loc_0);
+
+      if ( i+1 == b_end || edges[i+1].hi != edges[i].hi )
+      {
+        *topology_nbr(prim_grid, elem_0, loc_0) = -1;
+        continue;
+      }
+
+      topology_edge_elem(prim_grid, edges[i+1].edge, &elem_1, &loc_1);
+
+      /* Interior edges are oriented as in their first neighbor */
+      topology_elem_edge(prim_grid, elem_0, loc_0, 
+                         &prim_grid->intr_edges[i_edge][0],
+                         &prim_grid->intr_edges[i_edge][1]);
+
+      prim_grid->intr_edge_nbrs[i_edge][0] = elem_0;
+      prim_grid->intr_edge_nbrs[i_edge][1] = elem_1;
+
+      prim_grid->elem_edges[edges[i].edge]   = i_edge;
+      prim_grid->elem_edges[edges[i+1].edge] = i_edge;
+
+      *topology_nbr(prim_grid, elem_0, loc_0) = elem_1;
+      *topology_nbr(prim_grid, elem_1, loc_1) = elem_0;
+
+      ++i_edge;
+      ++i;
+    }
+  }
+
+} /* topology_match_task() */
+
+/***********************************************************************
+* Assigns the adjacent elements to all boundary edges. Every boundary
+* edge must match exactly one unmatched element edge, which is marked
+* as used afterwards.
+***********************************************************************/
+static int topology_match_bdry(TopologyCtx *tctx, int n_single)
+{
+  PrimaryGrid  *prim_grid = tctx->prim_grid;
+  TopologyEdge *edges     = tctx->edges;
+  int i, j;
+
+  for ( i = 0; i < prim_grid->n_bdry_edges; i++ )
+  {
+    const int p0 = prim_grid->bdry_edges[i][0];
+    const int p1 = prim_grid->bdry_edges[i][1];
+
+    check( p0 >= 0 && p0 < prim_grid->n_vertices 
+        && p1 >= 0 && p1 < prim_grid->n_vertices,
+        "Invalid boundary edge (%d,%d).", p0, p1);
+
+    const int lo = MIN(p0, p1);
+    const int hi = MAX(p0, p1);
+    const int b_end = tctx->buckets[lo+1];
+
+    for ( j = tctx->buckets[lo]; j < b_end && edges[j].hi != hi; j++ );
+
+    check( j < b_end, 
+        "Boundary edge (%d,%d) is not an element edge.", p0, p1);
+    check( j+1 == b_end || edges[j+1].hi != hi,
+        "Boundary edge (%d,%d) is an interior edge.", p0, p1);
+    check( edges[j].edge >= 0,
+        "Boundary edge (%d,%d) is defined twice.", p0, p1);
+
+    int elem, loc;
+
+    topology_edge_elem(prim_grid, edges[j].edge, &elem, &loc);
+
+    prim_grid->bdry_edge_nbrs[i] = elem;
+    prim_grid->elem_edges[edges[j].edge] = prim_grid->n_intr_edges + i;
+    edges[j].edge = -1 - edges[j].edge;
+  }
+
+  if ( n_single == prim_grid->n_bdry_edges )
+    return ICF_SUCCESS;
+
+  /*--------------------------------------------------------------------
+  | Report the first element edge without a boundary definition
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < prim_grid->n_vertices; i++ )
+    for ( j = tctx->buckets[i]; j < tctx->buckets[i+1]; j++ )
+    {
+      int is_single = ( j+1 == tctx->buckets[i+1] 
+                     || edges[j+1].hi != edges[j].hi )
+                   && ( j == tctx->buckets[i] 
+                     || edges[j-1].hi != edges[j].hi );
+
+      check( !is_single || edges[j].edge < 0,
+          "Edge (%d,%d) is neither interior nor a boundary edge.", 
+          i, edges[j].hi);
+    }
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* topology_match_bdry() */
+
+/***********************************************************************
+* Function to build the connectivity of a primary grid from its 
+* vertices, elements and marked boundary edges.
+***********************************************************************/
+int PrimaryGrid_build_topology(PrimaryGrid *prim_grid, int n_threads)
+{
+  TopologyCtx ctx;
+  ThreadPool *pool = NULL;
+  int v, i_task;
+
+  memset(&ctx, 0, sizeof(ctx));
+
+  const int n_verts = prim_grid->n_vertices;
+  const int n_elems = prim_grid->n_quads + prim_grid->n_tris 
+                    + prim_grid->n_polys;
+
+  check( n_verts > 0, "No vertices defined for primary grid.");
+  check( n_elems > 0, "No elements defined for primary grid.");
+  check( prim_grid->n_bdry_edges > 0, 
+      "No boundary edges defined for primary grid.");
+  check( prim_grid->n_quads < INT_MAX / 4 - prim_grid->n_tris, 
+      "Too many elements in primary grid.");
+
+  /* Number of element edges */
+  const int n_elem_edges = ( prim_grid->n_elements > 0 )
+                         ? prim_grid->elem_ptr[n_elems]
+                         : 4 * prim_grid->n_quads + 3 * prim_grid->n_tris;
+
+  pool = ThreadPool_create(n_threads);
+  check( pool, "Failed to create thread pool.");
+
+  ctx.prim_grid = prim_grid;
+  ctx.n_tasks   = pool->n_threads;
+  ctx.offsets   = calloc(n_verts, sizeof(int));
+  ctx.buckets   = calloc(n_verts + 1, sizeof(int));
+  ctx.edges     = calloc(MAX(n_elem_edges, 1), sizeof(TopologyEdge));
+  ctx.n_intr    = calloc(ctx.n_tasks + 1, sizeof(int));
+  ctx.n_single  = calloc(ctx.n_tasks, sizeof(int));
+  ctx.status    = calloc(ctx.n_tasks, sizeof(int));
+  check_mem(ctx.offsets);
+  check_mem(ctx.buckets);
+  check_mem(ctx.edges);
+  check_mem(ctx.n_intr);
+  check_mem(ctx.n_single);
+  check_mem(ctx.status);
+
+  /*--------------------------------------------------------------------
+  | Bucket all element edges by their lower vertex index
+  --------------------------------------------------------------------*/
+  ThreadPool_run(pool, ctx.n_tasks, topology_count_task, &ctx);
+
+  for ( i_task = 0; i_task < ctx.n_tasks; i_task++ )
+    check( ctx.status[i_task], "Invalid elements in primary grid.");
+
+  for ( v = 0; v < n_verts; v++ )
+  {
+    ctx.buckets[v+1] += ctx.buckets[v];
+    ctx.offsets[v]    = ctx.buckets[v];
+  }
+
+  ThreadPool_run(pool, ctx.n_tasks, topology_scatter_task, &ctx);
+
+  /*--------------------------------------------------------------------
+  | Sort the buckets and count the interior and boundary edges
+  --------------------------------------------------------------------*/
+  ThreadPool_run(pool, ctx.n_tasks, topology_sort_task, &ctx);
+
+  for ( i_task = 0; i_task < ctx.n_tasks; i_task++ )
+    check( ctx.status[i_task], "Invalid connectivity of primary grid.");
+
+  int n_intr   = 0;
+  int n_single = 0;
+
+  for ( i_task = 0; i_task < ctx.n_tasks; i_task++ )
+  {
+    int count = ctx.n_intr[i_task];
+    ctx.n_intr[i_task] = n_intr;
+    n_intr   += count;
+    n_single += ctx.n_single[i_task];
+  }
+
+  /*--------------------------------------------------------------------
+  | Allocate the connectivity arrays
+  --------------------------------------------------------------------*/
+  free( prim_grid->intr_edges );
+  free( prim_grid->intr_edge_nbrs );
+  prim_grid->n_intr_edges   = 0;
+  prim_grid->intr_edges     = calloc(MAX(n_intr, 1), 2*sizeof(int));
+  prim_grid->intr_edge_nbrs = calloc(MAX(n_intr, 1), 2*sizeof(int));
+  check_mem(prim_grid->intr_edges);
+  check_mem(prim_grid->intr_edge_nbrs);
+  prim_grid->n_intr_edges   = n_intr;
+
+  free( prim_grid->elem_edges );
+  prim_grid->elem_edges = malloc(MAX(n_elem_edges, 1) * sizeof(int));
+  check_mem(prim_grid->elem_edges);
+
+  if ( !prim_grid->bdry_edge_nbrs )
+  {
+    prim_grid->bdry_edge_nbrs = calloc(prim_grid->n_bdry_edges, 
+                                       sizeof(int));
+    check_mem(prim_grid->bdry_edge_nbrs);
+  }
+
+  /* The neighbors of an element store are views of its blocks      */
+  if ( prim_grid->n_elements > 0 && !prim_grid->elem_nbrs )
+  {
+    prim_grid->elem_nbrs = calloc(MAX(n_elem_edges, 1), sizeof(int));
+    check_mem(prim_grid->elem_nbrs);
+
+    prim_grid->quad_neighbors = (int (*)[4]) prim_grid->elem_nbrs;
+    prim_grid->tri_neighbors  = (int (*)[3]) ( prim_grid->elem_nbrs 
+                                             + 4 * prim_grid->n_quads );
+  }
+
+  if ( !prim_grid->quad_neighbors && prim_grid->n_quads > 0 )
+  {
+    prim_grid->quad_neighbors = calloc(prim_grid->n_quads, 
+                                       4*sizeof(int));
+    check_mem(prim_grid->quad_neighbors);
+  }
+
+  if ( !prim_grid->tri_neighbors && prim_grid->n_tris > 0 )
+  {
+    prim_grid->tri_neighbors = calloc(prim_grid->n_tris, 3*sizeof(int));
+    check_mem(prim_grid->tri_neighbors);
+  }
+
+  /*--------------------------------------------------------------------
+  | Match the element edges
+  --------------------------------------------------------------------*/
+  ThreadPool_run(pool, ctx.n_tasks, topology_match_task, &ctx);
+
+  check( topology_match_bdry(&ctx, n_single),
+      "Boundary edges do not match the primary grid elements.");
+
+  ThreadPool_destroy( pool );
+  free( ctx.offsets );
+  free( ctx.buckets );
+  free( ctx.edges );
+  free( ctx.n_intr );
+  free( ctx.n_single );
+  free( ctx.status );
+
+  return ICF_SUCCESS;
+
+error:
+  if ( pool )
+    ThreadPool_destroy( pool );
+  elem_edges_free( prim_grid );
+  free( ctx.offsets );
+  free( ctx.buckets );
+  free( ctx.edges );
+  free( ctx.n_intr );
+  free( ctx.n_single );
+  free( ctx.status );
+
+  return ICF_ERROR;
+
+} /* PrimaryGrid_build_topology() */
+
+/***********************************************************************
+* Function to replace the element store of a primary grid, which holds
+* no polygons, by separate quad and tri arrays
+***********************************************************************/
+static int elem_store_detach(PrimaryGrid *prim_grid)
+{
+  const int n_quads = prim_grid->n_quads;
+  const int n_tris  = prim_grid->n_tris;
+  const int has_nbrs = ( prim_grid->elem_nbrs != NULL );
+
+  int (*quads)[4]     = malloc(( (size_t) n_quads + 1 ) * 4*sizeof(int));
+  int (*tris)[3]      = malloc(( (size_t) n_tris  + 1 ) * 3*sizeof(int));
+  int (*quad_nbrs)[4] = NULL;
+  int (*tri_nbrs)[3]  = NULL;
+
+  check( prim_grid->n_polys == 0, 
+      "Polygons can not be stored as quads and tris.");
+  check_mem(quads);
+  check_mem(tris);
+
+  memcpy(quads, prim_grid->quads, (size_t) n_quads * 4*sizeof(int));
+  memcpy(tris,  prim_grid->tris,  (size_t) n_tris  * 3*sizeof(int));
+
+  if ( has_nbrs )
+  {
+    quad_nbrs = malloc(( (size_t) n_quads + 1 ) * 4*sizeof(int));
+    tri_nbrs  = malloc(( (size_t) n_tris  + 1 ) * 3*sizeof(int));
+    check_mem(quad_nbrs);
+    check_mem(tri_nbrs);
+
+    memcpy(quad_nbrs, prim_grid->quad_neighbors, 
+           (size_t) n_quads * 4*sizeof(int));
+    memcpy(tri_nbrs,  prim_grid->tri_neighbors,  
+           (size_t) n_tris  * 3*sizeof(int));
+  }
+
+  elem_store_free( prim_grid );
+
+  prim_grid->quads          = quads;
+  prim_grid->tris           = tris;
+  prim_grid->quad_neighbors = quad_nbrs;
+  prim_grid->tri_neighbors  = tri_nbrs;
+
+  return ICF_SUCCESS;
+
+error:
+  free( quads );
+  free( tris );
+  free( quad_nbrs );
+  free( tri_nbrs );
+  return ICF_ERROR;
+
+} /* elem_store_detach() */
+
+/***********************************************************************
+* Function to set up the unified element store of a primary grid
+***********************************************************************/
+int PrimaryGrid_build_elements(PrimaryGrid *prim_grid,
+                               int          n_polys,
+                               const int   *poly_ptr,
+                               const int   *poly_verts)
+{
+  const int n_old_quads = prim_grid->n_quads;
+  const int n_old_tris  = prim_grid->n_tris;
+  const int n_old_polys = prim_grid->n_polys;
+  const int n_old_elems = n_old_quads + n_old_tris + n_old_polys;
+
+  /* Neighbors are kept, if the element numbering does not change     */
+  const int has_nbrs = ( n_polys == 0 )
+    && ( n_old_quads == 0 || prim_grid->quad_neighbors )
+    && ( n_old_tris  == 0 || prim_grid->tri_neighbors  )
+    && ( n_old_polys == 0 || prim_grid->elem_nbrs      );
+
+  int           *ptr   = NULL;
+  int           *verts = NULL;
+  int           *nbrs  = NULL;
+  unsigned char *types = NULL;
+
+  int n_quads = n_old_quads;
+  int n_tris  = n_old_tris;
+  int n_elems = n_old_elems;
+  int i, k, e, i_quad, i_tri, i_poly;
+  long n_pos;
+
+  /*--------------------------------------------------------------------
+  | Sort the added polygons into the element blocks
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_polys; i++ )
+  {
+    const int n_loc = poly_ptr[i+1] - poly_ptr[i];
+
+    check( n_loc >= 3, "Polygon %d has less than three vertices.", i);
+
+    for ( k = poly_ptr[i]; k < poly_ptr[i+1]; k++ )
+      check( poly_verts[k] >= 0 && poly_verts[k] < prim_grid->n_vertices,
+          "Invalid vertex %d of polygon %d.", poly_verts[k], i);
+
+    if ( n_loc == 4 )
+      ++n_quads;
+    else if ( n_loc == 3 )
+      ++n_tris;
+
+    ++n_elems;
+  }
+
+  ptr   = malloc(( (size_t) n_elems + 1 ) * sizeof(int));
+  types = malloc(( (size_t) n_elems + 1 ) * sizeof(unsigned char));
+  check_mem(ptr);
+  check_mem(types);
+
+  /*--------------------------------------------------------------------
+  | Element pointers: quads, tris, existing and added polygons
+  --------------------------------------------------------------------*/
+  n_pos  = 4L * n_quads + 3L * n_tris;
+  i_poly = n_quads + n_tris;
+
+  for ( e = 0; e < i_poly; e++ )
+  {
+    ptr[e]   = ( e < n_quads ) ? 4 * e : 4 * n_quads + 3 * ( e - n_quads );
+    types[e] = ( e < n_quads ) ? ICF_ELEM_QUAD : ICF_ELEM_TRI;
+  }
+
+  for ( e = n_old_quads + n_old_tris; e < n_old_elems; e++, i_poly++ )
+  {
+    ptr[i_poly]   = (int) MIN(n_pos, INT_MAX);
+    types[i_poly] = ICF_ELEM_POLY;
+    n_pos += prim_grid->elem_ptr[e+1] - prim_grid->elem_ptr[e];
+  }
+
+  for ( i = 0; i < n_polys; i++ )
+  {
+    const int n_loc = poly_ptr[i+1] - poly_ptr[i];
+
+    if ( n_loc <= 4 )
+      continue;
+
+    ptr[i_poly]   = (int) MIN(n_pos, INT_MAX);
+    types[i_poly] = ICF_ELEM_POLY;
+    n_pos += n_loc;
+    ++i_poly;
+  }
+
+  check( n_pos < INT_MAX, "Too many element vertices in primary grid.");
+
+  ptr[n_elems] = (int) n_pos;
+
+  verts = malloc(( (size_t) n_pos + 1 ) * sizeof(int));
+  check_mem(verts);
+
+  if ( has_nbrs )
+  {
+    nbrs = malloc(( (size_t) n_pos + 1 ) * sizeof(int));
+    check_mem(nbrs);
+  }
+
+  /*--------------------------------------------------------------------
+  | Copy the existing elements, followed by the added polygons of 
+  | every block
+  --------------------------------------------------------------------*/
+  memcpy(verts, prim_grid->quads, (size_t) n_old_quads * 4*sizeof(int));
+  memcpy(verts + ptr[n_quads], prim_grid->tris, 
+         (size_t) n_old_tris * 3*sizeof(int));
+
+  if ( n_old_polys > 0 )
+    memcpy(verts + ptr[n_quads + n_tris], 
+           prim_grid->elem_verts + prim_grid->elem_ptr[n_old_quads 
+                                                       + n_old_tris],
+           (size_t) ( prim_grid->elem_ptr[n_old_elems] 
+                    - prim_grid->elem_ptr[n_old_quads + n_old_tris] ) 
+           * sizeof(int));
+
+  if ( has_nbrs )
+  {
+    memcpy(nbrs, prim_grid->quad_neighbors, 
+           (size_t) n_old_quads * 4*sizeof(int));
+    memcpy(nbrs + ptr[n_quads], prim_grid->tri_neighbors, 
+           (size_t) n_old_tris * 3*sizeof(int));
+
+    if ( n_old_polys > 0 )
+      memcpy(nbrs + ptr[n_quads + n_tris], 
+             prim_grid->elem_nbrs + prim_grid->elem_ptr[n_old_quads 
+                                                        + n_old_tris],
+             (size_t) ( n_pos - ptr[n_quads + n_tris] ) * sizeof(int));
+  }
+
+  i_quad = n_old_quads;
+  i_tri  = n_quads + n_old_tris;
+  i_poly = n_quads + n_tris + n_old_polys;
+
+  for ( i = 0; i < n_polys; i++ )
+  {
+    const int n_loc = poly_ptr[i+1] - poly_ptr[i];
+
+    if ( n_loc == 4 )
+      e = i_quad++;
+    else if ( n_loc == 3 )
+      e = i_tri++;
+    else
+      e = i_poly++;
+
+    memcpy(verts + ptr[e], poly_verts + poly_ptr[i], n_loc * sizeof(int));
+  }
+
+  /*--------------------------------------------------------------------
+  | Replace the element arrays by views of the store
+  --------------------------------------------------------------------*/
+  if ( !has_nbrs )
+    elem_edges_free( prim_grid );
+
+  if ( prim_grid->n_elements > 0 )
+    elem_store_free( prim_grid );
+  else
+  {
+    free( prim_grid->quads );
+    free( prim_grid->tris );
+    free( prim_grid->quad_neighbors );
+    free( prim_grid->tri_neighbors );
+  }
+
+  prim_grid->n_quads    = n_quads;
+  prim_grid->n_tris     = n_tris;
+  prim_grid->n_polys    = n_elems - n_quads - n_tris;
+  prim_grid->n_elements = n_elems;
+  prim_grid->elem_ptr   = ptr;
+  prim_grid->elem_verts = verts;
+  prim_grid->elem_nbrs  = nbrs;
+  prim_grid->elem_types = types;
+
+  prim_grid->elem_blocks[ICF_ELEM_QUAD]    = 0;
+  prim_grid->elem_blocks[ICF_ELEM_TRI]     = n_quads;
+  prim_grid->elem_blocks[ICF_ELEM_POLY]    = n_quads + n_tris;
+  prim_grid->elem_blocks[ICF_ELEM_N_TYPES] = n_elems;
+
+  prim_grid->quads = (int (*)[4]) verts;
+  prim_grid->tris  = (int (*)[3]) ( verts + ptr[n_quads] );
+
+  prim_grid->quad_neighbors = nbrs ? (int (*)[4]) nbrs : NULL;
+  prim_grid->tri_neighbors  = nbrs ? (int (*)[3]) ( nbrs + ptr[n_quads] ) 
+                                   : NULL;
+
+  return ICF_SUCCESS;
+
+error:
+  free( ptr );
+  free( verts );
+  free( nbrs );
+  free( types );
+  return ICF_ERROR;
+
+} /* PrimaryGrid_build_elements() */
+
+/***********************************************************************
+* Function to renumber the vertices of a primary grid, such that 
+* vertex i becomes vertex <new_index>[i]
+***********************************************************************/
+int PrimaryGrid_permute_vertices(PrimaryGrid *prim_grid, 
+                                 const int   *new_index)
+{
+  const int n_verts = prim_grid->n_vertices;
+  double (*coords)[2] = NULL;
+  int     *order      = NULL;
+  int i, k;
+
+  coords = calloc(n_verts, 2*sizeof(double));
+  order  = malloc(n_verts * sizeof(int));
+  check_mem(coords);
+  check_mem(order);
+
+  for ( i = 0; i < n_verts; i++ )
+    order[i] = -1;
+
+  for ( i = 0; i < n_verts; i++ )
+  {
+    const int j = new_index[i];
+
+    check( j >= 0 && j < n_verts && order[j] < 0,
+        "Invalid vertex permutation.");
+
+    coords[j][0] = prim_grid->vertex_coords[i][0];
+    coords[j][1] = prim_grid->vertex_coords[i][1];
+    order[j]     = prim_grid->vertex_order ? prim_grid->vertex_order[i]
+                                           : i;
+  }
+
+  /*--------------------------------------------------------------------
+  | Update all vertex references
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < prim_grid->n_tris; i++ )
+    for ( k = 0; k < 3; k++ )
+      prim_grid->tris[i][k] = new_index[ prim_grid->tris[i][k] ];
+
+  for ( i = 0; i < prim_grid->n_quads; i++ )
+    for ( k = 0; k < 4; k++ )
+      prim_grid->quads[i][k] = new_index[ prim_grid->quads[i][k] ];
+
+  if ( prim_grid->n_polys > 0 )
+    for ( i = prim_grid->elem_ptr[prim_grid->n_quads + prim_grid->n_tris];
+          i < prim_grid->elem_ptr[prim_grid->n_elements]; i++ )
+      prim_grid->elem_verts[i] = new_index[ prim_grid->elem_verts[i] ];
+
+  for ( i = 0; i < prim_grid->n_intr_edges; i++ )
+    for ( k = 0; k < 2; k++ )
+      prim_grid->intr_edges[i][k] = new_index[ prim_grid->intr_edges[i][k] ];
+
+  for ( i = 0; i < prim_grid->n_bdry_edges; i++ )
+    for ( k = 0; k < 2; k++ )
+      prim_grid->bdry_edges[i][k] = new_index[ prim_grid->bdry_edges[i][k] ];
+
+  free( prim_grid->vertex_coords );
+  free( prim_grid->vertex_order );
+  prim_grid->vertex_coords = coords;
+  prim_grid->vertex_order  = order;
+
+  return ICF_SUCCESS;
+
+error:
+  free( coords );
+  free( order );
+  return ICF_ERROR;
+
+} /* PrimaryGrid_permute_vertices() */
+
+/***********************************************************************
+* Function to compute the bandwidth of the vertex connectivity
+***********************************************************************/
+int PrimaryGrid_bandwidth(const PrimaryGrid *prim_grid)
+{
+  int i, bw = 0;
+
+  for ( i = 0; i < prim_grid->n_intr_edges; i++ )
+    bw = MAX(bw, abs( prim_grid->intr_edges[i][0] 
+                    - prim_grid->intr_edges[i][1] ));
+
+  for ( i = 0; i < prim_grid->n_bdry_edges; i++ )
+    bw = MAX(bw, abs( prim_grid->bdry_edges[i][0] 
+                    - prim_grid->bdry_edges[i][1] ));
+
+  return bw;
+
+} /* PrimaryGrid_bandwidth() */
+
+/***********************************************************************
+* Sorts the interior edges by their lower vertex index (stable 
+* counting sort), such that edge loops traverse the vertices in order
+***********************************************************************/
+static int sort_intr_edges(PrimaryGrid *prim_grid)
+{
+  const int n_edges = prim_grid->n_intr_edges;
+  int (*edges)[2] = NULL;
+  int (*nbrs)[2]  = NULL;
+  int  *offsets   = NULL;
+  int i, v;
+
+  elem_edges_free( prim_grid );
+
+  edges   = malloc((n_edges + 1) * 2 * sizeof(int));
+  nbrs    = malloc((n_edges + 1) * 2 * sizeof(int));
+  offsets = calloc(prim_grid->n_vertices + 1, sizeof(int));
+  check_mem(edges);
+  check_mem(nbrs);
+  check_mem(offsets);
+
+  for ( i = 0; i < n_edges; i++ )
+    ++offsets[ MIN(prim_grid->intr_edges[i][0], 
+                   prim_grid->intr_edges[i][1]) + 1 ];
+
+  for ( v = 0; v < prim_grid->n_vertices; v++ )
+    offsets[v+1] += offsets[v];
+
+  for ( i = 0; i < n_edges; i++ )
+  {
+    const int j = offsets[ MIN(prim_grid->intr_edges[i][0], 
+                               prim_grid->intr_edges[i][1]) ]++;
+
+    memcpy(edges[j], prim_grid->intr_edges[i],     2*sizeof(int));
+    memcpy(nbrs[j],  prim_grid->intr_edge_nbrs[i], 2*sizeof(int));
+  }
+
+  free( prim_grid->intr_edges );
+  free( prim_grid->intr_edge_nbrs );
+  prim_grid->intr_edges     = edges;
+  prim_grid->intr_edge_nbrs = nbrs;
+
+  free( offsets );
+
+  return ICF_SUCCESS;
+
+error:
+  free( edges );
+  free( nbrs );
+  free( offsets );
+  return ICF_ERROR;
+
+} /* sort_intr_edges() */
+
+/***********************************************************************
+* Vertex graph of the primary grid edges in compressed row storage
+***********************************************************************/
+typedef struct 
+{
+  int  n;
+  int *ptr;
+  int *adj;
+} RCMGraph;
+
+/***********************************************************************
+* Breadth-first search from vertex <start>, which stores the visited
+* vertices in <queue>. Vertices are marked with <stamp> in <mark>.
+* Returns the number of levels, the start of the last level is 
+* stored in <last> and the number of visited vertices in <n_visited>.
+***********************************************************************/
+static int rcm_levels(const RCMGraph *graph, int start, 
+                      int *mark, int stamp, int *queue, 
+                      int *last, int *n_visited)
+{
+  int head = 0, tail = 0, n_levels = 0, i, level_end;
+
+  queue[tail++] = start;
+  mark[start]   = stamp;
+
+  while ( head < tail )
+  {
+    *last     = head;
+    level_end = tail;
+    ++n_levels;
+
+    for ( ; head < level_end; head++ )
+    {
+      const int v = queue[head];
+
+      for ( i = graph->ptr[v]; i < graph->ptr[v+1]; i++ )
+        if ( mark[graph->adj[i]] != stamp )
+        {
+          mark[graph->adj[i]] = stamp;
+          queue[tail++]       = graph->adj[i];
+        }
+    }
+  }
+
+  *n_visited = tail;
+
+  return n_levels;
+
+} /* rcm_levels() */
+
+/***********************************************************************
+* Returns a pseudo-peripheral vertex of the component of <start>
+* (George & Liu): A vertex of minimum degree in the last level of 
+* the breadth-first search is chosen, as long as the number of 
+* levels increases.
+***********************************************************************/
+static int rcm_peripheral(const RCMGraph *graph, int start, 
+                          int *mark, int *stamp, int *queue)
+{
+  int last, n_visited, i;
+  int n_levels = rcm_levels(graph, start, mark, ++(*stamp), queue, 
+                            &last, &n_visited);
+
+  for ( ;; )
+  {
+    int next = queue[last];
+
+    for ( i = last + 1; i < n_visited; i++ )
+    {
+      const int v = queue[i];
+      if ( graph->ptr[v+1] - graph->ptr[v] 
+         < graph->ptr[next+1] - graph->ptr[next] )
+        next = v;
+    }
+
+    int n_next = rcm_levels(graph, next, mark, ++(*stamp), queue, 
+                            &last, &n_visited);
+
+    if ( n_next <= n_levels )
+      return start;
+
+    start    = next;
+    n_levels = n_next;
+  }
+
+} /* rcm_peripheral() */
+
+/***********************************************************************
+* Function to renumber the vertices of a primary grid with the 
+* reverse Cuthill-McKee algorithm
+***********************************************************************/
+int PrimaryGrid_renumber(PrimaryGrid *prim_grid, 
+                         int         *bw_before,
+                         int         *bw_after)
+{
+  const int n_verts = prim_grid->n_vertices;
+  const int n_edges = prim_grid->n_intr_edges + prim_grid->n_bdry_edges;
+
+  RCMGraph graph = { n_verts, NULL, NULL };
+  int *order     = NULL;
+  int *new_index = NULL;
+  int *mark      = NULL;
+  int *queue     = NULL;
+  int i, j, k, v, stamp = 0;
+
+  if ( bw_before )
+    *bw_before = PrimaryGrid_bandwidth(prim_grid);
+
+  graph.ptr = calloc(n_verts + 1, sizeof(int));
+  graph.adj = malloc((2 * (size_t) n_edges + 1) * sizeof(int));
+  order     = malloc((n_verts + 1) * sizeof(int));
+  new_index = malloc((n_verts + 1) * sizeof(int));
+  mark      = calloc(n_verts + 1, sizeof(int));
+  queue     = malloc((n_verts + 1) * sizeof(int));
+  check_mem(graph.ptr);
+  check_mem(graph.adj);
+  check_mem(order);
+  check_mem(new_index);
+  check_mem(mark);
+  check_mem(queue);
+
+  /*--------------------------------------------------------------------
+  | Build the vertex graph
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_edges; i++ )
+  {
+    const int *e = ( i < prim_grid->n_intr_edges ) 
+                 ? prim_grid->intr_edges[i]
+                 : prim_grid->bdry_edges[i - prim_grid->n_intr_edges];
+
+    check( e[0] >= 0 && e[0] < n_verts && e[1] >= 0 && e[1] < n_verts,
+        "Invalid edge (%d,%d) in primary grid.", e[0], e[1]);
+
+    ++graph.ptr[e[0]+1];
+    ++graph.ptr[e[1]+1];
+  }
+
+  for ( v = 0; v < n_verts; v++ )
+    graph.ptr[v+1] += graph.ptr[v];
+
+  for ( v = 0; v < n_verts; v++ )
+    new_index[v] = graph.ptr[v];
+
+  for ( i = 0; i < n_edges; i++ )
+  {
+    const int *e = ( i < prim_grid->n_intr_edges ) 
+                 ? prim_grid->intr_edges[i]
+                 : prim_grid->bdry_edges[i - prim_grid->n_intr_edges];
+
+    graph.adj[ new_index[e[0]]++ ] = e[1];
+    graph.adj[ new_index[e[1]]++ ] = e[0];
+  }
+
+  /*--------------------------------------------------------------------
+  | Cuthill-McKee ordering of every connected component, starting 
+  | from a pseudo-peripheral vertex. Neighbors are visited in order 
+  | of increasing degree. <new_index> marks the ordered vertices.
+  --------------------------------------------------------------------*/
+  for ( v = 0; v < n_verts; v++ )
+    new_index[v] = -1;
+
+  int n_ordered = 0;
+
+  for ( v = 0; v < n_verts; v++ )
+  {
+    if ( new_index[v] >= 0 )
+      continue;
+
+    int head = n_ordered;
+    int start = rcm_peripheral(&graph, v, mark, &stamp, queue);
+
+    order[n_ordered++] = start;
+    new_index[start]   = 0;
+
+    for ( ; head < n_ordered; head++ )
+    {
+      const int u     = order[head];
+      const int first = n_ordered;
+
+      for ( i = graph.ptr[u]; i < graph.ptr[u+1]; i++ )
+      {
+        const int w = graph.adj[i];
+
+        if ( new_index[w] >= 0 )
+          continue;
+
+        new_index[w] = 0;
+
+        const int deg_w = graph.ptr[w+1] - graph.ptr[w];
+
+        for ( j = n_ordered; j > first; j-- )
+        {
+          k = order[j-1];
+          if ( graph.ptr[k+1] - graph.ptr[k] <= deg_w )
+            break;
+          order[j] = k;
+        }
+
+        order[j] = w;
+        ++n_ordered;
+      }
+    }
+  }
+
+  /*--------------------------------------------------------------------
+  | Reverse the ordering
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_verts; i++ )
+    new_index[ order[i] ] = n_verts - 1 - i;
+
+  check( PrimaryGrid_permute_vertices(prim_grid, new_index),
+      "Failed to renumber primary grid vertices.");
+  check( sort_intr_edges(prim_grid),
+      "Failed to renumber primary grid vertices.");
+
+  if ( bw_after )
+    *bw_after = PrimaryGrid_bandwidth(prim_grid);
+
+  free( graph.ptr );
+  free( graph.adj );
+  free( order );
+  free( new_index );
+  free( mark );
+  free( queue );
+
+  return ICF_SUCCESS;
+
+error:
+  free( graph.ptr );
+  free( graph.adj );
+  free( order );
+  free( new_index );
+  free( mark );
+  free( queue );
+  return ICF_ERROR;
+
+} /* PrimaryGrid_renumber() */
+
+/***********************************************************************
+* Function to compute the index of the point (ix,iy) on a Morton or 
+* Hilbert curve through the grid [0, 2^ICF_SFC_BITS)^2
+***********************************************************************/
+uint64_t PrimaryGrid_sfc_key(SFCType curve, uint32_t ix, uint32_t iy)
+{
+  const uint32_t mask = ( 1u << ICF_SFC_BITS ) - 1u;
+
+  ix &= mask;
+  iy &= mask;
+
+  uint64_t key = 0;
+
+  if ( curve == ICF_SFC_MORTON )
+  {
+    uint64_t x = ix, y = iy;
+    int i;
+
+    /* Spread the bits of both coordinates and interleave them      */
+    static const uint64_t masks[5] = {
+      0x0000FFFF0000FFFFull, 0x00FF00FF00FF00FFull, 
+      0x0F0F0F0F0F0F0F0Full, 0x3333333333333333ull,
+      0x5555555555555555ull };
+
+    for ( i = 0; i < 5; i++ )
+    {
+      const int shift = 16 >> i;
+      x = ( x | ( x << shift ) ) & masks[i];
+      y = ( y | ( y << shift ) ) & masks[i];
+    }
+
+    return x | ( y << 1 );
+  }
+
+  /*--------------------------------------------------------------------
+  | Hilbert curve: Descend from the coarsest quadrant and rotate the
+  | remaining coordinates into the orientation of the subcurve. 
+  | The rotation is branch-free, since the quadrants are random.
+  --------------------------------------------------------------------*/
+  int b;
+
+  for ( b = ICF_SFC_BITS - 1; b >= 0; b-- )
+  {
+    const uint32_t rx = ( ix >> b ) & 1u;
+    const uint32_t ry = ( iy >> b ) & 1u;
+
+    key = ( key << 2 ) | ( ( 3u * rx ) ^ ry );
+
+    /* Reflect for (rx,ry) = (1,0) and swap for ry = 0              */
+    const uint32_t flip = ( 0u - ( rx & ( ry ^ 1u ) ) ) & mask;
+    const uint32_t swap = ( ix ^ iy ) & ( 0u - ( ry ^ 1u ) );
+
+    ix ^= flip;
+    iy ^= flip;
+    ix ^= swap;
+    iy ^= swap;
+  }
+
+  return key;
+
+} /* PrimaryGrid_sfc_key() */
+
+/***********************************************************************
+* Bounding box, which maps coordinates to the SFC grid
+***********************************************************************/
+typedef struct 
+{
+  SFCType curve;
+  double  min[2];
+  double  scale[2];
+} SFCBox;
+
+static inline uint64_t sfc_point_key(const SFCBox *box, 
+                                     double x, double y)
+{
+  const uint32_t ix = (uint32_t) ( ( x - box->min[0] ) * box->scale[0] );
+  const uint32_t iy = (uint32_t) ( ( y - box->min[1] ) * box->scale[1] );
+
+  return PrimaryGrid_sfc_key(box->curve, ix, iy);
+
+} /* sfc_point_key() */
+
+/***********************************************************************
+* Computes the sorting permutation of <n> keys with a LSD radix sort 
+* of 11-bit digits: <new_index>[i] is the position of key i.
+* Keys are limited to 2*ICF_SFC_BITS bits, such that every key is 
+* packed together with its index into a single 64-bit word.
+***********************************************************************/
+#define SFC_RADIX_BITS 11
+
+static int sfc_sort(const uint64_t *keys, int n, int *new_index)
+{
+  uint64_t *words  = malloc(( 2 * (size_t) n + 1 ) * sizeof(uint64_t));
+  int      *counts = malloc(( (1 << SFC_RADIX_BITS) + 1 ) * sizeof(int));
+  int i, shift, d;
+
+  check_mem(words);
+  check_mem(counts);
+
+  uint64_t *src = words;
+  uint64_t *dst = words + n;
+
+  for ( i = 0; i < n; i++ )
+    src[i] = ( keys[i] << 32 ) | (uint64_t) i;
+
+  for ( shift = 32; shift < 32 + 2 * ICF_SFC_BITS; 
+        shift += SFC_RADIX_BITS )
+  {
+    const uint64_t digit_mask = ( 1u << SFC_RADIX_BITS ) - 1u;
+
+    memset(counts, 0, ( (1 << SFC_RADIX_BITS) + 1 ) * sizeof(int));
+
+    for ( i = 0; i < n; i++ )
+      ++counts[ ( ( src[i] >> shift ) & digit_mask ) + 1 ];
+
+    for ( d = 0; d < (1 << SFC_RADIX_BITS); d++ )
+      counts[d+1] += counts[d];
+
+    for ( i = 0; i < n; i++ )
+      dst[ counts[ ( src[i] >> shift ) & digit_mask ]++ ] = src[i];
+
+    uint64_t *t = src;
+    src = dst;
+    dst = t;
+  }
+
+  for ( i = 0; i < n; i++ )
+    new_index[ (uint32_t) src[i] ] = i;
+
+  free( words );
+  free( counts );
+
+  return ICF_SUCCESS;
+
+error:
+  free( words );
+  free( counts );
+  return ICF_ERROR;
+
+} /* sfc_sort() */
+
+/***********************************************************************
+* Moves the rows of an array of <n> rows with <row_size> bytes, 
+* such that row i becomes row <new_index>[i]
+***********************************************************************/
+static int permute_rows(void **data, int n, size_t row_size, 
+                        const int *new_index)
+{
+  char *rows = malloc(( (size_t) n + 1 ) * row_size);
+  int i;
+
+  check_mem(rows);
+
+  for ( i = 0; i < n; i++ )
+    memcpy(rows + (size_t) new_index[i] * row_size,
+           (char *) *data + (size_t) i * row_size, row_size);
+
+  free( *data );
+  *data = rows;
+
+  return ICF_SUCCESS;
+
+error:
+  return ICF_ERROR;
+
+} /* permute_rows() */
+
+/***********************************************************************
+* Function to reorder a primary grid along a space-filling curve
+***********************************************************************/
+int PrimaryGrid_reorder_sfc(PrimaryGrid *prim_grid, SFCType curve)
+{
+  const int n_verts = prim_grid->n_vertices;
+  const int n_quads = prim_grid->n_quads;
+  const int n_tris  = prim_grid->n_tris;
+  const int n_intr  = prim_grid->n_intr_edges;
+  const int n_bdry  = prim_grid->n_bdry_edges;
+  const int n_max   = MAX(MAX(n_verts, n_quads + n_tris), 
+                          MAX(n_intr, n_bdry));
+
+  const int has_store = ( prim_grid->n_elements > 0 );
+
+  uint64_t *keys      = NULL;
+  int      *new_index = NULL;
+  int      *new_elem  = NULL;
+  SFCBox    box;
+  int i, k;
+
+  double (*xy)[2];
+
+  elem_edges_free( prim_grid );
+
+  /* The element rows are permuted as separate quad and tri arrays    */
+  if ( has_store )
+    check( elem_store_detach(prim_grid), 
+        "Failed to reorder primary grid.");
+
+  keys      = malloc(( (size_t) n_max + 1 ) * sizeof(uint64_t));
+  new_index = malloc(( (size_t) n_max + 1 ) * sizeof(int));
+  new_elem  = malloc(( (size_t) n_quads + n_tris + 1 ) * sizeof(int));
+  check_mem(keys);
+  check_mem(new_index);
+  check_mem(new_elem);
+
+  /*--------------------------------------------------------------------
+  | Map the bounding box of the grid to the SFC grid
+  --------------------------------------------------------------------*/
+  box.curve = curve;
+  box.min[0] = box.min[1] =  1.0E300;
+  double max[2] = { -1.0E300, -1.0E300 };
+
+  for ( i = 0; i < n_verts; i++ )
+    for ( k = 0; k < 2; k++ )
+    {
+      box.min[k] = MIN(box.min[k], prim_grid->vertex_coords[i][k]);
+      max[k]     = MAX(max[k],     prim_grid->vertex_coords[i][k]);
+    }
+
+  for ( k = 0; k < 2; k++ )
+    box.scale[k] = ( max[k] > box.min[k] ) 
+                 ? (double) ( ( 1u << ICF_SFC_BITS ) - 1u ) 
+                   / ( max[k] - box.min[k] ) : 0.0;
+
+  /*--------------------------------------------------------------------
+  | Vertices
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_verts; i++ )
+    keys[i] = sfc_point_key(&box, prim_grid->vertex_coords[i][0],
+                                  prim_grid->vertex_coords[i][1]);
+
+  check( sfc_sort(keys, n_verts, new_index), 
+      "Failed to reorder primary grid.");
+  check( PrimaryGrid_permute_vertices(prim_grid, new_index),
+      "Failed to reorder primary grid.");
+
+  xy = prim_grid->vertex_coords;
+
+  /*--------------------------------------------------------------------
+  | Elements: quads and tris are ordered separately, such that the
+  | quads are still numbered in front of the tris
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_quads; i++ )
+  {
+    const int *q = prim_grid->quads[i];
+    keys[i] = sfc_point_key(&box, 
+        0.25 * ( xy[q[0]][0] + xy[q[1]][0] + xy[q[2]][0] + xy[q[3]][0] ),
+        0.25 * ( xy[q[0]][1] + xy[q[1]][1] + xy[q[2]][1] + xy[q[3]][1] ));
+  }
+
+  check( sfc_sort(keys, n_quads, new_elem), 
+      "Failed to reorder primary grid.");
+
+  for ( i = 0; i < n_tris; i++ )
+  {
+    const int *t = prim_grid->tris[i];
+    keys[i] = sfc_point_key(&box, 
+        ( xy[t[0]][0] + xy[t[1]][0] + xy[t[2]][0] ) / 3.0,
+        ( xy[t[0]][1] + xy[t[1]][1] + xy[t[2]][1] ) / 3.0);
+  }
+
+  check( sfc_sort(keys, n_tris, new_elem + n_quads), 
+      "Failed to reorder primary grid.");
+
+  for ( i = 0; i < n_tris; i++ )
+    new_elem[n_quads + i] += n_quads;
+
+  /* Update the element references before the elements are moved     */
+#define SFC_NEW_ELEM(e) ( (e) >= 0 ? new_elem[(e)] : (e) )
+
+  for ( i = 0; i < n_quads && prim_grid->quad_neighbors; i++ )
+    for ( k = 0; k < 4; k++ )
+      prim_grid->quad_neighbors[i][k] 
+        = SFC_NEW_ELEM(prim_grid->quad_neighbors[i][k]);
+
+  for ( i = 0; i < n_tris && prim_grid->tri_neighbors; i++ )
+    for ( k = 0; k < 3; k++ )
+      prim_grid->tri_neighbors[i][k] 
+        = SFC_NEW_ELEM(prim_grid->tri_neighbors[i][k]);
+
+  for ( i = 0; i < n_intr; i++ )
+    for ( k = 0; k < 2; k++ )
+      prim_grid->intr_edge_nbrs[i][k] 
+        = SFC_NEW_ELEM(prim_grid->intr_edge_nbrs[i][k]);
+
+  for ( i = 0; i < n_bdry; i++ )
+    prim_grid->bdry_edge_nbrs[i] 
+      = SFC_NEW_ELEM(prim_grid->bdry_edge_nbrs[i]);
+
+#undef SFC_NEW_ELEM
+
+  for ( i = 0; i < n_tris; i++ )
+    new_elem[n_quads + i] -= n_quads;
+
+  check( permute_rows((void **) &prim_grid->quads, n_quads, 
+                      4*sizeof(int), new_elem)
+      && permute_rows((void **) &prim_grid->tris, n_tris, 
+                      3*sizeof(int), new_elem + n_quads),
+      "Failed to reorder primary grid.");
+
+  if ( prim_grid->quad_neighbors )
+    check( permute_rows((void **) &prim_grid->quad_neighbors, n_quads, 
+                        4*sizeof(int), new_elem),
+        "Failed to reorder primary grid.");
+
+  if ( prim_grid->tri_neighbors )
+    check( permute_rows((void **) &prim_grid->tri_neighbors, n_tris, 
+                        3*sizeof(int), new_elem + n_quads),
+        "Failed to reorder primary grid.");
+
+  /*--------------------------------------------------------------------
+  | Interior and boundary edges
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_intr; i++ )
+  {
+    const int *e = prim_grid->intr_edges[i];
+    keys[i] = sfc_point_key(&box, 0.5 * ( xy[e[0]][0] + xy[e[1]][0] ),
+                                  0.5 * ( xy[e[0]][1] + xy[e[1]][1] ));
+  }
+
+  check( sfc_sort(keys, n_intr, new_index)
+      && permute_rows((void **) &prim_grid->intr_edges, n_intr, 
+                      2*sizeof(int), new_index)
+      && permute_rows((void **) &prim_grid->intr_edge_nbrs, n_intr, 
+                      2*sizeof(int), new_index),
+      "Failed to reorder primary grid.");
+
+  for ( i = 0; i < n_bdry; i++ )
+  {
+    const int *e = prim_grid->bdry_edges[i];
+    keys[i] = sfc_point_key(&box, 0.5 * ( xy[e[0]][0] + xy[e[1]][0] ),
+                                  0.5 * ( xy[e[0]][1] + xy[e[1]][1] ));
+  }
+
+  check( sfc_sort(keys, n_bdry, new_index)
+      && permute_rows((void **) &prim_grid->bdry_edges, n_bdry, 
+                      2*sizeof(int), new_index)
+      && permute_rows((void **) &prim_grid->bdry_edge_nbrs, n_bdry, 
+                      sizeof(int), new_index)
+      && permute_rows((void **) &prim_grid->bdry_edge_marker, n_bdry, 
+                      sizeof(int), new_index),
+      "Failed to reorder primary grid.");
+
+  if ( has_store )
+    check( PrimaryGrid_build_elements(prim_grid, 0, NULL, NULL),
+        "Failed to reorder primary grid.");
+
+  free( keys );
+  free( new_index );
+  free( new_elem );
+
+  return ICF_SUCCESS;
+
+error:
+  free( keys );
+  free( new_index );
+  free( new_elem );
+  return ICF_ERROR;
+
+} /* PrimaryGrid_reorder_sfc() */
@@ -8,6 +8,80 @@
 #ifndef PRIMARYGRID_H
 #define PRIMARYGRID_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+/***********************************************************************
+* Binary primary grid file format
+*
+* The file starts with a PrimaryGridHeader, which is followed by the 
+* raw primary grid arrays. All data is stored in little-endian byte 
+* order. The location of every array is given by the section offsets 
+* in the header, such that the sections may appear in any order.
+* Sections of size zero are not present in the file.
+***********************************************************************/
+#define ICF_GRID_MAGIC     "ICFGRID"
+#define ICF_GRID_VERSION   1
+#define ICF_GRID_ALIGNMENT 64
+
+typedef enum
+{
+  ICF_GRID_VERTEX_COORDS,
+  ICF_GRID_TRIS,
+  ICF_GRID_QUADS,
+  ICF_GRID_TRI_NEIGHBORS,
+  ICF_GRID_QUAD_NEIGHBORS,
+  ICF_GRID_INTR_EDGES,
+  ICF_GRID_INTR_EDGE_NBRS,
+  ICF_GRID_BDRY_EDGES,
+  ICF_GRID_BDRY_EDGE_NBRS,
+  ICF_GRID_BDRY_EDGE_MARKER,
+  ICF_GRID_N_SECTIONS,
+} PrimaryGridSection;
+
+typedef struct PrimaryGridHeader {
+
+  char     magic[8];
+  uint32_t version;
+  uint32_t n_sections;
+
+  int64_t  n_vertices;
+  int64_t  n_tris;
+  int64_t  n_quads;
+  int64_t  n_intr_edges;
+  int64_t  n_bdry_edges;
+
+  /* Byte offset and size of every section in the file */
+  uint64_t offsets[ICF_GRID_N_SECTIONS];
+  uint64_t sizes[ICF_GRID_N_SECTIONS];
+
+} PrimaryGridHeader;
+
+/***********************************************************************
+* Space-filling curves for the reordering of primary grids. 
+* The bounding box of the grid is mapped to a grid of 
+* 2^ICF_SFC_BITS x 2^ICF_SFC_BITS cells along the curve.
+***********************************************************************/
+#define ICF_SFC_BITS 16
+
+typedef enum
+{
+  ICF_SFC_MORTON,
+  ICF_SFC_HILBERT,
+} SFCType;
+
+/***********************************************************************
+* Element types of the unified element store, in the order of their
+* blocks (see PrimaryGrid_build_elements)
+***********************************************************************/
+typedef enum
+{
+  ICF_ELEM_QUAD,
+  ICF_ELEM_TRI,
+  ICF_ELEM_POLY,
+  ICF_ELEM_N_TYPES,
+} ElementType;
+
 /***********************************************************************
 * Primary grid structure
 ***********************************************************************/
@@ -38,10 +112,68 @@ typedef struct PrimaryGrid {
 
   int  *bdry_edge_marker; 
 
+  /* Edge of every element edge, if it has been recorded by 
+   * PrimaryGrid_build_topology, otherwise NULL: The element edges are
+   * stored in the layout of the element store (i.e. 4*elem+loc for 
+   * quads) and interior edge i is i, boundary edge i is 
+   * n_intr_edges + i. Functions, that reorder the elements or edges,
+   * release it and DualGrid_build takes it over as element edge map.
+   */
+  int  *elem_edges;
+
+  /* Original index of every vertex, if the vertices have been 
+   * renumbered (see PrimaryGrid_permute_vertices), otherwise NULL */
+  int  *vertex_order;
 
+  /* Unified element store in CSR format, if it has been set up 
+   * (see PrimaryGrid_build_elements), otherwise n_elements = 0: 
+   * -> elem_verts[elem_ptr[e]] ... elem_verts[elem_ptr[e+1]-1] are the
+   *    vertices of element e and <elem_nbrs> holds the neighbor of 
+   *    every element edge at the same position (or NULL)
+   * -> The elements of type t form the block elem_blocks[t] ... 
+   *    elem_blocks[t+1]-1 and elem_types[e] is the type of element e
+   * The quads, tris and their neighbors are views of the quad and 
+   * tri blocks of the store then and must not be freed. */
+  int            n_polys;
+  int            n_elements;
+  int           *elem_ptr;
+  int           *elem_verts;
+  int           *elem_nbrs;
+  unsigned char *elem_types;
+  int            elem_blocks[ICF_ELEM_N_TYPES+1];
 
 } PrimaryGrid;
 
+/***********************************************************************
+* Unified element indices
+*
+* Quads and tris share one element numbering with the quads first, 
+* followed by the tris, i.e. element e is quads[e] for e < n_quads 
+* and tris[e-n_quads] otherwise. The polygons of the element store
+* follow the tris. The element neighbors refer to this numbering and
+* neighbor k of an element is adjacent to its local edge (k, k+1), 
+* where -1 marks the grid boundary (see PrimaryGrid_build_topology).
+***********************************************************************/
+#define ICF_ELEM_IS_QUAD(grid, e) ( (e) < (grid)->n_quads )
+
+#define ICF_ELEM_IS_TRI(grid, e)                                       \
+  ( !ICF_ELEM_IS_QUAD(grid, e) && (e) < (grid)->n_quads + (grid)->n_tris )
+
+#define ICF_ELEM_N_VERTS(grid, e)                                      \
+  ( ICF_ELEM_IS_QUAD(grid, e) ? 4                                     \
+  : ICF_ELEM_IS_TRI(grid, e)  ? 3                                     \
+  : (grid)->elem_ptr[(e)+1] - (grid)->elem_ptr[e] )
+
+#define ICF_ELEM_VERTS(grid, e)                                        \
+  ( ICF_ELEM_IS_QUAD(grid, e) ? (grid)->quads[e]                      \
+  : ICF_ELEM_IS_TRI(grid, e)  ? (grid)->tris[(e) - (grid)->n_quads]   \
+  : (grid)->elem_verts + (grid)->elem_ptr[e] )
+
+#define ICF_ELEM_NBRS(grid, e)                                         \
+  ( ICF_ELEM_IS_QUAD(grid, e) ? (grid)->quad_neighbors[e]             \
+  : ICF_ELEM_IS_TRI(grid, e)  ? (grid)->tri_neighbors[(e) - (grid)->n_quads] \
+  : (grid)->elem_nbrs + (grid)->elem_ptr[e] )
+
 /***********************************************************************
 * Function to create and initialize a new primary grid structure
 ***********************************************************************/
@@ -52,4 +184,126 @@ PrimaryGrid *PrimaryGrid_create();
 ***********************************************************************/
 int PrimaryGrid_destroy(PrimaryGrid *primary_grid);
 
+/***********************************************************************
+* Function to write a primary grid structure to a binary grid file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_write_binary(PrimaryGrid *prim_grid, 
+                             const char  *file_path);
+
+/***********************************************************************
+* Function to read a primary grid structure from a binary grid file
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_read_binary(PrimaryGrid *prim_grid,
+                            const char  *file_path);
+
+/***********************************************************************
+* Function to compute the sizes and offsets of all sections of a 
+* binary grid file from the grid dimensions in <header>
+***********************************************************************/
+void PrimaryGrid_init_binary_header(PrimaryGridHeader *header,
+                                    int has_tri_neighbors,
+                                    int has_quad_neighbors);
+
+/***********************************************************************
+* Function to convert an array between host and little-endian byte 
+* order. This is a no-op on little-endian hosts.
+***********************************************************************/
+void PrimaryGrid_swap_to_le(void *data, size_t n_elems, size_t elem_size);
+
+/***********************************************************************
+* Function to convert a binary grid header between host and 
+* little-endian byte order
+***********************************************************************/
+void PrimaryGrid_swap_header_to_le(PrimaryGridHeader *header);
+
+/***********************************************************************
+* Function to build the connectivity of a primary grid from its 
+* vertices, elements and marked boundary edges. 
+* The interior edges, the adjacent elements of all edges and the 
+* element neighbors (including the polygons of the element store) 
+* are recomputed by matching the element edges in buckets of their 
+* lower vertex index with <n_threads> threads, or with the number of
+* online processors for n_threads < 1. The buckets are sorted, such 
+* that the result does not depend on the number of threads:
+* -> Elements are numbered with the quads first, followed by the tris
+*    and the polygons
+* -> Neighbor k of an element is adjacent to its local edge (k, k+1)
+* -> Interior edges are sorted by their vertex indices and are 
+*    oriented as in their first neighbor, which is the element with 
+*    the lower index
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_build_topology(PrimaryGrid *prim_grid, int n_threads);
+
+/***********************************************************************
+* Function to set up the unified element store of a primary grid 
+* from its quads, tris and polygons of an existing store, to which 
+* <n_polys> polygons are added, where poly_verts[poly_ptr[i]] ...
+* poly_verts[poly_ptr[i+1]-1] are the vertices of polygon i. Added
+* polygons with three or four vertices are sorted into the tri and 
+* quad blocks, such that type-specialized kernels can run on every 
+* block. The quads, tris and their neighbors become views of the 
+* store afterwards. The element neighbors are kept, if they are 
+* available and no polygons are added, otherwise the topology must 
+* be rebuilt (see PrimaryGrid_build_topology).
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_build_elements(PrimaryGrid *prim_grid,
+                               int          n_polys,
+                               const int   *poly_ptr,
+                               const int   *poly_verts);
+
+/***********************************************************************
+* Function to renumber the vertices of a primary grid, such that 
+* vertex i becomes vertex <new_index>[i]. All vertex references of 
+* the elements and edges are updated and the original index of 
+* every vertex is kept in <vertex_order>. 
+* Must be called before the dualgrid is built.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_permute_vertices(PrimaryGrid *prim_grid, 
+                                 const int   *new_index);
+
+/***********************************************************************
+* Function to compute the bandwidth of the vertex connectivity, 
+* i.e. the maximum index difference of the vertices of all edges
+***********************************************************************/
+int PrimaryGrid_bandwidth(const PrimaryGrid *prim_grid);
+
+/***********************************************************************
+* Function to renumber the vertices of a primary grid with the 
+* reverse Cuthill-McKee algorithm, which reduces the bandwidth of 
+* the edge connectivity. Afterwards, the interior edges are sorted 
+* by their lower vertex index, such that edge loops traverse the 
+* vertices in order. The bandwidth before and after renumbering
+* is stored in <bw_before> and <bw_after>, if they are not NULL.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_renumber(PrimaryGrid *prim_grid, 
+                         int         *bw_before,
+                         int         *bw_after);
+
+/***********************************************************************
+* Function to compute the index of the point (ix,iy) on a Morton or 
+* Hilbert curve through the grid [0, 2^ICF_SFC_BITS)^2
+***********************************************************************/
+uint64_t PrimaryGrid_sfc_key(SFCType curve, uint32_t ix, uint32_t iy);
+
+/***********************************************************************
+* Function to reorder a primary grid along a space-filling curve.
+* The vertices are ordered by their coordinates, the quads and tris
+* by their centroids and the interior and boundary edges by their 
+* midpoints, such that spatially close entities are close in memory.
+* All references between vertices, elements and edges are updated 
+* and the vertex permutation is kept in <vertex_order>. 
+* Contiguous ranges of the new vertex numbering are compact regions, 
+* which may serve as a cheap partitioning.
+* An element store is rebuilt afterwards, but must not hold polygons.
+* Must be called before the dualgrid is built.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int PrimaryGrid_reorder_sfc(PrimaryGrid *prim_grid, SFCType curve);
+
 #endif /* PRIMARYGRID_H */
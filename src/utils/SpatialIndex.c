@@ -0,0 +1,765 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "PrimaryGrid.h"
+#include "SpatialIndex.h"
+
+/***********************************************************************
+* Checks if the point (x,y) lies within the convex element <elem>, 
+* i.e. on the same side of all element edges. Both orientations of 
+* the element are accepted.
+***********************************************************************/
+static inline int spatial_in_elem(const PrimaryGrid *primgrid,
+                                  int elem, double x, double y)
+{
+  const double (*coords)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  const int  n_verts = ICF_ELEM_N_VERTS(primgrid, elem);
+  const int *verts   = ICF_ELEM_VERTS(primgrid, elem);
+  int j, k;
+  int n_pos = 0;
+  int n_neg = 0;
+
+  for ( j = n_verts - 1, k = 0; k < n_verts; j = k++ )
+  {
+    const double *a = coords[verts[j]];
+    const double *b = coords[verts[k]];
+
+    const double ex  = b[0] - a[0];
+    const double ey  = b[1] - a[1];
+    const double c   = ex * ( y - a[1] ) - ey * ( x - a[0] );
+    const double tol = ICF_SPATIAL_TOL * ( ex*ex + ey*ey );
+
+    n_pos += ( c >  tol );
+    n_neg += ( c < -tol );
+  }
+
+  return n_pos == 0 || n_neg == 0;
+
+} /* spatial_in_elem() */
+
+/***********************************************************************
+* Checks if the point (x,y) lies within a bounding box
+***********************************************************************/
+static inline int spatial_in_box(const double *box, double x, double y)
+{
+  return x >= box[0] && y >= box[1] && x <= box[2] && y <= box[3];
+
+} /* spatial_in_box() */
+
+/***********************************************************************
+* Rearranges the <n> indices <ids>, such that ids[k] is the entry with
+* the k-th smallest coordinate <dim> of <xy>, preceded by entries 
+* with smaller or equal and followed by entries with larger or equal 
+* coordinates
+***********************************************************************/
+static void spatial_select(int *ids, int n, int k, 
+                           const double (*xy)[2], int dim)
+{
+  int lo = 0;
+  int hi = n - 1;
+
+  while ( hi > lo )
+  {
+    const double pivot = xy[ ids[(lo + hi) / 2] ][dim];
+    int i = lo;
+    int j = hi;
+
+    while ( i <= j )
+    {
+      while ( xy[ids[i]][dim] < pivot ) 
+        i++;
+      while ( xy[ids[j]][dim] > pivot ) 
+        j--;
+
+      if ( i <= j )
+      {
+        const int t = ids[i];
+        ids[i++] = ids[j];
+        ids[j--] = t;
+      }
+    }
+
+    if ( k <= j )
+      hi = j;
+    else if ( k >= i )
+      lo = i;
+    else
+      break;
+  }
+
+} /* spatial_select() */
+
+/***********************************************************************
+* Builds the subtree of node <i_node> for the elements 
+* elems[begin] ... elems[end-1] from the element centroids <cent> and
+* bounding boxes <ebox>
+***********************************************************************/
+static void spatial_build_node(SpatialIndex *index, int i_node, 
+                               int begin, int end,
+                               const double (*cent)[2],
+                               const double (*ebox)[4])
+{
+  SpatialNode *node  = &index->nodes[i_node];
+  int         *elems = index->elems;
+  double cmin[2] = {  DBL_MAX,  DBL_MAX };
+  double cmax[2] = { -DBL_MAX, -DBL_MAX };
+  int i, k;
+
+  node->box[0] = node->box[1] =  DBL_MAX;
+  node->box[2] = node->box[3] = -DBL_MAX;
+
+  for ( i = begin; i < end; i++ )
+  {
+    const int e = elems[i];
+
+    for ( k = 0; k < 2; k++ )
+    {
+      node->box[k]   = MIN(node->box[k],   ebox[e][k]);
+      node->box[k+2] = MAX(node->box[k+2], ebox[e][k+2]);
+      cmin[k] = MIN(cmin[k], cent[e][k]);
+      cmax[k] = MAX(cmax[k], cent[e][k]);
+    }
+  }
+
+  if ( end - begin <= ICF_SPATIAL_LEAF_SIZE )
+  {
+    node->first = begin;
+    node->count = end - begin;
+    return;
+  }
+
+  /*--------------------------------------------------------------------
+  | Split the centroids at the median of their longer extent
+  --------------------------------------------------------------------*/
+  const int dim   = ( cmax[0] - cmin[0] >= cmax[1] - cmin[1] ) ? 0 : 1;
+  const int mid   = begin + ( end - begin ) / 2;
+  const int child = index->n_nodes;
+
+  spatial_select(elems + begin, end - begin, mid - begin, cent, dim);
+
+  index->n_nodes += 2;
+  node->first = child;
+  node->count = 0;
+
+  index->nodes[child].parent   = i_node;
+  index->nodes[child+1].parent = i_node;
+
+  spatial_build_node(index, child,   begin, mid, cent, ebox);
+  spatial_build_node(index, child+1, mid,   end, cent, ebox);
+
+} /* spatial_build_node() */
+
+/***********************************************************************
+* Builds the implicit k-d tree of the vertex range [begin, end)
+***********************************************************************/
+static void spatial_build_kdtree(SpatialIndex *index, int begin, int end,
+                                 const double (*coords)[2])
+{
+  int *ids = index->vert_ids;
+
+  while ( end - begin > ICF_SPATIAL_LEAF_SIZE )
+  {
+    double vmin[2] = {  DBL_MAX,  DBL_MAX };
+    double vmax[2] = { -DBL_MAX, -DBL_MAX };
+    int i, k;
+
+    for ( i = begin; i < end; i++ )
+      for ( k = 0; k < 2; k++ )
+      {
+        vmin[k] = MIN(vmin[k], coords[ids[i]][k]);
+        vmax[k] = MAX(vmax[k], coords[ids[i]][k]);
+      }
+
+    const int dim = ( vmax[0] - vmin[0] >= vmax[1] - vmin[1] ) ? 0 : 1;
+    const int mid = begin + ( end - begin ) / 2;
+
+    spatial_select(ids + begin, end - begin, mid - begin, coords, dim);
+    index->vert_dim[mid] = (unsigned char) dim;
+
+    spatial_build_kdtree(index, begin, mid, coords);
+    begin = mid + 1;
+  }
+
+} /* spatial_build_kdtree() */
+
+/***********************************************************************
+* Function to free the data of a spatial index
+***********************************************************************/
+static void spatial_clear(SpatialIndex *index)
+{
+  free( index->nodes );
+  free( index->elems );
+  free( index->vert_ids );
+  free( index->vert_xy );
+  free( index->vert_dim );
+
+  memset(index, 0, sizeof(SpatialIndex));
+
+} /* spatial_clear() */
+
+/***********************************************************************
+* Function to create and initialize a new spatial index structure
+***********************************************************************/
+SpatialIndex *SpatialIndex_create()
+{
+  SpatialIndex *index = calloc(1, sizeof(SpatialIndex));
+  check_mem(index);
+
+  return index;
+error:
+  return NULL;
+
+} /* SpatialIndex_create() */
+
+/***********************************************************************
+* Function to destroy a spatial index structure
+***********************************************************************/
+void SpatialIndex_destroy(SpatialIndex *index)
+{
+  spatial_clear( index );
+  free( index );
+
+} /* SpatialIndex_destroy() */
+
+/***********************************************************************
+* Function to build the spatial index of a primary grid
+***********************************************************************/
+int SpatialIndex_build(SpatialIndex *index, const PrimaryGrid *primgrid)
+{
+  const double (*coords)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  const int n_elems = primgrid->n_quads + primgrid->n_tris 
+                    + primgrid->n_polys;
+  const int n_verts = primgrid->n_vertices;
+
+  double (*cent)[2] = NULL;
+  double (*ebox)[4] = NULL;
+  int i, j, k, n_loc;
+
+  spatial_clear( index );
+
+  index->primgrid   = primgrid;
+  index->n_elements = n_elems;
+  index->n_vertices = n_verts;
+
+  /* Every leaf of a median split holds at least half of the leaf 
+   * size, which bounds the number of nodes */
+  const int max_nodes = 2 * ( n_elems / ( (ICF_SPATIAL_LEAF_SIZE+1) / 2 ) ) 
+                      + 1;
+
+  index->nodes    = malloc(max_nodes * sizeof(SpatialNode));
+  index->elems    = malloc(( (size_t) n_elems + 1 ) * sizeof(int));
+  index->vert_ids = malloc(( (size_t) n_verts + 1 ) * sizeof(int));
+  index->vert_xy  = malloc(( (size_t) n_verts + 1 ) * sizeof(*index->vert_xy));
+  index->vert_dim = calloc(( (size_t) n_verts + 1 ), sizeof(unsigned char));
+  cent            = malloc(( (size_t) n_elems + 1 ) * sizeof(*cent));
+  ebox            = malloc(( (size_t) n_elems + 1 ) * sizeof(*ebox));
+
+  check_mem(index->nodes);
+  check_mem(index->elems);
+  check_mem(index->vert_ids);
+  check_mem(index->vert_xy);
+  check_mem(index->vert_dim);
+  check_mem(cent);
+  check_mem(ebox);
+
+  /*--------------------------------------------------------------------
+  | Grid bounding box
+  --------------------------------------------------------------------*/
+  index->box[0] = index->box[1] =  DBL_MAX;
+  index->box[2] = index->box[3] = -DBL_MAX;
+
+  for ( i = 0; i < n_verts; i++ )
+    for ( k = 0; k < 2; k++ )
+    {
+      index->box[k]   = MIN(index->box[k],   coords[i][k]);
+      index->box[k+2] = MAX(index->box[k+2], coords[i][k]);
+    }
+
+  /*--------------------------------------------------------------------
+  | Element bounding box tree
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_elems; i++ )
+  {
+    const int *verts = ICF_ELEM_VERTS(primgrid, i);
+
+    n_loc = ICF_ELEM_N_VERTS(primgrid, i);
+
+    ebox[i][0] = ebox[i][1] =  DBL_MAX;
+    ebox[i][2] = ebox[i][3] = -DBL_MAX;
+    cent[i][0] = cent[i][1] = 0.0;
+
+    for ( j = 0; j < n_loc; j++ )
+    {
+      check( verts[j] >= 0 && verts[j] < n_verts,
+          "Invalid vertex %d of element %d.", verts[j], i );
+
+      for ( k = 0; k < 2; k++ )
+      {
+        ebox[i][k]   = MIN(ebox[i][k],   coords[verts[j]][k]);
+        ebox[i][k+2] = MAX(ebox[i][k+2], coords[verts[j]][k]);
+        cent[i][k]  += coords[verts[j]][k] / (double) n_loc;
+      }
+    }
+
+    index->elems[i] = i;
+  }
+
+  if ( n_elems > 0 )
+  {
+    index->n_nodes = 1;
+    index->nodes[0].parent = -1;
+    spatial_build_node(index, 0, 0, n_elems, 
+                       (const double (*)[2]) cent, 
+                       (const double (*)[4]) ebox);
+  }
+
+  /*--------------------------------------------------------------------
+  | Vertex k-d tree -> Copy the coordinates into tree order
+  --------------------------------------------------------------------*/
+  for ( i = 0; i < n_verts; i++ )
+    index->vert_ids[i] = i;
+
+  spatial_build_kdtree(index, 0, n_verts, coords);
+
+  for ( i = 0; i < n_verts; i++ )
+  {
+    index->vert_xy[i][0] = coords[index->vert_ids[i]][0];
+    index->vert_xy[i][1] = coords[index->vert_ids[i]][1];
+  }
+
+  free( cent );
+  free( ebox );
+
+  return ICF_SUCCESS;
+
+error:
+  free( cent );
+  free( ebox );
+  spatial_clear( index );
+  return ICF_ERROR;
+
+} /* SpatialIndex_build() */
+
+/***********************************************************************
+* Locates the point (x,y) in the subtree of node <i_root>, whose box
+* must contain the point. The leaf of the element is stored in <leaf>.
+***********************************************************************/
+static int spatial_locate_subtree(const SpatialIndex *index, int i_root,
+                                  double x, double y, int *leaf)
+{
+  const SpatialNode *nodes = index->nodes;
+  int stack[ICF_SPATIAL_STACK];
+  int n_stack = 0;
+  int i;
+
+  stack[n_stack++] = i_root;
+
+  while ( n_stack > 0 )
+  {
+    const int          i_node = stack[--n_stack];
+    const SpatialNode *node   = &nodes[i_node];
+
+    if ( node->count > 0 )
+    {
+      for ( i = node->first; i < node->first + node->count; i++ )
+        if ( spatial_in_elem(index->primgrid, index->elems[i], x, y) )
+        {
+          *leaf = i_node;
+          return index->elems[i];
+        }
+
+      continue;
+    }
+
+    if ( spatial_in_box(nodes[node->first+1].box, x, y) )
+      stack[n_stack++] = node->first + 1;
+
+    if ( spatial_in_box(nodes[node->first].box, x, y) )
+      stack[n_stack++] = node->first;
+  }
+
+  return -1;
+
+} /* spatial_locate_subtree() */
+
+/***********************************************************************
+* Function to locate the element, which contains the point (x,y)
+***********************************************************************/
+int SpatialIndex_locate(const SpatialIndex *index, double x, double y)
+{
+  int leaf;
+
+  if ( index->n_nodes < 1 || !spatial_in_box(index->nodes[0].box, x, y) )
+    return -1;
+
+  return spatial_locate_subtree(index, 0, x, y, &leaf);
+
+} /* SpatialIndex_locate() */
+
+/***********************************************************************
+* Checks if the element neighbors of a primary grid are available
+***********************************************************************/
+static inline int spatial_has_nbrs(const PrimaryGrid *primgrid)
+{
+  return ( primgrid->n_quads == 0 || primgrid->quad_neighbors )
+      && ( primgrid->n_tris  == 0 || primgrid->tri_neighbors  )
+      && ( primgrid->n_polys == 0 || primgrid->elem_nbrs      );
+
+} /* spatial_has_nbrs() */
+
+/***********************************************************************
+* Function to locate the element, which contains the point (x,y), by
+* a visibility walk from the element <hint>
+***********************************************************************/
+int SpatialIndex_walk(const SpatialIndex *index, int hint, 
+                      double x, double y)
+{
+  const PrimaryGrid *primgrid = index->primgrid;
+  const double (*coords)[2] = (const double (*)[2]) primgrid->vertex_coords;
+  int elem = hint;
+  int prev = -1;
+  int step, k;
+
+  if ( hint < 0 || hint >= index->n_elements || !spatial_has_nbrs(primgrid) )
+    return SpatialIndex_locate(index, x, y);
+
+  for ( step = 0; step < ICF_WALK_MAX_STEPS; step++ )
+  {
+    const int  n_verts = ICF_ELEM_N_VERTS(primgrid, elem);
+    const int *verts   = ICF_ELEM_VERTS(primgrid, elem);
+    const int *nbrs    = ICF_ELEM_NBRS(primgrid, elem);
+    double area = 0.0;
+    double dist = 0.0;
+    int    next = -2;
+
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const double *a = coords[verts[k]];
+      const double *b = coords[verts[ k+1 < n_verts ? k+1 : 0 ]];
+      area += a[0] * b[1] - b[0] * a[1];
+    }
+
+    /* Edge k = (k, k+1) is adjacent to neighbor k. The point lies 
+     * beyond edge k, if it is on the other side than the element 
+     * interior -> Cross the edge with the largest distance of the 
+     * point                                                          */
+    for ( k = 0; k < n_verts; k++ )
+    {
+      const double *a = coords[verts[k]];
+      const double *b = coords[verts[ k+1 < n_verts ? k+1 : 0 ]];
+
+      const double ex   = b[0] - a[0];
+      const double ey   = b[1] - a[1];
+      const double c    = ex * ( y - a[1] ) - ey * ( x - a[0] );
+      const double len2 = ex*ex + ey*ey;
+      const double ck   = ( area < 0.0 ) ? -c : c;
+
+      if ( ck >= -ICF_SPATIAL_TOL * len2 
+        || ( prev >= 0 && nbrs[k] == prev ) )
+        continue;
+
+      if ( next == -2 || ck * ck > dist * len2 )
+      {
+        next = nbrs[k];
+        dist = ck * ck / len2;
+      }
+    }
+
+    if ( next == -2 )
+      return elem;
+
+    if ( next < 0 || next >= index->n_elements )
+      break;
+
+    prev = elem;
+    elem = next;
+  }
+
+  return SpatialIndex_locate(index, x, y);
+
+} /* SpatialIndex_walk() */
+
+/***********************************************************************
+* Function to locate the elements of a sequence of coherent points
+***********************************************************************/
+void SpatialIndex_locate_path(const SpatialIndex *index,
+                              int                 n_points,
+                              const double      (*xy)[2],
+                              int                 hint,
+                              int                *elems)
+{
+  int i;
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    elems[i] = SpatialIndex_walk(index, hint, xy[i][0], xy[i][1]);
+
+    if ( elems[i] >= 0 )
+      hint = elems[i];
+  }
+
+} /* SpatialIndex_locate_path() */
+
+/***********************************************************************
+* Searches the vertex range [begin, end) of the k-d tree for a vertex
+* closer to (x,y) than the current candidate at tree position <best>
+***********************************************************************/
+static void spatial_nearest(const SpatialIndex *index, int begin, int end,
+                            double x, double y, 
+                            int *best, double *best_d2)
+{
+  const double (*xy)[2] = (const double (*)[2]) index->vert_xy;
+  int i;
+
+  while ( end - begin > ICF_SPATIAL_LEAF_SIZE )
+  {
+    const int    mid  = begin + ( end - begin ) / 2;
+    const int    dim  = index->vert_dim[mid];
+    const double diff = ( dim == 0 ? x : y ) - xy[mid][dim];
+    const double d2   = SQR(x - xy[mid][0]) + SQR(y - xy[mid][1]);
+
+    if ( d2 < *best_d2 )
+    {
+      *best    = mid;
+      *best_d2 = d2;
+    }
+
+    /* Descend into the near side first, the far side is only 
+     * searched if the splitting line is closer than the candidate */
+    if ( diff < 0.0 )
+    {
+      spatial_nearest(index, begin, mid, x, y, best, best_d2);
+      if ( diff * diff >= *best_d2 )
+        return;
+      begin = mid + 1;
+    }
+    else
+    {
+      spatial_nearest(index, mid + 1, end, x, y, best, best_d2);
+      if ( diff * diff >= *best_d2 )
+        return;
+      end = mid;
+    }
+  }
+
+  for ( i = begin; i < end; i++ )
+  {
+    const double d2 = SQR(x - xy[i][0]) + SQR(y - xy[i][1]);
+
+    if ( d2 < *best_d2 )
+    {
+      *best    = i;
+      *best_d2 = d2;
+    }
+  }
+
+} /* spatial_nearest() */
+
+/***********************************************************************
+* Function to find the grid vertex, which is closest to the point (x,y)
+***********************************************************************/
+int SpatialIndex_nearest_vertex(const SpatialIndex *index, 
+                                double x, double y)
+{
+  int    best    = -1;
+  double best_d2 = DBL_MAX;
+
+  spatial_nearest(index, 0, index->n_vertices, x, y, &best, &best_d2);
+
+  return ( best < 0 ) ? -1 : index->vert_ids[best];
+
+} /* SpatialIndex_nearest_vertex() */
+
+/***********************************************************************
+* Computes the order of <n_points> points along a Hilbert curve 
+* through the grid bounding box with a LSD radix sort of the packed 
+* keys and point indices. Points outside of the box are clamped.
+***********************************************************************/
+#define SPATIAL_RADIX_BITS 8
+
+static int spatial_sort_points(const SpatialIndex *index, int n_points,
+                               const double (*xy)[2], int *order)
+{
+  const double n_cells = (double) ( ( 1u << ICF_SFC_BITS ) - 1u );
+  const double dx = MAX(index->box[2] - index->box[0], ICF_SMALL);
+  const double dy = MAX(index->box[3] - index->box[1], ICF_SMALL);
+
+  uint64_t *words  = malloc(( 2 * (size_t) n_points + 1 ) * sizeof(uint64_t));
+  int      *counts = malloc(( (1 << SPATIAL_RADIX_BITS) + 1 ) * sizeof(int));
+  int i, shift, d;
+
+  check_mem(words);
+  check_mem(counts);
+
+  uint64_t *src = words;
+  uint64_t *dst = words + n_points;
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const double sx = ( xy[i][0] - index->box[0] ) / dx;
+    const double sy = ( xy[i][1] - index->box[1] ) / dy;
+
+    const uint32_t ix = (uint32_t) ( MIN(MAX0(sx), 1.0) * n_cells );
+    const uint32_t iy = (uint32_t) ( MIN(MAX0(sy), 1.0) * n_cells );
+
+    src[i] = ( PrimaryGrid_sfc_key(ICF_SFC_HILBERT, ix, iy) << 32 ) 
+           | (uint64_t) i;
+  }
+
+  for ( shift = 32; shift < 32 + 2 * ICF_SFC_BITS; 
+        shift += SPATIAL_RADIX_BITS )
+  {
+    const uint64_t digit_mask = ( 1u << SPATIAL_RADIX_BITS ) - 1u;
+
+    memset(counts, 0, ( (1 << SPATIAL_RADIX_BITS) + 1 ) * sizeof(int));
+
+    for ( i = 0; i < n_points; i++ )
+      ++counts[ ( ( src[i] >> shift ) & digit_mask ) + 1 ];
+
+    for ( d = 0; d < (1 << SPATIAL_RADIX_BITS); d++ )
+      counts[d+1] += counts[d];
+
+    for ( i = 0; i < n_points; i++ )
+      dst[ counts[ ( src[i] >> shift ) & digit_mask ]++ ] = src[i];
+
+    uint64_t *t = src;
+    src = dst;
+    dst = t;
+  }
+
+  for ( i = 0; i < n_points; i++ )
+    order[i] = (int) (uint32_t) src[i];
+
+  free( words );
+  free( counts );
+
+  return ICF_SUCCESS;
+
+error:
+  free( words );
+  free( counts );
+  return ICF_ERROR;
+
+} /* spatial_sort_points() */
+
+/***********************************************************************
+* Function to locate the elements of a batch of points
+***********************************************************************/
+int SpatialIndex_locate_batch(const SpatialIndex *index,
+                              int                 n_points,
+                              const double      (*xy)[2],
+                              int                *elems)
+{
+  const SpatialNode *nodes    = index->nodes;
+  const int          has_nbrs = spatial_has_nbrs(index->primgrid);
+  int *order = malloc(( (size_t) n_points + 1 ) * sizeof(int));
+  int  last  = -1;
+  int  leaf  = 0;
+  int  i;
+
+  check_mem(order);
+  check( spatial_sort_points(index, n_points, xy, order),
+      "Failed to sort the query points." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const int    p = order[i];
+    const double x = xy[p][0];
+    const double y = xy[p][1];
+    int i_node = leaf;
+
+    if ( has_nbrs )
+    {
+      elems[p] = SpatialIndex_walk(index, last, x, y);
+      last = ( elems[p] >= 0 ) ? elems[p] : last;
+      continue;
+    }
+
+    if ( last >= 0 && spatial_in_elem(index->primgrid, last, x, y) )
+    {
+      elems[p] = last;
+      continue;
+    }
+
+    if ( index->n_nodes < 1 || !spatial_in_box(nodes[0].box, x, y) )
+    {
+      elems[p] = -1;
+      continue;
+    }
+
+    /* Climb from the previous leaf to the closest ancestor, which 
+     * contains the point, and fall back to the root, if its subtree
+     * holds no matching element */
+    while ( i_node > 0 && !spatial_in_box(nodes[i_node].box, x, y) )
+      i_node = nodes[i_node].parent;
+
+    last = spatial_locate_subtree(index, i_node, x, y, &leaf);
+
+    if ( last < 0 && i_node > 0 )
+      last = spatial_locate_subtree(index, 0, x, y, &leaf);
+
+    elems[p] = last;
+  }
+
+  free( order );
+  return ICF_SUCCESS;
+
+error:
+  free( order );
+  return ICF_ERROR;
+
+} /* SpatialIndex_locate_batch() */
+
+/***********************************************************************
+* Function to find the nearest vertices of a batch of points
+***********************************************************************/
+int SpatialIndex_nearest_vertex_batch(const SpatialIndex *index,
+                                      int                 n_points,
+                                      const double      (*xy)[2],
+                                      int                *verts)
+{
+  const double (*vert_xy)[2] = (const double (*)[2]) index->vert_xy;
+  int *order = malloc(( (size_t) n_points + 1 ) * sizeof(int));
+  int  best  = -1;
+  int  i;
+
+  check_mem(order);
+  check( spatial_sort_points(index, n_points, xy, order),
+      "Failed to sort the query points." );
+
+  for ( i = 0; i < n_points; i++ )
+  {
+    const int    p = order[i];
+    const double x = xy[p][0];
+    const double y = xy[p][1];
+    double best_d2 = DBL_MAX;
+
+    /* The nearest vertex of the predecessor bounds the search */
+    if ( best >= 0 )
+      best_d2 = SQR(x - vert_xy[best][0]) + SQR(y - vert_xy[best][1]);
+
+    spatial_nearest(index, 0, index->n_vertices, x, y, &best, &best_d2);
+
+    verts[p] = ( best < 0 ) ? -1 : index->vert_ids[best];
+  }
+
+  free( order );
+  return ICF_SUCCESS;
+
+error:
+  free( order );
+  return ICF_ERROR;
+
+} /* SpatialIndex_nearest_vertex_batch() */
@@ -0,0 +1,172 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "PrimaryGrid.h"
+
+/***********************************************************************
+* Spatial index of a primary grid for point location
+*
+* The elements are held in a bounding box tree, which is bulk-loaded
+* by median splits of the element centroids along the longer extent.
+* The children of a node are stored next to each other and the 
+* elements of every leaf are contiguous in <elems>.
+* The vertices are held in an implicit k-d tree: The vertex range 
+* [begin, end) is split at mid = (begin+end)/2 along vert_dim[mid], 
+* such that no further node data is required.
+* Elements are numbered with the quads first, followed by the tris
+* and the convex polygons of the element store (see 
+* PrimaryGrid_build_topology).
+*
+* -> ICF_SPATIAL_LEAF_SIZE: Maximum number of entries per leaf
+* -> ICF_SPATIAL_TOL:       Relative tolerance of the point-in-element
+*                           test, such that points on element edges 
+*                           are located
+* -> ICF_SPATIAL_STACK:     Traversal stack size, which bounds the tree
+*                           depth of median splits for any int size
+* -> ICF_WALK_MAX_STEPS:    Maximum number of steps of a neighbor walk,
+*                           before it falls back to the tree search
+***********************************************************************/
+#define ICF_SPATIAL_LEAF_SIZE 4
+#define ICF_SPATIAL_TOL       1.0E-10
+#define ICF_SPATIAL_STACK     64
+#define ICF_WALK_MAX_STEPS    4096
+
+/***********************************************************************
+* Node of the element bounding box tree 
+* -> Inner nodes: count = 0 and first is the index of the first child
+* -> Leaves:      elems[first] ... elems[first+count-1] are the 
+*                 elements of the leaf
+* The root has the parent -1.
+***********************************************************************/
+typedef struct SpatialNode
+{
+  /* Bounding box (xmin, ymin, xmax, ymax) */
+  double box[4];
+
+  int    first;
+  int    count;
+  int    parent;
+
+} SpatialNode;
+
+/***********************************************************************
+* SpatialIndex structure
+***********************************************************************/
+struct SpatialIndex;
+typedef struct SpatialIndex 
+{
+  /* Indexed primary grid, which is not owned by the index */
+  const PrimaryGrid *primgrid;
+
+  /* Bounding box of the grid vertices (xmin, ymin, xmax, ymax) */
+  double box[4];
+
+  /* Element bounding box tree */
+  int          n_elements;
+  int          n_nodes;
+  SpatialNode *nodes;
+  int         *elems;
+
+  /* Vertex k-d tree -> Vertex indices, coordinates and split 
+   * directions in tree order */
+  int             n_vertices;
+  int            *vert_ids;
+  double        (*vert_xy)[2];
+  unsigned char  *vert_dim;
+
+} SpatialIndex;
+
+/***********************************************************************
+* Function to create and initialize a new spatial index structure
+***********************************************************************/
+SpatialIndex *SpatialIndex_create();
+
+/***********************************************************************
+* Function to destroy a spatial index structure
+***********************************************************************/
+void SpatialIndex_destroy(SpatialIndex *index);
+
+/***********************************************************************
+* Function to build the spatial index of a primary grid. The grid
+* must not be changed or destroyed while the index is in use.
+* An existing index is replaced.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int SpatialIndex_build(SpatialIndex *index, const PrimaryGrid *primgrid);
+
+/***********************************************************************
+* Function to locate the element, which contains the point (x,y).
+* Elements are assumed to be convex. 
+* Returns the element index or -1, if the point lies outside the grid
+***********************************************************************/
+int SpatialIndex_locate(const SpatialIndex *index, double x, double y);
+
+/***********************************************************************
+* Function to find the grid vertex, which is closest to the point (x,y)
+* Returns the vertex index or -1 for an empty grid
+***********************************************************************/
+int SpatialIndex_nearest_vertex(const SpatialIndex *index, 
+                                double x, double y);
+
+/***********************************************************************
+* Function to locate the element, which contains the point (x,y), by
+* a visibility walk through the element neighbors, which starts at 
+* the element <hint>. Every step crosses the element edge, beyond 
+* which the point lies farthest, except for the edge that was just 
+* crossed. Coherent queries with a close hint thus take a few steps, 
+* independent of the grid size. 
+* The walk falls back to SpatialIndex_locate(), if it reaches the 
+* grid boundary or exceeds ICF_WALK_MAX_STEPS steps, if hint < 0 or 
+* if the grid has no element neighbors.
+* Returns the element index or -1, if the point lies outside the grid
+***********************************************************************/
+int SpatialIndex_walk(const SpatialIndex *index, int hint, 
+                      double x, double y);
+
+/***********************************************************************
+* Function to locate the elements <elems> of a sequence of <n_points> 
+* coherent points <xy>, e.g. along a probe line or a particle path. 
+* Every point is located by a walk from the element of the last 
+* located point, starting with the element <hint> (or -1).
+***********************************************************************/
+void SpatialIndex_locate_path(const SpatialIndex *index,
+                              int                 n_points,
+                              const double      (*xy)[2],
+                              int                 hint,
+                              int                *elems);
+
+/***********************************************************************
+* Function to locate the elements <elems> of <n_points> points <xy>. 
+* The points are processed along a Hilbert curve. Every point is 
+* located by a walk from the element of its predecessor, if the grid
+* has element neighbors. Otherwise, the point is tested against the 
+* element of its predecessor first and the search starts at the 
+* closest ancestor of the predecessor's leaf, whose box contains the 
+* point, such that close points share the traversal of the tree.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int SpatialIndex_locate_batch(const SpatialIndex *index,
+                              int                 n_points,
+                              const double      (*xy)[2],
+                              int                *elems);
+
+/***********************************************************************
+* Function to find the nearest vertices <verts> of <n_points> points 
+* <xy>. The points are processed along a Hilbert curve and the 
+* distance to the nearest vertex of the predecessor bounds the search
+* of every point.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+int SpatialIndex_nearest_vertex_batch(const SpatialIndex *index,
+                                      int                 n_points,
+                                      const double      (*xy)[2],
+                                      int                *verts);
+
+#endif /* SPATIALINDEX_H */
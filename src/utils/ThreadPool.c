@@ -0,0 +1,214 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "dbg.h"
+#include "icf_utils.h"
+
+#include "ThreadPool.h"
+
+/***********************************************************************
+* Pulls tasks from the current batch until it is exhausted
+***********************************************************************/
+static void ThreadPool_work(ThreadPool *pool, int i_thread)
+{
+  for ( ;; )
+  {
+    pthread_mutex_lock(&pool->lock);
+    int i_task = pool->next_task++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if ( i_task >= pool->n_tasks )
+      break;
+
+    pool->task(pool->ctx, i_task, i_thread);
+  }
+
+} /* ThreadPool_work() */
+
+/***********************************************************************
+* Main loop of the worker threads
+***********************************************************************/
+typedef struct 
+{
+  ThreadPool *pool;
+  int         i_thread;
+} ThreadPoolWorker;
+
+static void *ThreadPool_worker(void *arg)
+{
+  ThreadPoolWorker *worker = arg;
+  ThreadPool *pool = worker->pool;
+  int i_thread     = worker->i_thread;
+  unsigned long generation = 0;
+
+  free(worker);
+
+  for ( ;; )
+  {
+    pthread_mutex_lock(&pool->lock);
+
+    while ( pool->generation == generation && !pool->shutdown )
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+
+    if ( pool->shutdown )
+    {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+
+    generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    ThreadPool_work(pool, i_thread);
+
+    pthread_mutex_lock(&pool->lock);
+    if ( --pool->n_busy == 0 )
+      pthread_cond_signal(&pool->done_cond);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+
+} /* ThreadPool_worker() */
+
+/***********************************************************************
+* Returns the number of online processors
+***********************************************************************/
+int ThreadPool_n_procs()
+{
+  long n_procs = sysconf(_SC_NPROCESSORS_ONLN);
+  return ( n_procs > 0 ) ? (int) n_procs : 1;
+
+} /* ThreadPool_n_procs() */
+
+/***********************************************************************
+* Function to create a new thread pool with <n_threads> threads in
+* total. The calling thread counts as one of them, hence 
+* <n_threads>-1 worker threads are spawned. 
+* For n_threads < 1, the number of online processors is used.
+***********************************************************************/
+ThreadPool *ThreadPool_create(int n_threads)
+{
+  int i;
+
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  check_mem(pool);
+
+  if ( n_threads < 1 )
+    n_threads = ThreadPool_n_procs();
+
+  pool->n_threads  = n_threads;
+  pool->threads    = calloc(n_threads, sizeof(pthread_t));
+  pool->task       = NULL;
+  pool->ctx        = NULL;
+  pool->n_tasks    = 0;
+  pool->next_task  = 0;
+  pool->n_busy     = 0;
+  pool->generation = 0;
+  pool->shutdown   = 0;
+  check_mem(pool->threads);
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for ( i = 1; i < n_threads; i++ )
+  {
+    ThreadPoolWorker *worker = malloc(sizeof(ThreadPoolWorker));
+    check_mem(worker);
+
+    worker->pool     = pool;
+    worker->i_thread = i;
+
+    check( pthread_create(&pool->threads[i], NULL, 
+                          ThreadPool_worker, worker) == 0,
+        "Failed to create worker thread %d.", i);
+  }
+
+  return pool;
+error:
+  return NULL;
+
+} /* ThreadPool_create() */
+
+/***********************************************************************
+* Function to destroy a thread pool structure
+***********************************************************************/
+void ThreadPool_destroy(ThreadPool *pool)
+{
+  int i;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for ( i = 1; i < pool->n_threads; i++ )
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->lock);
+
+  free( pool->threads );
+  free( pool );
+
+} /* ThreadPool_destroy() */
+
+/***********************************************************************
+* Function to execute <n_tasks> tasks on the thread pool. 
+* The function returns, once all tasks have been finished.
+***********************************************************************/
+void ThreadPool_run(ThreadPool     *pool, 
+                    int             n_tasks,
+                    ThreadPoolTask *task,
+                    void           *ctx)
+{
+  /*--------------------------------------------------------------------
+  | Single threaded execution without any synchronization
+  --------------------------------------------------------------------*/
+  if ( pool->n_threads < 2 || n_tasks < 2 )
+  {
+    int i_task;
+    for ( i_task = 0; i_task < n_tasks; i_task++ )
+      task(ctx, i_task, 0);
+    return;
+  }
+
+  /*--------------------------------------------------------------------
+  | Publish the new batch and wake up all workers
+  --------------------------------------------------------------------*/
+  pthread_mutex_lock(&pool->lock);
+
+  pool->task      = task;
+  pool->ctx       = ctx;
+  pool->n_tasks   = n_tasks;
+  pool->next_task = 0;
+  pool->n_busy    = pool->n_threads - 1;
+  ++pool->generation;
+
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  /*--------------------------------------------------------------------
+  | The calling thread takes part and waits for all workers afterwards
+  --------------------------------------------------------------------*/
+  ThreadPool_work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while ( pool->n_busy > 0 )
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+
+} /* ThreadPool_run() */
@@ -0,0 +1,76 @@
+/*
+* This file is part of the IncomFlow2D library.  
+* This code was written by Florian Setzwein in 2022, 
+* and is covered under the MIT License
+* Refer to the accompanying documentation for details
+* on usage and license.
+*/
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+/***********************************************************************
+* Function template for tasks that are executed by the thread pool
+* -> i_task:   Index of the current task
+* -> i_thread: Index of the executing thread (0 = calling thread)
+***********************************************************************/
+typedef void ThreadPoolTask(void *ctx, int i_task, int i_thread);
+
+/***********************************************************************
+* ThreadPool structure
+***********************************************************************/
+struct ThreadPool;
+typedef struct ThreadPool {
+
+  /* Number of threads, including the calling thread */
+  int              n_threads;
+  pthread_t       *threads;
+
+  pthread_mutex_t  lock;
+  pthread_cond_t   work_cond;
+  pthread_cond_t   done_cond;
+
+  /* Current batch of tasks */
+  ThreadPoolTask  *task;
+  void            *ctx;
+  int              n_tasks;
+  int              next_task;
+
+  /* Number of worker threads, that are still busy with the batch */
+  int              n_busy;
+
+  /* Incremented for every new batch of tasks */
+  unsigned long    generation;
+  int              shutdown;
+
+} ThreadPool;
+
+/***********************************************************************
+* Function to create a new thread pool with <n_threads> threads in
+* total. The calling thread counts as one of them, hence 
+* <n_threads>-1 worker threads are spawned. 
+* For n_threads < 1, the number of online processors is used.
+***********************************************************************/
+ThreadPool *ThreadPool_create(int n_threads);
+
+/***********************************************************************
+* Function to destroy a thread pool structure
+***********************************************************************/
+void ThreadPool_destroy(ThreadPool *pool);
+
+/***********************************************************************
+* Function to execute <n_tasks> tasks on the thread pool. 
+* The function returns, once all tasks have been finished.
+***********************************************************************/
+void ThreadPool_run(ThreadPool     *pool, 
+                    int             n_tasks,
+                    ThreadPoolTask *task,
+                    void           *ctx);
+
+/***********************************************************************
+* Returns the number of online processors
+***********************************************************************/
+int ThreadPool_n_procs();
+
+#endif /* THREADPOOL_H */
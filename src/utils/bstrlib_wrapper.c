@@ -159,6 +159,132 @@ error:
   return NULL;
 } /* bstrlib_get_lines_with() */
 
+/***********************************************************************
+* Function extracts the parameter behind the specifier <fltr> 
+* from a single line and stores it into <value>.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+static int extract_param_from_line(bstring line, const char *fltr,
+                                   int type, void *value)
+{
+  bstring bfltr = bfromcstr( fltr ); 
+  bstring bextr = NULL;
+
+  int off = binstr(line, 0, bfltr); 
+  int len = bfltr->slen;
+
+  bextr = bmidstr( line, off+len, line->slen );
+
+  /*----------------------------------------------------------
+  | Remove leading whitespaces and copy first value
+  ----------------------------------------------------------*/
+  bstring valstr = bextr;
+
+  if (type == 0)
+    *(int*)value = atoi(valstr->data);
+  else if (type == 1)
+    *(double*)value = atof(valstr->data);
+  else if (type == 2)
+    *(bstring*)value = bfromcstr( valstr->data );
+  else
+  {
+    log_err("Wrong type definition.");
+    goto error;
+  }
+
+  bdestroy( bextr );
+  bdestroy( bfltr );
+  return ICF_SUCCESS;
+
+error:
+  bdestroy( bextr );
+  bdestroy( bfltr );
+  return ICF_ERROR;
+
+} /* extract_param_from_line() */
+
+/***********************************************************************
+* Function extracts the array behind the specifier <fltr> 
+* from a single line and stores it into <value>.
+* Returns ICF_SUCCESS or ICF_ERROR
+***********************************************************************/
+static int extract_array_from_line(bstring line, const char *fltr,
+                                   int type, void *value)
+{
+  int i;
+  bstring bfltr = bfromcstr( fltr ); 
+  bstring bextr = NULL;
+
+  int off = binstr(line, 0, bfltr); 
+  int len = bfltr->slen;
+
+  bextr = bmidstr( line, off+len, line->slen );
+
+  /*----------------------------------------------------------
+  | Remove leading whitespaces and copy first value
+  ----------------------------------------------------------*/
+  bstring wsfnd = bfromcstr( " " );
+  bstring wsrpl = bfromcstr( "" );
+  bfindreplace(bextr, wsfnd, wsrpl, 0);
+
+  /*----------------------------------------------------------
+  | Split into list of string -> comma is separator
+  ----------------------------------------------------------*/
+  struct bstrList *arrStr = bsplit(bextr, ',');
+  int nEntries            = arrStr->qty;
+  bstring *arr_ptr        = arrStr->entry;
+
+  if (type == 0)
+  {
+    int *array = calloc(nEntries, sizeof(int));
+
+    for (i = 0; i < nEntries; i++) 
+      array[i] = atoi(arr_ptr[i]->data);
+
+    *(int**)value = array;
+
+  }
+  else if (type == 1)
+  {
+    double *array = calloc(nEntries, sizeof(double));
+
+    for (i = 0; i < nEntries; i++) 
+      array[i] = atof(arr_ptr[i]->data);
+
+    *(double**)value = array;
+
+  }
+  else if (type == 2)
+  {
+    *(struct bstrList**)value = arrStr;
+    arrStr = NULL;
+  }
+  else
+  {
+    log_err("Wrong type definition.");
+    goto error;
+  }
+
+  /*----------------------------------------------------------
+  | Cleanup
+  ----------------------------------------------------------*/
+  bdestroy( wsfnd );
+  bdestroy( wsrpl );
+  bdestroy( bextr );
+  bdestroy( bfltr );
+  bstrListDestroy( arrStr );
+  return ICF_SUCCESS;
+
+error:
+  bdestroy( wsfnd );
+  bdestroy( wsrpl );
+  bdestroy( bextr );
+  bdestroy( bfltr );
+  bstrListDestroy( arrStr );
+  return ICF_ERROR;
+
+} /* extract_array_from_line() */
+
 /***********************************************************************
 * Function searches for a specifier <fltr> in a bstrList.
 * The parameter behind the specifier is then extracted 
@@ -178,10 +304,7 @@ int bstrlib_extract_param(struct bstrList *txtlist,
                           void *value)
 {
   int nfound = 0;
-  bstring line, valstr;
   struct bstrList *fltTxt = NULL;
-  struct bstrList *blstextr = NULL;
-  bstring bfltr, bextr;
 
   /*----------------------------------------------------------
   | Get all lines, containing the specifier
@@ -201,43 +324,16 @@ int bstrlib_extract_param(struct bstrList *txtlist,
   /*----------------------------------------------------------
   | Take last string, in which specifier was found
   ----------------------------------------------------------*/
-  line  = fltTxt->entry[fltTxt->qty - 1];
-  bfltr = bfromcstr( fltr ); 
-  
-  int off = binstr(line, 0, bfltr); 
-  int len = bfltr->slen;
+  check( extract_param_from_line(fltTxt->entry[fltTxt->qty - 1], 
+                                 fltr, type, value),
+      "Failed to extract parameter %s.", fltr );
 
-  bextr = bmidstr( line, off+len, line->slen );
-
-  /*----------------------------------------------------------
-  | Remove leading whitespaces and copy first value
-  ----------------------------------------------------------*/
-  valstr = bextr;
-
-  if (type == 0)
-    *(int*)value = atoi(valstr->data);
-  else if (type == 1)
-    *(double*)value = atof(valstr->data);
-  else if (type == 2)
-    *(bstring*)value = bfromcstr( valstr->data );
-  else
-    log_err("Wrong type definition.");
-
-  /*----------------------------------------------------------
-  | Cleanup
-  ----------------------------------------------------------*/
-  bdestroy( bextr );
-  bdestroy( bfltr );
   bstrListDestroy( fltTxt );
-  bstrListDestroy( blstextr );
 
   return nfound;
 
 error:
-  bdestroy( bextr );
-  bdestroy( bfltr );
   bstrListDestroy( fltTxt );
-  bstrListDestroy( blstextr );
   return -1;
 } /* bstrlib_extract_param() */
 
@@ -260,11 +356,8 @@ int bstrlib_extract_array(struct bstrList *txtlist,
                           const char *fltr, int type,
                           void *value)
 {
-  int i;
   int nfound = 0;
-  bstring line;
   struct bstrList *fltTxt = NULL;
-  bstring bfltr, bextr;
 
   /*----------------------------------------------------------
   | Get all lines, containing the specifier
@@ -284,70 +377,299 @@ int bstrlib_extract_array(struct bstrList *txtlist,
   /*----------------------------------------------------------
   | Take last string, in which specifier was found
   ----------------------------------------------------------*/
-  line  = fltTxt->entry[fltTxt->qty - 1];
-  bfltr = bfromcstr( fltr ); 
+  check( extract_array_from_line(fltTxt->entry[fltTxt->qty - 1], 
+                                 fltr, type, value),
+      "Failed to extract array %s.", fltr );
 
-  int off = binstr(line, 0, bfltr); 
-  int len = bfltr->slen;
+  bstrListDestroy( fltTxt );
 
-  bextr = bmidstr( line, off+len, line->slen );
+  return nfound;
 
-  /*----------------------------------------------------------
-  | Remove leading whitespaces and copy first value
-  ----------------------------------------------------------*/
-  bstring wsfnd = bfromcstr( " " );
-  bstring wsrpl = bfromcstr( "" );
-  bfindreplace(bextr, wsfnd, wsrpl, 0);
+error:
+  bstrListDestroy( fltTxt );
+  return -1;
+} /* bstrlib_extract_array() */
 
-  /*----------------------------------------------------------
-  | Split into list of string -> comma is separator
-  ----------------------------------------------------------*/
-  struct bstrList *arrStr = bsplit(bextr, ',');
-  int nEntries            = arrStr->qty;
-  bstring *arr_ptr        = arrStr->entry;
+/***********************************************************************
+* Returns ICF_TRUE, if a character terminates a keyword token
+***********************************************************************/
+static inline int index_is_delim(unsigned char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' 
+      || c == ':' || c == '=' || c == ',';
 
-  if (type == 0)
+} /* index_is_delim() */
+
+/***********************************************************************
+* Returns the length of the keyword token, which starts at <s>
+***********************************************************************/
+static inline int index_token_len(const unsigned char *s, int len)
+{
+  int i = 0;
+
+  while ( i < len && !index_is_delim(s[i]) )
+    i++;
+
+  return i;
+
+} /* index_token_len() */
+
+/***********************************************************************
+* FNV-1a hash of a keyword token
+***********************************************************************/
+static inline unsigned int index_hash(const unsigned char *s, int len)
+{
+  unsigned int h = 2166136261u;
+  int i;
+
+  for (i = 0; i < len; i++)
   {
-    int *array = calloc(nEntries, sizeof(int));
+    h ^= s[i];
+    h *= 16777619u;
+  }
 
-    for (i = 0; i < nEntries; i++) 
-      array[i] = atoi(arr_ptr[i]->data);
+  return h;
 
-    *(int**)value = array;
+} /* index_hash() */
+
+/***********************************************************************
+* Returns the hash slot of a keyword token. This is either the 
+* slot, which already holds the token, or the empty slot, where 
+* the token has to be inserted.
+***********************************************************************/
+static int index_slot(const bstrIndex *index, 
+                      const unsigned char *key, int key_len)
+{
+  bstring     *lines = index->txtlist->entry;
+  unsigned int mask  = (unsigned int) index->n_slots - 1;
+  unsigned int h     = index_hash(key, key_len) & mask;
+
+  while ( index->slots[h] >= 0 )
+  {
+    const int k = index->slots[h];
 
+    if ( index->key_len[k] == key_len 
+        && memcmp(lines[index->key_line[k]]->data + index->key_off[k], 
+                  key, key_len) == 0 )
+      break;
+
+    h = (h + 1) & mask;
   }
-  else if (type == 1)
+
+  return (int) h;
+
+} /* index_slot() */
+
+/***********************************************************************
+* Function creates a keyword index for a bstrList in a single 
+* pass over all lines
+***********************************************************************/
+bstrIndex *bstrlib_index_create(struct bstrList *txtlist)
+{
+  int i, k, n_alloc = 64;
+
+  bstrIndex *index = calloc(1, sizeof(bstrIndex));
+  check_mem(index);
+
+  index->txtlist  = txtlist;
+  index->key_line = malloc(n_alloc * sizeof(int));
+  index->key_off  = malloc(n_alloc * sizeof(int));
+  index->key_len  = malloc(n_alloc * sizeof(int));
+  check_mem(index->key_line);
+  check_mem(index->key_off);
+  check_mem(index->key_len);
+
+  /*----------------------------------------------------------
+  | Collect all lines starting with a keyword. 
+  | Data lines are rejected by their first character, such 
+  | that large mesh sections are skipped quickly.
+  ----------------------------------------------------------*/
+  for (i = 0; i < txtlist->qty; i++) 
   {
-    double *array = calloc(nEntries, sizeof(double));
+    const unsigned char *s = txtlist->entry[i]->data;
+    const int len          = txtlist->entry[i]->slen;
+    int off = 0;
 
-    for (i = 0; i < nEntries; i++) 
-      array[i] = atof(arr_ptr[i]->data);
+    while ( off < len && (s[off] == ' ' || s[off] == '\t') )
+      off++;
 
-    *(double**)value = array;
+    if ( off == len )
+      continue;
+
+    if ( !( (s[off] >= 'A' && s[off] <= 'Z') 
+         || (s[off] >= 'a' && s[off] <= 'z') || s[off] == '_' ) )
+      continue;
 
+    if ( index->n_keys == n_alloc )
+    {
+      int *p;
+
+      /* Keep the old arrays on failure, such that they are freed   */
+      n_alloc *= 2;
+      p = realloc(index->key_line, n_alloc*sizeof(int));
+      check_mem(p);
+      index->key_line = p;
+      p = realloc(index->key_off,  n_alloc*sizeof(int));
+      check_mem(p);
+      index->key_off  = p;
+      p = realloc(index->key_len,  n_alloc*sizeof(int));
+      check_mem(p);
+      index->key_len  = p;
+    }
+
+    index->key_line[index->n_keys] = i;
+    index->key_off[index->n_keys]  = off;
+    index->key_len[index->n_keys]  = index_token_len(s+off, len-off);
+    index->n_keys += 1;
   }
-  else if (type == 2)
+
+  /*----------------------------------------------------------
+  | Fill hash table with a load factor of at most 0.5
+  ----------------------------------------------------------*/
+  index->n_slots = 16;
+  while ( index->n_slots < 2 * index->n_keys )
+    index->n_slots *= 2;
+
+  index->slots    = malloc(index->n_slots * sizeof(int));
+  index->key_prev = malloc(MAX(index->n_keys, 1) * sizeof(int));
+  check_mem(index->slots);
+  check_mem(index->key_prev);
+
+  for (i = 0; i < index->n_slots; i++) 
+    index->slots[i] = -1;
+
+  for (k = 0; k < index->n_keys; k++) 
   {
-    *(struct bstrList**)value = arrStr;
+    const unsigned char *key = txtlist->entry[index->key_line[k]]->data
+                             + index->key_off[k];
+    const int h = index_slot(index, key, index->key_len[k]);
+
+    index->key_prev[k] = index->slots[h];
+    index->slots[h]    = k;
   }
-  else
-    log_err("Wrong type definition.");
+
+  return index;
+
+error:
+  bstrlib_index_destroy(index);
+  return NULL;
+
+} /* bstrlib_index_create() */
+
+/***********************************************************************
+* Function destroys a keyword index 
+***********************************************************************/
+void bstrlib_index_destroy(bstrIndex *index)
+{
+  if ( !index )
+    return;
+
+  free(index->key_line);
+  free(index->key_off);
+  free(index->key_len);
+  free(index->key_prev);
+  free(index->slots);
+  free(index);
+
+} /* bstrlib_index_destroy() */
+
+/***********************************************************************
+* Function searches for lines, which start with the specifier <fltr>.
+* The line index of the last of these lines is stored in <line>.
+*
+* Returns the number of lines starting with the specifier or 0 if 
+* it was not found.
+***********************************************************************/
+int bstrlib_index_find(const bstrIndex *index, const char *fltr,
+                       int *line)
+{
+  const unsigned char *key = (const unsigned char *) fltr;
+  const int fltr_len       = strlen(fltr);
+  const int key_len        = index_token_len(key, fltr_len);
+  bstring  *lines          = index->txtlist->entry;
+
+  int nfound = 0;
+  int k;
+
+  if ( key_len < 1 )
+    return 0;
+
+  k = index->slots[ index_slot(index, key, key_len) ];
 
   /*----------------------------------------------------------
-  | Cleanup
+  | Walk through all lines with the same leading token, 
+  | starting with the last one, and compare the total 
+  | specifier, which might span over several tokens
   ----------------------------------------------------------*/
-  bdestroy( wsfnd );
-  bdestroy( wsrpl );
-  bdestroy( bextr );
-  bdestroy( bfltr );
-  bstrListDestroy( fltTxt );
-  bstrListDestroy( arrStr);
+  for ( ; k >= 0; k = index->key_prev[k] )
+  {
+    const bstring cur = lines[index->key_line[k]];
+    const int     off = index->key_off[k];
+
+    if ( cur->slen - off < fltr_len )
+      continue;
+
+    if ( memcmp(cur->data + off, fltr, fltr_len) != 0 )
+      continue;
+
+    if ( nfound == 0 && line )
+      *line = index->key_line[k];
+
+    nfound += 1;
+  }
+
+  return nfound;
+
+} /* bstrlib_index_find() */
+
+/***********************************************************************
+* Indexed version of bstrlib_extract_param().
+* In contrast to the linear search, the specifier must be located 
+* at the beginning of a line.
+***********************************************************************/
+int bstrlib_index_extract_param(const bstrIndex *index,
+                                const char *fltr, int type,
+                                void *value)
+{
+  int line   = 0;
+  int nfound = bstrlib_index_find(index, fltr, &line);
+
+  if (nfound < 1)
+    return 0;
+
+  check( extract_param_from_line(index->txtlist->entry[line], 
+                                 fltr, type, value),
+      "Failed to extract parameter %s.", fltr );
 
   return nfound;
 
 error:
-  bdestroy( bextr );
-  bdestroy( bfltr );
-  bstrListDestroy( fltTxt );
   return -1;
-} /* bstrlib_extract_array() */
+
+} /* bstrlib_index_extract_param() */
+
+/***********************************************************************
+* Indexed version of bstrlib_extract_array().
+* In contrast to the linear search, the specifier must be located 
+* at the beginning of a line.
+***********************************************************************/
+int bstrlib_index_extract_array(const bstrIndex *index,
+                                const char *fltr, int type,
+                                void *value)
+{
+  int line   = 0;
+  int nfound = bstrlib_index_find(index, fltr, &line);
+
+  if (nfound < 1)
+    return 0;
+
+  check( extract_array_from_line(index->txtlist->entry[line], 
+                                 fltr, type, value),
+      "Failed to extract array %s.", fltr );
+
+  return nfound;
+
+error:
+  return -1;
+
+} /* bstrlib_index_extract_array() */
@@ -10,6 +10,32 @@
 
 #include "bstrlib.h"
 
+/***********************************************************************
+* Keyword index of a bstrList. 
+* Every line, that starts with a keyword (i.e. its first non-blank 
+* character is a letter or '_'), is stored in a hash table with its 
+* leading token as key. Lines with equal tokens are chained, such that
+* a specifier is found in O(1) instead of a search over all lines.
+* The index only references the lines of <txtlist>, which must 
+* therefore outlive the index.
+***********************************************************************/
+struct bstrIndex;
+typedef struct bstrIndex {
+  struct bstrList *txtlist;  /* Indexed list of lines              */
+
+  int  n_keys;               /* Number of indexed keyword lines    */
+  int *key_line;             /* Line index of every keyword line   */
+  int *key_off;              /* Offset of keyword in its line      */
+  int *key_len;              /* Length of leading keyword token    */
+  int *key_prev;             /* Previous keyword line with the     */
+                             /* same token, -1 for the first one   */
+
+  int  n_slots;              /* Number of hash slots (power of 2)  */
+  int *slots;                /* Hash slots -> last keyword line    */
+                             /* with the respective token, or -1   */
+
+} bstrIndex;
+
 /***********************************************************************
 * Function returns a bstring list of lines, that 
 * do not contain a certain specifier
@@ -61,4 +87,43 @@ int bstrlib_extract_array(struct bstrList *txtlist,
                           const char *fltr, int type,
                           void *value);
 
+/***********************************************************************
+* Function creates a keyword index for a bstrList in a single 
+* pass over all lines
+***********************************************************************/
+bstrIndex *bstrlib_index_create(struct bstrList *txtlist);
+
+/***********************************************************************
+* Function destroys a keyword index 
+***********************************************************************/
+void bstrlib_index_destroy(bstrIndex *index);
+
+/***********************************************************************
+* Function searches for lines, which start with the specifier <fltr>.
+* The line index of the last of these lines is stored in <line>.
+*
+* Returns the number of lines starting with the specifier or 0 if 
+* it was not found.
+***********************************************************************/
+int bstrlib_index_find(const bstrIndex *index, const char *fltr,
+                       int *line);
+
+/***********************************************************************
+* Indexed version of bstrlib_extract_param().
+* In contrast to the linear search, the specifier must be located 
+* at the beginning of a line.
+***********************************************************************/
+int bstrlib_index_extract_param(const bstrIndex *index,
+                                const char *fltr, int type,
+                                void *value);
+
+/***********************************************************************
+* Indexed version of bstrlib_extract_array().
+* In contrast to the linear search, the specifier must be located 
+* at the beginning of a line.
+***********************************************************************/
+int bstrlib_index_extract_array(const bstrIndex *index,
+                                const char *fltr, int type,
+                                void *value);
+
 #endif /* BSTRLIB_WRAPPER_H */